@@ -390,6 +390,8 @@ static gboolean
 gst_dash_demux_stream_advance_subfragment (GstAdaptiveDemuxStream * stream);
 static gboolean gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
+static void gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream, GArray * bitrates);
 static gint64 gst_dash_demux_get_manifest_update_interval (GstAdaptiveDemux *
     demux);
 static GstFlowReturn gst_dash_demux_update_manifest_data (GstAdaptiveDemux *
@@ -635,6 +637,8 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
   gstadaptivedemux_class->stream_seek = gst_dash_demux_stream_seek;
   gstadaptivedemux_class->stream_select_bitrate =
       gst_dash_demux_stream_select_bitrate;
+  gstadaptivedemux_class->stream_get_bitrates =
+      gst_dash_demux_stream_get_bitrates;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
@@ -2159,6 +2163,26 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
   return ret;
 }
 
+static void
+gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream,
+    GArray * bitrates)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstActiveStream *active_stream = dashstream->active_stream;
+  GList *iter;
+
+  if (active_stream == NULL || active_stream->cur_adapt_set == NULL)
+    return;
+
+  for (iter = active_stream->cur_adapt_set->Representations; iter;
+      iter = g_list_next (iter)) {
+    GstRepresentationNode *rep = iter->data;
+    guint64 bitrate = rep->bandwidth;
+
+    g_array_append_val (bitrates, bitrate);
+  }
+}
+
 static gboolean
 gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
@@ -107,8 +107,12 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static GstFlowReturn gst_hls_demux_peek_fragment_info (GstAdaptiveDemuxStream *
+    stream, guint distance, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
+static void gst_hls_demux_get_bitrates (GstAdaptiveDemuxStream * stream,
+    GArray * bitrates);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
 static gboolean gst_hls_demux_get_live_seek_range (GstAdaptiveDemux * demux,
     gint64 * start, gint64 * stop);
@@ -174,7 +178,10 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment_info =
+      gst_hls_demux_peek_fragment_info;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
+  adaptivedemux_class->stream_get_bitrates = gst_hls_demux_get_bitrates;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
   adaptivedemux_class->start_fragment = gst_hls_demux_start_fragment;
@@ -1124,6 +1131,34 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static GstFlowReturn
+gst_hls_demux_peek_fragment_info (GstAdaptiveDemuxStream * stream,
+    guint distance, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstHLSDemuxStream *hlsdemux_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (hlsdemux_stream);
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0,
+      distance);
+  if (file == NULL)
+    return GST_FLOW_EOS;
+
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return GST_FLOW_OK;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1153,6 +1188,34 @@ gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
   return changed;
 }
 
+static void
+gst_hls_demux_get_bitrates (GstAdaptiveDemuxStream * stream, GArray * bitrates)
+{
+  GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (stream->demux);
+  GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GList *l;
+
+  /* only the primary stream switches variants */
+  if (hls_stream->is_primary_playlist == FALSE)
+    return;
+
+  GST_M3U8_CLIENT_LOCK (hlsdemux->client);
+  if (hlsdemux->master != NULL && !hlsdemux->master->is_simple) {
+    if (hlsdemux->current_variant != NULL && hlsdemux->current_variant->iframe)
+      l = hlsdemux->master->iframe_variants;
+    else
+      l = hlsdemux->master->variants;
+
+    for (; l != NULL; l = l->next) {
+      GstHLSVariantStream *variant = l->data;
+      guint64 bitrate = variant->bandwidth;
+
+      g_array_append_val (bitrates, bitrate);
+    }
+  }
+  GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
+}
+
 static void
 gst_hls_demux_reset (GstAdaptiveDemux * ademux)
 {
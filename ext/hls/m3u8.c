@@ -1013,6 +1013,33 @@ out:
   GST_M3U8_UNLOCK (m3u8);
 }
 
+/* Returns the fragment @distance fragments after the current one, without
+ * advancing to it */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint distance)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *l;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  l = m3u8->current_file;
+  if (l == NULL)
+    l = m3u8_find_next_fragment (m3u8, forward);
+
+  for (; l != NULL && distance > 0; distance--)
+    l = forward ? l->next : l->prev;
+
+  if (l != NULL)
+    file = gst_m3u8_media_file_ref (l->data);
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 GstClockTime
 gst_m3u8_get_duration (GstM3U8 * m3u8)
 {
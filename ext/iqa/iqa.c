@@ -357,6 +357,8 @@ gst_iqa_class_init (GstIqaClass * klass)
       (GstVideoAggregatorClass *) klass;
 
   videoaggregator_class->aggregate_frames = gst_iqa_aggregate_frames;
+  /* The default conversion of the pads doesn't share any state */
+  videoaggregator_class->parallel_prepare_frames = TRUE;
 
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
@@ -130,6 +130,8 @@ static GstFlowReturn
 gst_mss_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream);
 static gboolean gst_mss_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
+static void gst_mss_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream, GArray * bitrates);
 static GstFlowReturn
 gst_mss_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream);
 static gboolean gst_mss_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek);
@@ -197,6 +199,8 @@ gst_mss_demux_class_init (GstMssDemuxClass * klass)
       gst_mss_demux_stream_has_next_fragment;
   gstadaptivedemux_class->stream_select_bitrate =
       gst_mss_demux_stream_select_bitrate;
+  gstadaptivedemux_class->stream_get_bitrates =
+      gst_mss_demux_stream_get_bitrates;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_mss_demux_stream_update_fragment_info;
   gstadaptivedemux_class->stream_get_fragment_waiting_time =
@@ -547,6 +551,15 @@ gst_mss_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
   return gst_mss_demux_setup_streams (demux);
 }
 
+static void
+gst_mss_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream,
+    GArray * bitrates)
+{
+  GstMssDemuxStream *mssstream = (GstMssDemuxStream *) stream;
+
+  gst_mss_stream_get_bitrates (mssstream->manifest_stream, bitrates);
+}
+
 static gboolean
 gst_mss_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
@@ -1407,7 +1407,7 @@ gst_mss_stream_select_bitrate (GstMssStream * stream, guint64 bitrate)
     next = g_list_next (iter);
     if (next) {
       next_q = next->data;
-      if (next_q->bitrate < bitrate) {
+      if (next_q->bitrate <= bitrate) {
         iter = next;
         q = iter->data;
       } else {
@@ -1435,6 +1435,18 @@ gst_mss_stream_get_current_bitrate (GstMssStream * stream)
   return q->bitrate;
 }
 
+void
+gst_mss_stream_get_bitrates (GstMssStream * stream, GArray * bitrates)
+{
+  GList *iter;
+
+  for (iter = stream->qualities; iter; iter = g_list_next (iter)) {
+    GstMssStreamQuality *q = iter->data;
+
+    g_array_append_val (bitrates, q->bitrate);
+  }
+}
+
 /**
  * gst_mss_manifest_change_bitrate:
  * @manifest: the manifest
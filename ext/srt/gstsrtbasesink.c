@@ -214,6 +214,13 @@ gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
       GST_TIME_ARGS (GST_BUFFER_DURATION (buffer)),
       gst_buffer_get_size (buffer));
 
+  if (bclass->queue_buffer) {
+    if (!bclass->queue_buffer (self, buffer))
+      ret = GST_FLOW_ERROR;
+
+    return ret;
+  }
+
   if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
     GST_ELEMENT_ERROR (self, RESOURCE, READ,
         ("Could not map the input stream"), (NULL));
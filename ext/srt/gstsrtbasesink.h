@@ -60,7 +60,11 @@ struct _GstSRTBaseSinkClass {
   /* ask the subclass to send a buffer */
   gboolean (*send_buffer)       (GstSRTBaseSink *self, const GstMapInfo *mapinfo);
 
-  gpointer _gst_reserved[GST_PADDING_LARGE];
+  /* ask the subclass to queue a buffer for sending, it may keep a reference
+   * to it. Used instead of send_buffer if set */
+  gboolean (*queue_buffer)      (GstSRTBaseSink *self, GstBuffer *buffer);
+
+  gpointer _gst_reserved[GST_PADDING_LARGE - 1];
 };
 
 GST_EXPORT
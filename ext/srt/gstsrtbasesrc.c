@@ -37,6 +37,8 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_BATCH_SIZE,
+  PROP_MERGE,
 
   /*< private > */
   PROP_LAST
@@ -44,6 +46,9 @@ enum
 
 static GParamSpec *properties[PROP_LAST];
 
+#define DEFAULT_BATCH_SIZE 64
+#define DEFAULT_MERGE FALSE
+
 static void gst_srt_base_src_uri_handler_init (gpointer g_iface,
     gpointer iface_data);
 static gchar *gst_srt_base_src_uri_get_uri (GstURIHandler * handler);
@@ -84,6 +89,16 @@ gst_srt_base_src_get_property (GObject * object,
     case PROP_KEY_LENGTH:
       g_value_set_int (value, self->key_length);
       break;
+    case PROP_BATCH_SIZE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->batch_size);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MERGE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->merge);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -122,6 +137,16 @@ gst_srt_base_src_set_property (GObject * object,
       self->key_length = key_length;
       break;
     }
+    case PROP_BATCH_SIZE:
+      GST_OBJECT_LOCK (self);
+      self->batch_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MERGE:
+      GST_OBJECT_LOCK (self);
+      self->merge = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -140,6 +165,203 @@ gst_srt_base_src_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static gboolean
+gst_srt_base_src_stop (GstBaseSrc * src)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+
+  if (self->pool) {
+    gst_buffer_pool_set_active (self->pool, FALSE);
+    g_clear_object (&self->pool);
+  }
+  self->pool_size = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gst_srt_base_src_ensure_pool (GstSRTBaseSrc * self, gsize size,
+    guint min_buffers)
+{
+  GstStructure *config;
+
+  if (self->pool && self->pool_size == size)
+    return TRUE;
+
+  if (self->pool) {
+    gst_buffer_pool_set_active (self->pool, FALSE);
+    gst_object_unref (self->pool);
+  }
+
+  GST_DEBUG_OBJECT (self, "new pool of %u buffers of %" G_GSIZE_FORMAT
+      " bytes", min_buffers, size);
+
+  self->pool = gst_buffer_pool_new ();
+  self->pool_size = size;
+
+  config = gst_buffer_pool_get_config (self->pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, min_buffers, 0);
+  if (!gst_buffer_pool_set_config (self->pool, config) ||
+      !gst_buffer_pool_set_active (self->pool, TRUE)) {
+    g_clear_object (&self->pool);
+    self->pool_size = 0;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * gst_srt_base_src_receive:
+ * @self: a #GstSRTBaseSrc
+ * @sock: the socket to receive from
+ * @outbuf: (out): the received data
+ * @n_messages: (out): the number of messages received, 0 at the end of
+ *   the stream or SRT_ERROR if the first message could not be received
+ *
+ * Receives the first message from @sock, blocking if it is a blocking
+ * socket, and then the messages that are already waiting, up to
+ * #GstSRTBaseSrc:batch-size messages. The buffers come from a pool.
+ *
+ * With #GstSRTBaseSrc:merge, all messages are stored one after the other
+ * in @outbuf. Otherwise, if there is more than one message, they are
+ * submitted as a buffer list and @outbuf is set to %NULL. This is meant
+ * to be called from the create function of subclasses.
+ *
+ * Returns: %GST_FLOW_OK unless no buffer could be acquired from the pool
+ */
+GstFlowReturn
+gst_srt_base_src_receive (GstSRTBaseSrc * self, SRTSOCKET sock,
+    GstBuffer ** outbuf, gint * n_messages)
+{
+  GstBaseSrc *src = GST_BASE_SRC (self);
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferList *list = NULL;
+  GstBuffer *buffer = NULL;
+  GstClockTime pts = GST_CLOCK_TIME_NONE;
+  GstMapInfo info;
+  gsize offset = 0;
+  guint blocksize, batch_size, i;
+  gboolean merge, nonblocking = FALSE;
+  gint len;
+
+  *outbuf = NULL;
+  *n_messages = 0;
+
+  GST_OBJECT_LOCK (self);
+  batch_size = self->batch_size;
+  merge = self->merge;
+  GST_OBJECT_UNLOCK (self);
+
+  /* Like the default of basesrc, every message gets blocksize bytes */
+  blocksize = gst_base_src_get_blocksize (src);
+
+  if (!gst_srt_base_src_ensure_pool (self,
+          merge ? (gsize) blocksize * batch_size : blocksize,
+          merge ? 2 : batch_size)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, FAILED,
+        ("Failed to configure the buffer pool"), (NULL));
+    return GST_FLOW_ERROR;
+  }
+
+  if (!merge && batch_size > 1)
+    list = gst_buffer_list_new_sized (batch_size);
+
+  for (i = 0; i < batch_size; i++) {
+    if (!buffer) {
+      ret = gst_buffer_pool_acquire_buffer (self->pool, &buffer, NULL);
+      if (ret != GST_FLOW_OK)
+        break;
+
+      if (!gst_buffer_map (buffer, &info, GST_MAP_WRITE)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Could not map the buffer for writing "), (NULL));
+        gst_buffer_unref (buffer);
+        buffer = NULL;
+        ret = GST_FLOW_ERROR;
+        break;
+      }
+    }
+
+    /* Only wait for the first message */
+    if (i == 1) {
+      srt_setsockopt (sock, 0, SRTO_RCVSYN, &(int) {
+          0}, sizeof (int));
+      nonblocking = TRUE;
+    }
+
+    len = srt_recvmsg (sock, (char *) info.data + offset, info.size - offset);
+    if (len == SRT_ERROR || len == 0) {
+      if (i == 0)
+        *n_messages = len;
+      else
+        srt_clearlasterror ();
+      break;
+    }
+
+    /* Arrival time of the first message */
+    if (i == 0 && GST_ELEMENT_CLOCK (self)) {
+      pts = gst_clock_get_time (GST_ELEMENT_CLOCK (self)) -
+          GST_ELEMENT_CAST (self)->base_time;
+    }
+
+    (*n_messages)++;
+    offset += len;
+
+    if (!merge) {
+      gst_buffer_unmap (buffer, &info);
+      gst_buffer_resize (buffer, 0, offset);
+      GST_BUFFER_PTS (buffer) = pts;
+      offset = 0;
+
+      if (list)
+        gst_buffer_list_add (list, buffer);
+      else
+        *outbuf = buffer;
+      buffer = NULL;
+    }
+  }
+
+  if (nonblocking) {
+    srt_setsockopt (sock, 0, SRTO_RCVSYN, &(int) {
+        1}, sizeof (int));
+  }
+
+  if (buffer) {
+    gst_buffer_unmap (buffer, &info);
+    if (offset > 0) {
+      gst_buffer_resize (buffer, 0, offset);
+      GST_BUFFER_PTS (buffer) = pts;
+      *outbuf = buffer;
+    } else {
+      gst_buffer_unref (buffer);
+    }
+  }
+
+  if (list) {
+    guint length = gst_buffer_list_length (list);
+
+    if (ret != GST_FLOW_OK || length == 0) {
+      gst_buffer_list_unref (list);
+    } else if (length == 1) {
+      *outbuf = gst_buffer_ref (gst_buffer_list_get (list, 0));
+      gst_buffer_list_unref (list);
+    } else {
+      gst_base_src_submit_buffer_list (src, list);
+    }
+  }
+
+  if (ret != GST_FLOW_OK && *outbuf) {
+    gst_buffer_unref (*outbuf);
+    *outbuf = NULL;
+  }
+
+  GST_LOG_OBJECT (self, "received %d messages, %" G_GSIZE_FORMAT " bytes",
+      *n_messages, *outbuf ? gst_buffer_get_size (*outbuf) : 0);
+
+  return ret;
+}
+
 static GstCaps *
 gst_srt_base_src_get_caps (GstBaseSrc * src, GstCaps * filter)
 {
@@ -210,9 +432,34 @@ gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTBaseSrc:batch-size:
+   *
+   * The maximum number of SRT messages received at once. The messages
+   * waiting in the receive buffer are all read in one go, up to this
+   * number.
+   */
+  properties[PROP_BATCH_SIZE] =
+      g_param_spec_uint ("batch-size", "Batch size",
+      "Maximum number of messages received per wakeup", 1, 1024,
+      DEFAULT_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTBaseSrc:merge:
+   *
+   * Output the messages received at once in a single buffer instead of one
+   * buffer per message. This is fine for byte streams like MPEG-TS, but
+   * loses the message boundaries.
+   */
+  properties[PROP_MERGE] =
+      g_param_spec_boolean ("merge", "Merge",
+      "Output the messages received at once in a single buffer",
+      DEFAULT_MERGE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_srt_base_src_get_caps);
+  gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_base_src_stop);
 }
 
 static void
@@ -223,6 +470,8 @@ gst_srt_base_src_init (GstSRTBaseSrc * self)
   gst_base_src_set_live (GST_BASE_SRC (self), TRUE);
   self->latency = SRT_DEFAULT_LATENCY;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->merge = DEFAULT_MERGE;
 }
 
 static GstURIType
@@ -24,6 +24,8 @@
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
 
+#include <srt/srt.h>
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_SRT_BASE_SRC              (gst_srt_base_src_get_type ())
@@ -46,8 +48,13 @@ struct _GstSRTBaseSrc {
   gint latency;
   gchar *passphrase;
   gint key_length;
+  guint batch_size;
+  gboolean merge;
 
   /*< private >*/
+  GstBufferPool *pool;
+  gsize pool_size;
+
   gpointer _gst_reserved[GST_PADDING];
 };
 
@@ -60,6 +67,9 @@ struct _GstSRTBaseSrcClass {
 GST_EXPORT
 GType gst_srt_base_src_get_type (void);
 
+GstFlowReturn gst_srt_base_src_receive (GstSRTBaseSrc *self, SRTSOCKET sock,
+    GstBuffer **outbuf, gint *n_messages);
+
 G_END_DECLS
 
 #endif /* __GST_SRT_BASE_SRC_H__ */
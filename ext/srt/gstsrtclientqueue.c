@@ -0,0 +1,51 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsrtclientqueue.h"
+
+/* Queues a ref of @buffer at the tail of @queue, which holds at most
+ * @max_size buffers. Once it is full, @policy decides which buffer is
+ * dropped, @dropped is incremented for each of them. Returns FALSE if the
+ * queue is full and the client has to be disconnected, @queue is left as is
+ * then. */
+gboolean
+gst_srt_client_queue_push (GQueue * queue, guint max_size,
+    GstSRTServerSinkDropPolicy policy, GstBuffer * buffer, guint64 * dropped)
+{
+  if (g_queue_get_length (queue) >= max_size) {
+    switch (policy) {
+      case GST_SRT_SERVER_SINK_DROP_OLD:
+        gst_buffer_unref (g_queue_pop_head (queue));
+        break;
+      case GST_SRT_SERVER_SINK_DROP_NEW:
+        (*dropped)++;
+        return TRUE;
+      case GST_SRT_SERVER_SINK_DISCONNECT:
+        return FALSE;
+    }
+    (*dropped)++;
+  }
+
+  g_queue_push_tail (queue, gst_buffer_ref (buffer));
+
+  return TRUE;
+}
@@ -0,0 +1,45 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SRT_CLIENT_QUEUE_H__
+#define __GST_SRT_CLIENT_QUEUE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GstSRTServerSinkDropPolicy:
+ * @GST_SRT_SERVER_SINK_DROP_OLD: drop the oldest buffer of the client queue
+ * @GST_SRT_SERVER_SINK_DROP_NEW: drop the new buffer
+ * @GST_SRT_SERVER_SINK_DISCONNECT: disconnect the client
+ *
+ * What to do when the queue of a client is full.
+ */
+typedef enum {
+  GST_SRT_SERVER_SINK_DROP_OLD,
+  GST_SRT_SERVER_SINK_DROP_NEW,
+  GST_SRT_SERVER_SINK_DISCONNECT
+} GstSRTServerSinkDropPolicy;
+
+gboolean gst_srt_client_queue_push (GQueue * queue, guint max_size,
+    GstSRTServerSinkDropPolicy policy, GstBuffer * buffer, guint64 * dropped);
+
+G_END_DECLS
+
+#endif /* __GST_SRT_CLIENT_QUEUE_H__ */
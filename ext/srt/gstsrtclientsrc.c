@@ -166,14 +166,13 @@ gst_srt_client_src_finalize (GObject * object)
 }
 
 static GstFlowReturn
-gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
+gst_srt_client_src_create (GstPushSrc * src, GstBuffer ** outbuf)
 {
   GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
   GstFlowReturn ret = GST_FLOW_OK;
-  GstMapInfo info;
   SRTSOCKET ready[2];
-  gint recv_len;
+  gint n_messages;
 
   if (srt_epoll_wait (priv->poll_id, 0, 0, ready, &(int) {
           2}, priv->poll_timeout, 0, 0, 0, 0) == -1) {
@@ -183,48 +182,28 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
       GST_ELEMENT_ERROR (src, RESOURCE, READ,
           (NULL), ("srt_epoll_wait error: %s", srt_getlasterror_str ()));
       ret = GST_FLOW_ERROR;
+    } else {
+      *outbuf = gst_buffer_new ();
     }
     srt_clearlasterror ();
     goto out;
   }
 
-  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
-    GST_ELEMENT_ERROR (src, RESOURCE, READ,
-        ("Could not map the buffer for writing "), (NULL));
-    ret = GST_FLOW_ERROR;
+  ret = gst_srt_base_src_receive (GST_SRT_BASE_SRC (src), priv->sock, outbuf,
+      &n_messages);
+  if (ret != GST_FLOW_OK)
     goto out;
-  }
-
-  recv_len = srt_recvmsg (priv->sock, (char *) info.data,
-      gst_buffer_get_size (outbuf));
 
-  gst_buffer_unmap (outbuf, &info);
-
-  if (recv_len == SRT_ERROR) {
+  if (n_messages == SRT_ERROR) {
     GST_ELEMENT_ERROR (src, RESOURCE, READ,
         (NULL), ("srt_recvmsg error: %s", srt_getlasterror_str ()));
     ret = GST_FLOW_ERROR;
     goto out;
-  } else if (recv_len == 0) {
+  } else if (n_messages == 0) {
     ret = GST_FLOW_EOS;
     goto out;
   }
 
-  GST_BUFFER_PTS (outbuf) =
-      gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
-      GST_ELEMENT_CAST (src)->base_time;
-
-  gst_buffer_resize (outbuf, 0, recv_len);
-
-  GST_LOG_OBJECT (src,
-      "filled buffer from _get of size %" G_GSIZE_FORMAT ", ts %"
-      GST_TIME_FORMAT ", dur %" GST_TIME_FORMAT
-      ", offset %" G_GINT64_FORMAT ", offset_end %" G_GINT64_FORMAT,
-      gst_buffer_get_size (outbuf),
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)),
-      GST_TIME_ARGS (GST_BUFFER_DURATION (outbuf)),
-      GST_BUFFER_OFFSET (outbuf), GST_BUFFER_OFFSET_END (outbuf));
-
 out:
   return ret;
 }
@@ -267,7 +246,7 @@ gst_srt_client_src_stop (GstBaseSrc * src)
     srt_close (priv->sock);
   priv->sock = SRT_INVALID_SOCK;
 
-  return TRUE;
+  return GST_BASE_SRC_CLASS (parent_class)->stop (src);
 }
 
 static void
@@ -320,7 +299,7 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_srt_client_src_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_client_src_stop);
 
-  gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_client_src_fill);
+  gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_srt_client_src_create);
 }
 
 static void
@@ -32,6 +32,14 @@
  * gst-launch-1.0 -v audiotestsrc ! srtserversink
  * ]| This pipeline shows how to serve SRT packets through the default port.
  * </refsect2>
+ *
+ * Each client has its own queue of at most #GstSRTServerSink:client-queue-size
+ * buffers. Buffers are sent right away to the clients that can take them,
+ * the ones whose send buffer is full get their queue drained by a separate
+ * thread once they can take more data, so that a slow client does not hold
+ * back the others. #GstSRTServerSink:drop-policy selects what happens when a
+ * queue is full. The per-client #GstSRTServerSink:stats contain the queue
+ * depth and the number of dropped buffers in addition to the SRT statistics.
  * 
  */
 
@@ -45,6 +53,11 @@
 #include <gio/gio.h>
 
 #define SRT_DEFAULT_POLL_TIMEOUT -1
+#define DEFAULT_CLIENT_QUEUE_SIZE 1000
+#define DEFAULT_DROP_POLICY GST_SRT_SERVER_SINK_DROP_OLD
+
+/* How often the send thread checks whether it has to stop */
+#define SEND_POLL_TIMEOUT 100
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -68,6 +81,17 @@ struct _GstSRTServerSinkPrivate
   GThread *thread;
 
   GList *clients;
+
+  guint client_queue_size;
+  GstSRTServerSinkDropPolicy drop_policy;
+
+  /* Clients that could not take all buffers are in send_poll_id until
+   * send_thread drained their queue. Protected by the object lock */
+  gint send_poll_id;
+  GThread *send_thread;
+  GCond send_cond;
+  guint n_blocked;
+  gboolean stopping;
 };
 
 #define GST_SRT_SERVER_SINK_GET_PRIVATE(obj)  \
@@ -77,6 +101,8 @@ enum
 {
   PROP_POLL_TIMEOUT = 1,
   PROP_STATS,
+  PROP_CLIENT_QUEUE_SIZE,
+  PROP_DROP_POLICY,
   /*< private > */
   PROP_LAST
 };
@@ -99,11 +125,37 @@ G_DEFINE_TYPE_WITH_CODE (GstSRTServerSink, gst_srt_server_sink,
     GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtserversink", 0,
         "SRT Server Sink"));
 
+#define GST_TYPE_SRT_SERVER_SINK_DROP_POLICY \
+    (gst_srt_server_sink_drop_policy_get_type ())
+static GType
+gst_srt_server_sink_drop_policy_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_SRT_SERVER_SINK_DROP_OLD, "Drop the oldest queued buffer",
+        "drop-old"},
+    {GST_SRT_SERVER_SINK_DROP_NEW, "Drop the new buffer", "drop-new"},
+    {GST_SRT_SERVER_SINK_DISCONNECT, "Disconnect the client", "disconnect"},
+    {0, NULL, NULL}
+  };
+
+  if (!type)
+    type = g_enum_register_static ("GstSRTServerSinkDropPolicy", values);
+
+  return type;
+}
+
 typedef struct
 {
   int sock;
   GSocketAddress *sockaddr;
   gboolean sent_headers;
+
+  /* Buffers not sent yet, protected by the object lock */
+  GQueue queue;
+  gboolean blocked;
+  guint64 buffers_sent;
+  guint64 buffers_dropped;
 } SRTClient;
 
 static SRTClient *
@@ -111,16 +163,22 @@ srt_client_new (void)
 {
   SRTClient *client = g_new0 (SRTClient, 1);
   client->sock = SRT_INVALID_SOCK;
+  g_queue_init (&client->queue);
   return client;
 }
 
 static void
 srt_client_free (SRTClient * client)
 {
+  GstBuffer *buffer;
+
   g_return_if_fail (client != NULL);
 
   g_clear_object (&client->sockaddr);
 
+  while ((buffer = g_queue_pop_head (&client->queue)))
+    gst_buffer_unref (buffer);
+
   if (client->sock != SRT_INVALID_SOCK) {
     srt_close (client->sock);
   }
@@ -138,6 +196,105 @@ srt_emit_client_removed (SRTClient * client, gpointer user_data)
       client->sockaddr);
 }
 
+/* Called with the object lock */
+static void
+srt_client_set_blocked (GstSRTServerSink * self, SRTClient * client,
+    gboolean blocked)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  if (client->blocked == blocked)
+    return;
+
+  client->blocked = blocked;
+  if (blocked) {
+    srt_epoll_add_usock (priv->send_poll_id, client->sock, &(int) {
+        SRT_EPOLL_OUT | SRT_EPOLL_ERR});
+    priv->n_blocked++;
+    g_cond_signal (&priv->send_cond);
+  } else {
+    srt_epoll_remove_usock (priv->send_poll_id, client->sock);
+    priv->n_blocked--;
+  }
+}
+
+/* Sends the queued buffers of @client until its send buffer is full. Returns
+ * FALSE if the client has to be removed. Called with the object lock. */
+static gboolean
+srt_client_flush (GstSRTServerSink * self, SRTClient * client)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_peek_head (&client->queue))) {
+    GstMapInfo info;
+    int ret;
+
+    if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+      GST_WARNING_OBJECT (self, "Could not map buffer %" GST_PTR_FORMAT,
+          buffer);
+      return FALSE;
+    }
+
+    ret = srt_sendmsg2 (client->sock, (char *) info.data, info.size, 0);
+    gst_buffer_unmap (buffer, &info);
+
+    if (ret == SRT_ERROR) {
+      if (srt_getlasterror (NULL) == SRT_EASYNCSND) {
+        srt_clearlasterror ();
+        srt_client_set_blocked (self, client, TRUE);
+        return TRUE;
+      }
+
+      GST_WARNING_OBJECT (self, "%s", srt_getlasterror_str ());
+      return FALSE;
+    }
+
+    g_queue_pop_head (&client->queue);
+    gst_buffer_unref (buffer);
+    client->buffers_sent++;
+  }
+
+  srt_client_set_blocked (self, client, FALSE);
+
+  return TRUE;
+}
+
+/* Returns FALSE if the client has to be removed. Called with the object
+ * lock. */
+static gboolean
+srt_client_queue_buffer (GstSRTServerSink * self, SRTClient * client,
+    GstBuffer * buffer)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  if (!gst_srt_client_queue_push (&client->queue, priv->client_queue_size,
+          priv->drop_policy, buffer, &client->buffers_dropped)) {
+    GST_WARNING_OBJECT (self, "queue of client %d is full, disconnecting",
+        client->sock);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Called with the object lock, the client has to be passed to
+ * srt_clients_removed() after releasing it */
+static void
+srt_client_remove (GstSRTServerSink * self, SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  priv->clients = g_list_remove (priv->clients, client);
+  srt_client_set_blocked (self, client, FALSE);
+}
+
+static void
+srt_clients_removed (GstSRTServerSink * self, GList * clients)
+{
+  g_list_foreach (clients, (GFunc) srt_emit_client_removed, self);
+  g_list_free_full (clients, (GDestroyNotify) srt_client_free);
+}
+
 static void
 gst_srt_server_sink_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
@@ -149,6 +306,16 @@ gst_srt_server_sink_get_property (GObject * object,
     case PROP_POLL_TIMEOUT:
       g_value_set_int (value, priv->poll_timeout);
       break;
+    case PROP_CLIENT_QUEUE_SIZE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, priv->client_queue_size);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_DROP_POLICY:
+      GST_OBJECT_LOCK (self);
+      g_value_set_enum (value, priv->drop_policy);
+      GST_OBJECT_UNLOCK (self);
+      break;
     case PROP_STATS:
     {
       GList *item;
@@ -157,10 +324,16 @@ gst_srt_server_sink_get_property (GObject * object,
       for (item = priv->clients; item; item = item->next) {
         SRTClient *client = item->data;
         GValue tmp = G_VALUE_INIT;
+        GstStructure *s;
+
+        s = gst_srt_base_sink_get_stats (client->sockaddr, client->sock);
+        gst_structure_set (s,
+            "queue-depth", G_TYPE_UINT, g_queue_get_length (&client->queue),
+            "buffers-sent", G_TYPE_UINT64, client->buffers_sent,
+            "buffers-dropped", G_TYPE_UINT64, client->buffers_dropped, NULL);
 
         g_value_init (&tmp, GST_TYPE_STRUCTURE);
-        g_value_take_boxed (&tmp, gst_srt_base_sink_get_stats (client->sockaddr,
-                client->sock));
+        g_value_take_boxed (&tmp, s);
         gst_value_array_append_and_take_value (value, &tmp);
       }
       GST_OBJECT_UNLOCK (self);
@@ -183,6 +356,16 @@ gst_srt_server_sink_set_property (GObject * object,
     case PROP_POLL_TIMEOUT:
       priv->poll_timeout = g_value_get_int (value);
       break;
+    case PROP_CLIENT_QUEUE_SIZE:
+      GST_OBJECT_LOCK (self);
+      priv->client_queue_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_DROP_POLICY:
+      GST_OBJECT_LOCK (self);
+      priv->drop_policy = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -257,6 +440,72 @@ thread_func (gpointer data)
   return NULL;
 }
 
+/* Drains the queues of the clients whose send buffer was full, as soon as
+ * they can take more data */
+static gpointer
+send_thread_func (gpointer data)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (data);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  SRTSOCKET *ready = NULL;
+  guint n_alloc = 0;
+
+  GST_OBJECT_LOCK (self);
+  while (!priv->stopping) {
+    GList *removed = NULL;
+    int n_ready;
+    guint i;
+
+    if (priv->n_blocked == 0) {
+      g_cond_wait (&priv->send_cond, GST_OBJECT_GET_LOCK (self));
+      continue;
+    }
+
+    if (n_alloc < priv->n_blocked) {
+      n_alloc = priv->n_blocked;
+      ready = g_renew (SRTSOCKET, ready, n_alloc);
+    }
+    n_ready = n_alloc;
+    GST_OBJECT_UNLOCK (self);
+
+    if (srt_epoll_wait (priv->send_poll_id, 0, 0, ready, &n_ready,
+            SEND_POLL_TIMEOUT, 0, 0, 0, 0) == -1) {
+      /* Timed out, or all sockets were removed from the poll meanwhile */
+      srt_clearlasterror ();
+      n_ready = 0;
+    }
+
+    GST_OBJECT_LOCK (self);
+    for (i = 0; i < MIN ((guint) n_ready, n_alloc); i++) {
+      GList *item;
+
+      for (item = priv->clients; item; item = item->next) {
+        SRTClient *client = item->data;
+
+        if (client->sock != ready[i] || !client->blocked)
+          continue;
+
+        if (!srt_client_flush (self, client)) {
+          srt_client_remove (self, client);
+          removed = g_list_prepend (removed, client);
+        }
+        break;
+      }
+    }
+
+    if (removed) {
+      GST_OBJECT_UNLOCK (self);
+      srt_clients_removed (self, removed);
+      GST_OBJECT_LOCK (self);
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  g_free (ready);
+
+  return NULL;
+}
+
 static gboolean
 gst_srt_server_sink_start (GstBaseSink * sink)
 {
@@ -361,10 +610,19 @@ gst_srt_server_sink_start (GstBaseSink * sink)
   g_source_attach (priv->server_source, priv->context);
   priv->loop = g_main_loop_new (priv->context, TRUE);
 
+  priv->send_poll_id = srt_epoll_create ();
+  priv->n_blocked = 0;
+  priv->stopping = FALSE;
+
   priv->thread = g_thread_try_new ("srtserversink", thread_func, self, &error);
+  if (error == NULL) {
+    priv->send_thread = g_thread_try_new ("srtserversink-send",
+        send_thread_func, self, &error);
+  }
   if (error != NULL) {
     GST_WARNING_OBJECT (self, "failed to create thread (reason: %s)",
         error->message);
+    g_clear_error (&error);
     ret = FALSE;
   }
 
@@ -392,55 +650,48 @@ failed:
 }
 
 static gboolean
-send_buffer_internal (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo, gpointer user_data)
-{
-  SRTClient *client = user_data;
-
-  if (srt_sendmsg2 (client->sock, (char *) mapinfo->data, mapinfo->size,
-          0) == SRT_ERROR) {
-    GST_WARNING_OBJECT (sink, "%s", srt_getlasterror_str ());
-    return FALSE;
-  }
-
-  return TRUE;
-}
-
-static gboolean
-gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo)
+gst_srt_server_sink_queue_buffer (GstSRTBaseSink * sink, GstBuffer * buffer)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
-  GList *clients = priv->clients;
+  GList *clients, *removed = NULL;
 
   GST_OBJECT_LOCK (sink);
+  clients = priv->clients;
   while (clients != NULL) {
     SRTClient *client = clients->data;
     clients = clients->next;
 
     if (!client->sent_headers) {
-      if (!gst_srt_base_sink_send_headers (sink, send_buffer_internal, client))
-        goto err;
+      guint i, size;
+
+      size = sink->headers ? gst_buffer_list_length (sink->headers) : 0;
+      GST_DEBUG_OBJECT (self, "Queueing %u stream headers", size);
+      for (i = 0; i < size; i++) {
+        g_queue_push_tail (&client->queue,
+            gst_buffer_ref (gst_buffer_list_get (sink->headers, i)));
+      }
 
       client->sent_headers = TRUE;
     }
 
-    if (!send_buffer_internal (sink, mapinfo, client))
+    if (!srt_client_queue_buffer (self, client, buffer))
+      goto err;
+
+    /* Otherwise the send thread waits for it to take more data */
+    if (!client->blocked && !srt_client_flush (self, client))
       goto err;
 
     continue;
 
   err:
-    priv->clients = g_list_remove (priv->clients, client);
-    GST_OBJECT_UNLOCK (sink);
-    g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
-        client->sockaddr);
-    srt_client_free (client);
-    GST_OBJECT_LOCK (sink);
+    srt_client_remove (self, client);
+    removed = g_list_prepend (removed, client);
   }
   GST_OBJECT_UNLOCK (sink);
 
+  srt_clients_removed (self, removed);
+
   return TRUE;
 }
 
@@ -451,15 +702,28 @@ gst_srt_server_sink_stop (GstBaseSink * sink)
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   GList *clients;
 
+  GST_DEBUG_OBJECT (self, "stopping send thread");
+
+  GST_OBJECT_LOCK (sink);
+  priv->stopping = TRUE;
+  g_cond_signal (&priv->send_cond);
+  GST_OBJECT_UNLOCK (sink);
+
+  if (priv->send_thread) {
+    g_thread_join (priv->send_thread);
+    priv->send_thread = NULL;
+  }
+
   GST_DEBUG_OBJECT (self, "closing client sockets");
 
   GST_OBJECT_LOCK (sink);
   clients = priv->clients;
   priv->clients = NULL;
+  priv->n_blocked = 0;
   GST_OBJECT_UNLOCK (sink);
 
-  g_list_foreach (clients, (GFunc) srt_emit_client_removed, self);
-  g_list_free_full (clients, (GDestroyNotify) srt_client_free);
+  srt_epoll_release (priv->send_poll_id);
+  srt_clients_removed (self, clients);
 
   GST_DEBUG_OBJECT (self, "closing SRT connection");
   srt_epoll_remove_usock (priv->poll_id, priv->sock);
@@ -505,6 +769,17 @@ gst_srt_server_sink_unlock_stop (GstBaseSink * sink)
   return TRUE;
 }
 
+static void
+gst_srt_server_sink_finalize (GObject * object)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (object);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  g_cond_clear (&priv->send_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
 {
@@ -515,6 +790,7 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
 
   gobject_class->set_property = gst_srt_server_sink_set_property;
   gobject_class->get_property = gst_srt_server_sink_get_property;
+  gobject_class->finalize = gst_srt_server_sink_finalize;
 
   properties[PROP_POLL_TIMEOUT] =
       g_param_spec_int ("poll-timeout", "Poll Timeout",
@@ -529,6 +805,17 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS),
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_CLIENT_QUEUE_SIZE] =
+      g_param_spec_uint ("client-queue-size", "Client queue size",
+      "Maximum number of buffers queued for a client", 1, G_MAXUINT,
+      DEFAULT_CLIENT_QUEUE_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_DROP_POLICY] =
+      g_param_spec_enum ("drop-policy", "Drop policy",
+      "What to do when the queue of a client is full",
+      GST_TYPE_SRT_SERVER_SINK_DROP_POLICY, DEFAULT_DROP_POLICY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   /**
@@ -573,8 +860,8 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
   gstbasesink_class->unlock_stop =
       GST_DEBUG_FUNCPTR (gst_srt_server_sink_unlock_stop);
 
-  gstsrtbasesink_class->send_buffer =
-      GST_DEBUG_FUNCPTR (gst_srt_server_sink_send_buffer);
+  gstsrtbasesink_class->queue_buffer =
+      GST_DEBUG_FUNCPTR (gst_srt_server_sink_queue_buffer);
 }
 
 static void
@@ -582,4 +869,7 @@ gst_srt_server_sink_init (GstSRTServerSink * self)
 {
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
+  priv->client_queue_size = DEFAULT_CLIENT_QUEUE_SIZE;
+  priv->drop_policy = DEFAULT_DROP_POLICY;
+  g_cond_init (&priv->send_cond);
 }
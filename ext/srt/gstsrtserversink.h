@@ -22,6 +22,7 @@
 #define __GST_SRT_SERVER_SINK_H__
 
 #include "gstsrtbasesink.h"
+#include "gstsrtclientqueue.h"
 
 G_BEGIN_DECLS
 
@@ -149,14 +149,13 @@ gst_srt_server_src_finalize (GObject * object)
 }
 
 static GstFlowReturn
-gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
+gst_srt_server_src_create (GstPushSrc * src, GstBuffer ** outbuf)
 {
   GstSRTServerSrc *self = GST_SRT_SERVER_SRC (src);
   GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
   GstFlowReturn ret = GST_FLOW_OK;
-  GstMapInfo info;
   SRTSOCKET ready[2];
-  gint recv_len;
+  gint n_messages;
   struct sockaddr client_sa;
   size_t client_sa_len;
 
@@ -207,21 +206,14 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     }
   }
 
-  GST_DEBUG_OBJECT (self, "filling buffer");
+  GST_DEBUG_OBJECT (self, "receiving");
 
-  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
-    GST_ELEMENT_ERROR (src, RESOURCE, WRITE,
-        ("Could not map the output stream"), (NULL));
-    ret = GST_FLOW_ERROR;
+  ret = gst_srt_base_src_receive (GST_SRT_BASE_SRC (src), priv->client_sock,
+      outbuf, &n_messages);
+  if (ret != GST_FLOW_OK)
     goto out;
-  }
-
-  recv_len = srt_recvmsg (priv->client_sock, (char *) info.data,
-      gst_buffer_get_size (outbuf));
 
-  gst_buffer_unmap (outbuf, &info);
-
-  if (recv_len == SRT_ERROR) {
+  if (n_messages == SRT_ERROR) {
     GST_WARNING_OBJECT (self, "%s", srt_getlasterror_str ());
 
     g_signal_emit (self, signals[SIG_CLIENT_CLOSED], 0,
@@ -231,29 +223,14 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     priv->client_sock = SRT_INVALID_SOCK;
     g_clear_object (&priv->client_sockaddr);
     priv->has_client = FALSE;
-    gst_buffer_resize (outbuf, 0, 0);
+    *outbuf = gst_buffer_new ();
     ret = GST_FLOW_OK;
     goto out;
-  } else if (recv_len == 0) {
+  } else if (n_messages == 0) {
     ret = GST_FLOW_EOS;
     goto out;
   }
 
-  GST_BUFFER_PTS (outbuf) =
-      gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
-      GST_ELEMENT_CAST (src)->base_time;
-
-  gst_buffer_resize (outbuf, 0, recv_len);
-
-  GST_LOG_OBJECT (src,
-      "filled buffer from _get of size %" G_GSIZE_FORMAT ", ts %"
-      GST_TIME_FORMAT ", dur %" GST_TIME_FORMAT
-      ", offset %" G_GINT64_FORMAT ", offset_end %" G_GINT64_FORMAT,
-      gst_buffer_get_size (outbuf),
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf)),
-      GST_TIME_ARGS (GST_BUFFER_DURATION (outbuf)),
-      GST_BUFFER_OFFSET (outbuf), GST_BUFFER_OFFSET_END (outbuf));
-
 out:
   return ret;
 }
@@ -402,7 +379,7 @@ gst_srt_server_src_stop (GstBaseSrc * src)
 
   priv->cancelled = FALSE;
 
-  return TRUE;
+  return GST_BASE_SRC_CLASS (parent_class)->stop (src);
 }
 
 static gboolean
@@ -495,7 +472,7 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
   gstbasesrc_class->unlock_stop =
       GST_DEBUG_FUNCPTR (gst_srt_server_src_unlock_stop);
 
-  gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_server_src_fill);
+  gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_srt_server_src_create);
 }
 
 static void
@@ -134,8 +134,10 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_BITRATE_LIMIT 0.8f
+#define DEFAULT_PREFETCH_DEPTH 0
+#define MAX_PREFETCH_DEPTH 32
+#define DEFAULT_ABR_ALGORITHM GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
-#define NUM_LOOKBACK_FRAGMENTS 3
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -162,6 +164,8 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_DEPTH,
+  PROP_ABR_ALGORITHM,
   PROP_LAST
 };
 
@@ -210,8 +214,34 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* Downloads the prefetched fragments of all streams */
+  GThreadPool *prefetch_pool;
 };
 
+/* A fragment, header or index downloaded in advance. Queued in
+ * stream->prefetch_requests until pushed. Once cancelled, it is not in the
+ * queue anymore and is freed by the pool thread when done */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  GstAdaptiveDemuxStream *stream;
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  /* protected by stream->fragment_download_lock */
+  GstUriDownloader *downloader; /* while downloading */
+  GstFragment *download;
+  GError *error;
+  GstClockTime download_start;  /* monotonic time the request was started */
+  GstClockTime download_time;
+  GstClockTime latency;         /* until the first byte, if known */
+  gdouble concurrency;
+  gboolean done;
+  gboolean cancelled;
+  gboolean waited;              /* the download task waits for it */
+} GstAdaptiveDemuxPrefetch;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -302,6 +332,10 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
 static gboolean
 gst_adaptive_demux_wait_until (GstClock * clock, GCond * cond, GMutex * mutex,
     GstClockTime end_time);
+static void gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch *
+    request, GstAdaptiveDemux * demux);
+static void gst_adaptive_demux_stream_prefetch_flush (GstAdaptiveDemuxStream *
+    stream);
 static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
     GstClockTime time, GstClockID id, gpointer user_data);
 static gboolean
@@ -354,6 +388,12 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->prefetch_depth = g_value_get_uint (value);
+      break;
+    case PROP_ABR_ALGORITHM:
+      demux->abr_algorithm = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -378,6 +418,12 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->prefetch_depth);
+      break;
+    case PROP_ABR_ALGORITHM:
+      g_value_set_enum (value, demux->abr_algorithm);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -421,6 +467,40 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-depth:
+   *
+   * Number of requests of a stream to download in parallel with the one
+   * whose data is being pushed. Headers and the next fragments are then
+   * requested without waiting for the previous ones to finish, and pushed
+   * in order once complete. Only the next fragments of subclasses
+   * implementing stream_peek_fragment_info() can be requested in advance.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of requests to download in advance of the one being pushed"
+          " (0 = disabled)", 0, MAX_PREFETCH_DEPTH, DEFAULT_PREFETCH_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:abr-algorithm:
+   *
+   * Algorithm picking the bitrate of the streams after each fragment. The
+   * buffer based one needs the downstream elements to answer position
+   * queries and to buffer several fragments, and only picks one of the
+   * bitrates directly for subclasses implementing stream_get_bitrates().
+   * Not used when #GstAdaptiveDemux:connection-speed is set.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ABR_ALGORITHM,
+      g_param_spec_enum ("abr-algorithm", "ABR algorithm",
+          "Algorithm used to select the bitrate of the streams",
+          GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM, DEFAULT_ABR_ALGORITHM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -500,6 +580,10 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_cond_init (&demux->priv->preroll_cond);
   g_mutex_init (&demux->priv->preroll_lock);
 
+  demux->priv->prefetch_pool =
+      g_thread_pool_new ((GFunc) gst_adaptive_demux_prefetch_func, demux, -1,
+      FALSE, NULL);
+
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
   g_return_if_fail (pad_template != NULL);
@@ -513,6 +597,8 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+  demux->abr_algorithm = DEFAULT_ABR_ALGORITHM;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -527,6 +613,7 @@ gst_adaptive_demux_finalize (GObject * object)
 
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
+  g_thread_pool_free (priv->prefetch_pool, FALSE, TRUE);
 
   g_mutex_clear (&priv->updates_timed_lock);
   g_cond_clear (&priv->updates_timed_cond);
@@ -1306,8 +1393,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
 
   stream->pad = pad;
   stream->demux = demux;
-  stream->fragment_bitrates =
-      g_malloc0 (sizeof (guint64) * NUM_LOOKBACK_FRAGMENTS);
+  stream->abr = gst_adaptive_demux_abr_new (demux->abr_algorithm, pad);
   gst_pad_set_element_private (pad, stream);
   stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
 
@@ -1324,6 +1410,7 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_queue_init (&stream->prefetch_requests);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1388,6 +1475,7 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  gst_adaptive_demux_stream_prefetch_flush (stream);
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -1423,7 +1511,7 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   g_cond_clear (&stream->fragment_download_cond);
   g_mutex_clear (&stream->fragment_download_lock);
-  g_free (stream->fragment_bitrates);
+  gst_adaptive_demux_abr_free (stream->abr);
 
   if (stream->pad) {
     gst_object_unref (stream->pad);
@@ -2127,6 +2215,9 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
        */
       gst_task_join (stream->download_task);
 
+      /* the download restarts from another position, if at all */
+      gst_adaptive_demux_stream_prefetch_flush (stream);
+
       GST_MANIFEST_LOCK (demux);
     }
     list_to_process = demux->prepared_streams;
@@ -2199,22 +2290,43 @@ gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
   stream->pending_events = g_list_append (stream->pending_events, event);
 }
 
-/* must be called with manifest_lock taken */
-static guint64
-_update_average_bitrate (GstAdaptiveDemux * demux,
-    GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+/* must be called with manifest_lock taken.
+ * Returns how much data was pushed downstream but not played yet, or
+ * GST_CLOCK_TIME_NONE if it is not known */
+static GstClockTime
+gst_adaptive_demux_stream_get_buffer_level (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
 {
-  gint index = stream->moving_index % NUM_LOOKBACK_FRAGMENTS;
+  GstClockTime pushed;
+  gint64 pos;
 
-  stream->moving_bitrate -= stream->fragment_bitrates[index];
-  stream->fragment_bitrates[index] = new_bitrate;
-  stream->moving_bitrate += new_bitrate;
+  if (demux->segment.rate < 0)
+    return GST_CLOCK_TIME_NONE;
 
-  stream->moving_index += 1;
+  if (!gst_pad_peer_query_position (stream->pad, GST_FORMAT_TIME, &pos)
+      || pos < 0)
+    return GST_CLOCK_TIME_NONE;
 
-  if (stream->moving_index > NUM_LOOKBACK_FRAGMENTS)
-    return stream->moving_bitrate / NUM_LOOKBACK_FRAGMENTS;
-  return stream->moving_bitrate / stream->moving_index;
+  GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
+  pushed =
+      gst_segment_to_stream_time (&stream->segment, GST_FORMAT_TIME,
+      stream->segment.position);
+  GST_ADAPTIVE_DEMUX_SEGMENT_UNLOCK (demux);
+
+  if (!GST_CLOCK_TIME_IS_VALID (pushed))
+    return GST_CLOCK_TIME_NONE;
+  if (pushed <= (GstClockTime) pos)
+    return 0;
+  return pushed - (GstClockTime) pos;
+}
+
+static gint
+compare_bitrates (gconstpointer a, gconstpointer b)
+{
+  guint64 bitrate_a = *(const guint64 *) a;
+  guint64 bitrate_b = *(const guint64 *) b;
+
+  return bitrate_a < bitrate_b ? -1 : bitrate_a > bitrate_b;
 }
 
 /* must be called with manifest_lock taken */
@@ -2222,8 +2334,10 @@ static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream)
 {
-  guint64 average_bitrate;
-  guint64 fragment_bitrate;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxAbrFragment fragment;
+  GstClockTime buffer_level = GST_CLOCK_TIME_NONE;
+  GArray *bitrates;
 
   if (demux->connection_speed) {
     GST_LOG_OBJECT (demux, "Connection-speed is set to %u kbps, using it",
@@ -2232,23 +2346,41 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
     return demux->connection_speed;
   }
 
-  fragment_bitrate = stream->last_bitrate;
-  GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
-      fragment_bitrate);
-
-  average_bitrate = _update_average_bitrate (demux, stream, fragment_bitrate);
+  if (gst_adaptive_demux_abr_get_algorithm (stream->abr) !=
+      demux->abr_algorithm) {
+    GST_DEBUG_OBJECT (stream->pad, "Switching to ABR algorithm %d",
+        demux->abr_algorithm);
+    gst_adaptive_demux_abr_free (stream->abr);
+    stream->abr = gst_adaptive_demux_abr_new (demux->abr_algorithm,
+        stream->pad);
+  }
 
-  GST_INFO_OBJECT (stream, "last fragment bitrate was %" G_GUINT64_FORMAT,
-      fragment_bitrate);
-  GST_INFO_OBJECT (stream,
-      "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
-      NUM_LOOKBACK_FRAGMENTS, average_bitrate);
+  GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
+      stream->last_bitrate);
+
+  fragment.size = stream->fragment_bytes_downloaded;
+  fragment.download_time = stream->last_download_time;
+  fragment.concurrency = stream->download_concurrency;
+  gst_adaptive_demux_abr_fragment_downloaded (stream->abr, &fragment);
+
+  bitrates = g_array_new (FALSE, FALSE, sizeof (guint64));
+  if (gst_adaptive_demux_abr_uses_buffer_level (stream->abr)) {
+    buffer_level = gst_adaptive_demux_stream_get_buffer_level (demux, stream);
+    GST_DEBUG_OBJECT (stream->pad, "Buffer level is %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (buffer_level));
+
+    if (klass->stream_get_bitrates) {
+      klass->stream_get_bitrates (stream, bitrates);
+      g_array_sort (bitrates, compare_bitrates);
+    }
+  }
 
-  /* Conservative approach, make sure we don't upgrade too fast */
-  stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  stream->current_download_rate =
+      gst_adaptive_demux_abr_get_bitrate (stream->abr, demux->bitrate_limit,
+      buffer_level, (const guint64 *) bitrates->data, bitrates->len);
+  g_array_free (bitrates, TRUE);
 
-  stream->current_download_rate *= demux->bitrate_limit;
-  GST_DEBUG_OBJECT (demux, "Bitrate after bitrate limit (%0.2f): %"
+  GST_DEBUG_OBJECT (demux, "Bitrate with bitrate limit (%0.2f): %"
       G_GUINT64_FORMAT, demux->bitrate_limit, stream->current_download_rate);
 
 #if 0
@@ -2522,18 +2654,14 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* Handles downloaded data, from the src element or prefetched */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_chain (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
   GST_MANIFEST_LOCK (demux);
 
   /* do not make any changes if the stream is cancelled */
@@ -2607,10 +2735,15 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       /* If this is the first buffer of a fragment (not the headers or index)
        * and we don't have a birate from the sub-class, then see if we
        * can work it out from the fragment size and duration */
-      if (stream->fragment.bitrate == 0 &&
-          stream->fragment.duration != 0 &&
-          gst_element_query_duration (stream->uri_handler, GST_FORMAT_BYTES,
-              &chunk_size)) {
+      if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0) {
+        /* prefetched fragments come in one buffer */
+        if (stream->downloading_prefetched)
+          chunk_size = gst_buffer_get_size (buffer);
+        else if (!gst_element_query_duration (stream->uri_handler,
+                GST_FORMAT_BYTES, &chunk_size))
+          chunk_size = 0;
+      }
+      if (chunk_size > 0) {
         guint bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (chunk_size,
                 8 * GST_SECOND, stream->fragment.duration));
         GST_LOG_OBJECT (demux,
@@ -2684,6 +2817,13 @@ error:
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  return gst_adaptive_demux_stream_chain (GST_ADAPTIVE_DEMUX_CAST (parent),
+      gst_pad_get_element_private (pad), buffer);
+}
+
 /* must be called with manifest_lock taken */
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
@@ -3109,6 +3249,384 @@ uritype (GstAdaptiveDemuxStream * s)
 }
 #endif
 
+/* must be called with fragment_download_lock taken */
+static void
+gst_adaptive_demux_stream_update_load (GstAdaptiveDemuxStream * stream,
+    GstClockTime now)
+{
+  if (stream->downloads_running > 0 && now > stream->download_load_time)
+    stream->download_load +=
+        stream->downloads_running * (now - stream->download_load_time);
+  stream->download_load_time = now;
+}
+
+/* must be called with fragment_download_lock taken.
+ * Returns the current load, to pass to
+ * gst_adaptive_demux_stream_end_download() */
+static GstClockTime
+gst_adaptive_demux_stream_begin_download (GstAdaptiveDemuxStream * stream,
+    GstClockTime now)
+{
+  gst_adaptive_demux_stream_update_load (stream, now);
+  stream->downloads_running++;
+
+  return stream->download_load;
+}
+
+/* must be called with fragment_download_lock taken.
+ * Returns the average number of downloads of the stream that were running
+ * since @start, including this one */
+static gdouble
+gst_adaptive_demux_stream_end_download (GstAdaptiveDemuxStream * stream,
+    GstClockTime now, GstClockTime start, GstClockTime load)
+{
+  gst_adaptive_demux_stream_update_load (stream, now);
+  stream->downloads_running--;
+
+  if (now <= start)
+    return 1.0;
+  return MAX (1.0, (stream->download_load - load) / (gdouble) (now - start));
+}
+
+static void
+gst_adaptive_demux_prefetch_free (GstAdaptiveDemuxPrefetch * request)
+{
+  g_free (request->uri);
+  if (request->download)
+    g_object_unref (request->download);
+  g_clear_error (&request->error);
+  g_slice_free (GstAdaptiveDemuxPrefetch, request);
+}
+
+/* must be called with fragment_download_lock taken. @request must not be
+ * in the queue anymore */
+static void
+gst_adaptive_demux_prefetch_cancel (GstAdaptiveDemuxPrefetch * request)
+{
+  GST_DEBUG_OBJECT (request->stream->pad, "Cancelling prefetch of %s",
+      request->uri);
+
+  request->cancelled = TRUE;
+  if (request->downloader)
+    gst_uri_downloader_cancel (request->downloader);
+  else if (request->done)
+    gst_adaptive_demux_prefetch_free (request);
+}
+
+/* runs in the prefetch thread pool */
+static void
+gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch * request,
+    GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxStream *stream = request->stream;
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  GError *err = NULL;
+  GstClockTime start, stop, load;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (!request->cancelled) {
+    downloader = request->downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (downloader, GST_ELEMENT_CAST (demux));
+    start = gst_adaptive_demux_get_monotonic_time (demux);
+    load = gst_adaptive_demux_stream_begin_download (stream, start);
+    g_mutex_unlock (&stream->fragment_download_lock);
+
+    GST_DEBUG_OBJECT (stream->pad, "Prefetching %s, range:%" G_GINT64_FORMAT
+        " - %" G_GINT64_FORMAT, request->uri, request->range_start,
+        request->range_end);
+
+    /* HTTP ranges are inclusive, GStreamer segments are exclusive for the
+     * stop position */
+    download = gst_uri_downloader_fetch_uri_with_range (downloader,
+        request->uri, NULL, FALSE, FALSE, TRUE, request->range_start,
+        request->range_end != -1 ? request->range_end + 1 : -1, &err);
+
+    g_mutex_lock (&stream->fragment_download_lock);
+    stop = gst_adaptive_demux_get_monotonic_time (demux);
+    request->concurrency =
+        gst_adaptive_demux_stream_end_download (stream, stop, start, load);
+    request->download_start = start;
+    request->download_time = stop - start;
+    /* the fragment measures from its own creation, which is when the
+     * downloader started the request */
+    if (download
+        && GST_CLOCK_TIME_IS_VALID (download->download_first_byte_time))
+      request->latency =
+          download->download_first_byte_time - download->download_start_time;
+    else
+      request->latency = GST_CLOCK_TIME_NONE;
+    request->download = download;
+    request->error = err;
+    request->downloader = NULL;
+    g_object_unref (downloader);
+
+    GST_DEBUG_OBJECT (stream->pad, "Prefetched %s in %" GST_TIME_FORMAT
+        " with %.2f downloads in parallel: %s", request->uri,
+        GST_TIME_ARGS (request->download_time), request->concurrency,
+        download ? "done" : (err ? err->message : "failed"));
+  }
+  request->done = TRUE;
+  stream->prefetch_pending--;
+  /* don't wake up the download task if it is waiting for something else */
+  if (request->waited || (stream->prefetch_flushing
+          && stream->prefetch_pending == 0))
+    g_cond_broadcast (&stream->fragment_download_cond);
+  if (request->cancelled)
+    gst_adaptive_demux_prefetch_free (request);
+  g_mutex_unlock (&stream->fragment_download_lock);
+}
+
+/* Cancels all the prefetched requests of @stream and waits for the thread
+ * pool to be done with them. Must not be called from the download task of
+ * @stream while it is running */
+static void
+gst_adaptive_demux_stream_prefetch_flush (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *request;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  while ((request = g_queue_pop_head (&stream->prefetch_requests)))
+    gst_adaptive_demux_prefetch_cancel (request);
+  stream->prefetch_flushing = TRUE;
+  while (stream->prefetch_pending > 0)
+    g_cond_wait (&stream->fragment_download_cond,
+        &stream->fragment_download_lock);
+  stream->prefetch_flushing = FALSE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+}
+
+static gboolean
+gst_adaptive_demux_prefetch_matches (GstAdaptiveDemuxPrefetch * request,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return g_str_equal (request->uri, uri) &&
+      request->range_start == range_start && request->range_end == range_end;
+}
+
+/* must be called with fragment_download_lock taken */
+static void
+gst_adaptive_demux_stream_prefetch_add (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GQueue * requests, const gchar * uri,
+    gint64 range_start, gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetch *request = NULL;
+  GList *iter;
+
+  /* keep the requests that are still wanted */
+  for (iter = stream->prefetch_requests.head; iter; iter = iter->next) {
+    if (gst_adaptive_demux_prefetch_matches (iter->data, uri, range_start,
+            range_end)) {
+      request = iter->data;
+      g_queue_delete_link (&stream->prefetch_requests, iter);
+      break;
+    }
+  }
+
+  if (request == NULL) {
+    GError *err = NULL;
+
+    request = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+    request->stream = stream;
+    request->uri = g_strdup (uri);
+    request->range_start = range_start;
+    request->range_end = range_end;
+
+    stream->prefetch_pending++;
+    if (!g_thread_pool_push (demux->priv->prefetch_pool, request, &err)) {
+      GST_WARNING_OBJECT (stream->pad, "Failed to prefetch %s: %s", uri,
+          err->message);
+      g_clear_error (&err);
+      stream->prefetch_pending--;
+      gst_adaptive_demux_prefetch_free (request);
+      return;
+    }
+  }
+
+  g_queue_push_tail (requests, request);
+}
+
+/* must be called with manifest_lock taken.
+ *
+ * Requests the headers of the current fragment, the current fragment and the
+ * next ones, at most prefetch_depth ahead of the first one, so that they
+ * download in parallel. Requests that are not needed anymore (e.g. after
+ * a bitrate switch) are cancelled.
+ */
+static void
+gst_adaptive_demux_stream_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GQueue requests = G_QUEUE_INIT;
+  GstAdaptiveDemuxPrefetch *request;
+  guint max_requests = demux->prefetch_depth + 1;
+  gboolean chunked;
+  guint i;
+
+  if (demux->prefetch_depth == 0 && stream->prefetch_requests.length == 0)
+    return;
+
+  /* chunks are only known once the previous one is downloaded */
+  chunked = klass->need_another_chunk && klass->need_another_chunk (stream)
+      && stream->fragment.chunk_size != 0;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+
+  if (demux->prefetch_depth > 0) {
+    if (stream->need_header && stream->fragment.header_uri)
+      gst_adaptive_demux_stream_prefetch_add (demux, stream, &requests,
+          stream->fragment.header_uri, stream->fragment.header_range_start,
+          stream->fragment.header_range_end);
+    if (stream->need_header && stream->fragment.index_uri
+        && requests.length < max_requests)
+      gst_adaptive_demux_stream_prefetch_add (demux, stream, &requests,
+          stream->fragment.index_uri, stream->fragment.index_range_start,
+          stream->fragment.index_range_end);
+    if (!chunked && stream->fragment.uri && requests.length < max_requests)
+      gst_adaptive_demux_stream_prefetch_add (demux, stream, &requests,
+          stream->fragment.uri, stream->fragment.range_start,
+          stream->fragment.range_end);
+
+    for (i = 1; !chunked && klass->stream_peek_fragment_info &&
+        requests.length < max_requests; i++) {
+      GstAdaptiveDemuxStreamFragment next = { 0, };
+
+      if (klass->stream_peek_fragment_info (stream, i, &next) != GST_FLOW_OK) {
+        gst_adaptive_demux_stream_fragment_clear (&next);
+        break;
+      }
+      if (next.uri)
+        gst_adaptive_demux_stream_prefetch_add (demux, stream, &requests,
+            next.uri, next.range_start, next.range_end);
+      gst_adaptive_demux_stream_fragment_clear (&next);
+    }
+  }
+
+  while ((request = g_queue_pop_head (&stream->prefetch_requests)))
+    gst_adaptive_demux_prefetch_cancel (request);
+  stream->prefetch_requests = requests;
+
+  g_mutex_unlock (&stream->fragment_download_lock);
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * If @uri was prefetched, waits for it to be downloaded and pushes it like
+ * gst_adaptive_demux_stream_download_uri() would. Returns %FALSE if @uri was
+ * not prefetched or the prefetch failed, in which case it should be
+ * downloaded again the usual way.
+ */
+static gboolean
+gst_adaptive_demux_stream_download_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, const gchar * uri, gint64 start,
+    gint64 end, GstFlowReturn * ret)
+{
+  GstAdaptiveDemuxPrefetch *request = NULL;
+  GstBuffer *buffer;
+  GList *iter;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  for (iter = stream->prefetch_requests.head; iter; iter = iter->next) {
+    if (gst_adaptive_demux_prefetch_matches (iter->data, uri, start, end)) {
+      request = iter->data;
+      break;
+    }
+  }
+  if (request == NULL) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    return FALSE;
+  }
+
+  /* anything queued before is not going to be pushed anymore */
+  while (g_queue_peek_head (&stream->prefetch_requests) != request)
+    gst_adaptive_demux_prefetch_cancel (g_queue_pop_head
+        (&stream->prefetch_requests));
+  g_queue_pop_head (&stream->prefetch_requests);
+
+  GST_DEBUG_OBJECT (stream->pad, "Waiting for prefetched %s: %s",
+      uritype (stream), uri);
+
+  GST_MANIFEST_UNLOCK (demux);
+  request->waited = TRUE;
+  while (!stream->cancelled && !request->done) {
+    g_cond_wait (&stream->fragment_download_cond,
+        &stream->fragment_download_lock);
+  }
+  if (G_UNLIKELY (stream->cancelled)) {
+    gst_adaptive_demux_prefetch_cancel (request);
+    g_mutex_unlock (&stream->fragment_download_lock);
+    GST_MANIFEST_LOCK (demux);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+  GST_MANIFEST_LOCK (demux);
+
+  if (request->download == NULL || !request->download->completed) {
+    GST_WARNING_OBJECT (stream->pad, "Prefetching %s failed: %s", uri,
+        request->error ? request->error->message : "unknown error");
+    gst_adaptive_demux_prefetch_free (request);
+    return FALSE;
+  }
+
+  buffer = gst_fragment_get_buffer (request->download);
+  if (buffer == NULL) {
+    /* an empty resource, same as a download without any data */
+    buffer = gst_buffer_new ();
+  }
+
+  stream->fragment_bytes_downloaded = gst_buffer_get_size (buffer);
+  stream->download_start_time = GST_TIME_AS_USECONDS (request->download_start);
+  if (GST_CLOCK_TIME_IS_VALID (request->latency))
+    stream->last_latency = request->latency;
+  stream->last_download_time = request->download_time;
+  stream->last_bitrate = stream->last_download_time ?
+      gst_util_uint64_scale (stream->fragment_bytes_downloaded, 8 * GST_SECOND,
+      stream->last_download_time) : 0;
+  if (!stream->downloading_header && !stream->downloading_index)
+    stream->download_concurrency = request->concurrency;
+  gst_adaptive_demux_prefetch_free (request);
+
+  GST_DEBUG_OBJECT (stream->pad, "Pushing prefetched %s: %s, %"
+      G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT " bps", uritype (stream),
+      uri, stream->fragment_bytes_downloaded, stream->last_bitrate);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+  stream->downloading_prefetched = TRUE;
+
+  /* push it as if it came from the src element */
+  GST_MANIFEST_UNLOCK (demux);
+  if (gst_buffer_get_size (buffer) > 0)
+    gst_adaptive_demux_stream_chain (demux, stream, buffer);
+  else
+    gst_buffer_unref (buffer);
+  GST_MANIFEST_LOCK (demux);
+
+  stream->downloading_prefetched = FALSE;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  if (!stream->download_finished) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_adaptive_demux_eos_handling (stream);
+  } else {
+    g_mutex_unlock (&stream->fragment_download_lock);
+  }
+
+  *ret = stream->last_ret;
+
+  return TRUE;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  *
@@ -3120,6 +3638,9 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
     gint64 end, guint * http_status)
 {
   GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime load_start, load;
+  gdouble concurrency;
+
   GST_DEBUG_OBJECT (stream->pad,
       "Downloading %s uri: %s, range:%" G_GINT64_FORMAT " - %" G_GINT64_FORMAT,
       uritype (stream), uri, start, end);
@@ -3127,6 +3648,11 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
   if (http_status)
     *http_status = 200;         /* default to ok if no further information */
 
+  if (stream->prefetch_requests.length > 0 &&
+      gst_adaptive_demux_stream_download_prefetched (demux, stream, uri, start,
+          end, &ret))
+    return ret;
+
   if (!gst_adaptive_demux_stream_update_source (stream, uri, NULL, FALSE, TRUE)) {
     ret = stream->last_ret = GST_FLOW_ERROR;
     return ret;
@@ -3196,6 +3722,8 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
         ret = stream->last_ret = GST_FLOW_FLUSHING;
         return ret;
       }
+      load_start = gst_adaptive_demux_get_monotonic_time (demux);
+      load = gst_adaptive_demux_stream_begin_download (stream, load_start);
       /* download_finished is only set:
        * * in ::fragment_download_finish()
        * * if EOS is received on the _src pad
@@ -3204,6 +3732,10 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
         g_cond_wait (&stream->fragment_download_cond,
             &stream->fragment_download_lock);
       }
+      concurrency = gst_adaptive_demux_stream_end_download (stream,
+          gst_adaptive_demux_get_monotonic_time (demux), load_start, load);
+      if (!stream->downloading_header && !stream->downloading_index)
+        stream->download_concurrency = concurrency;
       g_mutex_unlock (&stream->fragment_download_lock);
 
       GST_DEBUG_OBJECT (stream->pad,
@@ -3342,6 +3874,8 @@ gst_adaptive_demux_stream_download_fragment (GstAdaptiveDemuxStream * stream)
       stream->fragment.index_uri == NULL)
     goto no_url_error;
 
+  gst_adaptive_demux_stream_prefetch (demux, stream);
+
   if (stream->need_header) {
     ret = gst_adaptive_demux_stream_download_header_fragment (stream);
     if (ret != GST_FLOW_OK) {
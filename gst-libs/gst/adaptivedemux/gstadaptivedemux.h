@@ -26,6 +26,7 @@
 #include <gst/base/gstadapter.h>
 #include <gst/uridownloader/gsturidownloader.h>
 #include <gst/adaptivedemux/adaptive-demux-prelude.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
 
 G_BEGIN_DECLS
 
@@ -179,10 +180,8 @@ struct _GstAdaptiveDemuxStream
   GstClockTime last_latency;
   GstClockTime last_download_time;
 
-  /* Average for the last fragments */
-  guint64 moving_bitrate;
-  guint moving_index;
-  guint64 *fragment_bitrates;
+  /* bitrate adaptation, see the abr-algorithm property */
+  GstAdaptiveDemuxAbr *abr;
 
   /* QoS data */
   GstClockTime qos_earliest_time;
@@ -195,6 +194,23 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* fragments and headers downloaded in advance, in the order they will be
+   * pushed (see the prefetch-depth property). Protected by
+   * fragment_download_lock */
+  GQueue prefetch_requests;
+  guint prefetch_pending;       /* requests not done in the thread pool */
+  gboolean prefetch_flushing;
+  gboolean downloading_prefetched;
+
+  /* sum over time of the number of downloads of this stream running at the
+   * same time (protected by fragment_download_lock) */
+  guint downloads_running;
+  GstClockTime download_load;
+  GstClockTime download_load_time;
+  /* average number of downloads sharing the link while the previous
+   * fragment was downloaded */
+  gdouble download_concurrency;
 };
 
 /**
@@ -228,6 +244,8 @@ struct _GstAdaptiveDemux
   /* Properties */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;
+  guint prefetch_depth;
+  GstAdaptiveDemuxAbrAlgorithm abr_algorithm;
 
   gboolean have_group_id;
   guint group_id;
@@ -371,6 +389,20 @@ struct _GstAdaptiveDemuxClass
    *          if there is no fragment.
    */
   GstFlowReturn (*stream_update_fragment_info) (GstAdaptiveDemuxStream * stream);
+  /**
+   * stream_peek_fragment_info:
+   * @stream: #GstAdaptiveDemuxStream
+   * @distance: the number of fragments after the current one
+   * @fragment: the #GstAdaptiveDemuxStreamFragment to fill in
+   *
+   * Optional. Sets the URI and range of the fragment @distance fragments
+   * after the current one to @fragment, without changing the current
+   * fragment. Used to download the next fragments in advance.
+   *
+   * Returns: #GST_FLOW_OK in success, #GST_FLOW_EOS if there is no such
+   *          fragment (yet).
+   */
+  GstFlowReturn (*stream_peek_fragment_info) (GstAdaptiveDemuxStream * stream, guint distance, GstAdaptiveDemuxStreamFragment * fragment);
   /**
    * stream_select_bitrate:
    * @stream: #GstAdaptiveDemuxStream
@@ -385,6 +417,16 @@ struct _GstAdaptiveDemuxClass
    * Returns: %TRUE if the stream changed bitrate, %FALSE otherwise
    */
   gboolean      (*stream_select_bitrate) (GstAdaptiveDemuxStream * stream, guint64 bitrate);
+  /**
+   * stream_get_bitrates:
+   * @stream: #GstAdaptiveDemuxStream
+   * @bitrates: a #GArray of #guint64
+   *
+   * Optional. Appends the bitrates (in bits per second) that
+   * stream_select_bitrate() can switch @stream to, in any order. Used by the
+   * bitrate adaptation algorithms that pick one of them directly.
+   */
+  void          (*stream_get_bitrates) (GstAdaptiveDemuxStream * stream, GArray * bitrates);
   /**
    * stream_get_fragment_waiting_time:
    * @stream: #GstAdaptiveDemuxStream
@@ -0,0 +1,337 @@
+/* GStreamer
+ *
+ * gstadaptivedemuxabr.c: bitrate adaptation algorithms for adaptivedemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Each algorithm is fed the timing of every downloaded fragment of a stream
+ * and is then asked for the bitrate to switch to. The bitrate is handed to
+ * the stream_select_bitrate() vfunc of the subclass, which picks the highest
+ * bitrate that is not greater than it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include "gstadaptivedemuxabr.h"
+
+GST_DEBUG_CATEGORY_EXTERN (adaptivedemux_debug);
+#define GST_CAT_DEFAULT adaptivedemux_debug
+
+#define NUM_LOOKBACK_FRAGMENTS 3
+
+/* half-lives of the throughput averages, in seconds of download time */
+#define THROUGHPUT_FAST_HALF_LIFE 3.0
+#define THROUGHPUT_SLOW_HALF_LIFE 8.0
+
+/* buffer level under which the lowest bitrate is picked, and buffer level
+ * aimed for, in seconds. The buffer target grows with the number of
+ * bitrates to choose from */
+#define BOLA_MIN_BUFFER 10.0
+#define BOLA_BUFFER_TARGET 12.0
+#define BOLA_BUFFER_PER_BITRATE 2.0
+
+typedef struct
+{
+  gdouble half_life;
+  gdouble value;
+  gdouble total_weight;
+} GstAdaptiveDemuxAbrEwma;
+
+typedef struct
+{
+  GstAdaptiveDemuxAbrAlgorithm algorithm;
+  gboolean uses_buffer_level;
+
+  void (*fragment_downloaded) (GstAdaptiveDemuxAbr * abr, guint64 bitrate,
+      const GstAdaptiveDemuxAbrFragment * fragment);
+  guint64 (*get_bitrate) (GstAdaptiveDemuxAbr * abr, gdouble bitrate_limit,
+      GstClockTime buffer_level, const guint64 * bitrates, guint n_bitrates);
+} GstAdaptiveDemuxAbrImpl;
+
+struct _GstAdaptiveDemuxAbr
+{
+  const GstAdaptiveDemuxAbrImpl *impl;
+  /* the pad of the stream, for logging */
+  GstPad *pad;
+
+  /* moving average */
+  guint64 last_bitrate;
+  guint64 moving_bitrate;
+  guint moving_index;
+  guint64 fragment_bitrates[NUM_LOOKBACK_FRAGMENTS];
+
+  /* throughput */
+  GstAdaptiveDemuxAbrEwma fast;
+  GstAdaptiveDemuxAbrEwma slow;
+};
+
+GType
+gst_adaptive_demux_abr_algorithm_get_type (void)
+{
+  static volatile gsize abr_algorithm_type = 0;
+  static const GEnumValue abr_algorithms[] = {
+    {GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+        "Average bitrate of the last fragments", "moving-average"},
+    {GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT,
+        "Weighted moving average of the throughput", "throughput"},
+    {GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED,
+        "Buffer level based (BOLA)", "buffer-based"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&abr_algorithm_type)) {
+    GType tmp = g_enum_register_static ("GstAdaptiveDemuxAbrAlgorithm",
+        abr_algorithms);
+    g_once_init_leave (&abr_algorithm_type, tmp);
+  }
+
+  return (GType) abr_algorithm_type;
+}
+
+/* Moving average: the legacy algorithm, conservative when the bitrate goes
+ * up and following the last fragment when it goes down */
+static void
+moving_average_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+    guint64 bitrate, const GstAdaptiveDemuxAbrFragment * fragment)
+{
+  gint index = abr->moving_index % NUM_LOOKBACK_FRAGMENTS;
+
+  abr->moving_bitrate -= abr->fragment_bitrates[index];
+  abr->fragment_bitrates[index] = bitrate;
+  abr->moving_bitrate += bitrate;
+
+  abr->moving_index += 1;
+  abr->last_bitrate = bitrate;
+}
+
+static guint64
+moving_average_get_bitrate (GstAdaptiveDemuxAbr * abr, gdouble bitrate_limit,
+    GstClockTime buffer_level, const guint64 * bitrates, guint n_bitrates)
+{
+  guint64 average_bitrate;
+
+  if (abr->moving_index == 0)
+    return 0;
+
+  if (abr->moving_index > NUM_LOOKBACK_FRAGMENTS)
+    average_bitrate = abr->moving_bitrate / NUM_LOOKBACK_FRAGMENTS;
+  else
+    average_bitrate = abr->moving_bitrate / abr->moving_index;
+
+  GST_INFO_OBJECT (abr->pad,
+      "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
+      NUM_LOOKBACK_FRAGMENTS, average_bitrate);
+
+  /* Conservative approach, make sure we don't upgrade too fast */
+  return MIN (average_bitrate, abr->last_bitrate) * bitrate_limit;
+}
+
+static void
+ewma_add (GstAdaptiveDemuxAbrEwma * ewma, gdouble weight, gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / ewma->half_life);
+
+  ewma->value = alpha * ewma->value + (1.0 - alpha) * value;
+  ewma->total_weight += weight;
+}
+
+static gdouble
+ewma_get (const GstAdaptiveDemuxAbrEwma * ewma)
+{
+  /* the average starts at 0, scale it up until it saw enough samples */
+  gdouble zero_factor = 1.0 - pow (0.5, ewma->total_weight / ewma->half_life);
+
+  if (zero_factor <= 0.0)
+    return 0.0;
+  return ewma->value / zero_factor;
+}
+
+/* Throughput: a fast and a slow moving average of the bitrate. Each sample
+ * weighs as much as the time it took to download, so that a few slow
+ * downloads quickly outweigh many fast ones. Using the smallest of both
+ * averages drops the bitrate quickly and raises it slowly */
+static void
+throughput_fragment_downloaded (GstAdaptiveDemuxAbr * abr, guint64 bitrate,
+    const GstAdaptiveDemuxAbrFragment * fragment)
+{
+  gdouble weight;
+
+  if (!GST_CLOCK_TIME_IS_VALID (fragment->download_time) ||
+      fragment->download_time == 0)
+    return;
+
+  weight = fragment->download_time / (gdouble) GST_SECOND;
+  ewma_add (&abr->fast, weight, bitrate);
+  ewma_add (&abr->slow, weight, bitrate);
+}
+
+static guint64
+throughput_get_bitrate (GstAdaptiveDemuxAbr * abr, gdouble bitrate_limit,
+    GstClockTime buffer_level, const guint64 * bitrates, guint n_bitrates)
+{
+  gdouble fast = ewma_get (&abr->fast);
+  gdouble slow = ewma_get (&abr->slow);
+
+  GST_INFO_OBJECT (abr->pad,
+      "Throughput estimates %.0f bps (fast), %.0f bps (slow)", fast, slow);
+
+  return MIN (fast, slow) * bitrate_limit;
+}
+
+/* Buffer based: BOLA-BASIC, see "BOLA: Near-Optimal Bitrate Adaptation for
+ * Online Videos" (Spiteri, Urgaonkar, Sitaraman). Each bitrate has the
+ * utility ln (bitrate / lowest bitrate) + 1, and the one maximizing
+ * (V * (utility + gp) - buffer level) / bitrate is picked, with V and gp
+ * chosen so that the lowest bitrate is picked below BOLA_MIN_BUFFER and the
+ * highest one at the buffer target.
+ *
+ * Until the buffer reached BOLA_MIN_BUFFER, it would only pick the lowest
+ * bitrate, so the throughput is used if it allows a higher one */
+static guint64
+buffer_based_get_bitrate (GstAdaptiveDemuxAbr * abr, gdouble bitrate_limit,
+    GstClockTime buffer_level, const guint64 * bitrates, guint n_bitrates)
+{
+  guint64 throughput_bitrate;
+  gdouble level, target, gp, vp, best_score = 0.0;
+  gdouble max_utility;
+  guint i, best = 0;
+
+  throughput_bitrate =
+      throughput_get_bitrate (abr, bitrate_limit, buffer_level, bitrates,
+      n_bitrates);
+
+  if (n_bitrates < 2 || bitrates[0] == 0
+      || !GST_CLOCK_TIME_IS_VALID (buffer_level))
+    return throughput_bitrate;
+
+  level = buffer_level / (gdouble) GST_SECOND;
+  target = MAX (BOLA_BUFFER_TARGET,
+      BOLA_MIN_BUFFER + BOLA_BUFFER_PER_BITRATE * n_bitrates);
+  max_utility = log (bitrates[n_bitrates - 1] / (gdouble) bitrates[0]) + 1.0;
+  gp = (max_utility - 1.0) / (target / BOLA_MIN_BUFFER - 1.0);
+  if (gp <= 0.0)
+    return throughput_bitrate;
+  vp = BOLA_MIN_BUFFER / gp;
+
+  for (i = 0; i < n_bitrates; i++) {
+    gdouble utility = log (bitrates[i] / (gdouble) bitrates[0]) + 1.0;
+    gdouble score = (vp * (utility + gp) - level) / bitrates[i];
+
+    if (i == 0 || score >= best_score) {
+      best = i;
+      best_score = score;
+    }
+  }
+
+  GST_INFO_OBJECT (abr->pad, "Buffer level %.3f s, BOLA picks %"
+      G_GUINT64_FORMAT " bps", level, bitrates[best]);
+
+  if (level < BOLA_MIN_BUFFER)
+    return MAX (bitrates[best], throughput_bitrate);
+  return bitrates[best];
+}
+
+static const GstAdaptiveDemuxAbrImpl abr_impls[] = {
+  {GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE, FALSE,
+      moving_average_fragment_downloaded, moving_average_get_bitrate},
+  {GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT, FALSE,
+      throughput_fragment_downloaded, throughput_get_bitrate},
+  {GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED, TRUE,
+      throughput_fragment_downloaded, buffer_based_get_bitrate},
+};
+
+/* @pad is the pad of the stream, the messages about it are logged for it */
+GstAdaptiveDemuxAbr *
+gst_adaptive_demux_abr_new (GstAdaptiveDemuxAbrAlgorithm algorithm,
+    GstPad * pad)
+{
+  GstAdaptiveDemuxAbr *abr;
+
+  g_return_val_if_fail (algorithm < G_N_ELEMENTS (abr_impls), NULL);
+  g_return_val_if_fail (pad == NULL || GST_IS_PAD (pad), NULL);
+
+  abr = g_new0 (GstAdaptiveDemuxAbr, 1);
+  abr->impl = &abr_impls[algorithm];
+  if (pad)
+    abr->pad = gst_object_ref (pad);
+  abr->fast.half_life = THROUGHPUT_FAST_HALF_LIFE;
+  abr->slow.half_life = THROUGHPUT_SLOW_HALF_LIFE;
+
+  return abr;
+}
+
+void
+gst_adaptive_demux_abr_free (GstAdaptiveDemuxAbr * abr)
+{
+  if (abr->pad)
+    gst_object_unref (abr->pad);
+  g_free (abr);
+}
+
+GstAdaptiveDemuxAbrAlgorithm
+gst_adaptive_demux_abr_get_algorithm (GstAdaptiveDemuxAbr * abr)
+{
+  return abr->impl->algorithm;
+}
+
+/* Whether gst_adaptive_demux_abr_get_bitrate() needs the buffer level and
+ * the bitrates of the stream */
+gboolean
+gst_adaptive_demux_abr_uses_buffer_level (GstAdaptiveDemuxAbr * abr)
+{
+  return abr->impl->uses_buffer_level;
+}
+
+void
+gst_adaptive_demux_abr_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+    const GstAdaptiveDemuxAbrFragment * fragment)
+{
+  guint64 bitrate = 0;
+
+  if (GST_CLOCK_TIME_IS_VALID (fragment->download_time) &&
+      fragment->download_time > 0)
+    bitrate = gst_util_uint64_scale (fragment->size, 8 * GST_SECOND,
+        fragment->download_time);
+
+  /* When downloading in parallel, the fragment shared the link with the
+   * other requests of the stream that were downloading at the same time */
+  if (fragment->concurrency > 1.0)
+    bitrate *= fragment->concurrency;
+
+  GST_DEBUG_OBJECT (abr->pad, "Fragment of %" G_GUINT64_FORMAT
+      " bytes downloaded in %" GST_TIME_FORMAT ", link bitrate %"
+      G_GUINT64_FORMAT " bps", fragment->size,
+      GST_TIME_ARGS (fragment->download_time), bitrate);
+
+  abr->impl->fragment_downloaded (abr, bitrate, fragment);
+}
+
+/* @bitrates are the bitrates the stream can switch to, sorted from lowest
+ * to highest. Returns the bitrate to switch to, in bits per second */
+guint64
+gst_adaptive_demux_abr_get_bitrate (GstAdaptiveDemuxAbr * abr,
+    gdouble bitrate_limit, GstClockTime buffer_level,
+    const guint64 * bitrates, guint n_bitrates)
+{
+  return abr->impl->get_bitrate (abr, bitrate_limit, buffer_level, bitrates,
+      n_bitrates);
+}
@@ -0,0 +1,100 @@
+/* GStreamer
+ *
+ * gstadaptivedemuxabr.h: bitrate adaptation algorithms for adaptivedemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_ADAPTIVE_DEMUX_ABR_H_
+#define _GST_ADAPTIVE_DEMUX_ABR_H_
+
+#include <gst/gst.h>
+#include <gst/adaptivedemux/adaptive-demux-prelude.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM \
+  (gst_adaptive_demux_abr_algorithm_get_type())
+
+/**
+ * GstAdaptiveDemuxAbrAlgorithm:
+ * @GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE: the smallest of the last fragment
+ *     bitrate and of the average bitrate of the last fragments
+ * @GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT: exponentially weighted moving averages
+ *     of the throughput, weighted by the download time of each fragment
+ * @GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED: picks the bitrate from the amount of
+ *     data buffered downstream (BOLA), using the throughput while the buffer
+ *     is filling up
+ *
+ * Algorithm used to pick the bitrate of a stream after each fragment.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+  GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT,
+  GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED
+} GstAdaptiveDemuxAbrAlgorithm;
+
+/**
+ * GstAdaptiveDemuxAbrFragment:
+ * @size: number of bytes downloaded
+ * @download_time: time from the request to the last byte
+ * @concurrency: average number of downloads that shared the link with this
+ *     one, including itself
+ *
+ * Timing of a downloaded fragment, fed to the bitrate adaptation.
+ */
+typedef struct _GstAdaptiveDemuxAbrFragment
+{
+  guint64 size;
+  GstClockTime download_time;
+  gdouble concurrency;
+} GstAdaptiveDemuxAbrFragment;
+
+typedef struct _GstAdaptiveDemuxAbr GstAdaptiveDemuxAbr;
+
+GST_ADAPTIVE_DEMUX_API
+GType gst_adaptive_demux_abr_algorithm_get_type (void);
+
+GST_ADAPTIVE_DEMUX_API
+GstAdaptiveDemuxAbr *gst_adaptive_demux_abr_new (GstAdaptiveDemuxAbrAlgorithm algorithm,
+                                                 GstPad * pad);
+
+GST_ADAPTIVE_DEMUX_API
+void gst_adaptive_demux_abr_free (GstAdaptiveDemuxAbr * abr);
+
+GST_ADAPTIVE_DEMUX_API
+GstAdaptiveDemuxAbrAlgorithm gst_adaptive_demux_abr_get_algorithm (GstAdaptiveDemuxAbr * abr);
+
+GST_ADAPTIVE_DEMUX_API
+gboolean gst_adaptive_demux_abr_uses_buffer_level (GstAdaptiveDemuxAbr * abr);
+
+GST_ADAPTIVE_DEMUX_API
+void gst_adaptive_demux_abr_fragment_downloaded (GstAdaptiveDemuxAbr * abr,
+                                                 const GstAdaptiveDemuxAbrFragment * fragment);
+
+GST_ADAPTIVE_DEMUX_API
+guint64 gst_adaptive_demux_abr_get_bitrate (GstAdaptiveDemuxAbr * abr,
+                                            gdouble bitrate_limit,
+                                            GstClockTime buffer_level,
+                                            const guint64 * bitrates,
+                                            guint n_bitrates);
+
+G_END_DECLS
+
+#endif /* _GST_ADAPTIVE_DEMUX_ABR_H_ */
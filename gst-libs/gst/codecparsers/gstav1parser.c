@@ -30,6 +30,9 @@
  * gst_av1_parse_get_first_obu() for the first OBU in the provided data chunk.
  * and gst_av1_parse_get_next_obu() for the remaining OBUs in the data chunk.
  *
+ * Alternatively, gst_av1_parse_scan_obus() finds all the OBUs of a data chunk
+ * in one pass, without parsing anything but their headers.
+ *
  * Then, depending on the #GstAV1OBUType of the newly parsed #GstAV1OBU,
  * you should call the differents functions to parse the structure:
  *
@@ -543,6 +546,190 @@ gst_av1_parse_get_obu (GstAV1Parser * parser,
   return retval;
 }
 
+/* Reads a leb128() value at @pos in @data, which must end before @end */
+static GstAV1ParserResult
+gst_av1_scan_leb128 (const guint8 * data, gsize * pos, gsize end,
+    guint32 * value)
+{
+  guint64 v = 0;
+  gint i;
+
+  for (i = 0; i < 8; i++) {
+    guint8 byte;
+
+    if (*pos >= end)
+      return GST_AV1_PARSER_ERROR;
+
+    byte = data[(*pos)++];
+    v |= (guint64) (byte & 0x7f) << (i * 7);
+    if (!(byte & 0x80))
+      break;
+  }
+
+  /* check for bitstream conformance see chapter4.10.5 */
+  if (v >= G_MAXUINT32)
+    return GST_AV1_PARSER_BITSTREAM_ERROR;
+
+  *value = v;
+  return GST_AV1_PARSER_OK;
+}
+
+/* Same as gst_av1_parse_get_obu(), but reads the bytes directly and doesn't
+ * touch the parser state. The OBU must end before @end. */
+static GstAV1ParserResult
+gst_av1_scan_obu (GstAV1Parser * parser, const guint8 * data, gsize offset,
+    gsize end, GstAV1OBU * obu)
+{
+  GstAV1OBUHeader *header = &obu->header;
+  GstAV1ParserResult retval;
+  gsize pos = offset;
+  guint32 obu_length, obu_size;
+  guint8 byte;
+
+  memset (obu, 0, sizeof (GstAV1OBU));
+
+  if (parser->use_annexb) {
+    retval = gst_av1_scan_leb128 (data, &pos, end, &obu_length);
+    if (retval != GST_AV1_PARSER_OK)
+      return retval;
+    if (obu_length > end - pos)
+      return GST_AV1_PARSER_ERROR;
+    end = pos + obu_length;
+  }
+
+  if (pos >= end)
+    return GST_AV1_PARSER_ERROR;
+
+  byte = data[pos++];
+  if (byte & 0x80)
+    return GST_AV1_PARSER_BITSTREAM_ERROR;
+
+  header->obu_type = (byte >> 3) & 0x0f;
+  header->obu_extention_flag = (byte >> 2) & 0x01;
+  header->obu_has_size_field = (byte >> 1) & 0x01;
+  header->obu_reserved_1bit = byte & 0x01;
+
+  if (header->obu_extention_flag) {
+    if (pos >= end)
+      return GST_AV1_PARSER_ERROR;
+
+    byte = data[pos++];
+    header->extention.obu_temporal_id = byte >> 5;
+    header->extention.obu_spatial_id = (byte >> 3) & 0x03;
+    header->extention.obu_extension_header_reserved_3bits = byte & 0x07;
+  }
+
+  if (header->obu_has_size_field) {
+    retval = gst_av1_scan_leb128 (data, &pos, end, &obu_size);
+    if (retval != GST_AV1_PARSER_OK)
+      return retval;
+    header->obu_size = obu_size;
+
+    if (obu_size > end - pos)
+      return parser->use_annexb ? GST_AV1_PARSER_BITSTREAM_ERROR :
+          GST_AV1_PARSER_ERROR;
+    if (parser->use_annexb && obu_size != end - pos)
+      return GST_AV1_PARSER_BITSTREAM_ERROR;
+  } else {
+    /* the OBU lasts until the end of the obu_length or of the data */
+    obu_size = end - pos;
+  }
+
+  obu->offset = offset;
+  obu->header_size = pos - offset;
+  obu->data = data + pos;
+  obu->size = obu_size;
+
+  return GST_AV1_PARSER_OK;
+}
+
+/**
+ * gst_av1_parse_scan_obus:
+ * @parser: a #GstAV1Parser
+ * @data: The data to scan
+ * @size: the size of @data
+ * @obus: (element-type GstAV1OBU): a #GArray of #GstAV1OBU
+ *
+ * Finds all the OBUs in @data in one pass and appends them to @obus. Only
+ * the OBU headers (and, in Annex B mode, the temporal and frame unit sizes)
+ * are read and the state of @parser is left untouched, the OBUs can then be
+ * passed to the OBU parsing functions when their contents are needed, as
+ * long as @data stays valid.
+ *
+ * In the low overhead bitstream format, an OBU without obu_size is
+ * considered to extend to the end of @data.
+ *
+ * The scan stops at the first OBU that is not complete or valid, in which
+ * case the OBUs found before it are still appended to @obus.
+ *
+ * Returns: #GST_AV1_PARSER_OK if @data only contains complete OBUs,
+ *   #GST_AV1_PARSER_ERROR if the last one is truncated or another
+ *   #GstAV1ParserResult on error.
+ *
+ * Since: 1.16
+ */
+GstAV1ParserResult
+gst_av1_parse_scan_obus (GstAV1Parser * parser, const guint8 * data,
+    gsize size, GArray * obus)
+{
+  GstAV1ParserResult retval;
+  GstAV1OBU obu;
+  guint32 unit_size;
+  gsize pos = 0, temporal_unit_end, frame_unit_end;
+
+  g_return_val_if_fail (parser != NULL, GST_AV1_PARSER_ERROR);
+  g_return_val_if_fail (data != NULL || size == 0, GST_AV1_PARSER_ERROR);
+  g_return_val_if_fail (obus != NULL, GST_AV1_PARSER_ERROR);
+  g_return_val_if_fail (g_array_get_element_size (obus) == sizeof (GstAV1OBU),
+      GST_AV1_PARSER_ERROR);
+
+  if (!parser->use_annexb) {
+    while (pos < size) {
+      retval = gst_av1_scan_obu (parser, data, pos, size, &obu);
+      if (retval != GST_AV1_PARSER_OK)
+        return retval;
+
+      g_array_append_val (obus, obu);
+      pos = obu.data - data + obu.size;
+    }
+
+    return GST_AV1_PARSER_OK;
+  }
+
+  while (pos < size) {
+    retval = gst_av1_scan_leb128 (data, &pos, size, &unit_size);
+    if (retval != GST_AV1_PARSER_OK)
+      return retval;
+    if (unit_size > size - pos)
+      return GST_AV1_PARSER_ERROR;
+
+    temporal_unit_end = pos + unit_size;
+
+    while (pos < temporal_unit_end) {
+      retval = gst_av1_scan_leb128 (data, &pos, temporal_unit_end, &unit_size);
+      if (retval != GST_AV1_PARSER_OK)
+        return retval;
+      if (unit_size > temporal_unit_end - pos)
+        return GST_AV1_PARSER_BITSTREAM_ERROR;
+
+      frame_unit_end = pos + unit_size;
+
+      while (pos < frame_unit_end) {
+        retval = gst_av1_scan_obu (parser, data, pos, frame_unit_end, &obu);
+        if (retval == GST_AV1_PARSER_ERROR)
+          retval = GST_AV1_PARSER_BITSTREAM_ERROR;
+        if (retval != GST_AV1_PARSER_OK)
+          return retval;
+
+        g_array_append_val (obus, obu);
+        pos = obu.data - data + obu.size;
+      }
+    }
+  }
+
+  return GST_AV1_PARSER_OK;
+}
+
 /**
  * gst_av1_parse_get_first_obu:
  * @parser: a #GstAV1Parser
@@ -2950,6 +3137,9 @@ gst_av1_parse_frame_header_obu (GstAV1Parser * parser, GstAV1OBU * obu,
   GstBitReader br;
   GstAV1ParserResult retval;
   GST_AV1_DEBUG ();
+  /* the OBU may not be the last one whose header was parsed */
+  priv->temporal_id = obu->header.extention.obu_temporal_id;
+  priv->spatial_id = obu->header.extention.obu_spatial_id;
   gst_bit_reader_init (&br, obu->data, obu->size);
   if (priv->seen_frame_header == 1) {
     /*frame_header holds vaild data */
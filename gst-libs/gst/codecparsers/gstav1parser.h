@@ -1945,6 +1945,9 @@ GstAV1ParserResult gst_av1_parse_get_first_obu (GstAV1Parser * parser, const gui
 GST_CODEC_PARSERS_API
 GstAV1ParserResult gst_av1_parse_get_next_obu (GstAV1Parser * parser, GstAV1OBU * obu);
 
+GST_CODEC_PARSERS_API
+GstAV1ParserResult gst_av1_parse_scan_obus (GstAV1Parser * parser, const guint8 * data, gsize size, GArray * obus);
+
 GST_CODEC_PARSERS_API
 GstAV1ParserResult gst_av1_parse_sequence_header_obu (GstAV1Parser * parser, GstAV1OBU * obu, GstAV1SequenceHeaderOBU * seq_header);
 
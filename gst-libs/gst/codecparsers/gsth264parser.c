@@ -2041,22 +2041,11 @@ gst_h264_pps_clear (GstH264PPS * pps)
   pps->slice_group_id = NULL;
 }
 
-/**
- * gst_h264_parser_parse_slice_hdr:
- * @nalparser: a #GstH264NalParser
- * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
- * @slice: The #GstH264SliceHdr to fill.
- * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
- * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
- *
- * Parses @nalu containing a coded slice, and fills @slice.
- *
- * Returns: a #GstH264ParserResult
- */
-GstH264ParserResult
-gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
-    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
-    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+/* Parses the whole slice header, or with @partial only up to and including
+ * the picture order count fields */
+static GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_internal (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice, gboolean partial)
 {
   NalReader nr;
   gint pps_id;
@@ -2141,6 +2130,9 @@ gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
       READ_SE (&nr, slice->delta_pic_order_cnt[1]);
   }
 
+  if (partial)
+    return GST_H264_PARSER_OK;
+
   if (pps->redundant_pic_cnt_present_flag)
     READ_UE_MAX (&nr, slice->redundant_pic_cnt, G_MAXINT8);
 
@@ -2220,6 +2212,58 @@ error:
   return GST_H264_PARSER_ERROR;
 }
 
+/**
+ * gst_h264_parser_parse_slice_hdr:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ * @parse_pred_weight_table: Whether to parse the pred_weight_table or not
+ * @parse_dec_ref_pic_marking: Whether to parse the dec_ref_pic_marking or not
+ *
+ * Parses @nalu containing a coded slice, and fills @slice.
+ *
+ * Returns: a #GstH264ParserResult
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice,
+    gboolean parse_pred_weight_table, gboolean parse_dec_ref_pic_marking)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      FALSE);
+}
+
+/**
+ * gst_h264_parser_parse_slice_hdr_partial:
+ * @nalparser: a #GstH264NalParser
+ * @nalu: The #GST_H264_NAL_SLICE to #GST_H264_NAL_SLICE_IDR #GstH264NalUnit to parse
+ * @slice: The #GstH264SliceHdr to fill.
+ *
+ * Parses the start of the slice header in @nalu, up to and including the
+ * picture order count fields: first_mb_in_slice, slice_type, the PPS,
+ * colour_plane_id, frame_num, the field flags, idr_pic_id, pic_order_cnt_lsb
+ * and delta_pic_order_cnt. max_pic_num is derived from them.
+ *
+ * The fields that are not parsed keep the defaults that
+ * gst_h264_parser_parse_slice_hdr() starts from: the num_ref_idx_*_minus1
+ * fields are copied from the PPS and everything else is zero, including
+ * header_size.
+ *
+ * This is enough to find frame boundaries and key frames, for a fraction
+ * of the cost of gst_h264_parser_parse_slice_hdr().
+ *
+ * Returns: a #GstH264ParserResult
+ *
+ * Since: 1.16
+ */
+GstH264ParserResult
+gst_h264_parser_parse_slice_hdr_partial (GstH264NalParser * nalparser,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice)
+{
+  return gst_h264_parser_parse_slice_hdr_internal (nalparser, nalu, slice,
+      TRUE);
+}
+
 /* Free MVC-specific data from subset SPS header */
 static void
 gst_h264_sps_mvc_clear (GstH264SPS * sps)
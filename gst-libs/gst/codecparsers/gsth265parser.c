@@ -1886,21 +1886,11 @@ gst_h265_parser_parse_pps (GstH265Parser * parser,
   return res;
 }
 
-/**
- * gst_h265_parser_parse_slice_hdr:
- * @parser: a #GstH265Parser
- * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
- * @slice: The #GstH265SliceHdr to fill.
- *
- * Parses @data, and fills the @slice structure.
- * The resulting @slice_hdr structure shall be deallocated with
- * gst_h265_slice_hdr_free() when it is no longer needed
- *
- * Returns: a #GstH265ParserResult
- */
-GstH265ParserResult
-gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
-    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+/* Parses the whole slice segment header, or with @partial only up to and
+ * including slice_pic_order_cnt_lsb */
+static GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_internal (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice, gboolean partial)
 {
   NalReader nr;
   gint pps_id;
@@ -1967,6 +1957,11 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
     READ_UINT32 (&nr, slice->segment_address, n);
   }
 
+  /* the other fields of dependent slice segments are the ones of the
+   * previous independent slice segment */
+  if (partial && slice->dependent_slice_segment_flag)
+    return GST_H265_PARSER_OK;
+
   if (!slice->dependent_slice_segment_flag) {
     for (i = 0; i < pps->num_extra_slice_header_bits; i++)
       nal_reader_skip (&nr, 1);
@@ -1979,10 +1974,15 @@ gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
       READ_UINT8 (&nr, slice->colour_plane_id, 2);
 
     if ((nalu->type != GST_H265_NAL_SLICE_IDR_W_RADL)
-        && (nalu->type != GST_H265_NAL_SLICE_IDR_N_LP)) {
+        && (nalu->type != GST_H265_NAL_SLICE_IDR_N_LP))
       READ_UINT16 (&nr, slice->pic_order_cnt_lsb,
           (sps->log2_max_pic_order_cnt_lsb_minus4 + 4));
 
+    if (partial)
+      return GST_H265_PARSER_OK;
+
+    if ((nalu->type != GST_H265_NAL_SLICE_IDR_W_RADL)
+        && (nalu->type != GST_H265_NAL_SLICE_IDR_N_LP)) {
       READ_UINT8 (&nr, slice->short_term_ref_pic_set_sps_flag, 1);
       if (!slice->short_term_ref_pic_set_sps_flag) {
         if (!gst_h265_parser_parse_short_term_ref_pic_sets
@@ -2185,6 +2185,58 @@ error:
   return GST_H265_PARSER_ERROR;
 }
 
+/**
+ * gst_h265_parser_parse_slice_hdr:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses @data, and fills the @slice structure.
+ * The resulting @slice_hdr structure shall be deallocated with
+ * gst_h265_slice_hdr_free() when it is no longer needed
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, FALSE);
+}
+
+/**
+ * gst_h265_parser_parse_slice_hdr_partial:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses the start of the slice segment header in @nalu, up to and
+ * including slice_pic_order_cnt_lsb: first_slice_segment_in_pic_flag,
+ * no_output_of_prior_pics_flag, the PPS, dependent_slice_segment_flag, the
+ * segment address, slice_type, pic_output_flag, colour_plane_id and
+ * pic_order_cnt_lsb. For dependent slice segments, parsing stops after the
+ * segment address.
+ *
+ * The fields that are not parsed keep the defaults that
+ * gst_h265_parser_parse_slice_hdr() starts from: pic_output_flag and
+ * collocated_from_l0_flag are 1, the deblocking and loop filter fields are
+ * copied from the PPS and everything else is zero, including header_size.
+ *
+ * This is enough to find frame boundaries and key frames, for a fraction
+ * of the cost of gst_h265_parser_parse_slice_hdr().
+ * gst_h265_slice_hdr_free() does not need to be called on the result.
+ *
+ * Returns: a #GstH265ParserResult
+ *
+ * Since: 1.16
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr_partial (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  return gst_h265_parser_parse_slice_hdr_internal (parser, nalu, slice, TRUE);
+}
+
 static gboolean
 nal_reader_has_more_data_in_payload (NalReader * nr,
     guint32 payload_start_pos_bit, guint32 payloadSize)
@@ -61,8 +61,47 @@ ceil_log2 (guint32 v)
   return r + 1;
 }
 
+/* Returns the position of the first 0x00 0x00 @xx sequence starting at or
+ * after @start and ending before @end in @data, or -1.
+ *
+ * The first byte of a match has to be a zero, and zeros are rare in
+ * entropy coded slice data, so this mostly runs memchr(), which libc
+ * vectorises. */
+static gint
+nal_find_00_00_xx (const guint8 * data, guint start, guint end, guint8 xx)
+{
+  const guint8 *p, *last;
+
+  if (end < start + 3)
+    return -1;
+
+  p = data + start;
+  /* one after the last position a match can start at */
+  last = data + end - 2;
+
+  while (p < last) {
+    p = memchr (p, 0x00, last - p);
+    if (p == NULL)
+      return -1;
+
+    if (p[1] != 0x00) {
+      /* neither p nor p + 1 can start a match */
+      p += 2;
+    } else if (p[2] != xx) {
+      /* 0x00 0x00 0x00 might still be followed by @xx */
+      p += p[2] == 0x00 ? 1 : 3;
+    } else {
+      return p - data;
+    }
+  }
+
+  return -1;
+}
+
 /****** Nal parser ******/
 
+#define NAL_READER_EPB_LOOKAHEAD 64
+
 void
 nal_reader_init (NalReader * nr, const guint8 * data, guint size)
 {
@@ -71,12 +110,37 @@ nal_reader_init (NalReader * nr, const guint8 * data, guint size)
   nr->n_epb = 0;
 
   nr->byte = 0;
+  /* look for the first emulation prevention byte when reading starts */
+  nr->epb = 0;
   nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
   nr->first_byte = 0xff;
   nr->cache = 0xff;
 }
 
+/* Called when reaching nr->epb: skips the byte there if it is an
+ * emulation_prevention_three_byte, then looks for the next one in the
+ * following NAL_READER_EPB_LOOKAHEAD bytes. Parsers mostly read a few
+ * header bytes at the start of big slices, so don't look any further. */
+static void
+nal_reader_update_epb (NalReader * nr)
+{
+  guint start, end;
+  gint pos;
+
+  if (nr->byte >= 2 && nr->byte < nr->size && nr->data[nr->byte] == 0x03 &&
+      nr->data[nr->byte - 1] == 0x00 && nr->data[nr->byte - 2] == 0x00) {
+    nr->byte++;
+    nr->n_epb++;
+  }
+
+  /* the two zero bytes before it might already be in the cache */
+  start = nr->byte >= 2 ? nr->byte - 2 : 0;
+  end = MIN (nr->size, nr->byte + NAL_READER_EPB_LOOKAHEAD);
+
+  pos = nal_find_00_00_xx (nr->data, start, end, 0x03);
+  nr->epb = pos >= 0 ? (guint) pos + 2 : end;
+}
+
 gboolean
 nal_reader_read (NalReader * nr, guint nbits)
 {
@@ -87,26 +151,16 @@ nal_reader_read (NalReader * nr, guint nbits)
   }
 
   while (nr->bits_in_cache < nbits) {
-    guint8 byte;
-    gboolean check_three_byte;
+    /* Only the positions found by nal_reader_update_epb() need checking,
+     * every other byte goes to the cache as it is */
+    if (G_UNLIKELY (nr->byte == nr->epb))
+      nal_reader_update_epb (nr);
 
-    check_three_byte = TRUE;
-  next_byte:
     if (G_UNLIKELY (nr->byte >= nr->size))
       return FALSE;
 
-    byte = nr->data[nr->byte++];
-
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
-      nr->n_epb++;
-      goto next_byte;
-    }
     nr->cache = (nr->cache << 8) | nr->first_byte;
-    nr->first_byte = byte;
+    nr->first_byte = nr->data[nr->byte++];
     nr->bits_in_cache += 8;
   }
 
@@ -300,10 +354,9 @@ nal_reader_has_more_data (NalReader * nr)
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  if (size < 4)
+    return -1;
+
+  return nal_find_00_00_xx (data, 0, size - 1, 0x01);
 }
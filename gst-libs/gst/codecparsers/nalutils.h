@@ -48,6 +48,9 @@ typedef struct
 
   guint n_epb;                  /* Number of emulation prevention bytes */
   guint byte;                   /* Byte position */
+  guint epb;                    /* Byte position of the next emulation
+                                 * prevention byte, or of the end of the
+                                 * data searched for one so far */
   guint bits_in_cache;          /* bitpos in the cache of next bit */
   guint8 first_byte;
   guint64 cache;                /* cached bytes */
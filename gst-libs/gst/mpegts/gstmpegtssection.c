@@ -127,16 +127,48 @@ static const guint32 crc_tab[256] = {
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/* Tables for computing the CRC 8 bytes at a time ("slicing-by-8"):
+ * crc_tab_8[n][i] is the CRC of byte i followed by n zero bytes, so
+ * crc_tab_8[0] is crc_tab */
+static guint32 crc_tab_8[8][256];
+
+static gpointer
+_init_crc_tables (gpointer user_data)
+{
+  guint i, n;
+
+  for (i = 0; i < 256; i++) {
+    crc_tab_8[0][i] = crc_tab[i];
+    for (n = 1; n < 8; n++)
+      crc_tab_8[n][i] = (crc_tab_8[n - 1][i] << 8) ^
+          crc_tab[crc_tab_8[n - 1][i] >> 24];
+  }
+
+  return NULL;
+}
+
 /* _calc_crc32 relicensed to LGPL from fluendo ts demuxer */
 guint32
 _calc_crc32 (const guint8 * data, guint datalen)
 {
-  gint i;
+  static GOnce once = G_ONCE_INIT;
   guint32 crc = 0xffffffff;
 
-  for (i = 0; i < datalen; i++) {
-    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+  g_once (&once, _init_crc_tables, NULL);
+
+  for (; datalen >= 8; datalen -= 8, data += 8) {
+    guint32 hi = crc ^ GST_READ_UINT32_BE (data);
+    guint32 lo = GST_READ_UINT32_BE (data + 4);
+
+    crc = crc_tab_8[7][hi >> 24] ^ crc_tab_8[6][(hi >> 16) & 0xff] ^
+        crc_tab_8[5][(hi >> 8) & 0xff] ^ crc_tab_8[4][hi & 0xff] ^
+        crc_tab_8[3][lo >> 24] ^ crc_tab_8[2][(lo >> 16) & 0xff] ^
+        crc_tab_8[1][(lo >> 8) & 0xff] ^ crc_tab_8[0][lo & 0xff];
   }
+
+  while (datalen--)
+    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
+
   return crc;
 }
 
@@ -67,6 +67,8 @@ struct _GstVideoAggregatorPadPrivate
 {
   GstBuffer *buffer;
   GstVideoFrame prepared_frame;
+  /* Result of prepare_frame() when preparing in parallel */
+  gboolean prepare_failed;
 
   /* properties */
   guint zorder;
@@ -349,9 +351,15 @@ struct _GstVideoAggregatorConvertPadPrivate
   /* caps used for conversion if needed */
   GstVideoInfo conversion_info;
   GstBuffer *converted_buffer;
+  /* The input buffer converted_buffer contains the conversion of. Both are
+   * only kept while that input buffer is the current buffer of the pad, so
+   * that repeated frames are not converted again */
+  GstBuffer *converted_input;
 
   GstStructure *converter_config;
   gboolean converter_config_changed;
+  /* converter-config was set since the converter was created */
+  gboolean converter_config_updated;
 };
 
 G_DEFINE_TYPE (GstVideoAggregatorConvertPad, gst_video_aggregator_convert_pad,
@@ -370,9 +378,34 @@ gst_video_aggregator_convert_pad_finalize (GObject * o)
     gst_structure_free (vaggpad->priv->converter_config);
   vaggpad->priv->converter_config = NULL;
 
+  gst_buffer_replace (&vaggpad->priv->converted_buffer, NULL);
+  gst_buffer_replace (&vaggpad->priv->converted_input, NULL);
+
   G_OBJECT_CLASS (gst_video_aggregator_pad_parent_class)->finalize (o);
 }
 
+static void
+gst_video_aggregator_convert_pad_drop_converted (GstVideoAggregatorConvertPad *
+    pad)
+{
+  gst_buffer_replace (&pad->priv->converted_buffer, NULL);
+  gst_buffer_replace (&pad->priv->converted_input, NULL);
+}
+
+static GstFlowReturn
+gst_video_aggregator_convert_pad_flush (GstAggregatorPad * aggpad,
+    GstAggregator * aggregator)
+{
+  GstVideoAggregatorConvertPad *pad = GST_VIDEO_AGGREGATOR_CONVERT_PAD (aggpad);
+
+  gst_video_aggregator_convert_pad_drop_converted (pad);
+
+  return
+      GST_AGGREGATOR_PAD_CLASS
+      (gst_video_aggregator_convert_pad_parent_class)->flush (aggpad,
+      aggregator);
+}
+
 static void
     gst_video_aggregator_convert_pad_update_conversion_info_internal
     (GstVideoAggregatorPad * vpad)
@@ -401,11 +434,14 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     if (conversion_info.finfo == NULL)
       return FALSE;
     pad->priv->converter_config_changed = FALSE;
+    gst_video_aggregator_convert_pad_drop_converted (pad);
 
     if (!pad->priv->conversion_info.finfo
         || !gst_video_info_is_equal (&conversion_info,
-            &pad->priv->conversion_info)) {
+            &pad->priv->conversion_info)
+        || pad->priv->converter_config_updated) {
       pad->priv->conversion_info = conversion_info;
+      pad->priv->converter_config_updated = FALSE;
 
       if (pad->priv->convert)
         gst_video_converter_free (pad->priv->convert);
@@ -430,6 +466,19 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     }
   }
 
+  if (pad->priv->convert && pad->priv->converted_buffer
+      && pad->priv->converted_input == buffer) {
+    GST_LOG_OBJECT (pad, "Input buffer unchanged, reusing converted frame");
+
+    if (!gst_video_frame_map (prepared_frame, &(pad->priv->conversion_info),
+            pad->priv->converted_buffer, GST_MAP_READWRITE)) {
+      GST_WARNING_OBJECT (vagg, "Could not map converted frame");
+      return FALSE;
+    }
+
+    return TRUE;
+  }
+
   if (!gst_video_frame_map (&frame, &vpad->info, buffer, GST_MAP_READ)) {
     GST_WARNING_OBJECT (vagg, "Could not map input buffer");
     return FALSE;
@@ -437,7 +486,6 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
 
   if (pad->priv->convert) {
     GstVideoFrame converted_frame;
-    GstBuffer *converted_buf = NULL;
     static GstAllocationParams params = { 0, 15, 0, 0, };
     gint converted_size;
     guint outsize;
@@ -446,10 +494,13 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     converted_size = pad->priv->conversion_info.size;
     outsize = GST_VIDEO_INFO_SIZE (&vagg->info);
     converted_size = converted_size > outsize ? converted_size : outsize;
-    converted_buf = gst_buffer_new_allocate (NULL, converted_size, &params);
+
+    gst_video_aggregator_convert_pad_drop_converted (pad);
+    pad->priv->converted_buffer =
+        gst_buffer_new_allocate (NULL, converted_size, &params);
 
     if (!gst_video_frame_map (&converted_frame, &(pad->priv->conversion_info),
-            converted_buf, GST_MAP_READWRITE)) {
+            pad->priv->converted_buffer, GST_MAP_READWRITE)) {
       GST_WARNING_OBJECT (vagg, "Could not map converted frame");
 
       gst_video_frame_unmap (&frame);
@@ -457,7 +508,7 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     }
 
     gst_video_converter_frame (pad->priv->convert, &frame, &converted_frame);
-    pad->priv->converted_buffer = converted_buf;
+    pad->priv->converted_input = gst_buffer_ref (buffer);
     gst_video_frame_unmap (&frame);
     *prepared_frame = converted_frame;
   } else {
@@ -478,10 +529,10 @@ gst_video_aggregator_convert_pad_clean_frame (GstVideoAggregatorPad * vpad,
     memset (prepared_frame, 0, sizeof (GstVideoFrame));
   }
 
-  if (pad->priv->converted_buffer) {
-    gst_buffer_unref (pad->priv->converted_buffer);
-    pad->priv->converted_buffer = NULL;
-  }
+  /* The converted buffer stays valid as long as the pad keeps its current
+   * buffer, drop it once the input moved on */
+  if (pad->priv->converted_input != vpad->priv->buffer)
+    gst_video_aggregator_convert_pad_drop_converted (pad);
 }
 
 static void
@@ -574,6 +625,7 @@ gst_video_aggregator_convert_pad_set_property (GObject * object, guint prop_id,
         gst_structure_free (pad->priv->converter_config);
       pad->priv->converter_config = g_value_dup_boxed (value);
       pad->priv->converter_config_changed = TRUE;
+      pad->priv->converter_config_updated = TRUE;
       GST_OBJECT_UNLOCK (pad);
       break;
     default:
@@ -587,6 +639,7 @@ gst_video_aggregator_convert_pad_class_init (GstVideoAggregatorConvertPadClass *
     klass)
 {
   GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstAggregatorPadClass *aggpadclass = (GstAggregatorPadClass *) klass;
   GstVideoAggregatorPadClass *vaggpadclass =
       (GstVideoAggregatorPadClass *) klass;
 
@@ -606,6 +659,9 @@ gst_video_aggregator_convert_pad_class_init (GstVideoAggregatorConvertPadClass *
           "when scaling and converting this pad's video frames",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  aggpadclass->flush =
+      GST_DEBUG_FUNCPTR (gst_video_aggregator_convert_pad_flush);
+
   vaggpadclass->update_conversion_info =
       GST_DEBUG_FUNCPTR
       (gst_video_aggregator_convert_pad_update_conversion_info_internal);
@@ -627,9 +683,11 @@ gst_video_aggregator_convert_pad_init (GstVideoAggregatorConvertPad * vaggpad)
       GstVideoAggregatorConvertPadPrivate);
 
   vaggpad->priv->converted_buffer = NULL;
+  vaggpad->priv->converted_input = NULL;
   vaggpad->priv->convert = NULL;
   vaggpad->priv->converter_config = NULL;
   vaggpad->priv->converter_config_changed = FALSE;
+  vaggpad->priv->converter_config_updated = FALSE;
 }
 
 
@@ -690,6 +748,13 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* Pool running prepare_frame() of several pads concurrently, only used if
+   * the subclass sets parallel_prepare_frames */
+  GThreadPool *prepare_pool;
+  GMutex prepare_lock;
+  GCond prepare_cond;
+  guint prepare_pending;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1619,6 +1684,101 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
       vpad->priv->buffer, &vpad->priv->prepared_frame);
 }
 
+static void
+prepare_frames_thread (GstVideoAggregatorPad * vpad, GstVideoAggregator * vagg)
+{
+  vpad->priv->prepare_failed =
+      !prepare_frames (GST_ELEMENT_CAST (vagg), GST_PAD_CAST (vpad), NULL);
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  if (--vagg->priv->prepare_pending == 0)
+    g_cond_signal (&vagg->priv->prepare_cond);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+}
+
+static gboolean clean_pad (GstElement * agg, GstPad * pad, gpointer user_data);
+
+/* Same as calling prepare_frames() for each sink pad, but the pads that
+ * have a buffer are prepared concurrently on the thread pool. As in the
+ * serial case, the pads after one that failed to prepare its frame end up
+ * without a prepared frame, they are only prepared in vain. */
+static void
+gst_video_aggregator_prepare_frames_parallel (GstVideoAggregator * vagg)
+{
+  GList *pads = NULL, *l;
+  GstVideoAggregatorPad *last = NULL;
+  GError *err = NULL;
+  gboolean failed = FALSE;
+
+  if (!vagg->priv->prepare_pool) {
+    vagg->priv->prepare_pool =
+        g_thread_pool_new ((GFunc) prepare_frames_thread, vagg,
+        g_get_num_processors (), FALSE, &err);
+    if (!vagg->priv->prepare_pool) {
+      GST_WARNING_OBJECT (vagg, "Failed to create thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+      gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+          NULL);
+      return;
+    }
+  }
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT_CAST (vagg)->sinkpads; l; l = l->next)
+    pads = g_list_prepend (pads, gst_object_ref (l->data));
+  GST_OBJECT_UNLOCK (vagg);
+  pads = g_list_reverse (pads);
+
+  for (l = pads; l; l = l->next) {
+    GstVideoAggregatorPad *vpad = l->data;
+
+    vpad->priv->prepare_failed = FALSE;
+
+    if (vpad->priv->buffer == NULL) {
+      prepare_frames (GST_ELEMENT_CAST (vagg), GST_PAD_CAST (vpad), NULL);
+      continue;
+    }
+
+    /* Keep one pad for this thread instead of waiting idly */
+    if (last == NULL) {
+      last = vpad;
+      continue;
+    }
+
+    g_mutex_lock (&vagg->priv->prepare_lock);
+    vagg->priv->prepare_pending++;
+    g_mutex_unlock (&vagg->priv->prepare_lock);
+
+    if (!g_thread_pool_push (vagg->priv->prepare_pool, vpad, &err)) {
+      GST_WARNING_OBJECT (vagg, "Failed to push to thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+      prepare_frames_thread (vpad, vagg);
+    }
+  }
+
+  if (last) {
+    last->priv->prepare_failed =
+        !prepare_frames (GST_ELEMENT_CAST (vagg), GST_PAD_CAST (last), NULL);
+  }
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  while (vagg->priv->prepare_pending > 0)
+    g_cond_wait (&vagg->priv->prepare_cond, &vagg->priv->prepare_lock);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+
+  for (l = pads; l; l = l->next) {
+    GstVideoAggregatorPad *vpad = l->data;
+
+    if (failed)
+      clean_pad (GST_ELEMENT_CAST (vagg), GST_PAD_CAST (vpad), NULL);
+    else if (vpad->priv->prepare_failed)
+      failed = TRUE;
+  }
+  g_list_free_full (pads, gst_object_unref);
+}
+
 static gboolean
 clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
 {
@@ -1647,6 +1807,10 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   g_assert (vagg_klass->aggregate_frames != NULL);
   g_assert (vagg_klass->create_output_buffer != NULL);
 
+  /* Sync pad properties to the stream time, before creating the output
+   * buffer as that might depend on them */
+  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
+
   if ((ret = vagg_klass->create_output_buffer (vagg, outbuf)) != GST_FLOW_OK) {
     GST_WARNING_OBJECT (vagg, "Could not get an output buffer, reason: %s",
         gst_flow_get_name (ret));
@@ -1660,11 +1824,12 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
   GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
 
-  /* Sync pad properties to the stream time */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
-
   /* Convert all the frames the subclass has before aggregating */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  if (vagg_klass->parallel_prepare_frames)
+    gst_video_aggregator_prepare_frames_parallel (vagg);
+  else
+    gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+        NULL);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2464,7 +2629,13 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->prepare_pool)
+    g_thread_pool_free (vagg->priv->prepare_pool, FALSE, TRUE);
+  vagg->priv->prepare_pool = NULL;
+
   g_mutex_clear (&vagg->priv->lock);
+  g_mutex_clear (&vagg->priv->prepare_lock);
+  g_cond_clear (&vagg->priv->prepare_cond);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
 }
@@ -2562,6 +2733,8 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+  g_mutex_init (&vagg->priv->prepare_lock);
+  g_cond_init (&vagg->priv->prepare_cond);
 
   /* initialize variables */
   gst_video_aggregator_reset (vagg);
@@ -216,9 +216,14 @@ struct _GstVideoAggregator
  *                            aggregation should land in @outbuffer.
  * @create_output_buffer:     Optional.
  *                            Lets subclasses provide a #GstBuffer to be used as @outbuffer of
- *                            the #aggregate_frames vmethod.
+ *                            the #aggregate_frames vmethod. The pad properties are already
+ *                            synchronized to the stream time when this is called.
  * @find_best_format:         Optional.
  *                            Lets subclasses decide of the best common format to use.
+ * @parallel_prepare_frames:  Set to %TRUE if the prepare_frame() vmethod of the
+ *                            sink pads can be called for several pads at the same
+ *                            time from different threads. The frames of all pads
+ *                            are then prepared concurrently on a thread pool.
  **/
 struct _GstVideoAggregatorClass
 {
@@ -237,8 +242,10 @@ struct _GstVideoAggregatorClass
                                                    GstVideoInfo       *  best_info,
                                                    gboolean           *  at_least_one_alpha);
 
+  gboolean           parallel_prepare_frames;
+
   /* < private > */
-  gpointer            _gst_reserved[GST_PADDING_LARGE];
+  gpointer            _gst_reserved[GST_PADDING_LARGE - 1];
 };
 
 GST_VIDEO_BAD_API
@@ -44,11 +44,12 @@ GST_DEBUG_CATEGORY_STATIC (gst_compositor_blend_debug);
 #define BLEND_A32(name, method, LOOP)		\
 static void \
 method##_ ##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
-    gdouble src_alpha, GstVideoFrame * destframe, GstCompositorBlendMode mode) \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
 { \
   guint s_alpha; \
   gint src_stride, dest_stride; \
-  gint dest_width, dest_height; \
+  gint dest_width; \
   guint8 *src, *dest; \
   gint src_width, src_height; \
   \
@@ -59,7 +60,6 @@ method##_ ##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   dest = GST_VIDEO_FRAME_PLANE_DATA (destframe, 0); \
   dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (destframe, 0); \
   dest_width = GST_VIDEO_FRAME_COMP_WIDTH (destframe, 0); \
-  dest_height = GST_VIDEO_FRAME_COMP_HEIGHT (destframe, 0); \
   \
   s_alpha = CLAMP ((gint) (src_alpha * 256), 0, 256); \
   \
@@ -73,17 +73,17 @@ method##_ ##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dst_y_start) { \
+    src += (dst_y_start - ypos) * src_stride; \
+    src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
   } \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dst_y_end) { \
+    src_height = dst_y_end - ypos; \
   } \
   \
   if (src_height > 0 && src_width > 0) { \
@@ -143,20 +143,22 @@ BLEND_A32 (bgra, overlay, _overlay_loop_argb);
 
 #define A32_CHECKER_C(name, RGB, A, C1, C2, C3) \
 static void \
-fill_checker_##name##_c (GstVideoFrame * frame) \
+fill_checker_##name##_c (GstVideoFrame * frame, guint y_start, guint y_end) \
 { \
   gint i, j; \
   gint val; \
   static const gint tab[] = { 80, 160, 80, 160 }; \
-  gint width, height; \
+  gint width, stride, dest_add; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  dest_add = stride - width * 4; \
   \
+  dest += y_start * stride; \
   if (!RGB) { \
-    for (i = 0; i < height; i++) { \
+    for (i = y_start; i < y_end; i++) { \
       for (j = 0; j < width; j++) { \
         dest[A] = 0xff; \
         dest[C1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
@@ -164,9 +166,10 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
         dest[C3] = 128; \
         dest += 4; \
       } \
+      dest += dest_add; \
     } \
   } else { \
-    for (i = 0; i < height; i++) { \
+    for (i = y_start; i < y_end; i++) { \
       for (j = 0; j < width; j++) { \
         val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
         dest[A] = 0xFF; \
@@ -175,6 +178,7 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
         dest[C3] = val; \
         dest += 4; \
       } \
+      dest += dest_add; \
     } \
   } \
 }
@@ -189,16 +193,18 @@ A32_CHECKER_C (ayuv, FALSE, 0, 1, 2, 3);
 
 #define A32_COLOR(name, RGB, A, C1, C2, C3) \
 static void \
-fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
+fill_color_##name (GstVideoFrame * frame, guint y_start, guint y_end, \
+    gint Y, gint U, gint V) \
 { \
   gint c1, c2, c3; \
   guint32 val; \
-  gint width, height; \
+  gint width, stride; \
+  guint i; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   if (RGB) { \
     c1 = YUV_TO_R (Y, U, V); \
@@ -211,7 +217,11 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
   } \
   val = GUINT32_FROM_BE ((0xff << A) | (c1 << C1) | (c2 << C2) | (c3 << C3)); \
   \
-  compositor_orc_splat_u32 ((guint32 *) dest, val, height * width); \
+  dest += y_start * stride; \
+  for (i = y_start; i < y_end; i++) { \
+    compositor_orc_splat_u32 ((guint32 *) dest, val, width); \
+    dest += stride; \
+  } \
 }
 
 A32_COLOR (argb, TRUE, 24, 16, 8, 0);
@@ -254,7 +264,8 @@ _blend_##format_name (const guint8 * src, guint8 * dest, \
 \
 static void \
 blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
-    gdouble src_alpha, GstVideoFrame * destframe, GstCompositorBlendMode mode) \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
 { \
   const guint8 *b_src; \
   guint8 *b_dest; \
@@ -267,7 +278,7 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   gint src_comp_width; \
   gint comp_ypos, comp_xpos; \
   gint comp_yoffset, comp_xoffset; \
-  gint dest_width, dest_height; \
+  gint dest_width; \
   const GstVideoFormatInfo *info; \
   gint src_width, src_height; \
   \
@@ -276,7 +287,6 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   \
   info = srcframe->info.finfo; \
   dest_width = GST_VIDEO_FRAME_WIDTH (destframe); \
-  dest_height = GST_VIDEO_FRAME_HEIGHT (destframe); \
   \
   xpos = x_round (xpos); \
   ypos = y_round (ypos); \
@@ -290,10 +300,10 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     b_src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    yoffset = -ypos; \
-    b_src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dst_y_start) { \
+    yoffset = dst_y_start - ypos; \
+    b_src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
   } \
   /* If x or y offset are larger then the source it's outside of the picture */ \
   if (xoffset >= src_width || yoffset >= src_height) { \
@@ -304,8 +314,8 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   if (xpos + b_src_width > dest_width) { \
     b_src_width = dest_width - xpos; \
   } \
-  if (ypos + b_src_height > dest_height) { \
-    b_src_height = dest_height - ypos; \
+  if (ypos + b_src_height > dst_y_end) { \
+    b_src_height = dst_y_end - ypos; \
   } \
   if (b_src_width <= 0 || b_src_height <= 0) { \
     return; \
@@ -363,20 +373,22 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
 
 #define PLANAR_YUV_FILL_CHECKER(format_name, format_enum, MEMSET) \
 static void \
-fill_checker_##format_name (GstVideoFrame * frame) \
+fill_checker_##format_name (GstVideoFrame * frame, guint y_start, guint y_end) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
   guint8 *p; \
-  gint comp_width, comp_height; \
+  gint comp_width, comp_yoffset, comp_height; \
   gint rowstride; \
+  const GstVideoFormatInfo *info; \
   \
+  info = frame->info.finfo; \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  p += y_start * rowstride; \
   \
-  for (i = 0; i < comp_height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     for (j = 0; j < comp_width; j++) { \
       *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
     } \
@@ -385,8 +397,10 @@ fill_checker_##format_name (GstVideoFrame * frame) \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 1); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1); \
+  p += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, 0x80, comp_width); \
@@ -395,8 +409,10 @@ fill_checker_##format_name (GstVideoFrame * frame) \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 2); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 2); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 2); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 2, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 2, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 2); \
+  p += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, 0x80, comp_width); \
@@ -407,17 +423,20 @@ fill_checker_##format_name (GstVideoFrame * frame) \
 #define PLANAR_YUV_FILL_COLOR(format_name,format_enum,MEMSET) \
 static void \
 fill_color_##format_name (GstVideoFrame * frame, \
-    gint colY, gint colU, gint colV) \
+    guint y_start, guint y_end, gint colY, gint colU, gint colV) \
 { \
   guint8 *p; \
-  gint comp_width, comp_height; \
+  gint comp_width, comp_yoffset, comp_height; \
   gint rowstride; \
   gint i; \
+  const GstVideoFormatInfo *info; \
   \
+  info = frame->info.finfo; \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  comp_height = y_end - y_start; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  p += y_start * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, colY, comp_width); \
@@ -426,8 +445,10 @@ fill_color_##format_name (GstVideoFrame * frame, \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 1); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1); \
+  p += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, colU, comp_width); \
@@ -436,8 +457,10 @@ fill_color_##format_name (GstVideoFrame * frame, \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 2); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 2); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 2); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 2, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 2, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 2); \
+  p += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, colV, comp_width); \
@@ -499,7 +522,8 @@ _blend_##format_name (const guint8 * src, guint8 * dest, \
 \
 static void \
 blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
-    gdouble src_alpha, GstVideoFrame * destframe, GstCompositorBlendMode mode)                    \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
 { \
   const guint8 *b_src; \
   guint8 *b_dest; \
@@ -512,7 +536,7 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   gint src_comp_width; \
   gint comp_ypos, comp_xpos; \
   gint comp_yoffset, comp_xoffset; \
-  gint dest_width, dest_height; \
+  gint dest_width; \
   const GstVideoFormatInfo *info; \
   gint src_width, src_height; \
   \
@@ -521,7 +545,6 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   \
   info = srcframe->info.finfo; \
   dest_width = GST_VIDEO_FRAME_WIDTH (destframe); \
-  dest_height = GST_VIDEO_FRAME_HEIGHT (destframe); \
   \
   xpos = GST_ROUND_UP_2 (xpos); \
   ypos = GST_ROUND_UP_2 (ypos); \
@@ -535,10 +558,10 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     b_src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    yoffset += -ypos; \
-    b_src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dst_y_start) { \
+    yoffset = dst_y_start - ypos; \
+    b_src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
   } \
   /* If x or y offset are larger then the source it's outside of the picture */ \
   if (xoffset > src_width || yoffset > src_height) { \
@@ -549,10 +572,10 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   if (xpos + src_width > dest_width) { \
     b_src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    b_src_height = dest_height - ypos; \
+  if (ypos + b_src_height > dst_y_end) { \
+    b_src_height = dst_y_end - ypos; \
   } \
-  if (b_src_width < 0 || b_src_height < 0) { \
+  if (b_src_width <= 0 || b_src_height <= 0) { \
     return; \
   } \
   \
@@ -592,20 +615,22 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
 
 #define NV_YUV_FILL_CHECKER(format_name, MEMSET)        \
 static void \
-fill_checker_##format_name (GstVideoFrame * frame) \
+fill_checker_##format_name (GstVideoFrame * frame, guint y_start, guint y_end) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
   guint8 *p; \
-  gint comp_width, comp_height; \
+  gint comp_width, comp_yoffset, comp_height; \
   gint rowstride; \
+  const GstVideoFormatInfo *info; \
   \
+  info = frame->info.finfo; \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  p += y_start * rowstride; \
   \
-  for (i = 0; i < comp_height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     for (j = 0; j < comp_width; j++) { \
       *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
     } \
@@ -614,8 +639,10 @@ fill_checker_##format_name (GstVideoFrame * frame) \
   \
   p = GST_VIDEO_FRAME_PLANE_DATA (frame, 1); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1); \
+  p += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (p, 0x80, comp_width * 2); \
@@ -626,17 +653,20 @@ fill_checker_##format_name (GstVideoFrame * frame) \
 #define NV_YUV_FILL_COLOR(format_name,MEMSET) \
 static void \
 fill_color_##format_name (GstVideoFrame * frame, \
-    gint colY, gint colU, gint colV) \
+    guint y_start, guint y_end, gint colY, gint colU, gint colV) \
 { \
   guint8 *y, *u, *v; \
-  gint comp_width, comp_height; \
+  gint comp_width, comp_yoffset, comp_height; \
   gint rowstride; \
   gint i, j; \
+  const GstVideoFormatInfo *info; \
   \
+  info = frame->info.finfo; \
   y = GST_VIDEO_FRAME_COMP_DATA (frame, 0); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  comp_height = y_end - y_start; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  y += y_start * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     MEMSET (y, colY, comp_width); \
@@ -646,8 +676,11 @@ fill_color_##format_name (GstVideoFrame * frame, \
   u = GST_VIDEO_FRAME_COMP_DATA (frame, 1); \
   v = GST_VIDEO_FRAME_COMP_DATA (frame, 2); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
-  comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1); \
+  comp_yoffset = (y_start == 0) ? 0 : GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_start); \
+  comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, 1, y_end) - comp_yoffset; \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1); \
+  u += comp_yoffset * rowstride; \
+  v += comp_yoffset * rowstride; \
   \
   for (i = 0; i < comp_height; i++) { \
     for (j = 0; j < comp_width; j++) { \
@@ -670,12 +703,13 @@ NV_YUV_FILL_CHECKER (nv21, memset);
 #define RGB_BLEND(name, bpp, MEMCPY, BLENDLOOP) \
 static void \
 blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
-    gdouble src_alpha, GstVideoFrame * destframe, GstCompositorBlendMode mode) \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
 { \
   gint b_alpha; \
   gint i; \
   gint src_stride, dest_stride; \
-  gint dest_width, dest_height; \
+  gint dest_width; \
   guint8 *dest, *src; \
   gint src_width, src_height; \
   \
@@ -686,7 +720,6 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   dest = GST_VIDEO_FRAME_PLANE_DATA (destframe, 0); \
   \
   dest_width = GST_VIDEO_FRAME_WIDTH (destframe); \
-  dest_height = GST_VIDEO_FRAME_HEIGHT (destframe); \
   \
   src_stride = GST_VIDEO_FRAME_COMP_STRIDE (srcframe, 0); \
   dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (destframe, 0); \
@@ -699,17 +732,20 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dst_y_start) { \
+    src += (dst_y_start - ypos) * src_stride; \
+    src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
   } \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dst_y_end) { \
+    src_height = dst_y_end - ypos; \
+  } \
+  if (src_width <= 0 || src_height <= 0) { \
+    return; \
   } \
   \
   dest = dest + bpp * xpos + (ypos * dest_stride); \
@@ -735,20 +771,20 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
 
 #define RGB_FILL_CHECKER_C(name, bpp, r, g, b) \
 static void \
-fill_checker_##name##_c (GstVideoFrame * frame) \
+fill_checker_##name##_c (GstVideoFrame * frame, guint y_start, guint y_end) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  gint stride, dest_add, width, height; \
+  gint stride, dest_add, width; \
   guint8 *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
-  height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   dest_add = stride - width * bpp; \
+  dest += y_start * stride; \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     for (j = 0; j < width; j++) { \
       dest[r] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* red */ \
       dest[g] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* green */ \
@@ -762,24 +798,24 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 #define RGB_FILL_COLOR(name, bpp, MEMSET_RGB) \
 static void \
 fill_color_##name (GstVideoFrame * frame, \
-    gint colY, gint colU, gint colV) \
+    guint y_start, guint y_end, gint colY, gint colU, gint colV) \
 { \
   gint red, green, blue; \
   gint i; \
   gint dest_stride; \
-  gint width, height; \
+  gint width; \
   guint8 *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
-  height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  dest += y_start * dest_stride; \
   \
   red = YUV_TO_R (colY, colU, colV); \
   green = YUV_TO_G (colY, colU, colV); \
   blue = YUV_TO_B (colY, colU, colV); \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     MEMSET_RGB (dest, red, green, blue, width); \
     dest += dest_stride; \
   } \
@@ -836,12 +872,13 @@ RGB_FILL_COLOR (bgrx, 4, _memset_bgrx);
 #define PACKED_422_BLEND(name, MEMCPY, BLENDLOOP) \
 static void \
 blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
-    gdouble src_alpha, GstVideoFrame * destframe, GstCompositorBlendMode mode) \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
 { \
   gint b_alpha; \
   gint i; \
   gint src_stride, dest_stride; \
-  gint dest_width, dest_height; \
+  gint dest_width; \
   guint8 *src, *dest; \
   gint src_width, src_height; \
   \
@@ -849,7 +886,6 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   src_height = GST_VIDEO_FRAME_HEIGHT (srcframe); \
   \
   dest_width = GST_VIDEO_FRAME_WIDTH (destframe); \
-  dest_height = GST_VIDEO_FRAME_HEIGHT (destframe); \
   \
   src = GST_VIDEO_FRAME_PLANE_DATA (srcframe, 0); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (destframe, 0); \
@@ -867,18 +903,21 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_width -= -xpos; \
     xpos = 0; \
   } \
-  if (ypos < 0) { \
-    src += -ypos * src_stride; \
-    src_height -= -ypos; \
-    ypos = 0; \
+  if (ypos < dst_y_start) { \
+    src += (dst_y_start - ypos) * src_stride; \
+    src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
   } \
   \
   /* adjust width/height if the src is bigger than dest */ \
   if (xpos + src_width > dest_width) { \
     src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
-    src_height = dest_height - ypos; \
+  if (ypos + src_height > dst_y_end) { \
+    src_height = dst_y_end - ypos; \
+  } \
+  if (src_width <= 0 || src_height <= 0) { \
+    return; \
   } \
   \
   dest = dest + 2 * xpos + (ypos * dest_stride); \
@@ -904,22 +943,22 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
 
 #define PACKED_422_FILL_CHECKER_C(name, Y1, U, Y2, V) \
 static void \
-fill_checker_##name##_c (GstVideoFrame * frame) \
+fill_checker_##name##_c (GstVideoFrame * frame, guint y_start, guint y_end) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
   gint dest_add; \
-  gint width, height; \
+  gint width; \
   guint8 *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   width = GST_ROUND_UP_2 (width); \
-  height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   dest_add = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) - width * 2; \
+  dest += y_start * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   width /= 2; \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     for (j = 0; j < width; j++) { \
       dest[Y1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
       dest[Y2] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
@@ -934,24 +973,24 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 #define PACKED_422_FILL_COLOR(name, Y1, U, Y2, V) \
 static void \
 fill_color_##name (GstVideoFrame * frame, \
-    gint colY, gint colU, gint colV) \
+    guint y_start, guint y_end, gint colY, gint colU, gint colV) \
 { \
   gint i; \
   gint dest_stride; \
   guint32 val; \
-  gint width, height; \
+  gint width; \
   guint8 *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   width = GST_ROUND_UP_2 (width); \
-  height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  dest += y_start * dest_stride; \
   width /= 2; \
   \
   val = GUINT32_FROM_BE ((colY << Y1) | (colY << Y2) | (colU << U) | (colV << V)); \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = y_start; i < y_end; i++) { \
     compositor_orc_splat_u32 ((guint32 *) dest, val, width); \
     dest += dest_stride; \
   } \
@@ -964,6 +1003,422 @@ PACKED_422_FILL_COLOR (yuy2, 24, 16, 8, 0);
 PACKED_422_FILL_COLOR (yvyu, 24, 0, 8, 16);
 PACKED_422_FILL_COLOR (uyvy, 16, 24, 0, 8);
 
+/* I420_10LE, Y444_10LE, P010_10LE
+ *
+ * These store every sample in 16 bits, the blending is done with 12 bits of
+ * alpha precision so that all intermediate values fit into 32 bits. The
+ * loops are kept simple so that the compiler can vectorize them. */
+#define BLEND16(D,S,alpha) (((D) * (4096 - (alpha)) + (S) * (alpha)) >> 12)
+
+static inline void
+_blend_u16_le (guint8 * dest, gint dest_stride, const guint8 * src,
+    gint src_stride, guint alpha, gint n_samples, gint height, guint16 mask)
+{
+  gint i, j;
+
+  for (i = 0; i < height; i++) {
+    guint16 *d = (guint16 *) dest;
+    const guint16 *s = (const guint16 *) src;
+
+    for (j = 0; j < n_samples; j++) {
+      guint32 dv = GUINT16_FROM_LE (d[j]);
+      guint32 sv = GUINT16_FROM_LE (s[j]);
+
+      d[j] = GUINT16_TO_LE (BLEND16 (dv, sv, alpha) & mask);
+    }
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+
+/* Fills @n_samples samples alternating between @val1 and @val2 */
+static inline void
+_fill_u16_le (guint8 * dest, guint16 val1, guint16 val2, gint n_samples)
+{
+  guint16 *d = (guint16 *) dest;
+  gint j;
+
+  val1 = GUINT16_TO_LE (val1);
+  val2 = GUINT16_TO_LE (val2);
+  for (j = 0; j + 1 < n_samples; j += 2) {
+    d[j] = val1;
+    d[j + 1] = val2;
+  }
+  if (j < n_samples)
+    d[j] = val1;
+}
+
+/* Scales an 8 bit value to the depth and position of component @c */
+#define SCALE_U16(info, c, val) \
+    ((guint16) (((val) << (GST_VIDEO_FORMAT_INFO_DEPTH (info, c) - 8)) \
+        << GST_VIDEO_FORMAT_INFO_SHIFT (info, c)))
+
+/* Plane p holds component p for all of these formats, with the U and V
+ * components interleaved for P010_10LE */
+static void
+blend_planar_u16 (GstVideoFrame * srcframe, gint xpos, gint ypos,
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start,
+    gint dst_y_end, GstCompositorBlendMode mode)
+{
+  const GstVideoFormatInfo *info = srcframe->info.finfo;
+  gint src_width, src_height, dest_width;
+  gint b_src_width, b_src_height;
+  gint xoffset = 0, yoffset = 0;
+  guint b_alpha, plane;
+
+  /* If it's completely transparent... we just return */
+  if (G_UNLIKELY (src_alpha == 0.0))
+    return;
+
+  src_width = GST_VIDEO_FRAME_WIDTH (srcframe);
+  src_height = GST_VIDEO_FRAME_HEIGHT (srcframe);
+  dest_width = GST_VIDEO_FRAME_WIDTH (destframe);
+
+  xpos = GST_ROUND_UP_N (xpos, 1 << GST_VIDEO_FORMAT_INFO_W_SUB (info, 1));
+  ypos = GST_ROUND_UP_N (ypos, 1 << GST_VIDEO_FORMAT_INFO_H_SUB (info, 1));
+
+  b_src_width = src_width;
+  b_src_height = src_height;
+
+  /* adjust src pointers for negative sizes */
+  if (xpos < 0) {
+    xoffset = -xpos;
+    b_src_width -= -xpos;
+    xpos = 0;
+  }
+  if (ypos < dst_y_start) {
+    yoffset = dst_y_start - ypos;
+    b_src_height -= dst_y_start - ypos;
+    ypos = dst_y_start;
+  }
+  /* If x or y offset are larger then the source it's outside of the picture */
+  if (xoffset >= src_width || yoffset >= src_height)
+    return;
+
+  /* adjust width/height if the src is bigger than dest */
+  if (xpos + b_src_width > dest_width)
+    b_src_width = dest_width - xpos;
+  if (ypos + b_src_height > dst_y_end)
+    b_src_height = dst_y_end - ypos;
+  if (b_src_width <= 0 || b_src_height <= 0)
+    return;
+
+  b_alpha = CLAMP ((gint) (src_alpha * 4096), 0, 4096);
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (destframe); plane++) {
+    const guint8 *b_src;
+    guint8 *b_dest;
+    gint src_stride, dest_stride, pstride;
+    gint comp_width, comp_height, comp_xpos, comp_ypos;
+    gint comp_xoffset, comp_yoffset, i;
+    guint16 mask;
+
+    src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (srcframe, plane);
+    dest_stride = GST_VIDEO_FRAME_PLANE_STRIDE (destframe, plane);
+    pstride = GST_VIDEO_FORMAT_INFO_PSTRIDE (info, plane);
+    mask = ((1 << GST_VIDEO_FORMAT_INFO_DEPTH (info, plane)) - 1)
+        << GST_VIDEO_FORMAT_INFO_SHIFT (info, plane);
+
+    comp_width = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (info, plane, b_src_width);
+    comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane,
+        b_src_height);
+    comp_xpos = (xpos == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (info, plane, xpos);
+    comp_ypos = (ypos == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, ypos);
+    comp_xoffset = (xoffset == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (info, plane, xoffset);
+    comp_yoffset = (yoffset == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, yoffset);
+
+    b_src = (const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (srcframe, plane)
+        + comp_xoffset * pstride + comp_yoffset * src_stride;
+    b_dest = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (destframe, plane)
+        + comp_xpos * pstride + comp_ypos * dest_stride;
+
+    /* If it's completely opaque, we do a fast copy */
+    if (G_UNLIKELY (src_alpha == 1.0)) {
+      for (i = 0; i < comp_height; i++) {
+        memcpy (b_dest, b_src, comp_width * pstride);
+        b_src += src_stride;
+        b_dest += dest_stride;
+      }
+    } else {
+      _blend_u16_le (b_dest, dest_stride, b_src, src_stride, b_alpha,
+          comp_width * pstride / 2, comp_height, mask);
+    }
+  }
+}
+
+static void
+fill_checker_planar_u16 (GstVideoFrame * frame, guint y_start, guint y_end)
+{
+  static const gint tab[] = { 80, 160, 80, 160 };
+  const GstVideoFormatInfo *info = frame->info.finfo;
+  guint16 chroma = SCALE_U16 (info, 1, 0x80);
+  guint16 luma[4];
+  guint8 *p;
+  gint comp_width, comp_yoffset, comp_height, rowstride, pstride;
+  guint plane, i, j;
+
+  for (i = 0; i < 4; i++)
+    luma[i] = GUINT16_TO_LE (SCALE_U16 (info, 0, tab[i]));
+
+  p = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0);
+  rowstride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+  p += y_start * rowstride;
+
+  for (i = y_start; i < y_end; i++) {
+    guint16 *d = (guint16 *) p;
+
+    for (j = 0; j < comp_width; j++)
+      d[j] = luma[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];
+    p += rowstride;
+  }
+
+  for (plane = 1; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+    p = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+    comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, plane);
+    pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, plane);
+    comp_yoffset = (y_start == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, y_start);
+    comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, y_end)
+        - comp_yoffset;
+    rowstride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+    p += comp_yoffset * rowstride;
+
+    for (i = 0; i < comp_height; i++) {
+      _fill_u16_le (p, chroma, chroma, comp_width * pstride / 2);
+      p += rowstride;
+    }
+  }
+}
+
+static void
+fill_color_planar_u16 (GstVideoFrame * frame, guint y_start, guint y_end,
+    gint colY, gint colU, gint colV)
+{
+  const GstVideoFormatInfo *info = frame->info.finfo;
+  guint16 y = SCALE_U16 (info, 0, colY);
+  guint16 u = SCALE_U16 (info, 1, colU);
+  guint16 v = SCALE_U16 (info, 2, colV);
+  guint8 *p;
+  gint comp_width, comp_yoffset, comp_height, rowstride, pstride;
+  guint plane, i;
+
+  p = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0);
+  rowstride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+  p += y_start * rowstride;
+
+  for (i = y_start; i < y_end; i++) {
+    _fill_u16_le (p, y, y, comp_width);
+    p += rowstride;
+  }
+
+  for (plane = 1; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+    guint16 val1, val2;
+
+    p = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+    comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, plane);
+    pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, plane);
+    comp_yoffset = (y_start == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, y_start);
+    comp_height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (info, plane, y_end)
+        - comp_yoffset;
+    rowstride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+    p += comp_yoffset * rowstride;
+
+    /* Interleaved UV or one of the U and V planes */
+    if (pstride == 4) {
+      val1 = u;
+      val2 = v;
+    } else {
+      val1 = val2 = (plane == 1) ? u : v;
+    }
+
+    for (i = 0; i < comp_height; i++) {
+      _fill_u16_le (p, val1, val2, comp_width * pstride / 2);
+      p += rowstride;
+    }
+  }
+}
+
+/* AYUV64: 16 bit A, Y, U and V components in native endianness
+ *
+ * The loops don't branch per pixel so that the compiler can vectorize them.
+ * Alpha values are in [0, 65535], and scaled to [0, 65536] for blending so
+ * that it is done with shifts. */
+static inline void
+_blend_loop_ayuv64 (guint8 * dest, const guint8 * src, gint src_height,
+    gint src_width, gint src_stride, gint dest_stride, guint b_alpha)
+{
+  gint i, j;
+
+  for (i = 0; i < src_height; i++) {
+    guint16 *d = (guint16 *) dest;
+    const guint16 *s = (const guint16 *) src;
+
+    for (j = 0; j < src_width * 4; j += 4) {
+      guint32 sa = (s[j] * b_alpha) >> 12;
+      guint32 sa16 = sa + (sa >> 15);
+      guint32 da16 = 65536 - sa16;
+
+      d[j] = 0xffff;
+      d[j + 1] = (s[j + 1] * sa16 + d[j + 1] * da16) >> 16;
+      d[j + 2] = (s[j + 2] * sa16 + d[j + 2] * da16) >> 16;
+      d[j + 3] = (s[j + 3] * sa16 + d[j + 3] * da16) >> 16;
+    }
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+
+/* The output colour is the average of the source and destination colours
+ * weighted by their alpha. The weight of the source is computed once per
+ * pixel, with a 32 bit division that is a no-op when both are transparent */
+static inline void
+_overlay_loop_ayuv64 (guint8 * dest, const guint8 * src, gint src_height,
+    gint src_width, gint src_stride, gint dest_stride, guint b_alpha,
+    GstCompositorBlendMode mode)
+{
+  /* selects the destination alpha instead of its transparency */
+  guint32 additive = (mode == COMPOSITOR_BLEND_MODE_ADDITIVE) ? 0xffffffff : 0;
+  gint i, j;
+
+  for (i = 0; i < src_height; i++) {
+    guint16 *d = (guint16 *) dest;
+    const guint16 *s = (const guint16 *) src;
+
+    for (j = 0; j < src_width * 4; j += 4) {
+      guint32 sa = (s[j] * b_alpha) >> 12;
+      guint32 sa16 = sa + (sa >> 15);
+      guint32 da = (d[j] * (65536 - sa16)) >> 16;
+      guint32 outa = sa + da;
+      guint32 sw = (sa << 16) / (outa + (outa == 0));
+      guint32 dw = 65536 - sw;
+
+      d[j + 1] = (s[j + 1] * sw + d[j + 1] * dw + 32768) >> 16;
+      d[j + 2] = (s[j + 2] * sw + d[j + 2] * dw + 32768) >> 16;
+      d[j + 3] = (s[j + 3] * sw + d[j + 3] * dw + 32768) >> 16;
+      d[j] = MIN (sa + ((d[j] & additive) | (da & ~additive)), 0xffff);
+    }
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+
+#define BLEND_AYUV64(method, overlay) \
+static void \
+method##_ayuv64 (GstVideoFrame * srcframe, gint xpos, gint ypos, \
+    gdouble src_alpha, GstVideoFrame * destframe, gint dst_y_start, \
+    gint dst_y_end, GstCompositorBlendMode mode) \
+{ \
+  guint b_alpha; \
+  gint src_stride, dest_stride; \
+  gint dest_width; \
+  guint8 *src, *dest; \
+  gint src_width, src_height; \
+  \
+  src_width = GST_VIDEO_FRAME_WIDTH (srcframe); \
+  src_height = GST_VIDEO_FRAME_HEIGHT (srcframe); \
+  src = GST_VIDEO_FRAME_PLANE_DATA (srcframe, 0); \
+  src_stride = GST_VIDEO_FRAME_COMP_STRIDE (srcframe, 0); \
+  dest = GST_VIDEO_FRAME_PLANE_DATA (destframe, 0); \
+  dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (destframe, 0); \
+  dest_width = GST_VIDEO_FRAME_COMP_WIDTH (destframe, 0); \
+  \
+  b_alpha = CLAMP ((gint) (src_alpha * 4096), 0, 4096); \
+  \
+  /* If it's completely transparent... we just return */ \
+  if (G_UNLIKELY (b_alpha == 0)) \
+    return; \
+  \
+  /* adjust src pointers for negative sizes */ \
+  if (xpos < 0) { \
+    src += -xpos * 8; \
+    src_width -= -xpos; \
+    xpos = 0; \
+  } \
+  if (ypos < dst_y_start) { \
+    src += (dst_y_start - ypos) * src_stride; \
+    src_height -= dst_y_start - ypos; \
+    ypos = dst_y_start; \
+  } \
+  /* adjust width/height if the src is bigger than dest */ \
+  if (xpos + src_width > dest_width) { \
+    src_width = dest_width - xpos; \
+  } \
+  if (ypos + src_height > dst_y_end) { \
+    src_height = dst_y_end - ypos; \
+  } \
+  \
+  if (src_height > 0 && src_width > 0) { \
+    dest = dest + 8 * xpos + (ypos * dest_stride); \
+  \
+    if (overlay) \
+      _overlay_loop_ayuv64 (dest, src, src_height, src_width, src_stride, \
+          dest_stride, b_alpha, mode); \
+    else \
+      _blend_loop_ayuv64 (dest, src, src_height, src_width, src_stride, \
+          dest_stride, b_alpha); \
+  } \
+}
+
+BLEND_AYUV64 (blend, FALSE);
+BLEND_AYUV64 (overlay, TRUE);
+
+static void
+fill_checker_ayuv64 (GstVideoFrame * frame, guint y_start, guint y_end)
+{
+  static const guint16 tab[] = { 80 << 8, 160 << 8, 80 << 8, 160 << 8 };
+  gint i, j, width, stride;
+  guint8 *dest;
+
+  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0);
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  dest += y_start * stride;
+
+  for (i = y_start; i < y_end; i++) {
+    guint16 *d = (guint16 *) dest;
+
+    for (j = 0; j < width; j++, d += 4) {
+      d[0] = 0xffff;
+      d[1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];
+      d[2] = 0x8000;
+      d[3] = 0x8000;
+    }
+    dest += stride;
+  }
+}
+
+static void
+fill_color_ayuv64 (GstVideoFrame * frame, guint y_start, guint y_end,
+    gint colY, gint colU, gint colV)
+{
+  gint i, j, width, stride;
+  guint8 *dest;
+
+  dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0);
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  dest += y_start * stride;
+
+  for (i = y_start; i < y_end; i++) {
+    guint16 *d = (guint16 *) dest;
+
+    for (j = 0; j < width; j++, d += 4) {
+      d[0] = 0xffff;
+      d[1] = colY << 8;
+      d[2] = colU << 8;
+      d[3] = colV << 8;
+    }
+    dest += stride;
+  }
+}
+
 /* Init function */
 BlendFunction gst_compositor_blend_argb;
 BlendFunction gst_compositor_blend_bgra;
@@ -983,6 +1438,10 @@ BlendFunction gst_compositor_blend_rgbx;
 /* BGRx, xRGB, xBGR are equal to RGBx */
 BlendFunction gst_compositor_blend_yuy2;
 /* YVYU and UYVY are equal to YUY2 */
+BlendFunction gst_compositor_blend_planar_u16;
+/* I420_10LE, Y444_10LE and P010_10LE share the same function */
+BlendFunction gst_compositor_blend_ayuv64;
+BlendFunction gst_compositor_overlay_ayuv64;
 
 FillCheckerFunction gst_compositor_fill_checker_argb;
 FillCheckerFunction gst_compositor_fill_checker_bgra;
@@ -1002,6 +1461,8 @@ FillCheckerFunction gst_compositor_fill_checker_xrgb;
 FillCheckerFunction gst_compositor_fill_checker_yuy2;
 /* YVYU is equal to YUY2 */
 FillCheckerFunction gst_compositor_fill_checker_uyvy;
+FillCheckerFunction gst_compositor_fill_checker_planar_u16;
+FillCheckerFunction gst_compositor_fill_checker_ayuv64;
 
 FillColorFunction gst_compositor_fill_color_argb;
 FillColorFunction gst_compositor_fill_color_bgra;
@@ -1024,6 +1485,8 @@ FillColorFunction gst_compositor_fill_color_bgrx;
 FillColorFunction gst_compositor_fill_color_yuy2;
 FillColorFunction gst_compositor_fill_color_yvyu;
 FillColorFunction gst_compositor_fill_color_uyvy;
+FillColorFunction gst_compositor_fill_color_planar_u16;
+FillColorFunction gst_compositor_fill_color_ayuv64;
 
 void
 gst_compositor_init_blend (void)
@@ -1044,6 +1507,9 @@ gst_compositor_init_blend (void)
   gst_compositor_blend_rgb = GST_DEBUG_FUNCPTR (blend_rgb);
   gst_compositor_blend_xrgb = GST_DEBUG_FUNCPTR (blend_xrgb);
   gst_compositor_blend_yuy2 = GST_DEBUG_FUNCPTR (blend_yuy2);
+  gst_compositor_blend_planar_u16 = GST_DEBUG_FUNCPTR (blend_planar_u16);
+  gst_compositor_blend_ayuv64 = GST_DEBUG_FUNCPTR (blend_ayuv64);
+  gst_compositor_overlay_ayuv64 = GST_DEBUG_FUNCPTR (overlay_ayuv64);
 
   gst_compositor_fill_checker_argb = GST_DEBUG_FUNCPTR (fill_checker_argb_c);
   gst_compositor_fill_checker_bgra = GST_DEBUG_FUNCPTR (fill_checker_bgra_c);
@@ -1058,6 +1524,9 @@ gst_compositor_init_blend (void)
   gst_compositor_fill_checker_xrgb = GST_DEBUG_FUNCPTR (fill_checker_xrgb_c);
   gst_compositor_fill_checker_yuy2 = GST_DEBUG_FUNCPTR (fill_checker_yuy2_c);
   gst_compositor_fill_checker_uyvy = GST_DEBUG_FUNCPTR (fill_checker_uyvy_c);
+  gst_compositor_fill_checker_planar_u16 =
+      GST_DEBUG_FUNCPTR (fill_checker_planar_u16);
+  gst_compositor_fill_checker_ayuv64 = GST_DEBUG_FUNCPTR (fill_checker_ayuv64);
 
   gst_compositor_fill_color_argb = GST_DEBUG_FUNCPTR (fill_color_argb);
   gst_compositor_fill_color_bgra = GST_DEBUG_FUNCPTR (fill_color_bgra);
@@ -1079,4 +1548,7 @@ gst_compositor_init_blend (void)
   gst_compositor_fill_color_yuy2 = GST_DEBUG_FUNCPTR (fill_color_yuy2);
   gst_compositor_fill_color_yvyu = GST_DEBUG_FUNCPTR (fill_color_yvyu);
   gst_compositor_fill_color_uyvy = GST_DEBUG_FUNCPTR (fill_color_uyvy);
+  gst_compositor_fill_color_planar_u16 =
+      GST_DEBUG_FUNCPTR (fill_color_planar_u16);
+  gst_compositor_fill_color_ayuv64 = GST_DEBUG_FUNCPTR (fill_color_ayuv64);
 }
@@ -36,10 +36,13 @@ typedef enum
   COMPOSITOR_BLEND_MODE_ADDITIVE,
 } GstCompositorBlendMode;
 
+/* The dst_y_start/dst_y_end and y_start/y_end arguments restrict the
+ * operation to the output lines [start, end), which allows the output frame
+ * to be processed in independent horizontal stripes. */
 typedef void (*BlendFunction) (GstVideoFrame *srcframe, gint xpos, gint ypos, gdouble src_alpha, GstVideoFrame * destframe,
-    GstCompositorBlendMode mode);
-typedef void (*FillCheckerFunction) (GstVideoFrame * frame);
-typedef void (*FillColorFunction) (GstVideoFrame * frame, gint c1, gint c2, gint c3);
+    gint dst_y_start, gint dst_y_end, GstCompositorBlendMode mode);
+typedef void (*FillCheckerFunction) (GstVideoFrame * frame, guint y_start, guint y_end);
+typedef void (*FillColorFunction) (GstVideoFrame * frame, guint y_start, guint y_end, gint c1, gint c2, gint c3);
 
 extern BlendFunction gst_compositor_blend_argb;
 extern BlendFunction gst_compositor_blend_bgra;
@@ -73,6 +76,12 @@ extern BlendFunction gst_compositor_blend_rgbx;
 extern BlendFunction gst_compositor_blend_yuy2;
 #define gst_compositor_blend_uyvy gst_compositor_blend_yuy2;
 #define gst_compositor_blend_yvyu gst_compositor_blend_yuy2;
+extern BlendFunction gst_compositor_blend_planar_u16;
+#define gst_compositor_blend_i420_10le gst_compositor_blend_planar_u16
+#define gst_compositor_blend_y444_10le gst_compositor_blend_planar_u16
+#define gst_compositor_blend_p010_10le gst_compositor_blend_planar_u16
+extern BlendFunction gst_compositor_blend_ayuv64;
+extern BlendFunction gst_compositor_overlay_ayuv64;
 
 extern FillCheckerFunction gst_compositor_fill_checker_argb;
 #define gst_compositor_fill_checker_abgr gst_compositor_fill_checker_argb
@@ -95,6 +104,11 @@ extern FillCheckerFunction gst_compositor_fill_checker_rgbx;
 extern FillCheckerFunction gst_compositor_fill_checker_yuy2;
 #define gst_compositor_fill_checker_yvyu gst_compositor_fill_checker_yuy2;
 extern FillCheckerFunction gst_compositor_fill_checker_uyvy;
+extern FillCheckerFunction gst_compositor_fill_checker_planar_u16;
+#define gst_compositor_fill_checker_i420_10le gst_compositor_fill_checker_planar_u16
+#define gst_compositor_fill_checker_y444_10le gst_compositor_fill_checker_planar_u16
+#define gst_compositor_fill_checker_p010_10le gst_compositor_fill_checker_planar_u16
+extern FillCheckerFunction gst_compositor_fill_checker_ayuv64;
 
 extern FillColorFunction gst_compositor_fill_color_argb;
 extern FillColorFunction gst_compositor_fill_color_abgr;
@@ -117,6 +131,11 @@ extern FillColorFunction gst_compositor_fill_color_bgrx;
 extern FillColorFunction gst_compositor_fill_color_yuy2;
 extern FillColorFunction gst_compositor_fill_color_yvyu;
 extern FillColorFunction gst_compositor_fill_color_uyvy;
+extern FillColorFunction gst_compositor_fill_color_planar_u16;
+#define gst_compositor_fill_color_i420_10le gst_compositor_fill_color_planar_u16
+#define gst_compositor_fill_color_y444_10le gst_compositor_fill_color_planar_u16
+#define gst_compositor_fill_color_p010_10le gst_compositor_fill_color_planar_u16
+extern FillColorFunction gst_compositor_fill_color_ayuv64;
 
 void gst_compositor_init_blend (void);
 
@@ -84,6 +84,22 @@
  *   timeoverlay ! queue2 ! comp.
  * ]| A pipeline to demonstrate synchronized compositing (the second stream starts after 3 seconds)
  *
+ * Setting the #GstCompositor:n-threads property to a value other than 1
+ * splits every output frame into horizontal stripes that are filled and
+ * blended concurrently. The result is identical to the single-threaded
+ * output.
+ *
+ * With #GstCompositor:reuse-static-inputs enabled, only the output lines
+ * touched by pads whose buffer, position, size, alpha or zorder changed
+ * since the previous output frame are composited again. All other lines are
+ * copied from a cached copy of the previous output frame, which helps with
+ * mostly static layouts like a slide with a small camera overlay.
+ *
+ * If the only visible pad is an opaque input with the output caps at
+ * position 0,0 in its original size, its buffers are pushed downstream
+ * without copying them, which makes switching between full-frame inputs
+ * cheap.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -106,7 +122,7 @@ GST_DEBUG_CATEGORY_STATIC (gst_compositor_debug);
 
 #define FORMATS " { AYUV, BGRA, ARGB, RGBA, ABGR, Y444, Y42B, YUY2, UYVY, "\
                 "   YVYU, I420, YV12, NV12, NV21, Y41B, RGB, BGR, xRGB, xBGR, "\
-                "   RGBx, BGRx } "
+                "   RGBx, BGRx, AYUV64, Y444_10LE, I420_10LE, P010_10LE } "
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -270,6 +286,76 @@ is_rectangle_contained (GstVideoRectangle rect1, GstVideoRectangle rect2)
   return FALSE;
 }
 
+/* Remove rectangle2 from every rectangle in @rects, replacing each of them by
+ * the (up to four) parts of it that are not covered by rectangle2. Once
+ * @rects is empty the area it described is completely covered. */
+static void
+subtract_rectangle (GArray * rects, GstVideoRectangle rect2)
+{
+  GArray *remaining;
+  guint i;
+
+  remaining = g_array_sized_new (FALSE, FALSE, sizeof (GstVideoRectangle),
+      rects->len);
+
+  for (i = 0; i < rects->len; i++) {
+    GstVideoRectangle rect1 = g_array_index (rects, GstVideoRectangle, i);
+    GstVideoRectangle piece;
+    gint x1, y1, x2, y2;
+
+    if (is_rectangle_contained (rect1, rect2))
+      continue;
+
+    /* Intersection of both rectangles */
+    x1 = MAX (rect1.x, rect2.x);
+    y1 = MAX (rect1.y, rect2.y);
+    x2 = MIN (rect1.x + rect1.w, rect2.x + rect2.w);
+    y2 = MIN (rect1.y + rect1.h, rect2.y + rect2.h);
+
+    if (x1 >= x2 || y1 >= y2) {
+      g_array_append_val (remaining, rect1);
+      continue;
+    }
+
+    /* Full-width band above the intersection */
+    if (y1 > rect1.y) {
+      piece.x = rect1.x;
+      piece.y = rect1.y;
+      piece.w = rect1.w;
+      piece.h = y1 - rect1.y;
+      g_array_append_val (remaining, piece);
+    }
+    /* Full-width band below the intersection */
+    if (y2 < rect1.y + rect1.h) {
+      piece.x = rect1.x;
+      piece.y = y2;
+      piece.w = rect1.w;
+      piece.h = rect1.y + rect1.h - y2;
+      g_array_append_val (remaining, piece);
+    }
+    /* Left and right of the intersection */
+    if (x1 > rect1.x) {
+      piece.x = rect1.x;
+      piece.y = y1;
+      piece.w = x1 - rect1.x;
+      piece.h = y2 - y1;
+      g_array_append_val (remaining, piece);
+    }
+    if (x2 < rect1.x + rect1.w) {
+      piece.x = x2;
+      piece.y = y1;
+      piece.w = rect1.x + rect1.w - x2;
+      piece.h = y2 - y1;
+      g_array_append_val (remaining, piece);
+    }
+  }
+
+  g_array_set_size (rects, 0);
+  if (remaining->len > 0)
+    g_array_append_vals (rects, remaining->data, remaining->len);
+  g_array_free (remaining, TRUE);
+}
+
 static GstVideoRectangle
 clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
     gint outer_height)
@@ -290,6 +376,66 @@ clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
   return clamped;
 }
 
+/* Number of output lines stripes and blending ranges have to be aligned to,
+ * so that no subsampled chroma line is shared between two ranges */
+static guint
+_get_line_alignment (GstVideoInfo * info)
+{
+  guint align = 1, i;
+
+  for (i = 0; i < GST_VIDEO_INFO_N_COMPONENTS (info); i++)
+    align = MAX (align, 1 << GST_VIDEO_FORMAT_INFO_H_SUB (info->finfo, i));
+
+  return align;
+}
+
+/* WITH GST_OBJECT_LOCK
+ * Returns: %TRUE if @cpad has a buffer that will completely overwrite the
+ * output area it covers, which is stored in @rect */
+static gboolean
+_pad_get_opaque_rectangle (GstCompositor * comp, GstCompositorPad * cpad,
+    GstVideoRectangle * rect)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (comp);
+  GstVideoAggregatorPad *pad = GST_VIDEO_AGGREGATOR_PAD (cpad);
+  gint width, height, x_end, y_end;
+  guint x_align, y_align, i;
+
+  /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
+   * channel, then check opacity */
+  if (!gst_video_aggregator_pad_has_current_buffer (pad)
+      || cpad->alpha != 1.0 || GST_VIDEO_INFO_HAS_ALPHA (&pad->info))
+    return FALSE;
+
+  _mixer_pad_get_output_size (comp, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
+      GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
+
+  /* This is effectively what set_info and the conversion code do to
+   * calculate the desired width/height */
+  *rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+      GST_VIDEO_INFO_WIDTH (&vagg->info), GST_VIDEO_INFO_HEIGHT (&vagg->info));
+
+  /* The blend functions round the position up to the chroma subsampling,
+   * so only the aligned inner rectangle is sure to be overwritten */
+  x_align = 1;
+  y_align = 1;
+  for (i = 0; i < GST_VIDEO_INFO_N_COMPONENTS (&vagg->info); i++) {
+    x_align = MAX (x_align,
+        1 << GST_VIDEO_FORMAT_INFO_W_SUB (vagg->info.finfo, i));
+    y_align = MAX (y_align,
+        1 << GST_VIDEO_FORMAT_INFO_H_SUB (vagg->info.finfo, i));
+  }
+
+  x_end = GST_ROUND_DOWN_N (rect->x + rect->w, x_align);
+  y_end = GST_ROUND_DOWN_N (rect->y + rect->h, y_align);
+  rect->x = GST_ROUND_UP_N (rect->x, x_align);
+  rect->y = GST_ROUND_UP_N (rect->y, y_align);
+  rect->w = MAX (x_end - rect->x, 0);
+  rect->h = MAX (y_end - rect->y, 0);
+
+  return rect->w > 0 && rect->h > 0;
+}
+
 static gboolean
 gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg, GstBuffer * buffer,
@@ -298,11 +444,15 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstCompositor *comp = GST_COMPOSITOR (vagg);
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
   gint width, height;
-  gboolean frame_obscured = FALSE;
+  gboolean crossfading = FALSE;
   GList *l;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
   GstVideoRectangle frame_rect;
+  /* The parts of frame_rect not obscured by higher-zorder frames */
+  GArray *visible;
+  gint visible_y_start, visible_y_end;
+  guint i, align;
 
   /* There's three types of width/height here:
    * 1. GST_VIDEO_FRAME_WIDTH/HEIGHT:
@@ -316,6 +466,10 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
    *     width/height. See ->set_info()
    * */
 
+  /* The output is the buffer of one of the pads, nothing gets blended */
+  if (comp->passthrough)
+    return TRUE;
+
   _mixer_pad_get_output_size (comp, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
       GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
 
@@ -339,50 +493,70 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   if ((l->prev && GST_COMPOSITOR_PAD (l->prev->data)->crossfade >= 0.0) ||
       (GST_COMPOSITOR_PAD (pad)->crossfade >= 0.0)) {
     GST_DEBUG_OBJECT (pad, "Is being crossfaded with previous pad");
+    crossfading = TRUE;
     l = NULL;
   } else {
     l = l->next;
   }
 
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
+  /* Check which parts of this frame are obscured by the combination of all
    * higher-zorder frames */
-  for (; l; l = l->next) {
+  visible = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  g_array_append_val (visible, frame_rect);
+  for (; l && visible->len > 0; l = l->next) {
     GstVideoRectangle frame2_rect;
-    GstVideoAggregatorPad *pad2 = l->data;
-    GstCompositorPad *cpad2 = GST_COMPOSITOR_PAD (pad2);
-    gint pad2_width, pad2_height;
-
-    _mixer_pad_get_output_size (comp, cpad2, GST_VIDEO_INFO_PAR_N (&vagg->info),
-        GST_VIDEO_INFO_PAR_D (&vagg->info), &pad2_width, &pad2_height);
-
-    /* We don't need to clamp the coords of the second rectangle */
-    frame2_rect.x = cpad2->xpos;
-    frame2_rect.y = cpad2->ypos;
-    /* This is effectively what set_info and the above conversion
-     * code do to calculate the desired width/height */
-    frame2_rect.w = pad2_width;
-    frame2_rect.h = pad2_height;
-
-    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
-     * channel, then check opacity and frame boundaries */
-    if (gst_video_aggregator_pad_has_current_buffer (pad2)
-        && cpad2->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad2->info)
-        && is_rectangle_contained (frame_rect, frame2_rect)) {
-      frame_obscured = TRUE;
-      GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %s %ix%i@(%i,%i) "
-          "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
-          frame_rect.x, frame_rect.y, GST_PAD_NAME (pad2), frame2_rect.w,
-          frame2_rect.h, frame2_rect.x, frame2_rect.y,
-          GST_VIDEO_INFO_WIDTH (&vagg->info),
-          GST_VIDEO_INFO_HEIGHT (&vagg->info));
-      break;
-    }
+
+    if (!_pad_get_opaque_rectangle (comp, GST_COMPOSITOR_PAD (l->data),
+            &frame2_rect))
+      continue;
+
+    subtract_rectangle (visible, frame2_rect);
+    GST_LOG_OBJECT (pad, "%ix%i@(%i,%i) covered by %s %ix%i@(%i,%i), "
+        "%u visible parts left", frame_rect.w, frame_rect.h, frame_rect.x,
+        frame_rect.y, GST_PAD_NAME (l->data), frame2_rect.w, frame2_rect.h,
+        frame2_rect.x, frame2_rect.y, visible->len);
   }
   GST_OBJECT_UNLOCK (vagg);
 
-  if (frame_obscured)
+  if (visible->len == 0) {
+    GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by higher-zorder frames "
+        "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
+        frame_rect.x, frame_rect.y, GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
+    g_array_free (visible, TRUE);
     goto done;
+  }
+
+  if (crossfading) {
+    /* The prepared frame is replaced by an output sized one */
+    visible_y_start = 0;
+    visible_y_end = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  } else {
+    visible_y_start = G_MAXINT;
+    visible_y_end = 0;
+    for (i = 0; i < visible->len; i++) {
+      GstVideoRectangle *rect = &g_array_index (visible, GstVideoRectangle, i);
+
+      visible_y_start = MIN (visible_y_start, rect->y);
+      visible_y_end = MAX (visible_y_end, rect->y + rect->h);
+    }
+
+    /* The blend functions may move the frame down to the next line that is
+     * not subsampled away, so widen the range to cover that */
+    align = _get_line_alignment (&vagg->info);
+    visible_y_start = (visible_y_start / align) * align;
+    visible_y_end = ((visible_y_end + 2 * align - 2) / align) * align;
+    visible_y_end = MIN (visible_y_end, GST_VIDEO_INFO_HEIGHT (&vagg->info));
+
+    if (visible_y_start != frame_rect.y
+        || visible_y_end < frame_rect.y + frame_rect.h)
+      GST_LOG_OBJECT (pad, "Partially obscured, blending only lines %i-%i",
+          visible_y_start, visible_y_end);
+  }
+  g_array_free (visible, TRUE);
+
+  cpad->visible_y_start = visible_y_start;
+  cpad->visible_y_end = visible_y_end;
 
   return
       GST_VIDEO_AGGREGATOR_PAD_CLASS
@@ -437,6 +611,16 @@ gst_compositor_pad_create_conversion_info (GstVideoAggregatorConvertPad * pad,
   }
 }
 
+static void
+gst_compositor_pad_finalize (GObject * object)
+{
+  GstCompositorPad *pad = GST_COMPOSITOR_PAD (object);
+
+  gst_buffer_replace (&pad->composited_buffer, NULL);
+
+  G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -448,6 +632,7 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   gobject_class->set_property = gst_compositor_pad_set_property;
   gobject_class->get_property = gst_compositor_pad_get_property;
+  gobject_class->finalize = gst_compositor_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
       g_param_spec_int ("xpos", "X Position", "X Position of the picture",
@@ -493,12 +678,192 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 }
 
 
+/* GstParallelizedTaskRunner */
+typedef void (*GstParallelizedTaskFunc) (gpointer user_data);
+
+typedef struct _GstParallelizedTaskThread GstParallelizedTaskThread;
+
+struct _GstParallelizedTaskThread
+{
+  GstParallelizedTaskRunner *runner;
+  guint idx;
+  GThread *thread;
+};
+
+struct _GstParallelizedTaskRunner
+{
+  guint n_threads;
+
+  GstParallelizedTaskThread *threads;
+
+  GstParallelizedTaskFunc func;
+  gpointer *task_data;
+
+  GMutex lock;
+  GCond cond_todo, cond_done;
+  gint n_todo, n_done;
+  gboolean quit;
+};
+
+static gpointer
+gst_parallelized_task_thread_func (gpointer data)
+{
+  GstParallelizedTaskThread *self = data;
+
+  g_mutex_lock (&self->runner->lock);
+  self->runner->n_done++;
+  if (self->runner->n_done == self->runner->n_threads - 1)
+    g_cond_signal (&self->runner->cond_done);
+
+  do {
+    gint idx;
+
+    while (self->runner->n_todo == -1 && !self->runner->quit)
+      g_cond_wait (&self->runner->cond_todo, &self->runner->lock);
+
+    if (self->runner->quit)
+      break;
+
+    idx = self->runner->n_todo--;
+    g_assert (self->runner->n_todo >= -1);
+    g_mutex_unlock (&self->runner->lock);
+
+    g_assert (self->runner->func != NULL);
+
+    self->runner->func (self->runner->task_data[idx]);
+
+    g_mutex_lock (&self->runner->lock);
+    self->runner->n_done++;
+    if (self->runner->n_done == self->runner->n_threads - 1)
+      g_cond_signal (&self->runner->cond_done);
+  } while (TRUE);
+
+  g_mutex_unlock (&self->runner->lock);
+
+  return NULL;
+}
+
+static void
+gst_parallelized_task_runner_free (GstParallelizedTaskRunner * self)
+{
+  guint i;
+
+  g_mutex_lock (&self->lock);
+  self->quit = TRUE;
+  g_cond_broadcast (&self->cond_todo);
+  g_mutex_unlock (&self->lock);
+
+  for (i = 1; i < self->n_threads; i++) {
+    if (!self->threads[i].thread)
+      continue;
+
+    g_thread_join (self->threads[i].thread);
+  }
+
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond_todo);
+  g_cond_clear (&self->cond_done);
+  g_free (self->threads);
+  g_free (self);
+}
+
+/* The calling thread always runs one of the tasks itself, so only
+ * @n_threads - 1 additional threads are started. If starting a thread fails
+ * the runner continues with the threads that could be started. */
+static GstParallelizedTaskRunner *
+gst_parallelized_task_runner_new (guint n_threads)
+{
+  GstParallelizedTaskRunner *self;
+  guint i;
+  GError *err = NULL;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  self = g_new0 (GstParallelizedTaskRunner, 1);
+  self->n_threads = n_threads;
+  self->threads = g_new0 (GstParallelizedTaskThread, n_threads);
+
+  self->quit = FALSE;
+  self->n_todo = -1;
+  self->n_done = 0;
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond_todo);
+  g_cond_init (&self->cond_done);
+
+  /* Set when scheduling a job */
+  self->func = NULL;
+  self->task_data = NULL;
+
+  g_mutex_lock (&self->lock);
+  for (i = 1; i < n_threads; i++) {
+    self->threads[i].runner = self;
+    self->threads[i].idx = i;
+    self->threads[i].thread =
+        g_thread_try_new ("compositor-blend", gst_parallelized_task_thread_func,
+        &self->threads[i], &err);
+    if (!self->threads[i].thread) {
+      GST_WARNING ("Failed to start thread %u: %s", i, err->message);
+      g_clear_error (&err);
+      self->n_threads = i;
+      break;
+    }
+  }
+
+  /* Wait for all threads to be started */
+  while (self->n_done != self->n_threads - 1)
+    g_cond_wait (&self->cond_done, &self->lock);
+  self->n_done = 0;
+  g_mutex_unlock (&self->lock);
+
+  return self;
+}
+
+/* Runs @func once for each of the runner's n_threads entries of @task_data
+ * and returns once all of them are done */
+static void
+gst_parallelized_task_runner_run (GstParallelizedTaskRunner * self,
+    GstParallelizedTaskFunc func, gpointer * task_data)
+{
+  guint n_threads = self->n_threads;
+
+  self->func = func;
+  self->task_data = task_data;
+
+  if (n_threads > 1) {
+    g_mutex_lock (&self->lock);
+    self->n_todo = self->n_threads - 2;
+    self->n_done = 0;
+    g_cond_broadcast (&self->cond_todo);
+    g_mutex_unlock (&self->lock);
+  }
+
+  self->func (self->task_data[self->n_threads - 1]);
+
+  if (n_threads > 1) {
+    g_mutex_lock (&self->lock);
+    while (self->n_done < self->n_threads - 1)
+      g_cond_wait (&self->cond_done, &self->lock);
+    self->n_done = 0;
+    g_mutex_unlock (&self->lock);
+  }
+
+  self->func = NULL;
+  self->task_data = NULL;
+}
+
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_N_THREADS 1
+/* More threads than stripes worth blending only add overhead */
+#define MAX_N_THREADS 64
+#define DEFAULT_REUSE_STATIC_INPUTS FALSE
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_N_THREADS,
+  PROP_REUSE_STATIC_INPUTS,
 };
 
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
@@ -534,6 +899,16 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_REUSE_STATIC_INPUTS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->reuse_static_inputs);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -550,6 +925,16 @@ gst_compositor_set_property (GObject * object,
     case PROP_BACKGROUND:
       self->background = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_REUSE_STATIC_INPUTS:
+      GST_OBJECT_LOCK (self);
+      self->reuse_static_inputs = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -719,6 +1104,34 @@ set_functions (GstCompositor * self, GstVideoInfo * info)
       self->fill_color = gst_compositor_fill_color_bgrx;
       ret = TRUE;
       break;
+    case GST_VIDEO_FORMAT_AYUV64:
+      self->blend = gst_compositor_blend_ayuv64;
+      self->overlay = gst_compositor_overlay_ayuv64;
+      self->fill_checker = gst_compositor_fill_checker_ayuv64;
+      self->fill_color = gst_compositor_fill_color_ayuv64;
+      ret = TRUE;
+      break;
+    case GST_VIDEO_FORMAT_Y444_10LE:
+      self->blend = gst_compositor_blend_y444_10le;
+      self->overlay = self->blend;
+      self->fill_checker = gst_compositor_fill_checker_y444_10le;
+      self->fill_color = gst_compositor_fill_color_y444_10le;
+      ret = TRUE;
+      break;
+    case GST_VIDEO_FORMAT_I420_10LE:
+      self->blend = gst_compositor_blend_i420_10le;
+      self->overlay = self->blend;
+      self->fill_checker = gst_compositor_fill_checker_i420_10le;
+      self->fill_color = gst_compositor_fill_color_i420_10le;
+      ret = TRUE;
+      break;
+    case GST_VIDEO_FORMAT_P010_10LE:
+      self->blend = gst_compositor_blend_p010_10le;
+      self->overlay = self->blend;
+      self->fill_checker = gst_compositor_fill_checker_p010_10le;
+      self->fill_color = gst_compositor_fill_color_p010_10le;
+      ret = TRUE;
+      break;
     default:
       break;
   }
@@ -820,13 +1233,14 @@ _negotiated_caps (GstAggregator * agg, GstCaps * caps)
   return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
 }
 
-/* Fills frame with transparent pixels if @nframe is NULL otherwise copy @frame
- * properties and fill @nframes with transparent pixels */
+/* Fills lines [y_start, y_end) of frame with transparent pixels if @nframe
+ * is NULL otherwise copy @frame properties and fill the lines of @nframes
+ * with transparent pixels */
 static GstFlowReturn
 gst_compositor_fill_transparent (GstCompositor * self, GstVideoFrame * frame,
-    GstVideoFrame * nframe)
+    GstVideoFrame * nframe, guint y_start, guint y_end)
 {
-  guint plane, num_planes, height, i;
+  guint plane, num_planes, comp_y_start, height, i;
 
   if (nframe) {
     GstBuffer *cbuffer = gst_buffer_copy_deep (frame->buffer);
@@ -848,7 +1262,11 @@ gst_compositor_fill_transparent (GstCompositor * self, GstVideoFrame * frame,
     plane_stride = GST_VIDEO_FRAME_PLANE_STRIDE (nframe, plane);
     rowsize = GST_VIDEO_FRAME_COMP_WIDTH (nframe, plane)
         * GST_VIDEO_FRAME_COMP_PSTRIDE (nframe, plane);
-    height = GST_VIDEO_FRAME_COMP_HEIGHT (nframe, plane);
+    comp_y_start = (y_start == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (nframe->info.finfo, plane, y_start);
+    height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (nframe->info.finfo, plane,
+        y_end) - comp_y_start;
+    pdata += comp_y_start * plane_stride;
     for (i = 0; i < height; ++i) {
       memset (pdata, 0, rowsize);
       pdata += plane_stride;
@@ -903,7 +1321,8 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
           npad ? gst_video_aggregator_pad_get_prepared_frame (npad) : NULL;
 
       if (!all_crossfading) {
-        gst_compositor_fill_transparent (self, outframe, &nframe);
+        gst_compositor_fill_transparent (self, outframe, &nframe, 0,
+            GST_VIDEO_FRAME_HEIGHT (outframe));
       } else {
         nframe = *outframe;
       }
@@ -911,15 +1330,16 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
       self->overlay (prepared_frame,
           compo_pad->crossfaded ? 0 : compo_pad->xpos,
           compo_pad->crossfaded ? 0 : compo_pad->ypos,
-          alpha, &nframe, COMPOSITOR_BLEND_MODE_ADDITIVE);
+          alpha, &nframe, 0, GST_VIDEO_FRAME_HEIGHT (&nframe),
+          COMPOSITOR_BLEND_MODE_ADDITIVE);
 
       if (npad && next_prepared_frame) {
         GstCompositorPad *next_compo_pad = GST_COMPOSITOR_PAD (npad);
 
         alpha = (1.0 - compo_pad->crossfade) * next_compo_pad->alpha;
         self->overlay (next_prepared_frame, next_compo_pad->xpos,
-            next_compo_pad->ypos, alpha, &nframe,
-            COMPOSITOR_BLEND_MODE_ADDITIVE);
+            next_compo_pad->ypos, alpha, &nframe, 0,
+            GST_VIDEO_FRAME_HEIGHT (&nframe), COMPOSITOR_BLEND_MODE_ADDITIVE);
 
         /* Replace frame with current frame */
         pad_class->clean_frame (npad, vagg, next_prepared_frame);
@@ -946,13 +1366,461 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
   return all_crossfading;
 }
 
+/* WITH GST_OBJECT_LOCK
+ * Returns: %TRUE if the opaque pads completely cover the output frame so
+ * that the background is never visible */
+static gboolean
+_background_obscured (GstCompositor * self)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoRectangle bg_rect = { 0, 0, GST_VIDEO_INFO_WIDTH (&vagg->info),
+    GST_VIDEO_INFO_HEIGHT (&vagg->info)
+  };
+  GArray *visible;
+  gboolean obscured;
+  GList *l;
+
+  /* The transparent background is blended with different rules */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    return FALSE;
+
+  visible = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  g_array_append_val (visible, bg_rect);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l && visible->len > 0; l = l->next) {
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (l->data);
+    GstVideoRectangle rect;
+
+    /* Crossfaded pads are not blended as is */
+    if (cpad->crossfade >= 0.0) {
+      g_array_free (visible, TRUE);
+      return FALSE;
+    }
+
+    if (_pad_get_opaque_rectangle (self, cpad, &rect))
+      subtract_rectangle (visible, rect);
+  }
+  obscured = visible->len == 0;
+  g_array_free (visible, TRUE);
+
+  return obscured;
+}
+
+/* WITH GST_OBJECT_LOCK
+ * Drops the cached output frame and everything remembered about it */
+static void
+gst_compositor_reset_cache (GstCompositor * self)
+{
+  GList *l;
+
+  gst_buffer_replace (&self->cache_buffer, NULL);
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (l->data);
+
+    cpad->composited = FALSE;
+    gst_buffer_replace (&cpad->composited_buffer, NULL);
+  }
+}
+
+static void
+_mark_dirty_lines (guint8 * dirty_lines, GstVideoRectangle * rect, guint align,
+    gint height)
+{
+  gint y_start, y_end;
+
+  if (rect->w == 0 || rect->h == 0)
+    return;
+
+  /* Same widening as for the visible range of a pad */
+  y_start = (rect->y / align) * align;
+  y_end = ((rect->y + rect->h + 2 * align - 2) / align) * align;
+  y_end = MIN (y_end, height);
+
+  if (y_start < y_end)
+    memset (dirty_lines + y_start, 1, y_end - y_start);
+}
+
+/* WITH GST_OBJECT_LOCK
+ * Returns: a newly allocated array with one entry per output line that is
+ * non-zero if the line has to be composited again, or %NULL if the cached
+ * output frame can't be used at all */
+static guint8 *
+gst_compositor_update_dirty_lines (GstCompositor * self, guint align)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  gint width = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  gint height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  gboolean cache_valid;
+  guint8 *dirty_lines;
+  guint index = 0, n_dirty = 0, i;
+  GList *l;
+
+  /* Crossfading replaces the prepared frames, don't bother tracking that */
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    if (GST_COMPOSITOR_PAD (l->data)->crossfade >= 0.0) {
+      gst_compositor_reset_cache (self);
+      return NULL;
+    }
+  }
+
+  cache_valid = self->cache_buffer != NULL
+      && gst_video_info_is_equal (&self->cache_info, &vagg->info)
+      && self->cache_pads_cookie == GST_ELEMENT (self)->pads_cookie
+      && self->cache_background == self->background;
+
+  if (!cache_valid) {
+    gst_buffer_replace (&self->cache_buffer, NULL);
+    self->cache_buffer =
+        gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&vagg->info), NULL);
+    self->cache_info = vagg->info;
+    self->cache_pads_cookie = GST_ELEMENT (self)->pads_cookie;
+    self->cache_background = self->background;
+  }
+
+  dirty_lines = g_malloc (height);
+  memset (dirty_lines, cache_valid ? 0 : 1, height);
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next, index++) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+    GstVideoFrame *prepared_frame =
+        gst_video_aggregator_pad_get_prepared_frame (pad);
+    GstBuffer *buffer = NULL;
+    GstVideoRectangle rect = { 0, };
+    gboolean changed;
+
+    if (prepared_frame) {
+      /* The converted buffer if the pad is converted, which is replaced
+       * whenever the conversion changes, e.g. with the converter-config */
+      buffer = prepared_frame->buffer;
+      rect.x = cpad->crossfaded ? 0 : cpad->xpos;
+      rect.y = cpad->crossfaded ? 0 : cpad->ypos;
+      rect.w = GST_VIDEO_FRAME_WIDTH (prepared_frame);
+      rect.h = GST_VIDEO_FRAME_HEIGHT (prepared_frame);
+    }
+
+    /* We hold a reference to the composited buffer, so it can't have been
+     * reused for different content if the pointer is the same */
+    changed = cpad->composited != (prepared_frame != NULL);
+    if (!changed && prepared_frame) {
+      changed = buffer != cpad->composited_buffer
+          || rect.x != cpad->composited_rect.x
+          || rect.y != cpad->composited_rect.y
+          || rect.w != cpad->composited_rect.w
+          || rect.h != cpad->composited_rect.h
+          || cpad->alpha != cpad->composited_alpha
+          || index != cpad->composited_index;
+    }
+
+    if (changed && cache_valid) {
+      GstVideoRectangle clamped;
+
+      if (cpad->composited) {
+        clamped = clamp_rectangle (cpad->composited_rect.x,
+            cpad->composited_rect.y, cpad->composited_rect.w,
+            cpad->composited_rect.h, width, height);
+        _mark_dirty_lines (dirty_lines, &clamped, align, height);
+      }
+      if (prepared_frame) {
+        clamped = clamp_rectangle (rect.x, rect.y, rect.w, rect.h, width,
+            height);
+        _mark_dirty_lines (dirty_lines, &clamped, align, height);
+      }
+    }
+
+    cpad->composited = prepared_frame != NULL;
+    gst_buffer_replace (&cpad->composited_buffer, buffer);
+    cpad->composited_rect = rect;
+    cpad->composited_alpha = cpad->alpha;
+    cpad->composited_index = index;
+  }
+
+  for (i = 0; i < height; i++)
+    n_dirty += dirty_lines[i];
+  GST_LOG_OBJECT (self, "Compositing %u of %i lines", n_dirty, height);
+
+  return dirty_lines;
+}
+
+/* Copies lines [y_start, y_end) of @src to @dest */
+static void
+gst_compositor_copy_lines (GstVideoFrame * dest, GstVideoFrame * src,
+    guint y_start, guint y_end)
+{
+  guint plane, num_planes, comp_y_start, height, i;
+
+  num_planes = GST_VIDEO_FRAME_N_PLANES (dest);
+  for (plane = 0; plane < num_planes; ++plane) {
+    guint8 *ddata, *sdata;
+    gsize rowsize, dstride, sstride;
+
+    dstride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, plane);
+    sstride = GST_VIDEO_FRAME_PLANE_STRIDE (src, plane);
+    rowsize = GST_VIDEO_FRAME_COMP_WIDTH (dest, plane)
+        * GST_VIDEO_FRAME_COMP_PSTRIDE (dest, plane);
+    comp_y_start = (y_start == 0) ? 0 :
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (dest->info.finfo, plane, y_start);
+    height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (dest->info.finfo, plane,
+        y_end) - comp_y_start;
+    ddata = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (dest, plane)
+        + comp_y_start * dstride;
+    sdata = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (src, plane)
+        + comp_y_start * sstride;
+    for (i = 0; i < height; ++i) {
+      memcpy (ddata, sdata, rowsize);
+      ddata += dstride;
+      sdata += sstride;
+    }
+  }
+}
+
+static void
+gst_compositor_fill_background (GstCompositor * self, GstVideoFrame * outframe,
+    guint y_start, guint y_end)
+{
+  switch (self->background) {
+    case COMPOSITOR_BACKGROUND_CHECKER:
+      self->fill_checker (outframe, y_start, y_end);
+      break;
+    case COMPOSITOR_BACKGROUND_BLACK:
+      self->fill_color (outframe, y_start, y_end, 16, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_WHITE:
+      self->fill_color (outframe, y_start, y_end, 240, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_TRANSPARENT:
+      gst_compositor_fill_transparent (self, outframe, NULL, y_start, y_end);
+      break;
+  }
+}
+
+/* WITH GST_OBJECT_LOCK held by the thread that scheduled the stripes */
+static void
+gst_compositor_blend_lines (GstCompositor * self, GstVideoFrame * outframe,
+    BlendFunction composite, guint lines_start, guint lines_end)
+{
+  GList *l;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+    GstVideoFrame *prepared_frame =
+        gst_video_aggregator_pad_get_prepared_frame (pad);
+    gint y_start, y_end;
+
+    if (prepared_frame == NULL)
+      continue;
+
+    /* Lines outside of the visible range are overwritten by opaque
+     * higher-zorder pads later anyway */
+    y_start = MAX ((gint) lines_start, compo_pad->visible_y_start);
+    y_end = MIN ((gint) lines_end, compo_pad->visible_y_end);
+    if (y_start >= y_end)
+      continue;
+
+    composite (prepared_frame,
+        compo_pad->crossfaded ? 0 : compo_pad->xpos,
+        compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
+        outframe, y_start, y_end, COMPOSITOR_BLEND_MODE_NORMAL);
+  }
+}
+
+/* A horizontal stripe of the output frame, processed by one thread */
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  BlendFunction composite;
+  guint y_start, y_end;
+
+  /* Only used when reusing the previous output frame */
+  GstVideoFrame *cache_frame;
+  const guint8 *dirty_lines;
+  gboolean draw_background;
+} CompositorStripe;
+
+static void
+gst_compositor_fill_background_stripe (CompositorStripe * stripe)
+{
+  if (stripe->y_start == stripe->y_end)
+    return;
+
+  gst_compositor_fill_background (stripe->self, stripe->outframe,
+      stripe->y_start, stripe->y_end);
+}
+
+/* WITH GST_OBJECT_LOCK held by the thread that scheduled the stripes */
+static void
+gst_compositor_blend_stripe (CompositorStripe * stripe)
+{
+  if (stripe->y_start == stripe->y_end)
+    return;
+
+  gst_compositor_blend_lines (stripe->self, stripe->outframe,
+      stripe->composite, stripe->y_start, stripe->y_end);
+}
+
+/* WITH GST_OBJECT_LOCK held by the thread that scheduled the stripes
+ * Composites the dirty runs of lines of the stripe and updates the cache
+ * with them, the remaining lines are copied from the cache */
+static void
+gst_compositor_update_stripe (CompositorStripe * stripe)
+{
+  guint y, run_end;
+
+  for (y = stripe->y_start; y < stripe->y_end; y = run_end) {
+    guint8 dirty = stripe->dirty_lines[y];
+
+    run_end = y + 1;
+    while (run_end < stripe->y_end && stripe->dirty_lines[run_end] == dirty)
+      run_end++;
+
+    if (dirty) {
+      if (stripe->draw_background)
+        gst_compositor_fill_background (stripe->self, stripe->outframe, y,
+            run_end);
+      gst_compositor_blend_lines (stripe->self, stripe->outframe,
+          stripe->composite, y, run_end);
+      gst_compositor_copy_lines (stripe->cache_frame, stripe->outframe, y,
+          run_end);
+    } else {
+      gst_compositor_copy_lines (stripe->outframe, stripe->cache_frame, y,
+          run_end);
+    }
+  }
+}
+
+/* WITH GST_OBJECT_LOCK
+ * Returns: %TRUE if blending @buffer of @cpad would just copy it over the
+ * complete output frame */
+static gboolean
+_pad_covers_output_unmodified (GstCompositor * self, GstCompositorPad * cpad,
+    GstBuffer * buffer)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoAggregatorPad *pad = GST_VIDEO_AGGREGATOR_PAD (cpad);
+  GstVideoInfo *out_info = &vagg->info;
+  GstVideoMeta *meta;
+  gint width, height;
+  guint i;
+
+  if (cpad->alpha != 1.0 || cpad->xpos != 0 || cpad->ypos != 0
+      || GST_VIDEO_INFO_HAS_ALPHA (&pad->info))
+    return FALSE;
+
+  /* Neither scaled nor converted */
+  _mixer_pad_get_output_size (self, cpad, GST_VIDEO_INFO_PAR_N (out_info),
+      GST_VIDEO_INFO_PAR_D (out_info), &width, &height);
+  if (width != GST_VIDEO_INFO_WIDTH (out_info)
+      || height != GST_VIDEO_INFO_HEIGHT (out_info)
+      || GST_VIDEO_INFO_WIDTH (&pad->info) != width
+      || GST_VIDEO_INFO_HEIGHT (&pad->info) != height
+      || GST_VIDEO_INFO_FORMAT (&pad->info) != GST_VIDEO_INFO_FORMAT (out_info)
+      || GST_VIDEO_INFO_INTERLACE_MODE (&pad->info) !=
+      GST_VIDEO_INFO_INTERLACE_MODE (out_info)
+      || pad->info.chroma_site != out_info->chroma_site
+      || !gst_video_colorimetry_is_equal (&pad->info.colorimetry,
+          &out_info->colorimetry))
+    return FALSE;
+
+  /* Downstream might not know about a custom memory layout */
+  meta = gst_buffer_get_video_meta (buffer);
+  if (meta) {
+    for (i = 0; i < meta->n_planes; i++) {
+      if (meta->offset[i] != GST_VIDEO_INFO_PLANE_OFFSET (out_info, i)
+          || meta->stride[i] != GST_VIDEO_INFO_PLANE_STRIDE (out_info, i))
+        return FALSE;
+    }
+  }
+
+  return gst_buffer_get_size (buffer) >= GST_VIDEO_INFO_SIZE (out_info);
+}
+
+/* WITH GST_OBJECT_LOCK
+ * Returns: the pad whose current buffer can be pushed downstream instead of
+ * compositing a new frame, or %NULL */
+static GstVideoAggregatorPad *
+_get_passthrough_pad (GstCompositor * self)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoAggregatorPad *found = NULL;
+  GList *l;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+    GstBuffer *buffer = gst_video_aggregator_pad_get_current_buffer (pad);
+    GstVideoRectangle rect;
+    gint width, height;
+
+    if (cpad->crossfade >= 0.0)
+      return NULL;
+
+    if (buffer == NULL || cpad->alpha == 0.0)
+      continue;
+
+    _mixer_pad_get_output_size (self, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
+        GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
+    rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
+        GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
+    if (rect.w == 0 || rect.h == 0)
+      continue;
+
+    /* Everything below a pad covering the complete output is invisible, so
+     * only the topmost visible pad matters */
+    found = _pad_covers_output_unmodified (self, cpad, buffer) ? pad : NULL;
+  }
+
+  return found;
+}
+
+static GstFlowReturn
+gst_compositor_create_output_buffer (GstVideoAggregator * vagg,
+    GstBuffer ** outbuf)
+{
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstVideoAggregatorPad *pad;
+
+  GST_OBJECT_LOCK (vagg);
+  pad = _get_passthrough_pad (self);
+  if (pad) {
+    GST_LOG_OBJECT (self, "Passing through buffer of %s:%s",
+        GST_DEBUG_PAD_NAME (pad));
+    /* Shares the memory, but not the flags and metadata of the input */
+    *outbuf =
+        gst_buffer_copy_region (gst_video_aggregator_pad_get_current_buffer
+        (pad), GST_BUFFER_COPY_MEMORY, 0, -1);
+    /* The cached frame does not match the last output anymore */
+    if (self->cache_buffer)
+      gst_compositor_reset_cache (self);
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  self->passthrough = pad != NULL;
+  if (self->passthrough)
+    return GST_FLOW_OK;
+
+  return GST_VIDEO_AGGREGATOR_CLASS (parent_class)->create_output_buffer (vagg,
+      outbuf);
+}
+
 static GstFlowReturn
 gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 {
   GList *l;
   GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
-  GstVideoFrame out_frame, *outframe;
+  GstVideoFrame out_frame, *outframe, cache_frame;
+  CompositorStripe *stripes;
+  gpointer *stripes_p;
+  guint n_threads, n_stripes, lines_per_stripe, align, height, i;
+  gboolean draw_background;
+  guint8 *dirty_lines = NULL;
+
+  /* outbuf already is the input buffer that covers the complete frame */
+  if (self->passthrough)
+    return GST_FLOW_OK;
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
@@ -960,47 +1828,99 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   }
 
   outframe = &out_frame;
-  /* default to blending */
+  /* default to blending, use overlay to keep background transparent */
   composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+
+  GST_OBJECT_LOCK (vagg);
+  n_threads = self->n_threads;
+  GST_OBJECT_UNLOCK (vagg);
+  if (n_threads == 0)
+    n_threads = MIN (g_get_num_processors (), MAX_N_THREADS);
+
+  if (self->blend_runner && self->blend_runner_n_threads != n_threads) {
+    gst_parallelized_task_runner_free (self->blend_runner);
+    self->blend_runner = NULL;
+  }
+  if (!self->blend_runner) {
+    GST_DEBUG_OBJECT (self, "Blending with %u threads", n_threads);
+    self->blend_runner = gst_parallelized_task_runner_new (n_threads);
+    self->blend_runner_n_threads = n_threads;
+  }
+
+  /* Stripes must start on a line that is not vertically subsampled away in
+   * any component, otherwise chroma lines would be shared between stripes */
+  align = _get_line_alignment (&vagg->info);
+
+  /* If the frames to be composited completely obscure the background,
    * don't bother drawing the background at all. */
-  switch (self->background) {
-    case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
-      break;
-    case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_TRANSPARENT:
-      gst_compositor_fill_transparent (self, outframe, NULL);
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
-      break;
+  GST_OBJECT_LOCK (vagg);
+  draw_background = !_background_obscured (self);
+  if (self->reuse_static_inputs)
+    dirty_lines = gst_compositor_update_dirty_lines (self, align);
+  else if (self->cache_buffer)
+    gst_compositor_reset_cache (self);
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (dirty_lines && !gst_video_frame_map (&cache_frame, &vagg->info,
+          self->cache_buffer, GST_MAP_READWRITE)) {
+    GST_WARNING_OBJECT (vagg, "Could not map cached output frame");
+    GST_OBJECT_LOCK (vagg);
+    gst_compositor_reset_cache (self);
+    GST_OBJECT_UNLOCK (vagg);
+    g_free (dirty_lines);
+    dirty_lines = NULL;
   }
 
+  n_stripes = self->blend_runner->n_threads;
+  height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  lines_per_stripe = (height + n_stripes - 1) / n_stripes;
+  lines_per_stripe = ((lines_per_stripe + align - 1) / align) * align;
+
+  stripes = g_newa (CompositorStripe, n_stripes);
+  stripes_p = g_newa (gpointer, n_stripes);
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].self = self;
+    stripes[i].outframe = outframe;
+    stripes[i].composite = composite;
+    stripes[i].y_start = MIN (i * lines_per_stripe, height);
+    stripes[i].y_end = MIN (stripes[i].y_start + lines_per_stripe, height);
+    stripes[i].cache_frame = &cache_frame;
+    stripes[i].dirty_lines = dirty_lines;
+    stripes[i].draw_background = draw_background;
+    stripes_p[i] = &stripes[i];
+  }
+
+  if (!draw_background)
+    GST_LOG_OBJECT (self, "Background obscured, not drawing it");
+  else if (!dirty_lines)
+    gst_parallelized_task_runner_run (self->blend_runner,
+        (GstParallelizedTaskFunc) gst_compositor_fill_background_stripe,
+        stripes_p);
+
   GST_OBJECT_LOCK (vagg);
-  /* First mix the crossfade frames as required */
-  if (!gst_compositor_crossfade_frames (self, outframe)) {
+  /* First mix the crossfade frames as required, there are none if the
+   * cached frame is used */
+  if (dirty_lines || !gst_compositor_crossfade_frames (self, outframe)) {
+    gst_parallelized_task_runner_run (self->blend_runner, dirty_lines ?
+        (GstParallelizedTaskFunc) gst_compositor_update_stripe :
+        (GstParallelizedTaskFunc) gst_compositor_blend_stripe, stripes_p);
+
     for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
       GstVideoAggregatorPad *pad = l->data;
-      GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
-      GstVideoFrame *prepared_frame =
-          gst_video_aggregator_pad_get_prepared_frame (pad);
-
-      if (prepared_frame != NULL) {
-        composite (prepared_frame,
-            compo_pad->crossfaded ? 0 : compo_pad->xpos,
-            compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
-            outframe, COMPOSITOR_BLEND_MODE_NORMAL);
-        compo_pad->crossfaded = FALSE;
-      }
+
+      if (gst_video_aggregator_pad_get_prepared_frame (pad) != NULL)
+        GST_COMPOSITOR_PAD (pad)->crossfaded = FALSE;
     }
   }
   GST_OBJECT_UNLOCK (vagg);
 
+  if (dirty_lines) {
+    gst_video_frame_unmap (&cache_frame);
+    g_free (dirty_lines);
+  }
+
   gst_video_frame_unmap (outframe);
 
   return GST_FLOW_OK;
@@ -1088,6 +2008,19 @@ _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
   }
 }
 
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  if (self->blend_runner)
+    gst_parallelized_task_runner_free (self->blend_runner);
+  self->blend_runner = NULL;
+  gst_buffer_replace (&self->cache_buffer, NULL);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 /* GObject boilerplate */
 static void
 gst_compositor_class_init (GstCompositorClass * klass)
@@ -1100,6 +2033,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_compositor_request_new_pad);
@@ -1109,12 +2043,42 @@ gst_compositor_class_init (GstCompositorClass * klass)
   agg_class->fixate_src_caps = _fixate_caps;
   agg_class->negotiated_src_caps = _negotiated_caps;
   videoaggregator_class->aggregate_frames = gst_compositor_aggregate_frames;
+  videoaggregator_class->create_output_buffer =
+      gst_compositor_create_output_buffer;
+  /* Pads only take the object lock to look at other pads' properties */
+  videoaggregator_class->parallel_prepare_frames = TRUE;
 
   g_object_class_install_property (gobject_class, PROP_BACKGROUND,
       g_param_spec_enum ("background", "Background", "Background type",
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:n-threads:
+   *
+   * Number of threads used to fill and blend horizontal stripes of the
+   * output frame. 0 uses one thread per processor, up to 64.
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use for blending (0 = auto)",
+          0, MAX_N_THREADS, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:reuse-static-inputs:
+   *
+   * Keep a copy of the last output frame and only composite the lines
+   * that changed since then. This costs one frame copy worth of memory and
+   * bandwidth but saves the blending of static parts of the layout.
+   * Crossfading pads always cause the full frame to be composited.
+   */
+  g_object_class_install_property (gobject_class, PROP_REUSE_STATIC_INPUTS,
+      g_param_spec_boolean ("reuse-static-inputs", "Reuse static inputs",
+          "Only composite the output lines changed since the previous frame",
+          DEFAULT_REUSE_STATIC_INPUTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1131,6 +2095,8 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  self->n_threads = DEFAULT_N_THREADS;
+  self->reuse_static_inputs = DEFAULT_REUSE_STATIC_INPUTS;
 }
 
 /* GstChildProxy implementation */
@@ -41,6 +41,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstCompositor GstCompositor;
 typedef struct _GstCompositorClass GstCompositorClass;
+typedef struct _GstParallelizedTaskRunner GstParallelizedTaskRunner;
 
 /**
  * GstcompositorBackground:
@@ -69,9 +70,26 @@ struct _GstCompositor
   GstVideoAggregator videoaggregator;
   GstCompositorBackground background;
 
+  guint n_threads;
+  gboolean reuse_static_inputs;
+
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* Worker threads blending horizontal stripes of the output frame */
+  GstParallelizedTaskRunner *blend_runner;
+  guint blend_runner_n_threads;
+
+  /* The output buffer is a copy of an input buffer that covers it */
+  gboolean passthrough;
+
+  /* Copy of the last output frame, lines of it that no pad changed since
+   * then are copied instead of being blended again */
+  GstBuffer *cache_buffer;
+  GstVideoInfo cache_info;
+  guint32 cache_pads_cookie;
+  GstCompositorBackground cache_background;
 };
 
 struct _GstCompositorClass
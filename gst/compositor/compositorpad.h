@@ -55,6 +55,18 @@ struct _GstCompositorPad
   gdouble crossfade;
 
   gboolean crossfaded;
+
+  /* Output lines [visible_y_start, visible_y_end) contain all parts of the
+   * prepared frame that are not obscured by higher-zorder pads */
+  gint visible_y_start, visible_y_end;
+
+  /* What was blended into the cached output frame, see
+   * GstCompositor:reuse-static-inputs */
+  gboolean composited;
+  GstBuffer *composited_buffer;
+  GstVideoRectangle composited_rect;
+  gdouble composited_alpha;
+  guint composited_index;
 };
 
 struct _GstCompositorPadClass
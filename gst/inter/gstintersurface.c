@@ -52,6 +52,7 @@ gst_inter_surface_get (const char *name)
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   surface->audio_period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  surface->video_n_frames = DEFAULT_VIDEO_N_FRAMES;
 
   list = g_list_append (list, surface);
   g_mutex_unlock (&mutex);
@@ -78,7 +79,8 @@ gst_inter_surface_unref (GstInterSurface * surface)
     }
 
     g_mutex_clear (&surface->mutex);
-    gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_surface_clear_video_frames (surface);
+    gst_object_replace ((GstObject **) & surface->video_clock, NULL);
     gst_buffer_replace (&surface->sub_buffer, NULL);
     gst_object_unref (surface->audio_adapter);
     g_free (surface->name);
@@ -86,3 +88,172 @@ gst_inter_surface_unref (GstInterSurface * surface)
   }
   g_mutex_unlock (&mutex);
 }
+
+/* Called by the sink only, so there is a single writer. The slot of the new
+ * frame and the one of the frame that falls out of the queue are locked just
+ * long enough to swap their buffer, the sources never wait for the sink. */
+void
+gst_inter_surface_push_video_frame (GstInterSurface * surface,
+    GstBuffer * buffer, GstClockTime clock_time)
+{
+  GstInterSurfaceFrame *frame;
+  GstBuffer *old, *expired = NULL;
+  guint seqnum, n_frames;
+
+  seqnum = (guint) g_atomic_int_get (&surface->video_seqnum);
+  n_frames = (guint) g_atomic_int_get (&surface->video_n_frames);
+
+  frame = &surface->video_frames[seqnum % GST_INTER_SURFACE_MAX_VIDEO_FRAMES];
+  g_bit_lock (&frame->lock, 0);
+  old = frame->buffer;
+  frame->buffer = gst_buffer_ref (buffer);
+  frame->seqnum = seqnum;
+  frame->info_cookie = g_atomic_int_get (&surface->video_info_cookie);
+  frame->clock_time = clock_time;
+  g_bit_unlock (&frame->lock, 0);
+
+  /* Don't keep frames the sources are not allowed to pick anymore alive */
+  if (n_frames < GST_INTER_SURFACE_MAX_VIDEO_FRAMES) {
+    guint n = seqnum - n_frames;
+
+    frame = &surface->video_frames[n % GST_INTER_SURFACE_MAX_VIDEO_FRAMES];
+    g_bit_lock (&frame->lock, 0);
+    if (frame->seqnum == n) {
+      expired = frame->buffer;
+      frame->buffer = NULL;
+    }
+    g_bit_unlock (&frame->lock, 0);
+  }
+
+  g_atomic_int_inc (&surface->video_seqnum);
+
+  if (old)
+    gst_buffer_unref (old);
+  if (expired)
+    gst_buffer_unref (expired);
+}
+
+/* Called by the sink only. Frames that fall out of the queue when it gets
+ * shorter are released right away instead of when their slot is reused. */
+void
+gst_inter_surface_set_video_n_frames (GstInterSurface * surface,
+    guint n_frames)
+{
+  guint write;
+  gint i;
+
+  g_atomic_int_set (&surface->video_n_frames, n_frames);
+  write = (guint) g_atomic_int_get (&surface->video_seqnum);
+
+  for (i = 0; i < GST_INTER_SURFACE_MAX_VIDEO_FRAMES; i++) {
+    GstInterSurfaceFrame *frame = &surface->video_frames[i];
+    GstBuffer *expired = NULL;
+
+    /* Frames pushed in the meantime are newer than write */
+    g_bit_lock (&frame->lock, 0);
+    if (frame->buffer && (gint) (write - frame->seqnum) > (gint) n_frames) {
+      expired = frame->buffer;
+      frame->buffer = NULL;
+    }
+    g_bit_unlock (&frame->lock, 0);
+
+    if (expired)
+      gst_buffer_unref (expired);
+  }
+}
+
+void
+gst_inter_surface_clear_video_frames (GstInterSurface * surface)
+{
+  gint i;
+
+  for (i = 0; i < GST_INTER_SURFACE_MAX_VIDEO_FRAMES; i++) {
+    GstInterSurfaceFrame *frame = &surface->video_frames[i];
+    GstBuffer *buffer;
+
+    g_bit_lock (&frame->lock, 0);
+    buffer = frame->buffer;
+    frame->buffer = NULL;
+    g_bit_unlock (&frame->lock, 0);
+
+    if (buffer)
+      gst_buffer_unref (buffer);
+  }
+}
+
+/* Returns the next frame for a source, or NULL if there is no new one yet.
+ * @seqnum is the number of the first frame the source did not see yet and is
+ * advanced past the returned frame, the frames skipped on the way are added
+ * to @dropped. Frames pushed with caps older than @info_cookie are skipped
+ * and count as dropped, newer ones are left for after the source
+ * renegotiated.
+ *
+ * Without a valid @clock_time the frames are returned in order. Otherwise
+ * the most recent frame the sink rendered at or before @clock_time is
+ * returned, so that a source running slower than the sink drops frames and
+ * one running faster repeats them. */
+GstBuffer *
+gst_inter_surface_get_video_frame (GstInterSurface * surface, guint * seqnum,
+    gint info_cookie, GstClockTime clock_time, guint * dropped)
+{
+  GstBuffer *buffer = NULL;
+  guint write, n_frames, n, next = *seqnum;
+
+  write = (guint) g_atomic_int_get (&surface->video_seqnum);
+  n_frames = (guint) g_atomic_int_get (&surface->video_n_frames);
+
+  /* The frames that fell out of the queue already */
+  if (write - *seqnum > n_frames) {
+    *dropped += write - n_frames - *seqnum;
+    *seqnum = next = write - n_frames;
+  }
+
+  for (n = *seqnum; n != write; n++) {
+    GstInterSurfaceFrame *frame;
+    GstBuffer *tmp = NULL;
+    GstClockTime frame_time;
+    gint frame_cookie;
+
+    frame = &surface->video_frames[n % GST_INTER_SURFACE_MAX_VIDEO_FRAMES];
+    g_bit_lock (&frame->lock, 0);
+    if (frame->seqnum == n && frame->buffer)
+      tmp = gst_buffer_ref (frame->buffer);
+    frame_cookie = frame->info_cookie;
+    frame_time = frame->clock_time;
+    g_bit_unlock (&frame->lock, 0);
+
+    /* Replaced or cleared in the meantime */
+    if (!tmp)
+      continue;
+
+    /* Not in the format the source negotiated */
+    if (frame_cookie != info_cookie) {
+      gst_buffer_unref (tmp);
+      if ((gint) ((guint) frame_cookie - (guint) info_cookie) > 0)
+        break;
+      continue;
+    }
+
+    /* Neither this frame nor the following ones are due yet */
+    if (GST_CLOCK_TIME_IS_VALID (clock_time) &&
+        GST_CLOCK_TIME_IS_VALID (frame_time) && frame_time > clock_time) {
+      gst_buffer_unref (tmp);
+      break;
+    }
+
+    if (buffer)
+      gst_buffer_unref (buffer);
+    buffer = tmp;
+    next = n + 1;
+
+    if (!GST_CLOCK_TIME_IS_VALID (clock_time))
+      break;
+  }
+
+  if (buffer) {
+    *dropped += next - 1 - *seqnum;
+    *seqnum = next;
+  }
+
+  return buffer;
+}
@@ -27,6 +27,22 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterSurfaceFrame GstInterSurfaceFrame;
+
+#define GST_INTER_SURFACE_MAX_VIDEO_FRAMES 64
+
+/* A slot of the video frame ring. Bit 0 of lock protects the other fields,
+ * it is only held to swap or ref the buffer */
+struct _GstInterSurfaceFrame
+{
+  volatile gint lock;
+  guint seqnum;
+  /* video_info_cookie of the surface when the frame was pushed */
+  gint info_cookie;
+  /* Clock time at which the frame was to be rendered by the sink */
+  GstClockTime clock_time;
+  GstBuffer *buffer;
+};
 
 struct _GstInterSurface
 {
@@ -37,7 +53,21 @@ struct _GstInterSurface
 
   /* video */
   GstVideoInfo video_info;
-  int video_buffer_count;
+  /* The clock of the sink, which the clock times of the frames refer to */
+  GstClock *video_clock;
+  /* Incremented when video_info or video_clock change, so that the sources
+   * only need to take the mutex then */
+  volatile gint video_cookie;
+  /* Incremented when video_info changes, the frames carry the value they
+   * were pushed with so that the sources don't take frames of other caps */
+  volatile gint video_info_cookie;
+
+  /* The last video_n_frames frames, frame n is in slot n % MAX_VIDEO_FRAMES.
+   * Written by the sink without the mutex, video_seqnum is the number of
+   * frames it pushed so far. */
+  GstInterSurfaceFrame video_frames[GST_INTER_SURFACE_MAX_VIDEO_FRAMES];
+  volatile gint video_n_frames;
+  volatile gint video_seqnum;
 
   /* audio */
   GstAudioInfo audio_info;
@@ -45,7 +75,6 @@ struct _GstInterSurface
   guint64 audio_latency_time;
   guint64 audio_period_time;
 
-  GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
   GstAdapter *audio_adapter;
 };
@@ -53,11 +82,20 @@ struct _GstInterSurface
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
 #define DEFAULT_AUDIO_LATENCY_TIME (100 * GST_MSECOND)
 #define DEFAULT_AUDIO_PERIOD_TIME  (25 * GST_MSECOND)
+#define DEFAULT_VIDEO_N_FRAMES     (1)
 
 
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+void gst_inter_surface_push_video_frame (GstInterSurface *surface,
+    GstBuffer *buffer, GstClockTime clock_time);
+void gst_inter_surface_set_video_n_frames (GstInterSurface *surface,
+    guint n_frames);
+void gst_inter_surface_clear_video_frames (GstInterSurface *surface);
+GstBuffer * gst_inter_surface_get_video_frame (GstInterSurface *surface,
+    guint *seqnum, gint info_cookie, GstClockTime clock_time, guint *dropped);
+
 
 G_END_DECLS
 
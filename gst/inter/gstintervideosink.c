@@ -34,6 +34,12 @@
  * See the gstintertest.c example in the gst-plugins-bad source code for
  * more details.
  *
+ * The last #GstInterVideoSink:max-frames frames are kept along with the
+ * clock time at which they were rendered, so that intervideosrc elements
+ * running at a lower rate or in bursts can pick the frame that was current
+ * at the time of their own output frames instead of the last one. Any number
+ * of intervideosrc elements can read from the same channel.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,10 +72,12 @@ static GstFlowReturn gst_inter_video_sink_show_frame (GstVideoSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_MAX_FRAMES
 };
 
 #define DEFAULT_CHANNEL ("default")
+#define DEFAULT_MAX_FRAMES DEFAULT_VIDEO_N_FRAMES
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_sink_sink_template =
@@ -118,12 +126,19 @@ gst_inter_video_sink_class_init (GstInterVideoSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_FRAMES,
+      g_param_spec_uint ("max-frames", "Max frames",
+          "Number of recent frames the intervideosrc elements can choose from",
+          1, GST_INTER_SURFACE_MAX_VIDEO_FRAMES, DEFAULT_MAX_FRAMES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_video_sink_init (GstInterVideoSink * intervideosink)
 {
   intervideosink->channel = g_strdup (DEFAULT_CHANNEL);
+  intervideosink->max_frames = DEFAULT_MAX_FRAMES;
 }
 
 void
@@ -137,6 +152,14 @@ gst_inter_video_sink_set_property (GObject * object, guint property_id,
       g_free (intervideosink->channel);
       intervideosink->channel = g_value_dup_string (value);
       break;
+    case PROP_MAX_FRAMES:
+      GST_OBJECT_LOCK (intervideosink);
+      intervideosink->max_frames = g_value_get_uint (value);
+      if (intervideosink->surface)
+        gst_inter_surface_set_video_n_frames (intervideosink->surface,
+            intervideosink->max_frames);
+      GST_OBJECT_UNLOCK (intervideosink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -153,6 +176,11 @@ gst_inter_video_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, intervideosink->channel);
       break;
+    case PROP_MAX_FRAMES:
+      GST_OBJECT_LOCK (intervideosink);
+      g_value_set_uint (value, intervideosink->max_frames);
+      GST_OBJECT_UNLOCK (intervideosink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -195,11 +223,20 @@ static gboolean
 gst_inter_video_sink_start (GstBaseSink * sink)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstInterSurface *surface;
 
-  intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
-  g_mutex_lock (&intervideosink->surface->mutex);
-  memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
-  g_mutex_unlock (&intervideosink->surface->mutex);
+  surface = gst_inter_surface_get (intervideosink->channel);
+  g_mutex_lock (&surface->mutex);
+  memset (&surface->video_info, 0, sizeof (GstVideoInfo));
+  g_atomic_int_inc (&surface->video_info_cookie);
+  g_atomic_int_inc (&surface->video_cookie);
+  g_mutex_unlock (&surface->mutex);
+
+  /* max-frames can be set from any thread */
+  GST_OBJECT_LOCK (intervideosink);
+  intervideosink->surface = surface;
+  gst_inter_surface_set_video_n_frames (surface, intervideosink->max_frames);
+  GST_OBJECT_UNLOCK (intervideosink);
 
   return TRUE;
 }
@@ -208,17 +245,25 @@ static gboolean
 gst_inter_video_sink_stop (GstBaseSink * sink)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstInterSurface *surface;
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = NULL;
-  memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
-  g_mutex_unlock (&intervideosink->surface->mutex);
-
-  gst_inter_surface_unref (intervideosink->surface);
+  GST_OBJECT_LOCK (intervideosink);
+  surface = intervideosink->surface;
   intervideosink->surface = NULL;
+  GST_OBJECT_UNLOCK (intervideosink);
+
+  gst_inter_surface_clear_video_frames (surface);
+
+  g_mutex_lock (&surface->mutex);
+  memset (&surface->video_info, 0, sizeof (GstVideoInfo));
+  gst_object_replace ((GstObject **) & surface->video_clock, NULL);
+  g_atomic_int_inc (&surface->video_info_cookie);
+  g_atomic_int_inc (&surface->video_cookie);
+  g_mutex_unlock (&surface->mutex);
+
+  gst_object_replace ((GstObject **) & intervideosink->clock, NULL);
+
+  gst_inter_surface_unref (surface);
 
   return TRUE;
 }
@@ -237,6 +282,8 @@ gst_inter_video_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   g_mutex_lock (&intervideosink->surface->mutex);
   intervideosink->surface->video_info = info;
   intervideosink->info = info;
+  g_atomic_int_inc (&intervideosink->surface->video_info_cookie);
+  g_atomic_int_inc (&intervideosink->surface->video_cookie);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
@@ -246,17 +293,45 @@ static GstFlowReturn
 gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstClockTime running_time, clock_time = GST_CLOCK_TIME_NONE;
+  GstClockTime base_time;
+  GstClock *clock;
 
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
-  g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
+  GST_OBJECT_LOCK (sink);
+  clock = GST_ELEMENT_CLOCK (sink);
+  if (clock)
+    gst_object_ref (clock);
+  base_time = GST_ELEMENT_CAST (sink)->base_time;
+  GST_OBJECT_UNLOCK (sink);
+
+  /* Let the sources know which clock the frame times refer to */
+  if (clock != intervideosink->clock) {
+    gst_object_replace ((GstObject **) & intervideosink->clock,
+        (GstObject *) clock);
+
+    g_mutex_lock (&intervideosink->surface->mutex);
+    gst_object_replace ((GstObject **) & intervideosink->surface->video_clock,
+        (GstObject *) clock);
+    g_atomic_int_inc (&intervideosink->surface->video_cookie);
+    g_mutex_unlock (&intervideosink->surface->mutex);
   }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
-  g_mutex_unlock (&intervideosink->surface->mutex);
+
+  running_time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  /* Without sync the frames are not rendered at their time, the sources
+   * then take them in order */
+  if (clock && gst_base_sink_get_sync (GST_BASE_SINK (sink)) &&
+      GST_CLOCK_TIME_IS_VALID (running_time))
+    clock_time = running_time + base_time;
+
+  if (clock)
+    gst_object_unref (clock);
+
+  gst_inter_surface_push_video_frame (intervideosink->surface, buffer,
+      clock_time);
 
   return GST_FLOW_OK;
 }
@@ -40,8 +40,11 @@ struct _GstInterVideoSink
 
   GstInterSurface *surface;
   char *channel;
+  guint max_frames;
 
   GstVideoInfo info;
+  /* The clock last announced on the surface */
+  GstClock *clock;
 };
 
 struct _GstInterVideoSinkClass
@@ -32,6 +32,14 @@
  * The intersubsrc element cannot be used effectively with gst-launch-1.0,
  * as it requires a second pipeline in the application to send subtitles.
  *
+ * When both pipelines use the same clock, each output frame is the most
+ * recent frame the intervideosink rendered before its own clock time, out of
+ * the last #GstInterVideoSink:max-frames ones. Otherwise the frames are
+ * output in the order the sink received them. If there is no new frame, the
+ * previous one is repeated until #GstInterVideoSrc:timeout runs out, then
+ * black frames are output. The #GstInterVideoSrc:stats property reports how
+ * many frames were dropped and repeated.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -60,6 +68,8 @@ static gboolean gst_inter_video_src_set_caps (GstBaseSrc * src, GstCaps * caps);
 static GstCaps *gst_inter_video_src_fixate (GstBaseSrc * src, GstCaps * caps);
 static gboolean gst_inter_video_src_start (GstBaseSrc * src);
 static gboolean gst_inter_video_src_stop (GstBaseSrc * src);
+static gboolean gst_inter_video_src_unlock (GstBaseSrc * src);
+static gboolean gst_inter_video_src_unlock_stop (GstBaseSrc * src);
 static void
 gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
     GstClockTime * start, GstClockTime * end);
@@ -71,7 +81,8 @@ enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_STATS
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -117,6 +128,9 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
   base_src_class->fixate = GST_DEBUG_FUNCPTR (gst_inter_video_src_fixate);
   base_src_class->start = GST_DEBUG_FUNCPTR (gst_inter_video_src_start);
   base_src_class->stop = GST_DEBUG_FUNCPTR (gst_inter_video_src_stop);
+  base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_inter_video_src_unlock);
+  base_src_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_inter_video_src_unlock_stop);
   base_src_class->get_times = GST_DEBUG_FUNCPTR (gst_inter_video_src_get_times);
   base_src_class->create = GST_DEBUG_FUNCPTR (gst_inter_video_src_create);
 
@@ -130,6 +144,23 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSrc:stats:
+   *
+   * Various statistics. This property returns a GstStructure
+   * with name application/x-intervideosrc-stats with the following fields:
+   *
+   * - "new-frames" G_TYPE_UINT64 frames that were output for the first time
+   * - "repeated-frames" G_TYPE_UINT64 frames that were output again because
+   *   there was no new one
+   * - "dropped-frames" G_TYPE_UINT64 frames of the sink that were never output
+   * - "black-frames" G_TYPE_UINT64 black frames that were output
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics about the frames taken from the sink",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -175,6 +206,17 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-intervideosrc-stats",
+              "new-frames", G_TYPE_UINT64, intervideosrc->new_frames,
+              "repeated-frames", G_TYPE_UINT64, intervideosrc->repeated_frames,
+              "dropped-frames", G_TYPE_UINT64, intervideosrc->dropped_frames,
+              "black-frames", G_TYPE_UINT64, intervideosrc->black_frames,
+              NULL));
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -277,6 +319,24 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
 
+  /* Start with the most recent frame of the sink */
+  intervideosrc->seqnum =
+      g_atomic_int_get (&intervideosrc->surface->video_seqnum);
+  if (intervideosrc->seqnum > 0)
+    intervideosrc->seqnum--;
+  intervideosrc->video_cookie =
+      g_atomic_int_get (&intervideosrc->surface->video_cookie) - 1;
+  memset (&intervideosrc->surface_info, 0, sizeof (GstVideoInfo));
+  intervideosrc->repeats = 0;
+  intervideosrc->showing_black = FALSE;
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->new_frames = 0;
+  intervideosrc->repeated_frames = 0;
+  intervideosrc->dropped_frames = 0;
+  intervideosrc->black_frames = 0;
+  GST_OBJECT_UNLOCK (intervideosrc);
+
   return TRUE;
 }
 
@@ -290,6 +350,34 @@ gst_inter_video_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
+  gst_object_replace ((GstObject **) & intervideosrc->surface_clock, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+gst_inter_video_src_unlock (GstBaseSrc * src)
+{
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->flushing = TRUE;
+  if (intervideosrc->clock_id)
+    gst_clock_id_unschedule (intervideosrc->clock_id);
+  GST_OBJECT_UNLOCK (intervideosrc);
+
+  return TRUE;
+}
+
+static gboolean
+gst_inter_video_src_unlock_stop (GstBaseSrc * src)
+{
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->flushing = FALSE;
+  GST_OBJECT_UNLOCK (intervideosrc);
 
   return TRUE;
 }
@@ -319,6 +407,32 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+/* Waits until @clock_time, so that the sink had the chance to render the
+ * frames due until then. Returns FALSE when flushing. */
+static gboolean
+gst_inter_video_src_wait (GstInterVideoSrc * intervideosrc, GstClock * clock,
+    GstClockTime clock_time)
+{
+  GstClockReturn ret;
+
+  GST_OBJECT_LOCK (intervideosrc);
+  if (intervideosrc->flushing) {
+    GST_OBJECT_UNLOCK (intervideosrc);
+    return FALSE;
+  }
+  intervideosrc->clock_id = gst_clock_new_single_shot_id (clock, clock_time);
+  GST_OBJECT_UNLOCK (intervideosrc);
+
+  ret = gst_clock_id_wait (intervideosrc->clock_id, NULL);
+
+  GST_OBJECT_LOCK (intervideosrc);
+  gst_clock_id_unref (intervideosrc->clock_id);
+  intervideosrc->clock_id = NULL;
+  GST_OBJECT_UNLOCK (intervideosrc);
+
+  return ret != GST_CLOCK_UNSCHEDULED;
+}
+
 static GstFlowReturn
 gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
@@ -326,8 +440,12 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
   GstCaps *caps;
   GstBuffer *buffer;
+  GstClock *clock;
+  GstClockTime pts, base_time, clock_time = GST_CLOCK_TIME_NONE;
   guint64 frames;
-  gboolean is_gap = FALSE;
+  guint dropped = 0;
+  gint cookie;
+  gboolean is_gap = FALSE, is_repeat = FALSE;
 
   GST_DEBUG_OBJECT (intervideosrc, "create");
 
@@ -338,9 +456,29 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
       GST_VIDEO_INFO_FPS_N (&intervideosrc->info),
       GST_VIDEO_INFO_FPS_D (&intervideosrc->info) * GST_SECOND);
 
-  g_mutex_lock (&intervideosrc->surface->mutex);
-  if (intervideosrc->surface->video_info.finfo) {
-    GstVideoInfo tmp_info = intervideosrc->surface->video_info;
+  /* The frames are read without the mutex, it's only needed when the caps or
+   * the clock of the sink changed */
+  cookie = g_atomic_int_get (&intervideosrc->surface->video_cookie);
+  if (cookie != intervideosrc->video_cookie) {
+    gint info_cookie = intervideosrc->info_cookie;
+
+    g_mutex_lock (&intervideosrc->surface->mutex);
+    intervideosrc->video_cookie =
+        g_atomic_int_get (&intervideosrc->surface->video_cookie);
+    intervideosrc->info_cookie =
+        g_atomic_int_get (&intervideosrc->surface->video_info_cookie);
+    intervideosrc->surface_info = intervideosrc->surface->video_info;
+    gst_object_replace ((GstObject **) & intervideosrc->surface_clock,
+        (GstObject *) intervideosrc->surface->video_clock);
+    g_mutex_unlock (&intervideosrc->surface->mutex);
+
+    /* The sink stopped or changed caps, don't repeat its last frame */
+    if (intervideosrc->info_cookie != info_cookie)
+      gst_buffer_replace (&intervideosrc->last_frame, NULL);
+  }
+
+  if (intervideosrc->surface_info.finfo) {
+    GstVideoInfo tmp_info = intervideosrc->surface_info;
 
     /* We negotiate the framerate ourselves */
     tmp_info.fps_n = intervideosrc->info.fps_n;
@@ -360,26 +498,6 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
-    /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
-
-    /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
-    }
-  }
-
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
-    /* This is a repeat of the stored buffer or of a black frame */
-    is_gap = TRUE;
-  }
-
-  intervideosrc->surface->video_buffer_count++;
-  g_mutex_unlock (&intervideosrc->surface->mutex);
-
   if (caps) {
     gboolean ret;
     GstStructure *s;
@@ -407,8 +525,6 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
 
     if (gst_caps_is_empty (negotiated_caps)) {
       GST_ERROR_OBJECT (src, "Failed to negotiate caps %" GST_PTR_FORMAT, caps);
-      if (buffer)
-        gst_buffer_unref (buffer);
       gst_caps_unref (caps);
       return GST_FLOW_NOT_NEGOTIATED;
     }
@@ -433,17 +549,79 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     if (!ret) {
       GST_ERROR_OBJECT (src, "Failed to set caps %" GST_PTR_FORMAT,
           negotiated_caps);
-      if (buffer)
-        gst_buffer_unref (buffer);
       gst_caps_unref (negotiated_caps);
       return GST_FLOW_NOT_NEGOTIATED;
     }
     gst_caps_unref (negotiated_caps);
   }
 
+  pts = intervideosrc->timestamp_offset +
+      gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
+      GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+      GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+
+  /* The frame times of the sink can only be compared to ours if both
+   * pipelines use the same clock */
+  GST_OBJECT_LOCK (src);
+  clock = GST_ELEMENT_CLOCK (src);
+  if (clock)
+    gst_object_ref (clock);
+  base_time = GST_ELEMENT_CAST (src)->base_time;
+  GST_OBJECT_UNLOCK (src);
+
+  if (clock && clock == intervideosrc->surface_clock) {
+    clock_time = base_time + pts;
+
+    if (!gst_inter_video_src_wait (intervideosrc, clock, clock_time)) {
+      gst_object_unref (clock);
+      return GST_FLOW_FLUSHING;
+    }
+  }
+  if (clock)
+    gst_object_unref (clock);
+
+  if (intervideosrc->surface_info.finfo) {
+    buffer = gst_inter_surface_get_video_frame (intervideosrc->surface,
+        &intervideosrc->seqnum, intervideosrc->info_cookie, clock_time,
+        &dropped);
+  }
+
+  if (buffer) {
+    gst_buffer_replace (&intervideosrc->last_frame, buffer);
+    intervideosrc->repeats = 0;
+  } else if (intervideosrc->last_frame) {
+    /* This is a repeat of the stored buffer */
+    buffer = gst_buffer_ref (intervideosrc->last_frame);
+    intervideosrc->repeats++;
+    is_repeat = is_gap = TRUE;
+  }
+
+  /* Can only be FALSE if timeout > 0 */
+  if (intervideosrc->last_frame && intervideosrc->repeats >= frames)
+    gst_buffer_replace (&intervideosrc->last_frame, NULL);
+
+  if (dropped > 0)
+    GST_LOG_OBJECT (intervideosrc, "Dropped %u frames", dropped);
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->dropped_frames += dropped;
+  if (!buffer)
+    intervideosrc->black_frames++;
+  else if (is_repeat)
+    intervideosrc->repeated_frames++;
+  else
+    intervideosrc->new_frames++;
+  GST_OBJECT_UNLOCK (intervideosrc);
+
   if (buffer == NULL) {
     GST_DEBUG_OBJECT (intervideosrc, "Creating black frame");
     buffer = gst_buffer_copy (intervideosrc->black_frame);
+
+    /* Only the first black frame replaces what downstream shows */
+    is_gap = intervideosrc->showing_black;
+    intervideosrc->showing_black = TRUE;
+  } else {
+    intervideosrc->showing_black = FALSE;
   }
 
   buffer = gst_buffer_make_writable (buffer);
@@ -451,10 +629,7 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   if (is_gap)
     GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
 
-  GST_BUFFER_PTS (buffer) = intervideosrc->timestamp_offset +
-      gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
-      GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
-      GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+  GST_BUFFER_PTS (buffer) = pts;
   GST_BUFFER_DTS (buffer) = GST_CLOCK_TIME_NONE;
   GST_DEBUG_OBJECT (intervideosrc, "create ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
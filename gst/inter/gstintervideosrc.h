@@ -48,6 +48,26 @@ struct _GstInterVideoSrc
   GstBuffer *black_frame;
   int n_frames;
   GstClockTime timestamp_offset;
+
+  /* Copy of the surface state, refreshed when the cookie changes */
+  gint video_cookie;
+  gint info_cookie;
+  GstVideoInfo surface_info;
+  GstClock *surface_clock;
+
+  /* Next frame of the surface to look at */
+  guint seqnum;
+  GstBuffer *last_frame;
+  guint64 repeats;
+  gboolean showing_black;
+
+  /* protected by the object lock */
+  GstClockID clock_id;
+  gboolean flushing;
+  guint64 new_frames;
+  guint64 repeated_frames;
+  guint64 dropped_frames;
+  guint64 black_frames;
 };
 
 struct _GstInterVideoSrcClass
@@ -63,6 +63,7 @@ enum
 {
   PROP_0,
   PROP_PARSE_PRIVATE_SECTIONS,
+  PROP_STATS,
   /* FILL ME */
 };
 
@@ -138,6 +139,12 @@ mpegts_base_class_init (MpegTSBaseClass * klass)
           "Parse private sections", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Number of packets processed and of packets dropped by the PID "
+          "filter, and number of bytes copied and of payload bytes output",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -165,6 +172,15 @@ mpegts_base_get_property (GObject * object, guint prop_id,
     case PROP_PARSE_PRIVATE_SECTIONS:
       g_value_set_boolean (value, base->parse_private_sections);
       break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (base);
+      g_value_take_boxed (value, gst_structure_new ("application/x-mpegts-stats",
+              "packets-processed", G_TYPE_UINT64, base->packets_processed,
+              "packets-dropped", G_TYPE_UINT64, base->packets_dropped,
+              "bytes-copied", G_TYPE_UINT64, base->bytes_copied,
+              "bytes-output", G_TYPE_UINT64, base->bytes_output, NULL));
+      GST_OBJECT_UNLOCK (base);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -210,6 +226,19 @@ mpegts_base_reset (MpegTSBase * base)
   g_hash_table_foreach_remove (base->programs, (GHRFunc) remove_each_program,
       base);
 
+  base->filter_program_number = -1;
+  mpegts_packetizer_set_pid_filter (base->packetizer, NULL);
+  base->packetizer->packets_processed = 0;
+  base->packetizer->packets_dropped = 0;
+  base->packetizer->bytes_copied = 0;
+  base->packetizer->bytes_output = 0;
+  GST_OBJECT_LOCK (base);
+  base->packets_processed = 0;
+  base->packets_dropped = 0;
+  base->bytes_copied = 0;
+  base->bytes_output = 0;
+  GST_OBJECT_UNLOCK (base);
+
   base->streams_aware = GST_OBJECT_PARENT (base)
       && GST_OBJECT_FLAG_IS_SET (GST_OBJECT_PARENT (base),
       GST_BIN_FLAG_STREAMS_AWARE);
@@ -496,6 +525,43 @@ mpegts_base_deactivate_and_free_program (MpegTSBase * base,
   mpegts_base_free_program (program);
 }
 
+/* Builds the PID filter from the PSI PIDs and the PIDs of the filtered
+ * program. All packets are let through while that program is unknown. */
+static void
+mpegts_base_update_pid_filter (MpegTSBase * base)
+{
+  MpegTSBaseProgram *program = NULL;
+  guint8 pids[1024];
+  GList *tmp;
+
+  if (base->filter_program_number != -1)
+    program = mpegts_base_get_program (base, base->filter_program_number);
+
+  if (program == NULL || !program->active) {
+    mpegts_packetizer_set_pid_filter (base->packetizer, NULL);
+    return;
+  }
+
+  memcpy (pids, base->known_psi, sizeof (pids));
+  for (tmp = program->stream_list; tmp; tmp = tmp->next)
+    MPEGTS_BIT_SET (pids, ((MpegTSBaseStream *) tmp->data)->pid);
+  MPEGTS_BIT_SET (pids, program->pcr_pid);
+
+  mpegts_packetizer_set_pid_filter (base->packetizer, pids);
+}
+
+/* Drops the packets of all PIDs that neither carry PSI nor belong to program
+ * @program_number before they get parsed, or none if it is -1. For
+ * subclasses that only output a single program. */
+void
+mpegts_base_set_pid_filter (MpegTSBase * base, gint program_number)
+{
+  GST_DEBUG_OBJECT (base, "Filtering PIDs of program %d", program_number);
+
+  base->filter_program_number = program_number;
+  mpegts_base_update_pid_filter (base);
+}
+
 static void
 mpegts_base_remove_program (MpegTSBase * base, gint program_number)
 {
@@ -869,6 +935,8 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
   /* Inform subclasses we're deactivating this program */
   if (klass->program_stopped)
     klass->program_stopped (base, program);
+
+  mpegts_base_update_pid_filter (base);
 }
 
 static void
@@ -1174,6 +1242,9 @@ mpegts_base_handle_psi (MpegTSBase * base, GstMpegtsSection * section)
       break;
   }
 
+  /* Tables might have added PSI PIDs or changed the filtered program */
+  mpegts_base_update_pid_filter (base);
+
   /* Finally post message (if it wasn't corrupted) */
   if (post_message)
     gst_element_post_message (GST_ELEMENT_CAST (base),
@@ -1441,6 +1512,13 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     mpegts_packetizer_clear_packet (base->packetizer, &packet);
   }
 
+  GST_OBJECT_LOCK (base);
+  base->packets_processed = packetizer->packets_processed;
+  base->packets_dropped = packetizer->packets_dropped;
+  base->bytes_copied = packetizer->bytes_copied;
+  base->bytes_output = packetizer->bytes_output;
+  GST_OBJECT_UNLOCK (base);
+
   if (klass->input_done) {
     if (res == GST_FLOW_OK)
       res = klass->input_done (base, buf);
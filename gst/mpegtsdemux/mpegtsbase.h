@@ -161,6 +161,16 @@ struct _MpegTSBase {
   /* Whether the parent bin is streams-aware, meaning we can
    * add/remove streams at any point in time */
   gboolean streams_aware;
+
+  /* Program whose PIDs (with the PSI PIDs) are the only ones processed,
+   * -1 to process all PIDs */
+  gint filter_program_number;
+
+  /* Packet statistics, protected by the OBJECT_LOCK */
+  guint64 packets_processed;
+  guint64 packets_dropped;
+  guint64 bytes_copied;
+  guint64 bytes_output;
 };
 
 struct _MpegTSBaseClass {
@@ -232,6 +242,8 @@ G_GNUC_INTERNAL gboolean gst_mpegtsbase_plugin_init (GstPlugin * plugin);
 
 G_GNUC_INTERNAL void mpegts_base_deactivate_and_free_program (MpegTSBase *base, MpegTSBaseProgram *program);
 
+G_GNUC_INTERNAL void mpegts_base_set_pid_filter (MpegTSBase *base, gint program_number);
+
 G_END_DECLS
 
 #endif /* GST_MPEG_TS_BASE_H */
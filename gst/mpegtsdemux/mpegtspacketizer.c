@@ -261,6 +261,7 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->batch_packets = 0;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -270,6 +271,12 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->refoffset = -1;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
   packetizer->pcr_discont_threshold = GST_SECOND;
+
+  packetizer->filter_pids = FALSE;
+  packetizer->packets_processed = 0;
+  packetizer->packets_dropped = 0;
+  packetizer->bytes_copied = 0;
+  packetizer->bytes_output = 0;
 }
 
 static void
@@ -578,6 +585,7 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->batch_packets = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -618,6 +626,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->batch_packets = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -690,8 +699,13 @@ mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
   packetizer->map_data = NULL;
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
+  packetizer->batch_packets = 0;
 }
 
+/* Maps at least @size bytes. If the first input buffer holds enough data,
+ * all of it is mapped in place. Else only @size bytes are merged from the
+ * following buffers, so that input data only gets copied around the
+ * boundaries of the input buffers. */
 static gboolean
 mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
 {
@@ -702,10 +716,15 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
 
   mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
 
-  available = gst_adapter_available (packetizer->adapter);
-  if (available < size)
+  if (gst_adapter_available (packetizer->adapter) < size)
     return FALSE;
 
+  available = gst_adapter_available_fast (packetizer->adapter);
+  if (available < size) {
+    available = size;
+    packetizer->bytes_copied += size;
+  }
+
   packetizer->map_data =
       (guint8 *) gst_adapter_map (packetizer->adapter, available);
   if (!packetizer->map_data)
@@ -719,11 +738,57 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+/* Returns the position of the first sync byte in data[from, to[, or @to if
+ * there is none. memchr() is vectorized by all common C libraries, which
+ * makes skipping over garbage a lot cheaper than checking every byte. */
+static inline gsize
+mpegts_find_sync_byte (const guint8 * data, gsize from, gsize to)
+{
+  const guint8 *sync;
+
+  sync = memchr (data + from, PACKET_SYNC_BYTE, to - from);
+
+  return sync ? sync - data : to;
+}
+
+static inline void
+mpegts_packetizer_skip_packet (MpegTSPacketizer2 * packetizer)
+{
+  guint8 packet_size = packetizer->packet_size;
+
+  if (packetizer->map_data) {
+    packetizer->map_offset += packet_size;
+    if (packetizer->map_size - packetizer->map_offset < packet_size)
+      mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
+  }
+}
+
+/* Returns how many packets from the current position of the mapped data on
+ * have their sync byte in place */
+static guint
+mpegts_packetizer_count_synced_packets (MpegTSPacketizer2 * packetizer,
+    gsize sync_offset)
+{
+  const guint8 *data;
+  guint packet_size = packetizer->packet_size;
+  gsize i, n;
+
+  data = packetizer->map_data + packetizer->map_offset + sync_offset;
+  n = (packetizer->map_size - packetizer->map_offset) / packet_size;
+
+  for (i = 0; i < n; i++) {
+    if (G_UNLIKELY (data[i * packet_size] != PACKET_SYNC_BYTE))
+      break;
+  }
+
+  return i;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, limit, i, j;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -737,12 +802,10 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
+  limit = size - 3 * MPEGTS_MAX_PACKETSIZE;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
-
+  for (i = mpegts_find_sync_byte (data, 0, limit); i < limit;
+      i = mpegts_find_sync_byte (data, i + 1, limit)) {
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
       guint packet_size = psizes[j];
@@ -781,7 +844,7 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   gboolean found = FALSE;
   guint8 *data;
   guint packet_size;
-  gsize size, sync_offset, i;
+  gsize size, limit, sync_offset, i;
 
   packet_size = packetizer->packet_size;
 
@@ -790,15 +853,16 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
 
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
+  limit = size - 2 * packet_size;
 
   if (packet_size == MPEGTS_M2TS_PACKETSIZE)
     sync_offset = 4;
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+  for (i = mpegts_find_sync_byte (data, sync_offset, limit); i < limit;
+      i = mpegts_find_sync_byte (data, i + 1, limit)) {
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -834,36 +898,60 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
   else
     sync_offset = 0;
 
+  /* Packets are validated in batches: whenever the current batch is used up,
+   * the sync bytes of all complete packets in the mapped data are checked at
+   * once, and the following packets are handed out straight from the
+   * mapping. */
   while (1) {
-    if (packetizer->need_sync) {
-      if (!mpegts_packetizer_sync (packetizer))
+    while (G_UNLIKELY (packetizer->batch_packets == 0)) {
+      if (packetizer->need_sync) {
+        if (!mpegts_packetizer_sync (packetizer))
+          return PACKET_NEED_MORE;
+        packetizer->need_sync = FALSE;
+      }
+
+      if (!mpegts_packetizer_map (packetizer, packet_size))
         return PACKET_NEED_MORE;
-      packetizer->need_sync = FALSE;
-    }
 
-    if (!mpegts_packetizer_map (packetizer, packet_size))
-      return PACKET_NEED_MORE;
+      packetizer->batch_packets =
+          mpegts_packetizer_count_synced_packets (packetizer, sync_offset);
+      if (G_UNLIKELY (packetizer->batch_packets == 0)) {
+        GST_DEBUG ("lost sync");
+        packetizer->need_sync = TRUE;
+      } else {
+        GST_LOG ("%u packets in sync", packetizer->batch_packets);
+      }
+    }
 
+    packetizer->batch_packets--;
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
-    /* Check sync byte */
-    if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
-      GST_DEBUG ("lost sync");
-      packetizer->need_sync = TRUE;
-    } else {
-      /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
-       * packet sizes contain either extra data (timesync, FEC, ..) either
-       * before or after the data */
-      packet->data_start = packet_data;
-      packet->data_end = packet->data_start + 188;
-      packet->offset = packetizer->offset;
-      GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
+    /* Drop filtered out packets before doing any parsing */
+    if (packetizer->filter_pids &&
+        !MPEGTS_BIT_IS_SET (packetizer->pid_filter,
+            GST_READ_UINT16_BE (packet_data + 1) & 0x1FFF)) {
+      packetizer->packets_dropped++;
       packetizer->offset += packet_size;
-      GST_MEMDUMP ("data_start", packet->data_start, 16);
-
-      return mpegts_packetizer_parse_packet (packetizer, packet);
+      mpegts_packetizer_skip_packet (packetizer);
+      continue;
     }
+
+    break;
   }
+
+  packetizer->packets_processed++;
+
+  /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger
+   * packet sizes contain either extra data (timesync, FEC, ..) either
+   * before or after the data */
+  packet->data_start = packet_data;
+  packet->data_end = packet->data_start + 188;
+  packet->offset = packetizer->offset;
+  GST_LOG ("offset %" G_GUINT64_FORMAT, packet->offset);
+  packetizer->offset += packet_size;
+  GST_MEMDUMP ("data_start", packet->data_start, 16);
+
+  return mpegts_packetizer_parse_packet (packetizer, packet);
 }
 
 MpegTSPacketizerPacketReturn
@@ -883,13 +971,7 @@ void
 mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
 {
-  guint8 packet_size = packetizer->packet_size;
-
-  if (packetizer->map_data) {
-    packetizer->map_offset += packet_size;
-    if (packetizer->map_size - packetizer->map_offset < packet_size)
-      mpegts_packetizer_flush_bytes (packetizer, packetizer->map_offset);
-  }
+  mpegts_packetizer_skip_packet (packetizer);
 }
 
 gboolean
@@ -2465,6 +2547,17 @@ mpegts_packetizer_set_reference_offset (MpegTSPacketizer2 * packetizer,
   PACKETIZER_GROUP_UNLOCK (packetizer);
 }
 
+/* Makes mpegts_packetizer_next_packet() skip all packets whose PID is not
+ * set in the @pids bitmap (which is copied). %NULL disables filtering. */
+void
+mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 * packetizer,
+    const guint8 * pids)
+{
+  packetizer->filter_pids = pids != NULL;
+  if (pids)
+    memcpy (packetizer->pid_filter, pids, sizeof (packetizer->pid_filter));
+}
+
 void
 mpegts_packetizer_set_pcr_discont_threshold (MpegTSPacketizer2 * packetizer,
     GstClockTime threshold)
@@ -268,6 +268,9 @@ struct _MpegTSPacketizer2 {
   gsize map_offset;
   gsize map_size;
   gboolean need_sync;
+  /* Number of packets from map_offset on whose sync byte was already
+   * checked, they can be handed out without looking at the adapter */
+  guint batch_packets;
 
   /* Reference offset */
   guint64 refoffset;
@@ -283,6 +286,22 @@ struct _MpegTSPacketizer2 {
   MpegTSPCR *observations[MAX_PCR_OBS_CHANNELS];
   guint8 lastobsid;
   GstClockTime pcr_discont_threshold;
+
+  /* If TRUE, packets of PIDs not set in pid_filter are dropped before
+   * being parsed. Use MPEGTS_BIT_* to check the values */
+  gboolean filter_pids;
+  guint8 pid_filter[1024];
+
+  /* Packets returned by mpegts_packetizer_next_packet() and packets dropped
+   * by the PID filter */
+  guint64 packets_processed;
+  guint64 packets_dropped;
+
+  /* Bytes copied to merge input buffers when a packet straddles two of
+   * them. Users of the packetizer add the bytes they copy while assembling
+   * payloads, and count the payload bytes they output */
+  guint64 bytes_copied;
+  guint64 bytes_output;
 };
 
 struct _MpegTSPacketizer2Class {
@@ -374,6 +393,9 @@ G_GNUC_INTERNAL void
 mpegts_packetizer_set_reference_offset (MpegTSPacketizer2 * packetizer,
 					guint64 refoffset);
 G_GNUC_INTERNAL void
+mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 * packetizer,
+					const guint8 * pids);
+G_GNUC_INTERNAL void
 mpegts_packetizer_set_pcr_discont_threshold (MpegTSPacketizer2 * packetizer,
 					GstClockTime threshold);
 G_END_DECLS
@@ -46,6 +46,7 @@
 #include "gstmpegdefs.h"
 #include "mpegtspacketizer.h"
 #include "pesparse.h"
+#include "tsseekindex.h"
 #include <gst/codecparsers/gsth264parser.h>
 #include <gst/codecparsers/gstmpegvideoparser.h>
 #include <gst/video/video-color.h>
@@ -70,6 +71,16 @@
  */
 #define SEEK_TIMESTAMP_OFFSET (2500 * GST_MSECOND)
 
+/* Maximum distance between the seek position and the keyframe or PCR
+ * found in the seek index. Anything further away means that part of the
+ * stream isn't indexed yet. */
+#define SEEK_INDEX_MAX_KEYFRAME_DISTANCE (10 * GST_SECOND)
+#define SEEK_INDEX_MAX_PCR_DISTANCE (2 * TS_SEEK_INDEX_PCR_INTERVAL)
+
+/* Amount of data at the start of the stream that identifies it for the
+ * seek index */
+#define SEEK_INDEX_FINGERPRINT_SIZE (64 * 1024)
+
 #define GST_FLOW_REWINDING GST_FLOW_CUSTOM_ERROR
 
 /* latency in nsecs */
@@ -152,6 +163,9 @@ struct _TSDemuxStream
   /* Whether this is a sparse stream (subtitles or metadata) */
   gboolean sparse;
 
+  /* Whether this is a video stream */
+  gboolean is_video;
+
   /* TRUE if we are waiting for a valid timestamp */
   gboolean pending_ts;
 
@@ -168,6 +182,9 @@ struct _TSDemuxStream
   guint current_size;
   /* Size of ->data */
   guint allocated_size;
+  /* Size to allocate for PES packets of unknown size, learnt from the
+   * previous ones */
+  guint size_hint;
 
   /* Current PTS/DTS for this stream (in running time) */
   GstClockTime pts;
@@ -282,6 +299,8 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_SEEK_INDEX,
+  PROP_SEEK_INDEX_LOCATION,
   /* FILL ME */
 };
 
@@ -322,6 +341,7 @@ static void gst_ts_demux_stream_flush (TSDemuxStream * stream,
     GstTSDemux * demux, gboolean hard);
 
 static gboolean push_event (MpegTSBase * base, GstEvent * event);
+static void gst_ts_demux_save_seek_index (GstTSDemux * demux);
 static void gst_ts_demux_check_and_sync_streams (GstTSDemux * demux,
     GstClockTime time);
 
@@ -347,6 +367,8 @@ gst_ts_demux_dispose (GObject * object)
   GstTSDemux *demux = GST_TS_DEMUX_CAST (object);
 
   gst_flow_combiner_free (demux->flowcombiner);
+  g_free (demux->seek_index_location);
+  demux->seek_index_location = NULL;
 
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
@@ -373,6 +395,31 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:seek-index:
+   *
+   * When reading from a seekable source, index the PCR positions and the
+   * video keyframes (PES packets with the random_access_indicator set)
+   * while playing, and seek straight to the indexed positions instead of
+   * estimating the offset and searching for a keyframe.
+   */
+  g_object_class_install_property (gobject_class, PROP_SEEK_INDEX,
+      g_param_spec_boolean ("seek-index", "Seek index",
+          "Build an index of PCRs and keyframes while playing and use it "
+          "for seeking", FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:seek-index-location:
+   *
+   * File the seek index is loaded from when starting and saved to when
+   * stopping, so that it can be extended over several runs. Setting this
+   * implies #GstTSDemux:seek-index.
+   */
+  g_object_class_install_property (gobject_class, PROP_SEEK_INDEX_LOCATION,
+      g_param_spec_string ("seek-index-location", "Seek index location",
+          "File to load the seek index from and to save it to", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -432,6 +479,12 @@ gst_ts_demux_reset (MpegTSBase * base)
 
   demux->last_seek_offset = -1;
   demux->program_generation = 0;
+
+  if (demux->seek_index) {
+    gst_ts_demux_save_seek_index (demux);
+    ts_seek_index_free (demux->seek_index);
+    demux->seek_index = NULL;
+  }
 }
 
 static void
@@ -466,6 +519,17 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_SEEK_INDEX:
+      GST_OBJECT_LOCK (demux);
+      demux->build_seek_index = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_SEEK_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->seek_index_location);
+      demux->seek_index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -484,11 +548,156 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_SEEK_INDEX:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_boolean (value, demux->build_seek_index);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_SEEK_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->seek_index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
 }
 
+/* Creates the seek index if enabled, with the content of the sidecar file
+ * if there is one. Only done in pull mode, where the times computed by the
+ * packetizer don't depend on where playback started */
+static void
+gst_ts_demux_setup_seek_index (GstTSDemux * demux)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  GError *err = NULL;
+  GstBuffer *head = NULL;
+  GstMapInfo map;
+  gchar *location;
+  gboolean enabled;
+  gint64 size;
+
+  if (demux->seek_index || base->mode == BASE_MODE_PUSHING)
+    return;
+
+  GST_OBJECT_LOCK (demux);
+  enabled = demux->build_seek_index || demux->seek_index_location;
+  location = g_strdup (demux->seek_index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (!enabled)
+    goto done;
+
+  if (!gst_pad_peer_query_duration (base->sinkpad, GST_FORMAT_BYTES, &size)) {
+    GST_WARNING_OBJECT (demux, "Unknown upstream size, no seek index");
+    goto done;
+  }
+
+  if (gst_pad_pull_range (base->sinkpad, 0, SEEK_INDEX_FINGERPRINT_SIZE,
+          &head) != GST_FLOW_OK) {
+    GST_WARNING_OBJECT (demux, "Could not read the stream start, no seek "
+        "index");
+    goto done;
+  }
+
+  demux->seek_index = ts_seek_index_new ();
+  demux->seek_index_stream_size = size;
+
+  gst_buffer_map (head, &map, GST_MAP_READ);
+  ts_seek_index_set_fingerprint (demux->seek_index, map.data, map.size,
+      demux->program->pmt_pid, demux->program->pcr_pid);
+  gst_buffer_unmap (head, &map);
+  gst_buffer_unref (head);
+
+  if (location && g_file_test (location, G_FILE_TEST_EXISTS)) {
+    if (ts_seek_index_load (demux->seek_index, location, size, &err)) {
+      GST_INFO_OBJECT (demux, "Loaded seek index from %s", location);
+    } else {
+      GST_WARNING_OBJECT (demux, "Not using seek index: %s", err->message);
+      g_clear_error (&err);
+    }
+  }
+
+done:
+  g_free (location);
+}
+
+static void
+gst_ts_demux_save_seek_index (GstTSDemux * demux)
+{
+  GError *err = NULL;
+  gchar *location;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->seek_index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location && ts_seek_index_is_dirty (demux->seek_index)) {
+    if (ts_seek_index_save (demux->seek_index, location,
+            demux->seek_index_stream_size, &err)) {
+      GST_INFO_OBJECT (demux, "Saved seek index to %s", location);
+    } else {
+      GST_WARNING_OBJECT (demux, "Could not save seek index: %s",
+          err->message);
+      g_clear_error (&err);
+    }
+  }
+
+  g_free (location);
+}
+
+/* Looks up the offset to start reading from for a seek to @position: the
+ * last keyframe before it if all video streams have one indexed close
+ * enough, else the last PCR before the usual pre-roll distance. @keyframe
+ * tells which of them it is. */
+static gboolean
+gst_ts_demux_lookup_seek_index (GstTSDemux * demux, GstClockTime position,
+    guint64 * offset, gboolean * keyframe)
+{
+  TSSeekIndexEntry entry;
+  gboolean found = FALSE;
+  GList *tmp;
+
+  for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
+    TSDemuxStream *stream = tmp->data;
+
+    if (!stream->is_video)
+      continue;
+
+    if (!ts_seek_index_lookup (demux->seek_index, TS_SEEK_INDEX_KEYFRAME,
+            stream->stream.pid, position, SEEK_INDEX_MAX_KEYFRAME_DISTANCE,
+            &entry)) {
+      found = FALSE;
+      break;
+    }
+
+    if (!found || entry.offset < *offset)
+      *offset = entry.offset;
+    found = TRUE;
+  }
+
+  if (found) {
+    GST_DEBUG_OBJECT (demux, "Indexed keyframe at offset %" G_GUINT64_FORMAT,
+        *offset);
+    *keyframe = TRUE;
+    return TRUE;
+  }
+
+  position = position > SEEK_TIMESTAMP_OFFSET ?
+      position - SEEK_TIMESTAMP_OFFSET : 0;
+  if (ts_seek_index_lookup (demux->seek_index, TS_SEEK_INDEX_PCR,
+          demux->program->pcr_pid, position, SEEK_INDEX_MAX_PCR_DISTANCE,
+          &entry)) {
+    GST_DEBUG_OBJECT (demux, "Indexed PCR %" GST_TIME_FORMAT " at offset %"
+        G_GUINT64_FORMAT, GST_TIME_ARGS (entry.ts), entry.offset);
+    *offset = entry.offset;
+    *keyframe = FALSE;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
 static gboolean
 gst_ts_demux_get_duration (GstTSDemux * demux, GstClockTime * dur)
 {
@@ -705,8 +914,7 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
         if (h264infos->framedata.size)
           break;
 
-        res = gst_h264_parser_parse_slice_hdr (parser, &unit, &slice,
-            FALSE, FALSE);
+        res = gst_h264_parser_parse_slice_hdr_partial (parser, &unit, &slice);
 
         if (GST_H264_IS_I_SLICE (&slice) || GST_H264_IS_SI_SLICE (&slice)) {
           if (*(unit.data + unit.offset + 1) & 0x80) {
@@ -828,6 +1036,7 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GstSeekType start_type, stop_type;
   gint64 start, stop;
   guint64 start_offset;
+  gboolean at_keyframe = FALSE;
 
   gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
       &stop_type, &stop);
@@ -850,9 +1059,15 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GST_DEBUG_OBJECT (demux, "configuring seek");
 
   if (start_type != GST_SEEK_TYPE_NONE) {
-    start_offset =
-        mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
-            start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+    if (demux->seek_index
+        && gst_ts_demux_lookup_seek_index (demux, MAX (0, start),
+            &start_offset, &at_keyframe)) {
+      GST_DEBUG_OBJECT (demux, "Using seek index");
+    } else {
+      start_offset =
+          mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
+              start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+    }
 
     if (G_UNLIKELY (start_offset == -1)) {
       GST_WARNING ("Couldn't convert start position to an offset");
@@ -893,7 +1108,9 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     TSDemuxStream *stream = tmp->data;
 
-    if (flags & GST_SEEK_FLAG_ACCURATE)
+    /* Reading starts right at the keyframes if they were indexed, no need
+     * to scan backwards for them */
+    if ((flags & GST_SEEK_FLAG_ACCURATE) && !at_keyframe)
       stream->needs_keyframe = TRUE;
 
     stream->seeked_pts = GST_CLOCK_TIME_NONE;
@@ -979,6 +1196,9 @@ push_event (MpegTSBase * base, GstEvent * event)
     return early_ret;
   }
 
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS && demux->seek_index)
+    gst_ts_demux_save_seek_index (demux);
+
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     TSDemuxStream *stream = (TSDemuxStream *) tmp->data;
     if (stream->pad) {
@@ -1704,6 +1924,7 @@ done:
           GST_STREAM_FLAG_SPARSE);
     }
     stream->sparse = sparse;
+    stream->is_video = is_video;
     gst_stream_set_caps (bstream->stream_object, caps);
     if (!stream->taglist)
       stream->taglist = gst_tag_list_new_empty ();
@@ -1959,6 +2180,11 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
     demux->program_number = program->program_number;
     demux->program = program;
 
+    /* The other programs of the multiplex can be skipped right away */
+    mpegts_base_set_pid_filter (base, program->program_number);
+
+    gst_ts_demux_setup_seek_index (demux);
+
     /* Increment the program_generation counter */
     demux->program_generation = (demux->program_generation + 1) & 0xf;
 
@@ -2039,6 +2265,7 @@ gst_ts_demux_program_stopped (MpegTSBase * base, MpegTSBaseProgram * program)
   if (demux->program == program) {
     demux->program = NULL;
     demux->program_number = -1;
+    mpegts_base_set_pid_filter (base, -1);
   }
 }
 
@@ -2307,16 +2534,18 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
-  /* Create the output buffer */
+  /* Create the output buffer, big enough to never have to be reallocated
+   * (and copied) if the size is known or the hint was right */
   if (stream->expected_size)
     stream->allocated_size = MAX (stream->expected_size, length);
   else
-    stream->allocated_size = MAX (8192, length);
+    stream->allocated_size = MAX (MAX (8192, stream->size_hint), length);
 
   g_assert (stream->data == NULL);
   stream->data = g_malloc (stream->allocated_size);
   memcpy (stream->data, data, length);
   stream->current_size = length;
+  ((MpegTSBase *) demux)->packetizer->bytes_copied += length;
 
   stream->state = PENDING_PACKET_BUFFER;
 
@@ -2335,6 +2564,7 @@ static inline void
 gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     MpegTSPacketizerPacket * packet)
 {
+  MpegTSPacketizer2 *packetizer = ((MpegTSBase *) demux)->packetizer;
   guint8 *data;
   guint size;
   guint8 cc = FLAGS_CONTINUITY_COUNTER (packet->scram_afc_cc);
@@ -2385,9 +2615,12 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
           stream->allocated_size *= 2;
         } while (stream->current_size + size > stream->allocated_size);
         stream->data = g_realloc (stream->data, stream->allocated_size);
+        /* Worst case, the allocator can often grow in place */
+        packetizer->bytes_copied += stream->current_size;
       }
       memcpy (stream->data + stream->current_size, data, size);
       stream->current_size += size;
+      packetizer->bytes_copied += size;
       break;
     }
     case PENDING_PACKET_DISCONT:
@@ -2839,6 +3072,21 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
     goto beach;
   }
 
+  /* Remember how big PES packets of unknown size get, with some margin and
+   * slowly forgetting about the biggest ones, so that the next ones can be
+   * assembled without reallocations. Then give back what was allocated in
+   * excess, which shrinks the allocation in place. */
+  if (!stream->expected_size)
+    stream->size_hint = MAX (stream->current_size + stream->current_size / 4,
+        stream->size_hint - stream->size_hint / 256);
+  if (stream->current_size > 0 &&
+      stream->allocated_size - stream->current_size >
+      stream->allocated_size / 4) {
+    stream->data = g_realloc (stream->data, stream->current_size);
+    stream->allocated_size = stream->current_size;
+  }
+  ((MpegTSBase *) demux)->packetizer->bytes_output += stream->current_size;
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -3080,6 +3328,15 @@ gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
     gst_ts_demux_queue_data (demux, stream, packet);
     GST_LOG ("current_size:%d, expected_size:%d",
         stream->current_size, stream->expected_size);
+
+    /* Index video PES packets starting with a random access point */
+    if (G_UNLIKELY (demux->seek_index) && stream->is_video &&
+        packet->payload_unit_start_indicator &&
+        (packet->afc_flags & MPEGTS_AFC_RANDOM_ACCES_FLAGS) &&
+        stream->state == PENDING_PACKET_BUFFER &&
+        GST_CLOCK_TIME_IS_VALID (stream->pts))
+      ts_seek_index_add (demux->seek_index, TS_SEEK_INDEX_KEYFRAME,
+          packet->pid, stream->pts, packet->offset);
     /* Finally check if the data we queued completes a packet */
     if (stream->expected_size && stream->current_size == stream->expected_size) {
       GST_LOG ("pushing complete packet");
@@ -3149,6 +3406,16 @@ gst_ts_demux_push (MpegTSBase * base, MpegTSPacketizerPacket * packet,
   GstFlowReturn res = GST_FLOW_OK;
 
   if (G_LIKELY (demux->program)) {
+    if (G_UNLIKELY (demux->seek_index) && packet->pcr != G_MAXUINT64 &&
+        packet->pid == demux->program->pcr_pid) {
+      GstClockTime ts = mpegts_packetizer_pts_to_ts (base->packetizer,
+          PCRTIME_TO_GSTTIME (packet->pcr), packet->pid);
+
+      if (GST_CLOCK_TIME_IS_VALID (ts))
+        ts_seek_index_add (demux->seek_index, TS_SEEK_INDEX_PCR, packet->pid,
+            ts, packet->offset);
+    }
+
     stream = (TSDemuxStream *) demux->program->streams[packet->pid];
 
     if (stream) {
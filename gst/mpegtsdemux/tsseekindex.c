@@ -0,0 +1,329 @@
+/*
+ * tsseekindex.c : Seek index for MPEG transport streams
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gst/base/gstbytereader.h>
+#include <gst/base/gstbytewriter.h>
+
+#include "tsseekindex.h"
+
+/* File layout, all values big endian:
+ *
+ * magic          8 bytes "GSTTSIDX"
+ * version        32 bits
+ * stream_size    64 bits  size of the stream when the index was saved
+ * fingerprint    20 bytes see ts_seek_index_set_fingerprint()
+ * n_tables       32 bits
+ * n_tables times:
+ *   type         8 bits   TSSeekIndexType
+ *   pid          16 bits
+ *   n_entries    32 bits
+ *   n_entries times:
+ *     ts         64 bits
+ *     offset     64 bits
+ */
+#define TS_SEEK_INDEX_MAGIC "GSTTSIDX"
+#define TS_SEEK_INDEX_VERSION 2
+#define TS_SEEK_INDEX_FINGERPRINT_SIZE 20
+
+#define TABLE_KEY(type, pid) GUINT_TO_POINTER (((type) << 16) | (pid))
+#define TABLE_KEY_TYPE(key) (GPOINTER_TO_UINT (key) >> 16)
+#define TABLE_KEY_PID(key) (GPOINTER_TO_UINT (key) & 0xffff)
+
+#define ABSDIFF(a,b) (((a) > (b)) ? ((a) - (b)) : ((b) - (a)))
+
+struct _TSSeekIndex
+{
+  /* TABLE_KEY => GArray of TSSeekIndexEntry, sorted by offset */
+  GHashTable *tables;
+
+  /* Whether entries were added since the index was loaded or saved */
+  gboolean dirty;
+
+  /* SHA-1 identifying the stream the entries belong to */
+  guint8 fingerprint[TS_SEEK_INDEX_FINGERPRINT_SIZE];
+};
+
+TSSeekIndex *
+ts_seek_index_new (void)
+{
+  TSSeekIndex *index = g_new0 (TSSeekIndex, 1);
+
+  index->tables = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) g_array_unref);
+
+  return index;
+}
+
+void
+ts_seek_index_free (TSSeekIndex * index)
+{
+  g_hash_table_unref (index->tables);
+  g_free (index);
+}
+
+/* Identifies the stream by a hash of its first @head_size bytes and of the
+ * PIDs of the PMT and PCR of the program, which have to be the same when
+ * loading the index. Size checks alone would accept an index of another
+ * recording of about the same length. */
+void
+ts_seek_index_set_fingerprint (TSSeekIndex * index, const guint8 * head,
+    gsize head_size, guint16 pmt_pid, guint16 pcr_pid)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  gsize len = TS_SEEK_INDEX_FINGERPRINT_SIZE;
+  guint8 pids[4];
+
+  GST_WRITE_UINT16_BE (pids, pmt_pid);
+  GST_WRITE_UINT16_BE (pids + 2, pcr_pid);
+
+  g_checksum_update (checksum, head, head_size);
+  g_checksum_update (checksum, pids, sizeof (pids));
+  g_checksum_get_digest (checksum, index->fingerprint, &len);
+  g_checksum_free (checksum);
+}
+
+/* Returns the position of the first entry with an offset >= @offset */
+static guint
+ts_seek_index_find_offset (GArray * table, guint64 offset)
+{
+  guint lo = 0, hi = table->len;
+
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (g_array_index (table, TSSeekIndexEntry, mid).offset < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+void
+ts_seek_index_add (TSSeekIndex * index, TSSeekIndexType type, guint16 pid,
+    GstClockTime ts, guint64 offset)
+{
+  TSSeekIndexEntry entry = { ts, offset };
+  TSSeekIndexEntry *entries;
+  GArray *table;
+  guint pos;
+
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (ts));
+
+  table = g_hash_table_lookup (index->tables, TABLE_KEY (type, pid));
+  if (table == NULL) {
+    table = g_array_new (FALSE, FALSE, sizeof (TSSeekIndexEntry));
+    g_hash_table_insert (index->tables, TABLE_KEY (type, pid), table);
+  }
+  entries = (TSSeekIndexEntry *) table->data;
+
+  /* While playing, entries are appended. They only need to be inserted in the
+   * middle after seeking back into a region that wasn't indexed yet */
+  pos = table->len;
+  if (pos > 0 && entries[pos - 1].offset >= offset)
+    pos = ts_seek_index_find_offset (table, offset);
+
+  if (pos < table->len && entries[pos].offset == offset)
+    return;
+
+  if (type == TS_SEEK_INDEX_PCR) {
+    if (pos > 0
+        && ABSDIFF (entries[pos - 1].ts, ts) < TS_SEEK_INDEX_PCR_INTERVAL)
+      return;
+    if (pos < table->len
+        && ABSDIFF (entries[pos].ts, ts) < TS_SEEK_INDEX_PCR_INTERVAL)
+      return;
+  }
+
+  g_array_insert_val (table, pos, entry);
+  index->dirty = TRUE;
+}
+
+/* Finds the last entry at or before @ts, if it is at most @max_distance
+ * away from it */
+gboolean
+ts_seek_index_lookup (TSSeekIndex * index, TSSeekIndexType type, guint16 pid,
+    GstClockTime ts, GstClockTime max_distance, TSSeekIndexEntry * entry)
+{
+  TSSeekIndexEntry *found;
+  GArray *table;
+  guint lo, hi;
+
+  table = g_hash_table_lookup (index->tables, TABLE_KEY (type, pid));
+  if (table == NULL)
+    return FALSE;
+
+  /* Timestamps increase with the offset, except across PCR discontinuities.
+   * The distance check below rejects what such a jump could return. */
+  lo = 0;
+  hi = table->len;
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (g_array_index (table, TSSeekIndexEntry, mid).ts <= ts)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return FALSE;
+
+  found = &g_array_index (table, TSSeekIndexEntry, lo - 1);
+  if (found->ts > ts || ts - found->ts > max_distance)
+    return FALSE;
+
+  *entry = *found;
+  return TRUE;
+}
+
+gboolean
+ts_seek_index_is_dirty (TSSeekIndex * index)
+{
+  return index->dirty;
+}
+
+/* Adds the entries stored in @location. Fails if the file was written for a
+ * stream with another fingerprint, or bigger than @stream_size, which can't
+ * be the same one. Recordings which grew since are fine. */
+gboolean
+ts_seek_index_load (TSSeekIndex * index, const gchar * location,
+    guint64 stream_size, GError ** error)
+{
+  GstByteReader br;
+  gchar *contents;
+  gsize size;
+  const guint8 *magic, *fingerprint;
+  guint32 version, n_tables, n_entries, i, j;
+  guint64 saved_size, ts, offset;
+  guint16 pid;
+  guint8 type;
+  gboolean dirty = index->dirty;
+
+  if (!g_file_get_contents (location, &contents, &size, error))
+    return FALSE;
+
+  gst_byte_reader_init (&br, (const guint8 *) contents, size);
+
+  if (!gst_byte_reader_get_data (&br, 8, &magic) ||
+      memcmp (magic, TS_SEEK_INDEX_MAGIC, 8) != 0 ||
+      !gst_byte_reader_get_uint32_be (&br, &version) ||
+      version != TS_SEEK_INDEX_VERSION)
+    goto invalid;
+
+  if (!gst_byte_reader_get_uint64_be (&br, &saved_size) ||
+      !gst_byte_reader_get_data (&br, TS_SEEK_INDEX_FINGERPRINT_SIZE,
+          &fingerprint) || !gst_byte_reader_get_uint32_be (&br, &n_tables))
+    goto invalid;
+
+  if (memcmp (fingerprint, index->fingerprint,
+          TS_SEEK_INDEX_FINGERPRINT_SIZE) != 0) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "Seek index %s is for another stream", location);
+    g_free (contents);
+    return FALSE;
+  }
+
+  if (saved_size > stream_size) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "Seek index %s is for a stream of %" G_GUINT64_FORMAT " bytes, not %"
+        G_GUINT64_FORMAT, location, saved_size, stream_size);
+    g_free (contents);
+    return FALSE;
+  }
+
+  for (i = 0; i < n_tables; i++) {
+    if (!gst_byte_reader_get_uint8 (&br, &type) ||
+        !gst_byte_reader_get_uint16_be (&br, &pid) ||
+        !gst_byte_reader_get_uint32_be (&br, &n_entries) ||
+        type > TS_SEEK_INDEX_KEYFRAME || pid > 0x1fff ||
+        gst_byte_reader_get_remaining (&br) / 16 < n_entries)
+      goto invalid;
+
+    for (j = 0; j < n_entries; j++) {
+      ts = gst_byte_reader_get_uint64_be_unchecked (&br);
+      offset = gst_byte_reader_get_uint64_be_unchecked (&br);
+      if (GST_CLOCK_TIME_IS_VALID (ts))
+        ts_seek_index_add (index, type, pid, ts, offset);
+    }
+  }
+
+  g_free (contents);
+  index->dirty = dirty;
+  return TRUE;
+
+invalid:
+  g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+      "%s is not a valid seek index", location);
+  g_free (contents);
+  return FALSE;
+}
+
+gboolean
+ts_seek_index_save (TSSeekIndex * index, const gchar * location,
+    guint64 stream_size, GError ** error)
+{
+  GstByteWriter bw;
+  GHashTableIter iter;
+  gpointer key;
+  GArray *table;
+  guint8 *data;
+  gsize size;
+  gboolean ret;
+  guint i;
+
+  gst_byte_writer_init (&bw);
+  gst_byte_writer_put_data (&bw, (const guint8 *) TS_SEEK_INDEX_MAGIC, 8);
+  gst_byte_writer_put_uint32_be (&bw, TS_SEEK_INDEX_VERSION);
+  gst_byte_writer_put_uint64_be (&bw, stream_size);
+  gst_byte_writer_put_data (&bw, index->fingerprint,
+      TS_SEEK_INDEX_FINGERPRINT_SIZE);
+  gst_byte_writer_put_uint32_be (&bw, g_hash_table_size (index->tables));
+
+  g_hash_table_iter_init (&iter, index->tables);
+  while (g_hash_table_iter_next (&iter, &key, (gpointer *) & table)) {
+    gst_byte_writer_put_uint8 (&bw, TABLE_KEY_TYPE (key));
+    gst_byte_writer_put_uint16_be (&bw, TABLE_KEY_PID (key));
+    gst_byte_writer_put_uint32_be (&bw, table->len);
+    for (i = 0; i < table->len; i++) {
+      TSSeekIndexEntry *entry = &g_array_index (table, TSSeekIndexEntry, i);
+
+      gst_byte_writer_put_uint64_be (&bw, entry->ts);
+      gst_byte_writer_put_uint64_be (&bw, entry->offset);
+    }
+  }
+
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+
+  ret = g_file_set_contents (location, (const gchar *) data, size, error);
+  if (ret)
+    index->dirty = FALSE;
+
+  g_free (data);
+
+  return ret;
+}
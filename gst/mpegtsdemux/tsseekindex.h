@@ -0,0 +1,72 @@
+/*
+ * tsseekindex.h : Seek index for MPEG transport streams
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __TS_SEEK_INDEX_H__
+#define __TS_SEEK_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Minimum distance between two PCR entries of the same PID */
+#define TS_SEEK_INDEX_PCR_INTERVAL GST_SECOND
+
+typedef enum
+{
+  /* Position of a PCR */
+  TS_SEEK_INDEX_PCR = 0,
+  /* Start of a PES packet with the random_access_indicator set */
+  TS_SEEK_INDEX_KEYFRAME = 1
+} TSSeekIndexType;
+
+typedef struct
+{
+  /* Time in the same base as mpegts_packetizer_pts_to_ts() */
+  GstClockTime ts;
+  /* Byte offset of the TS packet */
+  guint64 offset;
+} TSSeekIndexEntry;
+
+/* Sorted tables of TSSeekIndexEntry per PID and type, which can be saved
+ * to and restored from a file. Entries of regions of the stream that were
+ * not read (yet) are simply missing, so lookups have to check how far away
+ * the returned entry is from the requested position. */
+typedef struct _TSSeekIndex TSSeekIndex;
+
+G_GNUC_INTERNAL TSSeekIndex *ts_seek_index_new (void);
+G_GNUC_INTERNAL void ts_seek_index_free (TSSeekIndex * index);
+
+G_GNUC_INTERNAL void ts_seek_index_set_fingerprint (TSSeekIndex * index,
+    const guint8 * head, gsize head_size, guint16 pmt_pid, guint16 pcr_pid);
+
+G_GNUC_INTERNAL void ts_seek_index_add (TSSeekIndex * index,
+    TSSeekIndexType type, guint16 pid, GstClockTime ts, guint64 offset);
+G_GNUC_INTERNAL gboolean ts_seek_index_lookup (TSSeekIndex * index,
+    TSSeekIndexType type, guint16 pid, GstClockTime ts,
+    GstClockTime max_distance, TSSeekIndexEntry * entry);
+
+G_GNUC_INTERNAL gboolean ts_seek_index_is_dirty (TSSeekIndex * index);
+G_GNUC_INTERNAL gboolean ts_seek_index_load (TSSeekIndex * index,
+    const gchar * location, guint64 stream_size, GError ** error);
+G_GNUC_INTERNAL gboolean ts_seek_index_save (TSSeekIndex * index,
+    const gchar * location, guint64 stream_size, GError ** error);
+
+G_END_DECLS
+
+#endif /* __TS_SEEK_INDEX_H__ */
@@ -115,10 +115,21 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE,
+  PROP_N_THREADS
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
+#define MPEGTSMUX_DEFAULT_BITRATE      0
+#define MPEGTSMUX_DEFAULT_N_THREADS    1
+#define MPEGTSMUX_MAX_N_THREADS        64
+
+/* Number of input buffers packetised ahead of the output per thread */
+#define MPEGTSMUX_JOBS_PER_THREAD 4
+
+/* Number of packets per output buffer without alignment */
+#define MPEGTSMUX_BUFFER_PACKETS 64
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
@@ -173,6 +184,8 @@ static void gst_mpegtsmux_get_property (GObject * object, guint prop_id,
 
 static void mpegtsmux_reset (MpegTsMux * mux, gboolean alloc);
 static void mpegtsmux_dispose (GObject * object);
+static void mpegtsmux_finalize (GObject * object);
+static void mpegtsmux_stop_jobs (MpegTsMux * mux);
 static void alloc_packet_cb (GstBuffer ** _buf, void *user_data);
 static gboolean new_packet_cb (GstBuffer * buf, void *user_data,
     gint64 new_pcr);
@@ -259,6 +272,7 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gst_mpegtsmux_set_property);
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_mpegtsmux_get_property);
   gobject_class->dispose = mpegtsmux_dispose;
+  gobject_class->finalize = mpegtsmux_finalize;
 
   gstelement_class->request_new_pad = mpegtsmux_request_new_pad;
   gstelement_class->release_pad = mpegtsmux_release_pad;
@@ -305,6 +319,27 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target bitrate, will insert null packets as padding "
+          "and timestamp buffers by their sending time "
+          "(0 = variable bitrate)", 0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MpegTsMux:n-threads:
+   *
+   * Number of threads which packetise the input buffers of different
+   * streams concurrently, ahead of the output. The output is the same as
+   * with a single thread. Ignored in constant bitrate mode.
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use for packetising (0 = auto)",
+          0, MPEGTSMUX_MAX_N_THREADS, MPEGTSMUX_DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -329,7 +364,6 @@ mpegtsmux_init (MpegTsMux * mux)
       GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
 
   mux->adapter = gst_adapter_new ();
-  mux->out_adapter = gst_adapter_new ();
 
   /* properties */
   mux->m2ts_mode = MPEGTSMUX_DEFAULT_M2TS;
@@ -338,6 +372,12 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
+  mux->n_threads = MPEGTSMUX_DEFAULT_N_THREADS;
+
+  g_mutex_init (&mux->job_lock);
+  g_cond_init (&mux->job_cond);
+  g_queue_init (&mux->jobs);
 
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
@@ -373,12 +413,56 @@ mpegtsmux_pad_reset (MpegTsPadData * pad_data)
 
 }
 
+static GstBufferPool *
+mpegtsmux_new_buffer_pool (guint size)
+{
+  GstBufferPool *pool = gst_buffer_pool_new ();
+  GstStructure *config;
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+static void
+mpegtsmux_free_buffer_pool (GstBufferPool ** pool)
+{
+  if (*pool) {
+    gst_buffer_pool_set_active (*pool, FALSE);
+    gst_object_unref (*pool);
+    *pool = NULL;
+  }
+}
+
+/* Packets go back to the pool once copied into an output buffer */
+static gboolean
+mpegtsmux_ensure_packet_pool (MpegTsMux * mux)
+{
+  if (!mux->packet_pool) {
+    gint offset = mux->m2ts_mode ? 4 : 0;
+
+    mux->packet_pool =
+        mpegtsmux_new_buffer_pool (NORMAL_TS_PACKET_LENGTH + offset);
+  }
+
+  return mux->packet_pool != NULL;
+}
+
 static void
 mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
 {
   GstBuffer *buf;
   GSList *walk;
 
+  /* jobs refer to the streams of tsmux */
+  mpegtsmux_stop_jobs (mux);
+
   mux->first = TRUE;
   mux->last_flow_ret = GST_FLOW_OK;
   mux->previous_pcr = -1;
@@ -401,8 +485,6 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
 #endif
   if (mux->adapter)
     gst_adapter_clear (mux->adapter);
-  if (mux->out_adapter)
-    gst_adapter_clear (mux->out_adapter);
 
   if (mux->tsmux) {
     tsmux_free (mux->tsmux);
@@ -418,7 +500,17 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     gst_buffer_unref (buf);
 
   gst_event_replace (&mux->force_key_unit_event, NULL);
-  gst_buffer_replace (&mux->out_buffer, NULL);
+
+  if (mux->out_buffer) {
+    gst_buffer_unmap (mux->out_buffer, &mux->out_map);
+    gst_buffer_replace (&mux->out_buffer, NULL);
+  }
+  if (mux->out_list) {
+    gst_buffer_list_unref (mux->out_list);
+    mux->out_list = NULL;
+  }
+  mpegtsmux_free_buffer_pool (&mux->packet_pool);
+  mpegtsmux_free_buffer_pool (&mux->out_pool);
 
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
@@ -445,10 +537,6 @@ mpegtsmux_dispose (GObject * object)
     g_object_unref (mux->adapter);
     mux->adapter = NULL;
   }
-  if (mux->out_adapter) {
-    g_object_unref (mux->out_adapter);
-    mux->out_adapter = NULL;
-  }
   if (mux->collect) {
     gst_object_unref (mux->collect);
     mux->collect = NULL;
@@ -464,6 +552,17 @@ mpegtsmux_dispose (GObject * object)
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
+static void
+mpegtsmux_finalize (GObject * object)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (object);
+
+  g_mutex_clear (&mux->job_lock);
+  g_cond_clear (&mux->job_cond);
+
+  GST_CALL_PARENT (G_OBJECT_CLASS, finalize, (object));
+}
+
 static void
 gst_mpegtsmux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -511,6 +610,13 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      /* only applied when starting, see change_state */
+      mux->bitrate = g_value_get_uint64 (value);
+      break;
+    case PROP_N_THREADS:
+      mux->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -542,6 +648,12 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, mux->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1089,6 +1201,11 @@ mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
     case GST_EVENT_FLUSH_STOP:{
       GList *cur;
 
+      /* Drop the data queued before the flush */
+      GST_COLLECT_PADS_STREAM_LOCK (pads);
+      mpegtsmux_stop_jobs (mux);
+      GST_COLLECT_PADS_STREAM_UNLOCK (pads);
+
       /* Send initial segments again after a flush-stop, and also resend the
        * header sections */
       mux->first = TRUE;
@@ -1319,6 +1436,242 @@ beach:
   return GST_FLOW_OK;
 }
 
+typedef enum
+{
+  /* waiting for the previous job of the same stream */
+  MPEGTSMUX_JOB_WAITING,
+  MPEGTSMUX_JOB_RUNNING,
+  MPEGTSMUX_JOB_DONE
+} MpegTsMuxJobState;
+
+/* Packetisation of one input buffer */
+typedef struct
+{
+  TsMuxStream *stream;
+  StreamData *stream_data;
+  gint64 pts;
+  gint64 dts;
+  gboolean delta;
+  gboolean header;
+  /* timestamp the output follows, if from the PCR stream */
+  GstClockTime ts;
+
+  MpegTsMuxJobState state;
+  gboolean failed;
+  /* TsMuxPacket */
+  GArray *packets;
+} MpegTsMuxJob;
+
+static void
+mpegtsmux_job_free (MpegTsMuxJob * job)
+{
+  guint i;
+
+  for (i = 0; i < job->packets->len; i++) {
+    TsMuxPacket *packet = &g_array_index (job->packets, TsMuxPacket, i);
+
+    if (packet->buf)
+      gst_buffer_unref (packet->buf);
+  }
+  g_array_free (job->packets, TRUE);
+  stream_data_free (job->stream_data);
+  g_slice_free (MpegTsMuxJob, job);
+}
+
+/* Runs on job_pool. Only touches the state of the job's stream, jobs of
+ * the same stream are run one after another */
+static void
+mpegtsmux_run_job (MpegTsMux * mux, MpegTsMuxJob * job)
+{
+  TsMuxPacket packet;
+
+  tsmux_stream_add_data (job->stream, job->stream_data->map_info.data,
+      job->stream_data->map_info.size, job->stream_data, job->pts, job->dts,
+      !job->delta);
+  /* released by the stream once written */
+  job->stream_data = NULL;
+
+  while (tsmux_stream_bytes_in_buffer (job->stream) > 0) {
+    if (!tsmux_prepare_stream_packet (mux->tsmux, job->stream, &packet)) {
+      job->failed = TRUE;
+      break;
+    }
+    g_array_append_val (job->packets, packet);
+  }
+}
+
+static void
+mpegtsmux_job_thread (MpegTsMuxJob * job, MpegTsMux * mux)
+{
+  while (job) {
+    MpegTsMuxJob *next = NULL;
+    GList *l;
+
+    mpegtsmux_run_job (mux, job);
+
+    g_mutex_lock (&mux->job_lock);
+    job->state = MPEGTSMUX_JOB_DONE;
+    /* continue with the next job of the stream, if it waits for this one */
+    for (l = mux->jobs.head; l; l = l->next) {
+      MpegTsMuxJob *other = l->data;
+
+      if (other->stream == job->stream
+          && other->state == MPEGTSMUX_JOB_WAITING) {
+        other->state = MPEGTSMUX_JOB_RUNNING;
+        next = other;
+        break;
+      }
+    }
+    g_cond_broadcast (&mux->job_cond);
+    g_mutex_unlock (&mux->job_lock);
+
+    job = next;
+  }
+}
+
+/* Writes out the packets of a finished job, as the serial code path would
+ * have written them */
+static GstFlowReturn
+mpegtsmux_write_job (MpegTsMux * mux, MpegTsMuxJob * job)
+{
+  guint i;
+
+  if (GST_CLOCK_TIME_IS_VALID (job->ts))
+    mux->last_ts = job->ts;
+  mux->is_delta = job->delta;
+  mux->is_header = job->header;
+
+  for (i = 0; i < job->packets->len; i++) {
+    TsMuxPacket *packet = &g_array_index (job->packets, TsMuxPacket, i);
+
+    if (!tsmux_write_prepared_packet (mux->tsmux, packet))
+      goto write_fail;
+  }
+
+  if (job->failed)
+    goto write_fail;
+
+  return GST_FLOW_OK;
+
+write_fail:
+  {
+    GST_DEBUG_OBJECT (mux, "Failed to write data packet");
+    GST_ELEMENT_ERROR (mux, STREAM, MUX,
+        ("Failed writing output data to stream %04x", job->stream->id),
+        (NULL));
+    return mux->last_flow_ret;
+  }
+}
+
+/* Writes out the finished jobs at the start of the queue. Waits for jobs to
+ * finish while the queue is full, or until it is empty if @drain is set */
+static GstFlowReturn
+mpegtsmux_output_jobs (MpegTsMux * mux, gboolean drain)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  MpegTsMuxJob *job;
+  guint max_jobs = 0;
+
+  if (mux->job_pool)
+    max_jobs = MPEGTSMUX_JOBS_PER_THREAD *
+        g_thread_pool_get_max_threads (mux->job_pool);
+
+  g_mutex_lock (&mux->job_lock);
+  while ((job = g_queue_peek_head (&mux->jobs))) {
+    if (job->state != MPEGTSMUX_JOB_DONE) {
+      if (!drain && mux->jobs.length < max_jobs)
+        break;
+      g_cond_wait (&mux->job_cond, &mux->job_lock);
+      continue;
+    }
+
+    g_queue_pop_head (&mux->jobs);
+    g_mutex_unlock (&mux->job_lock);
+
+    if (ret == GST_FLOW_OK)
+      ret = mpegtsmux_write_job (mux, job);
+    mpegtsmux_job_free (job);
+
+    g_mutex_lock (&mux->job_lock);
+  }
+  g_mutex_unlock (&mux->job_lock);
+
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  /* flush packet cache */
+  return mpegtsmux_push_packets (mux, FALSE);
+}
+
+/* Queues the packetisation of @job on job_pool. It starts right away unless
+ * a previous job of the same stream is not done yet, then it is run after
+ * that one */
+static GstFlowReturn
+mpegtsmux_queue_job (MpegTsMux * mux, MpegTsMuxJob * job)
+{
+  GError *err = NULL;
+  GList *l;
+
+  if (mux->job_pool == NULL) {
+    guint n_threads = mux->n_threads;
+
+    if (n_threads == 0)
+      n_threads = MIN (g_get_num_processors (), MPEGTSMUX_MAX_N_THREADS);
+
+    mux->job_pool = g_thread_pool_new ((GFunc) mpegtsmux_job_thread, mux,
+        n_threads, FALSE, &err);
+    if (mux->job_pool == NULL) {
+      GST_ELEMENT_ERROR (mux, CORE, FAILED,
+          ("Failed to create packetising threads"), ("%s", err->message));
+      g_clear_error (&err);
+      mpegtsmux_job_free (job);
+      return GST_FLOW_ERROR;
+    }
+  }
+
+  /* the jobs share the packet pool */
+  if (!mpegtsmux_ensure_packet_pool (mux)) {
+    GST_ELEMENT_ERROR (mux, RESOURCE, FAILED,
+        ("Failed to create a packet buffer pool"), (NULL));
+    mpegtsmux_job_free (job);
+    return GST_FLOW_ERROR;
+  }
+
+  g_mutex_lock (&mux->job_lock);
+  job->state = MPEGTSMUX_JOB_RUNNING;
+  for (l = mux->jobs.tail; l; l = l->prev) {
+    MpegTsMuxJob *other = l->data;
+
+    if (other->stream == job->stream) {
+      if (other->state != MPEGTSMUX_JOB_DONE)
+        job->state = MPEGTSMUX_JOB_WAITING;
+      break;
+    }
+  }
+  g_queue_push_tail (&mux->jobs, job);
+  g_mutex_unlock (&mux->job_lock);
+
+  if (job->state == MPEGTSMUX_JOB_RUNNING)
+    g_thread_pool_push (mux->job_pool, job, NULL);
+
+  return mpegtsmux_output_jobs (mux, FALSE);
+}
+
+/* Waits for the running jobs and drops all of them */
+static void
+mpegtsmux_stop_jobs (MpegTsMux * mux)
+{
+  MpegTsMuxJob *job;
+
+  if (mux->job_pool) {
+    g_thread_pool_free (mux->job_pool, FALSE, TRUE);
+    mux->job_pool = NULL;
+  }
+
+  while ((job = g_queue_pop_head (&mux->jobs)))
+    mpegtsmux_job_free (job);
+}
+
 static GstFlowReturn
 mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     GstBuffer * buf, MpegTsMux * mux)
@@ -1350,6 +1703,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     /* EOS */
     GST_INFO_OBJECT (mux, "EOS");
     /* drain some possibly cached data */
+    mpegtsmux_output_jobs (mux, TRUE);
     new_packet_m2ts (mux, NULL, -1);
     mpegtsmux_push_packets (mux, TRUE);
     gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
@@ -1386,6 +1740,14 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
       guint count;
       GList *cur;
 
+      /* the event and the tables follow all data before */
+      ret = mpegtsmux_output_jobs (mux, TRUE);
+      if (ret != GST_FLOW_OK) {
+        gst_event_unref (event);
+        gst_buffer_unref (buf);
+        return ret;
+      }
+
       mux->pending_key_unit_ts = GST_CLOCK_TIME_NONE;
       gst_event_replace (&mux->force_key_unit_event, NULL);
 
@@ -1466,6 +1828,40 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
   GST_DEBUG_OBJECT (mux, "delta: %d", delta);
 
   stream_data = stream_data_new (buf);
+
+  /* Packetise on the job threads, except in constant bitrate mode where each
+   * packet depends on the ones of all streams written before */
+  if (mux->n_threads != 1 && tsmux_get_bitrate (mux->tsmux) == 0) {
+    MpegTsMuxJob *job = g_slice_new0 (MpegTsMuxJob);
+
+    job->stream = best->stream;
+    job->stream_data = stream_data;
+    job->pts = pts;
+    job->dts = dts;
+    job->delta = delta;
+    job->header = header;
+    job->ts = GST_CLOCK_TIME_NONE;
+    /* outgoing ts follows ts of PCR program stream */
+    if (prog->pcr_stream == best->stream) {
+      /* prefer DTS if present for PCR as it should be monotone */
+      job->ts =
+          GST_CLOCK_TIME_IS_VALID (GST_BUFFER_DTS (buf)) ?
+          GST_BUFFER_DTS (buf) : GST_BUFFER_PTS (buf);
+    }
+    job->packets = g_array_new (FALSE, FALSE, sizeof (TsMuxPacket));
+
+    return mpegtsmux_queue_job (mux, job);
+  }
+
+  /* jobs queued before the property changed go first */
+  if (!g_queue_is_empty (&mux->jobs)) {
+    ret = mpegtsmux_output_jobs (mux, TRUE);
+    if (ret != GST_FLOW_OK) {
+      stream_data_free (stream_data);
+      return ret;
+    }
+  }
+
   tsmux_stream_add_data (best->stream, stream_data->map_info.data,
       stream_data->map_info.size, stream_data, pts, dts, !delta);
 
@@ -1627,81 +2023,34 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
   }
 }
 
-static GstFlowReturn
-mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+/* Number of packets per output buffer, 0 to output them as they come */
+static gint
+mpegtsmux_get_alignment (MpegTsMux * mux)
 {
-  GstBufferList *buffer_list;
-  gint align = mux->alignment;
-  gint av, packet_size;
-
-  if (mux->m2ts_mode) {
-    packet_size = M2TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 32;
-  } else {
-    packet_size = NORMAL_TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 0;
-  }
-
-  av = gst_adapter_available (mux->out_adapter);
-  GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
-
-  if (av == 0)
-    return GST_FLOW_OK;
-
-  /* no alignment, just push all available data */
-  if (align == 0) {
-    buffer_list = gst_adapter_take_buffer_list (mux->out_adapter, av);
-    return gst_pad_push_list (mux->srcpad, buffer_list);
-  }
-
-  align *= packet_size;
+  if (mux->alignment >= 0)
+    return mux->alignment;
 
-  if (!force && align > av)
-    return GST_FLOW_OK;
-
-  buffer_list = gst_buffer_list_new_sized ((av / align) + 1);
-
-  GST_LOG_OBJECT (mux, "aligning to %d bytes", align);
-  while (align <= av) {
-    GstBuffer *buf;
-    GstClockTime pts;
+  return mux->m2ts_mode ? 32 : 0;
+}
 
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_adapter_take_buffer (mux->out_adapter, align);
+/* Queues the current output buffer for pushing. If @pad is set, the rest
+ * of an aligned buffer is filled with null packets. */
+static void
+mpegtsmux_finish_out_buffer (MpegTsMux * mux, gboolean pad)
+{
+  gint packet_size;
 
-    GST_BUFFER_PTS (buf) = pts;
+  if (!mux->out_buffer)
+    return;
 
-    gst_buffer_list_add (buffer_list, buf);
-    av -= align;
-  }
+  packet_size = mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH;
 
-  if (av > 0 && force) {
-    GstBuffer *buf;
-    GstClockTime pts;
-    guint8 *data;
-    guint32 header;
+  if (pad && mpegtsmux_get_alignment (mux) > 0) {
+    guint8 *data = mux->out_map.data + mux->out_offset;
+    guint32 header = GST_READ_UINT32_BE (data - packet_size);
     gint dummy;
-    GstMapInfo map;
-
-    GST_LOG_OBJECT (mux, "handling %d leftover bytes", av);
-
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_buffer_new_and_alloc (align);
-
-    GST_BUFFER_PTS (buf) = pts;
-
-    gst_buffer_map (buf, &map, GST_MAP_READ);
-    data = map.data;
-
-    gst_adapter_copy (mux->out_adapter, data, 0, av);
-    gst_adapter_clear (mux->out_adapter);
-
-    data += av;
-    header = GST_READ_UINT32_BE (data - packet_size);
 
-    dummy = (map.size - av) / packet_size;
+    dummy = (mux->out_map.size - mux->out_offset) / packet_size;
     GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
 
     for (; dummy > 0; dummy--) {
@@ -1723,21 +2072,91 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
       /* payload */
       memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
       data += packet_size;
+      mux->out_offset += packet_size;
     }
-
-    gst_buffer_unmap (buf, &map);
-    gst_buffer_list_add (buffer_list, buf);
   }
 
+  gst_buffer_unmap (mux->out_buffer, &mux->out_map);
+  gst_buffer_set_size (mux->out_buffer, mux->out_offset);
+
+  if (!mux->out_list)
+    mux->out_list = gst_buffer_list_new ();
+  gst_buffer_list_add (mux->out_list, mux->out_buffer);
+  mux->out_buffer = NULL;
+}
+
+static GstFlowReturn
+mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list;
+
+  /* Aligned output buffers are only pushed once full, except when draining
+   * where the last one is padded. All others are pushed right away. */
+  if (force || mpegtsmux_get_alignment (mux) == 0)
+    mpegtsmux_finish_out_buffer (mux, force);
+
+  if (!mux->out_list)
+    return GST_FLOW_OK;
+
+  buffer_list = mux->out_list;
+  mux->out_list = NULL;
+
+  GST_LOG_OBJECT (mux, "pushing %u buffers",
+      gst_buffer_list_length (buffer_list));
+
   return gst_pad_push_list (mux->srcpad, buffer_list);
 }
 
+/* Copies the packet into the current output buffer, which takes the
+ * timestamp and the flags of its first packet */
 static GstFlowReturn
 mpegtsmux_collect_packet (MpegTsMux * mux, GstBuffer * buf)
 {
-  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT,
-      gst_buffer_get_size (buf));
-  gst_adapter_push (mux->out_adapter, buf);
+  gsize size;
+
+  /* Section packets can carry 4 more bytes reserved for the M2TS header */
+  size = mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH;
+
+  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT, size);
+
+  /* Without alignment, keyframes start a new buffer so that downstream can
+   * split the stream there */
+  if (mux->out_buffer && mpegtsmux_get_alignment (mux) == 0 &&
+      !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT))
+    mpegtsmux_finish_out_buffer (mux, FALSE);
+
+  if (!mux->out_buffer) {
+    if (!mux->out_pool) {
+      gint packets = mpegtsmux_get_alignment (mux);
+
+      if (packets == 0)
+        packets = MPEGTSMUX_BUFFER_PACKETS;
+      mux->out_pool = mpegtsmux_new_buffer_pool (packets * size);
+    }
+
+    if (!mux->out_pool || gst_buffer_pool_acquire_buffer (mux->out_pool,
+            &mux->out_buffer, NULL) != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (mux, "Failed to get an output buffer");
+      gst_buffer_unref (buf);
+      return GST_FLOW_ERROR;
+    }
+
+    gst_buffer_map (mux->out_buffer, &mux->out_map, GST_MAP_WRITE);
+    mux->out_offset = 0;
+
+    GST_BUFFER_PTS (mux->out_buffer) = GST_BUFFER_PTS (buf);
+    if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_HEADER))
+      GST_BUFFER_FLAG_SET (mux->out_buffer, GST_BUFFER_FLAG_HEADER);
+    if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT))
+      GST_BUFFER_FLAG_SET (mux->out_buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  gst_buffer_extract (buf, 0, mux->out_map.data + mux->out_offset, size);
+  mux->out_offset += size;
+  gst_buffer_unref (buf);
+
+  if (mux->out_offset + size > mux->out_map.size)
+    mpegtsmux_finish_out_buffer (mux, FALSE);
 
   return GST_FLOW_OK;
 }
@@ -1880,7 +2299,17 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
     memmove (map.data + offset, map.data, map.size - offset);
   }
 
-  GST_BUFFER_PTS (buf) = mux->last_ts;
+  if (tsmux_get_bitrate (mux->tsmux) > 0) {
+    gint64 ts = tsmux_get_output_ts (mux->tsmux);
+
+    /* packets are timestamped with the time they have to be sent at */
+    if (ts != G_MININT64)
+      GST_BUFFER_PTS (buf) = MPEGTIME_TO_GSTTIME (MAX (ts, 0));
+    else
+      GST_BUFFER_PTS (buf) = mux->last_ts;
+  } else {
+    GST_BUFFER_PTS (buf) = mux->last_ts;
+  }
   /* do common init (flags and streamheaders) */
   new_packet_common_init (mux, buf, map.data + offset, map.size);
 
@@ -1889,10 +2318,8 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
   /* all is meant for downstream, including any prefix */
   if (offset)
     return new_packet_m2ts (mux, buf, new_pcr);
-  else
-    mpegtsmux_collect_packet (mux, buf);
 
-  return TRUE;
+  return mpegtsmux_collect_packet (mux, buf) == GST_FLOW_OK;
 }
 
 /* called when TsMux needs new packet to write into */
@@ -1900,13 +2327,16 @@ static void
 alloc_packet_cb (GstBuffer ** _buf, void *user_data)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  GstBuffer *buf;
-  gint offset = 0;
-
-  if (mux->m2ts_mode == TRUE)
-    offset = 4;
+  GstBuffer *buf = NULL;
+
+  if (!mpegtsmux_ensure_packet_pool (mux) ||
+      gst_buffer_pool_acquire_buffer (mux->packet_pool, &buf,
+          NULL) != GST_FLOW_OK) {
+    GST_ERROR_OBJECT (mux, "Failed to get a packet buffer");
+    *_buf = NULL;
+    return;
+  }
 
-  buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
   gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH);
 
   *_buf = buf;
@@ -1981,6 +2411,9 @@ mpegtsmux_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_NULL_TO_READY:
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      /* Changing the bitrate while running would restart the output
+       * timeline without signalling a discontinuity */
+      tsmux_set_bitrate (mux->tsmux, mux->bitrate);
       gst_collect_pads_start (mux->collect);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
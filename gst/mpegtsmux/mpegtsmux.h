@@ -101,6 +101,8 @@ G_BEGIN_DECLS
 #define GSTTIME_TO_MPEGTIME(time) \
     (((time) > 0 ? (gint64) 1 : (gint64) -1) * \
     (gint64) gst_util_uint64_scale (ABS(time), CLOCK_BASE, GST_MSECOND/10))
+#define MPEGTIME_TO_GSTTIME(time) \
+    (gst_util_uint64_scale ((time), GST_MSECOND/10, CLOCK_BASE))
 
 /* 27 MHz SCR conversions: */
 #define MPEG_SYS_TIME_TO_GSTTIME(time) (gst_util_uint64_scale ((time), \
@@ -139,6 +141,8 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint64 bitrate;
+  guint n_threads;
 
   /* state */
   gboolean first;
@@ -160,9 +164,23 @@ struct MpegTsMux {
   gint64 pcr_rate_den;
   GstAdapter *adapter;
 
-  /* output buffer aggregation */
-  GstAdapter *out_adapter;
+  /* packets are written into buffers of packet_pool, then copied into
+   * out_buffer, which holds several of them. Complete output buffers are
+   * collected in out_list until pushed */
+  GstBufferPool *packet_pool;
+  GstBufferPool *out_pool;
   GstBuffer *out_buffer;
+  GstMapInfo out_map;
+  gsize out_offset;
+  GstBufferList *out_list;
+
+  /* input buffers are packetised on job_pool ahead of the output, see
+   * mpegtsmux_queue_job(). jobs holds them in input order and is protected
+   * by job_lock */
+  GThreadPool *job_pool;
+  GMutex job_lock;
+  GCond job_cond;
+  GQueue jobs;
 
 #if 0
   /* SPN/PTS index handling */
@@ -113,6 +113,18 @@
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
 
+/* Offset in a packet of the byte the PCR refers to, the one containing the
+ * last bit of program_clock_reference_base */
+#define TSMUX_PCR_BYTE_OFFSET 10
+
+#define TSMUX_NULL_PID 0x1fff
+
+/* In constant bitrate mode, longest gap in the timestamps that is filled
+ * with null packets, in cycles of the 27MHz clock. Gaps of a few frames are
+ * normal, longer ones are jumps in the timestamps after which the output
+ * timeline restarts */
+#define TSMUX_MAX_STUFFING TSMUX_SYS_CLOCK_FREQ
+
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
 static void
@@ -150,6 +162,8 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -289,6 +303,82 @@ tsmux_resend_si (TsMux * mux)
   mux->last_si_ts = G_MININT64;
 }
 
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the output bitrate in bits per second, or 0
+ *
+ * Set a constant output bitrate. Packets of the streams are then sent at the
+ * latest %TSMUX_PCR_OFFSET before their DTS, with null packets filling up
+ * the gaps, and PCRs carry the time at which they are sent at @bitrate.
+ *
+ * If the streams need more than @bitrate, the output falls behind and the
+ * effective bitrate goes up. A @bitrate of 0 produces variable bitrate
+ * output without null packets.
+ *
+ * The timeline starts over with the next packet, and the PCR jumps without
+ * a discontinuity being signalled, so this should be called before any
+ * packet is written.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->bitrate = bitrate;
+  /* restart the timeline with the next packet */
+  mux->first_pcr = -1;
+  mux->n_bytes = 0;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured output bitrate. See also tsmux_set_bitrate().
+ *
+ * Returns: the output bitrate in bits per second, 0 if it is variable.
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
+/* PCR value at byte @offset of the next packet on the bitrate timeline */
+static gint64
+tsmux_get_current_pcr (TsMux * mux, guint offset)
+{
+  return mux->first_pcr + gst_util_uint64_scale ((mux->n_bytes + offset) * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
+/**
+ * tsmux_get_output_ts:
+ * @mux: a #TsMux
+ *
+ * Get the time at which the next packet is due to be sent in constant bitrate
+ * mode, in cycles of the 90kHz clock and the time base of the stream
+ * timestamps. This is the PCR of the packet shifted by %TSMUX_PCR_OFFSET, so
+ * a packet carrying the start of a frame is sent at its DTS at the latest.
+ *
+ * Returns: the output time of the next packet, or %G_MININT64 if the output
+ * does not have a constant bitrate or no stream packet was written yet.
+ */
+gint64
+tsmux_get_output_ts (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, G_MININT64);
+
+  if (mux->bitrate == 0 || mux->first_pcr == -1)
+    return G_MININT64;
+
+  return tsmux_get_current_pcr (mux, 0) / (TSMUX_SYS_CLOCK_FREQ /
+      TSMUX_CLOCK_FREQ) - CLOCK_BASE + TSMUX_PCR_OFFSET;
+}
+
 /**
  * tsmux_add_mpegts_si_section:
  * @mux: a #TsMux
@@ -628,13 +718,19 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
 static gboolean
 tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  gboolean res;
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
-    return TRUE;
+    res = TRUE;
+  } else {
+    res = mux->write_func (buf, mux->write_func_data, pcr);
   }
 
-  return mux->write_func (buf, mux->write_func_data, pcr);
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
+  return res;
 }
 
 /*
@@ -1019,42 +1115,270 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  map.data[0] = TSMUX_SYNC_BYTE;
+  map.data[1] = TSMUX_NULL_PID >> 8;
+  map.data[2] = TSMUX_NULL_PID & 0xff;
+  /* payload only, continuity counter 0 */
+  map.data[3] = 0x10;
+  memset (map.data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  gst_buffer_unmap (buf, &map);
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
+/* Writes a packet carrying only a PCR for @stream, when the stream has no
+ * data to send. @discont sets its discontinuity_indicator */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gboolean discont)
+{
+  TsMuxPacketInfo pi = { 0, };
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  guint payload_len, payload_offs;
+  gint64 pcr;
+
+  pcr = tsmux_get_current_pcr (mux, TSMUX_PCR_BYTE_OFFSET);
+
+  pi.pid = stream->pi.pid;
+  /* packets without payload repeat the counter of the previous one */
+  pi.packet_count = stream->pi.packet_count - 1;
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  if (discont)
+    pi.flags |= TSMUX_PACKET_FLAG_DISCONT;
+  pi.pcr = pcr;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  if (!tsmux_write_ts_header (map.data, &pi, &payload_len, &payload_offs)) {
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  stream->last_pcr = pcr;
+
+  return tsmux_packet_out (mux, buf, pcr);
+}
+
+/* Restarts the constant bitrate timeline at @pcr, and sends a PCR with the
+ * discontinuity_indicator set for every program which already had one */
+static gboolean
+tsmux_restart_timeline (TsMux * mux, gint64 pcr)
+{
+  GList *cur;
+
+  mux->first_pcr = pcr;
+  mux->n_bytes = 0;
+
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+    TsMuxStream *pcr_stream = program->pcr_stream;
+
+    if (pcr_stream == NULL || pcr_stream->last_pcr == -1)
+      continue;
+
+    if (!tsmux_write_pcr_packet (mux, pcr_stream, TRUE))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* In constant bitrate mode, fills the output with null packets until the
+ * next packet of @stream is due. PCR streams which have nothing to send
+ * meanwhile, including @stream, get PCR only packets to keep the PCR
+ * interval.
+ *
+ * When the next packet is due more than TSMUX_MAX_STUFFING after or before
+ * the current position, the timeline restarts instead */
+static gboolean
+tsmux_pad_stream (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 dts, target, cur_pcr;
+  GList *cur;
+
+  dts = tsmux_stream_get_next_dts (stream);
+  if (dts == G_MININT64)
+    return TRUE;
+
+  /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
+  target = (dts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+
+  if (mux->first_pcr == -1) {
+    GST_DEBUG ("Starting constant bitrate output at PCR %" G_GINT64_FORMAT,
+        target);
+    mux->first_pcr = target;
+    mux->n_bytes = 0;
+    return TRUE;
+  }
+
+  cur_pcr = tsmux_get_current_pcr (mux, 0);
+  if (ABS (target - cur_pcr) > TSMUX_MAX_STUFFING) {
+    GST_DEBUG ("PID 0x%04x is due %" G_GINT64_FORMAT " cycles of the 27MHz "
+        "clock from the current position, restarting the output timeline",
+        stream->pi.pid, target - cur_pcr);
+    return tsmux_restart_timeline (mux, target);
+  }
+
+  while (TRUE) {
+    cur_pcr = tsmux_get_current_pcr (mux, TSMUX_PCR_BYTE_OFFSET);
+
+    for (cur = mux->programs; cur; cur = cur->next) {
+      TsMuxProgram *program = (TsMuxProgram *) cur->data;
+      TsMuxStream *pcr_stream = program->pcr_stream;
+
+      if (pcr_stream == NULL || pcr_stream->last_pcr == -1)
+        continue;
+
+      if (cur_pcr - pcr_stream->last_pcr >
+          TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ) {
+        if (!tsmux_write_pcr_packet (mux, pcr_stream, FALSE))
+          return FALSE;
+        cur_pcr = tsmux_get_current_pcr (mux, TSMUX_PCR_BYTE_OFFSET);
+      }
+    }
+
+    if (tsmux_get_current_pcr (mux, 0) >= target)
+      break;
+
+    if (!tsmux_write_null_packet (mux))
+      return FALSE;
+  }
+
+  if (cur_pcr > target + TSMUX_PCR_OFFSET *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)) {
+    GST_DEBUG ("PID 0x%04x is late by %" G_GINT64_FORMAT " cycles of the "
+        "27MHz clock, bitrate is too low", stream->pi.pid,
+        cur_pcr - target - TSMUX_PCR_OFFSET *
+        (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+  }
+
+  return TRUE;
+}
+
+/* Writes the PAT, SI tables and PMTs which are due at @cur_pts, the PTS of
+ * a PCR stream */
+static gboolean
+tsmux_write_tables (TsMux * mux, gint64 cur_pts)
+{
+  gboolean write_pat;
+  gboolean write_si;
+  GList *cur;
+
+  /* check if we need to rewrite pat */
+  if (mux->last_pat_ts == G_MININT64 || mux->pat_changed)
+    write_pat = TRUE;
+  else if (cur_pts >= mux->last_pat_ts + mux->pat_interval)
+    write_pat = TRUE;
+  else
+    write_pat = FALSE;
+
+  if (write_pat) {
+    mux->last_pat_ts = cur_pts;
+    if (!tsmux_write_pat (mux))
+      return FALSE;
+  }
+
+  /* check if we need to rewrite sit */
+  if (mux->last_si_ts == G_MININT64 || mux->si_changed)
+    write_si = TRUE;
+  else if (cur_pts >= mux->last_si_ts + mux->si_interval)
+    write_si = TRUE;
+  else
+    write_si = FALSE;
+
+  if (write_si) {
+    mux->last_si_ts = cur_pts;
+    if (!tsmux_write_si (mux))
+      return FALSE;
+  }
+
+  /* check if we need to rewrite any of the current pmts */
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+    gboolean write_pmt;
+
+    if (program->last_pmt_ts == G_MININT64 || program->pmt_changed)
+      write_pmt = TRUE;
+    else if (cur_pts >= program->last_pmt_ts + program->pmt_interval)
+      write_pmt = TRUE;
+    else
+      write_pmt = FALSE;
+
+    if (write_pmt) {
+      program->last_pmt_ts = cur_pts;
+      if (!tsmux_write_pmt (mux, program))
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 /**
- * tsmux_write_stream_packet:
+ * tsmux_prepare_stream_packet:
  * @mux: a #TsMux
  * @stream: a #TsMuxStream
+ * @packet: (out): the prepared packet
  *
- * Write a packet of @stream.
+ * Packetize the next packet of @stream into a buffer obtained from the
+ * allocation function, without writing it out. The packet has to be written
+ * with tsmux_write_prepared_packet(), in the order the packets were prepared
+ * in, for the tables which are due to be written before it.
  *
- * Returns: TRUE if the packet could be written.
+ * Only the state of @stream is used and modified, so packets of different
+ * streams can be prepared concurrently if the alloc function allows it. This
+ * does not hold in constant bitrate mode, where the PCR depends on the
+ * packets written before.
+ *
+ * Returns: TRUE if the packet could be prepared.
  */
 gboolean
-tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
+tsmux_prepare_stream_packet (TsMux * mux, TsMuxStream * stream,
+    TsMuxPacket * packet)
 {
   guint payload_len, payload_offs;
   TsMuxPacketInfo *pi = &stream->pi;
-  gboolean res;
   gint64 cur_pcr = -1;
   GstBuffer *buf = NULL;
   GstMapInfo map;
 
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  packet->stream = stream;
+  packet->table_ts = tsmux_stream_get_pts (stream);
 
   if (tsmux_stream_is_pcr (stream)) {
-    gint64 cur_pts = tsmux_stream_get_pts (stream);
-    gboolean write_pat;
-    gboolean write_si;
-    GList *cur;
+    gint64 cur_pts = packet->table_ts;
 
     cur_pcr = 0;
     if (cur_pts != G_MININT64) {
       TS_DEBUG ("TS for PCR stream is %" G_GINT64_FORMAT, cur_pts);
     }
 
-    /* FIXME: The current PCR needs more careful calculation than just
-     * writing a fixed offset */
-    if (cur_pts != G_MININT64) {
+    /* In constant bitrate mode, the PCR is the time at which the packet is
+     * sent */
+    if (mux->bitrate > 0 && mux->first_pcr != -1) {
+      cur_pcr = tsmux_get_current_pcr (mux, TSMUX_PCR_BYTE_OFFSET);
+    } else if (cur_pts != G_MININT64) {
+      /* FIXME: The current PCR needs more careful calculation than just
+       * writing a fixed offset */
       /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
       cur_pts += CLOCK_BASE;
       cur_pcr = (cur_pts - TSMUX_PCR_OFFSET) *
@@ -1073,53 +1397,6 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
     } else {
       cur_pcr = -1;
     }
-
-    /* check if we need to rewrite pat */
-    if (mux->last_pat_ts == G_MININT64 || mux->pat_changed)
-      write_pat = TRUE;
-    else if (cur_pts >= mux->last_pat_ts + mux->pat_interval)
-      write_pat = TRUE;
-    else
-      write_pat = FALSE;
-
-    if (write_pat) {
-      mux->last_pat_ts = cur_pts;
-      if (!tsmux_write_pat (mux))
-        return FALSE;
-    }
-
-    /* check if we need to rewrite sit */
-    if (mux->last_si_ts == G_MININT64 || mux->si_changed)
-      write_si = TRUE;
-    else if (cur_pts >= mux->last_si_ts + mux->si_interval)
-      write_si = TRUE;
-    else
-      write_si = FALSE;
-
-    if (write_si) {
-      mux->last_si_ts = cur_pts;
-      if (!tsmux_write_si (mux))
-        return FALSE;
-    }
-
-    /* check if we need to rewrite any of the current pmts */
-    for (cur = mux->programs; cur; cur = cur->next) {
-      TsMuxProgram *program = (TsMuxProgram *) cur->data;
-      gboolean write_pmt;
-
-      if (program->last_pmt_ts == G_MININT64 || program->pmt_changed)
-        write_pmt = TRUE;
-      else if (cur_pts >= program->last_pmt_ts + program->pmt_interval)
-        write_pmt = TRUE;
-      else
-        write_pmt = FALSE;
-
-      if (write_pmt) {
-        program->last_pmt_ts = cur_pts;
-        if (!tsmux_write_pmt (mux, program))
-          return FALSE;
-      }
-    }
   }
 
   pi->packet_start_unit_indicator = tsmux_stream_at_pes_start (stream);
@@ -1147,13 +1424,15 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
 
   gst_buffer_unmap (buf, &map);
 
-  GST_DEBUG ("Writing PES of size %d", (int) gst_buffer_get_size (buf));
-  res = tsmux_packet_out (mux, buf, cur_pcr);
+  GST_DEBUG ("Prepared PES of size %d", (int) gst_buffer_get_size (buf));
 
   /* Reset all dynamic flags */
   stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
 
-  return res;
+  packet->buf = buf;
+  packet->pcr = cur_pcr;
+
+  return TRUE;
 
   /* ERRORS */
 fail:
@@ -1165,6 +1444,70 @@ fail:
   }
 }
 
+/**
+ * tsmux_write_prepared_packet:
+ * @mux: a #TsMux
+ * @packet: a packet prepared with tsmux_prepare_stream_packet()
+ *
+ * Write the tables which are due before @packet, then @packet. The buffer
+ * of @packet is given away.
+ *
+ * Returns: TRUE if the packet could be written.
+ */
+gboolean
+tsmux_write_prepared_packet (TsMux * mux, TsMuxPacket * packet)
+{
+  GstBuffer *buf;
+
+  g_return_val_if_fail (mux != NULL, FALSE);
+  g_return_val_if_fail (packet != NULL, FALSE);
+
+  buf = packet->buf;
+  packet->buf = NULL;
+
+  if (tsmux_stream_is_pcr (packet->stream) &&
+      !tsmux_write_tables (mux, packet->table_ts)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  GST_DEBUG ("Writing PES of size %d", (int) gst_buffer_get_size (buf));
+  return tsmux_packet_out (mux, buf, packet->pcr);
+}
+
+/**
+ * tsmux_write_stream_packet:
+ * @mux: a #TsMux
+ * @stream: a #TsMuxStream
+ *
+ * Write a packet of @stream.
+ *
+ * Returns: TRUE if the packet could be written.
+ */
+gboolean
+tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
+{
+  TsMuxPacket packet;
+
+  g_return_val_if_fail (mux != NULL, FALSE);
+  g_return_val_if_fail (stream != NULL, FALSE);
+
+  if (mux->bitrate > 0 && !tsmux_pad_stream (mux, stream))
+    return FALSE;
+
+  /* The tables go first, so that in constant bitrate mode the PCR of the
+   * packet accounts for them */
+  if (tsmux_stream_is_pcr (stream) &&
+      !tsmux_write_tables (mux, tsmux_stream_get_pts (stream)))
+    return FALSE;
+
+  if (!tsmux_prepare_stream_packet (mux, stream, &packet))
+    return FALSE;
+
+  GST_DEBUG ("Writing PES of size %d", (int) gst_buffer_get_size (packet.buf));
+  return tsmux_packet_out (mux, packet.buf, packet.pcr);
+}
+
 /**
  * tsmux_program_free:
  * @program: a #TsMuxProgram
@@ -98,6 +98,7 @@ G_BEGIN_DECLS
 #define TSMUX_START_ES_PID 0x0040
 
 typedef struct TsMuxSection TsMuxSection;
+typedef struct TsMuxPacket TsMuxPacket;
 typedef struct TsMux TsMux;
 
 typedef gboolean (*TsMuxWriteFunc) (GstBuffer * buf, void *user_data, gint64 new_pcr);
@@ -108,6 +109,17 @@ struct TsMuxSection {
   GstMpegtsSection *section;
 };
 
+/* A packet of a stream, see tsmux_prepare_stream_packet() */
+struct TsMuxPacket {
+  TsMuxStream *stream;
+  GstBuffer *buf;
+  /* PCR written in the packet, or -1 */
+  gint64 pcr;
+  /* PTS of the stream when the packet was prepared, which the tables written
+   * before packets of PCR streams are timed by */
+  gint64 table_ts;
+};
+
 /* Information for the streams associated with one program */
 struct TsMuxProgram {
   TsMuxSection pmt;
@@ -169,6 +181,13 @@ struct TsMux {
   /* last time SIT written in MPEG PTS clock time */
   gint64   last_si_ts;
 
+  /* constant output bitrate in bits per second, 0 for variable bitrate */
+  guint64  bitrate;
+  /* bytes output since first_pcr */
+  guint64  n_bytes;
+  /* PCR of the first packet on the bitrate timeline, -1 if not started */
+  gint64   first_pcr;
+
   /* callback to write finished packet */
   TsMuxWriteFunc write_func;
   void *write_func_data;
@@ -191,6 +210,9 @@ void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
 void 		tsmux_resend_pat                (TsMux *mux);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
+void 		tsmux_set_bitrate               (TsMux *mux, guint64 bitrate);
+guint64 	tsmux_get_bitrate               (TsMux *mux);
+gint64 		tsmux_get_output_ts             (TsMux *mux);
 
 /* pid/program management */
 TsMuxProgram *	tsmux_program_new 		(TsMux *mux, gint prog_id);
@@ -214,6 +236,8 @@ void 		tsmux_program_set_pcr_stream 	(TsMuxProgram *program, TsMuxStream *stream
 
 /* writing stuff */
 gboolean 	tsmux_write_stream_packet 	(TsMux *mux, TsMuxStream *stream);
+gboolean 	tsmux_prepare_stream_packet 	(TsMux *mux, TsMuxStream *stream, TsMuxPacket *packet);
+gboolean 	tsmux_write_prepared_packet 	(TsMux *mux, TsMuxPacket *packet);
 
 G_END_DECLS
 
@@ -1090,3 +1090,38 @@ tsmux_stream_get_pts (TsMuxStream * stream)
 
   return stream->last_pts;
 }
+
+/**
+ * tsmux_stream_get_next_dts:
+ * @stream: a #TsMuxStream
+ *
+ * Return the DTS, or the PTS if it has none, of the buffer the next packet
+ * of @stream starts with. Falls back to the timestamps of the last written
+ * buffer if that one has none.
+ *
+ * Returns: the decoding time of the next bytes of @stream, or
+ * %G_MININT64 if it is not known.
+ */
+gint64
+tsmux_stream_get_next_dts (TsMuxStream * stream)
+{
+  TsMuxStreamBuffer *buf;
+
+  g_return_val_if_fail (stream != NULL, G_MININT64);
+
+  buf = stream->cur_buffer;
+  if (buf == NULL && stream->buffers)
+    buf = (TsMuxStreamBuffer *) stream->buffers->data;
+
+  if (buf) {
+    if (GST_CLOCK_STIME_IS_VALID (buf->dts))
+      return buf->dts;
+    if (GST_CLOCK_STIME_IS_VALID (buf->pts))
+      return buf->pts;
+  }
+
+  if (GST_CLOCK_STIME_IS_VALID (stream->last_dts))
+    return stream->last_dts;
+
+  return stream->last_pts;
+}
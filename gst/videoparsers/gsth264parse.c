@@ -418,35 +418,68 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+/* Writes the start code or length prefix of a NAL of @size bytes in
+ * @format to @prefix, and returns its size */
+static guint
+gst_h264_parse_nal_prefix (GstH264Parse * h264parse, guint format, guint size,
+    guint8 prefix[4])
 {
-  GstBuffer *buf;
   guint nl = h264parse->nal_length_size;
-  guint32 tmp;
 
-  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
-
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    GST_WRITE_UINT32_BE (prefix, size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work. 
      * There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    GST_WRITE_UINT32_BE (prefix, 1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, prefix);
+
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
+/* Same as gst_h264_parse_wrap_nal(), for a NAL at @offset in @buffer. Only
+ * the prefix is allocated, the NAL itself shares the memory of @buffer. */
+static GstBuffer *
+gst_h264_parse_wrap_nal_buffer (GstH264Parse * h264parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, prefix);
+
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
+
+  return gst_buffer_append (buf,
+      gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset, size));
+}
+
 static void
 gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     GstH264NalUnitType naltype, GstH264NalUnit * nalu)
@@ -699,9 +732,11 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   g_array_free (messages, TRUE);
 }
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload. @buffer is the buffer that
+ * nalu->data is mapped from, if any */
 static gboolean
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    GstBuffer * buffer)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
@@ -834,8 +869,9 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       {
         GstH264SliceHdr slice;
 
-        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
-            FALSE, FALSE);
+        /* only the first fields are used, skip the rest of the header */
+        pres = gst_h264_parser_parse_slice_hdr_partial (nalparser, nalu,
+            &slice);
         GST_DEBUG_OBJECT (h264parse,
             "parse result %d, first MB: %u, slice type: %u",
             pres, slice.first_mb_in_slice, slice.type);
@@ -894,8 +930,12 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (buffer)
+      buf = gst_h264_parse_wrap_nal_buffer (h264parse, h264parse->format,
+          buffer, nalu->offset, nalu->size);
+    else
+      buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
+          nalu->data + nalu->offset, nalu->size);
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -957,6 +997,63 @@ static guint8 au_delim[6] = {
   0xf0                          /* allow any slice type */
 };
 
+static gboolean
+gst_h264_parse_buffer_is_writable (GstBuffer * buffer)
+{
+  guint i, n;
+
+  if (!gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  n = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n; i++) {
+    if (!gst_memory_is_writable (gst_buffer_peek_memory (buffer, i)))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* If all NALs of @buffer were collected in frame_out with the same prefix
+ * sizes as in the input, the output only differs in the prefixes. Replaces
+ * them in place when possible so that @buffer can be pushed as it is,
+ * instead of the NALs spliced out of it.
+ *
+ * The NALs in frame_out share the memory of @buffer, which makes it look
+ * read-only, so @writable has to be checked before collecting them, and
+ * frame_out released before mapping @buffer for writing. Returns FALSE if
+ * frame_out was released but @buffer could not be converted. */
+static gboolean
+gst_h264_parse_convert_in_place (GstH264Parse * h264parse, GstBuffer * buffer,
+    gboolean writable)
+{
+  const guint nl = h264parse->nal_length_size;
+  GstMapInfo map;
+  gsize offset;
+
+  if (h264parse->format == GST_H264_PARSE_FORMAT_BYTE) {
+    if (nl != 4 || !writable)
+      return TRUE;
+
+    gst_adapter_clear (h264parse->frame_out);
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE))
+      return FALSE;
+
+    for (offset = 0; offset + nl <= map.size;) {
+      guint32 size = GST_READ_UINT32_BE (map.data + offset);
+
+      GST_WRITE_UINT32_BE (map.data + offset, 1);
+      offset += nl + size;
+    }
+    gst_buffer_unmap (buffer, &map);
+  }
+
+  GST_LOG_OBJECT (h264parse, "converted frame in place");
+  gst_adapter_clear (h264parse->frame_out);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GstBaseParseFrame * frame)
@@ -969,6 +1066,8 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
   const guint nl = h264parse->nal_length_size;
   GstMapInfo map;
   gint left;
+  gsize before;
+  gboolean writable;
 
   if (nl < 1 || nl > 4) {
     GST_DEBUG_OBJECT (h264parse, "insufficient data to split input");
@@ -979,9 +1078,13 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
   if (h264parse->split_packetized)
     buffer = gst_buffer_copy (frame->buffer);
 
+  /* before frame_out shares the memory of the buffer */
+  writable = gst_h264_parse_buffer_is_writable (buffer);
+
   gst_buffer_map (buffer, &map, GST_MAP_READ);
 
   left = map.size;
+  before = gst_adapter_available (h264parse->frame_out);
 
   GST_LOG_OBJECT (h264parse,
       "processing packet buffer of size %" G_GSIZE_FORMAT, map.size);
@@ -993,7 +1096,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1022,6 +1125,12 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
   gst_buffer_unmap (buffer, &map);
 
   if (!h264parse->split_packetized) {
+    if (h264parse->transform && before == 0
+        && gst_adapter_available (h264parse->frame_out) == map.size
+        && !gst_h264_parse_convert_in_place (h264parse, buffer, writable)) {
+      GST_WARNING_OBJECT (h264parse, "failed to convert frame in place");
+      frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+    }
     gst_h264_parse_parse_frame (parse, frame);
     ret = gst_base_parse_finish_frame (parse, frame, map.size);
   } else {
@@ -1231,7 +1340,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    if (!gst_h264_parse_process_nal (h264parse, &nalu, buffer)) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -2182,7 +2291,8 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    /* keep the NALs in the memory they were wrapped in */
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2678,7 +2788,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
@@ -2697,7 +2807,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
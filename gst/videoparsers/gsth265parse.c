@@ -362,35 +362,68 @@ gst_h265_parse_negotiate (GstH265Parse * h265parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
-    guint size)
+/* Writes the start code or length prefix of a NAL of @size bytes in
+ * @format to @prefix, and returns its size */
+static guint
+gst_h265_parse_nal_prefix (GstH265Parse * h265parse, guint format, guint size,
+    guint8 prefix[4])
 {
-  GstBuffer *buf;
   guint nl = h265parse->nal_length_size;
-  guint32 tmp;
 
-  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
-
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H265_PARSE_FORMAT_HVC1
       || format == GST_H265_PARSE_FORMAT_HEV1) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    GST_WRITE_UINT32_BE (prefix, size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work.
      * There are legit cases where nl in hevc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    GST_WRITE_UINT32_BE (prefix, 1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, prefix);
+
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
+/* Same as gst_h265_parse_wrap_nal(), for a NAL at @offset in @buffer. Only
+ * the prefix is allocated, the NAL itself shares the memory of @buffer. */
+static GstBuffer *
+gst_h265_parse_wrap_nal_buffer (GstH265Parse * h265parse, guint format,
+    GstBuffer * buffer, guint offset, guint size)
+{
+  GstBuffer *buf;
+  guint8 prefix[4];
+  guint nl;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, prefix);
+
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, prefix, nl);
+
+  return gst_buffer_append (buf,
+      gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, offset, size));
+}
+
 static void
 gst_h265_parser_store_nal (GstH265Parse * h265parse, guint id,
     GstH265NalUnitType naltype, GstH265NalUnit * nalu)
@@ -485,9 +518,11 @@ _nal_name (GstH265NalUnitType nal_type)
 }
 #endif
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload. @buffer is the buffer that
+ * nalu->data is mapped from, if any */
 static void
-gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
+gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu,
+    GstBuffer * buffer)
 {
   GstH265PPS pps = { 0, };
   GstH265SPS sps = { 0, };
@@ -614,7 +649,8 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     {
       GstH265SliceHdr slice;
 
-      pres = gst_h265_parser_parse_slice_hdr (nalparser, nalu, &slice);
+      /* only the first fields are used, skip the rest of the header */
+      pres = gst_h265_parser_parse_slice_hdr_partial (nalparser, nalu, &slice);
 
       if (pres == GST_H265_PARSER_OK) {
         if (GST_H265_IS_I_SLICE (&slice))
@@ -627,8 +663,6 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
       GST_DEBUG_OBJECT (h265parse,
           "parse result %d, first slice_segment: %u, slice type: %u",
           pres, slice.first_slice_segment_in_pic_flag, slice.type);
-
-      gst_h265_slice_hdr_free (&slice);
     }
 
       is_irap = ((nal_type >= GST_H265_NAL_SLICE_BLA_W_LP)
@@ -666,8 +700,12 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
-    buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (buffer)
+      buf = gst_h265_parse_wrap_nal_buffer (h265parse, h265parse->format,
+          buffer, nalu->offset, nalu->size);
+    else
+      buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+          nalu->data + nalu->offset, nalu->size);
     gst_adapter_push (h265parse->frame_out, buf);
   }
 }
@@ -722,6 +760,63 @@ gst_h265_parse_collect_nal (GstH265Parse * h265parse, const guint8 * data,
   return complete;
 }
 
+static gboolean
+gst_h265_parse_buffer_is_writable (GstBuffer * buffer)
+{
+  guint i, n;
+
+  if (!gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  n = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n; i++) {
+    if (!gst_memory_is_writable (gst_buffer_peek_memory (buffer, i)))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* If all NALs of @buffer were collected in frame_out with the same prefix
+ * sizes as in the input, the output only differs in the prefixes. Replaces
+ * them in place when possible so that @buffer can be pushed as it is,
+ * instead of the NALs spliced out of it.
+ *
+ * The NALs in frame_out share the memory of @buffer, which makes it look
+ * read-only, so @writable has to be checked before collecting them, and
+ * frame_out released before mapping @buffer for writing. Returns FALSE if
+ * frame_out was released but @buffer could not be converted. */
+static gboolean
+gst_h265_parse_convert_in_place (GstH265Parse * h265parse, GstBuffer * buffer,
+    gboolean writable)
+{
+  const guint nl = h265parse->nal_length_size;
+  GstMapInfo map;
+  gsize offset;
+
+  if (h265parse->format == GST_H265_PARSE_FORMAT_BYTE) {
+    if (nl != 4 || !writable)
+      return TRUE;
+
+    gst_adapter_clear (h265parse->frame_out);
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READWRITE))
+      return FALSE;
+
+    for (offset = 0; offset + nl <= map.size;) {
+      guint32 size = GST_READ_UINT32_BE (map.data + offset);
+
+      GST_WRITE_UINT32_BE (map.data + offset, 1);
+      offset += nl + size;
+    }
+    gst_buffer_unmap (buffer, &map);
+  }
+
+  GST_LOG_OBJECT (h265parse, "converted frame in place");
+  gst_adapter_clear (h265parse->frame_out);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GstBaseParseFrame * frame)
@@ -734,6 +829,8 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
   const guint nl = h265parse->nal_length_size;
   GstMapInfo map;
   gint left;
+  gsize before;
+  gboolean writable;
 
   if (nl < 1 || nl > 4) {
     GST_DEBUG_OBJECT (h265parse, "insufficient data to split input");
@@ -744,9 +841,13 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
   if (h265parse->split_packetized)
     buffer = gst_buffer_copy (frame->buffer);
 
+  /* before frame_out shares the memory of the buffer */
+  writable = gst_h265_parse_buffer_is_writable (buffer);
+
   gst_buffer_map (buffer, &map, GST_MAP_READ);
 
   left = map.size;
+  before = gst_adapter_available (h265parse->frame_out);
 
   GST_LOG_OBJECT (h265parse,
       "processing packet buffer of size %" G_GSIZE_FORMAT, map.size);
@@ -758,7 +859,7 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h265parse, "HEVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h265_parse_process_nal (h265parse, &nalu);
+    gst_h265_parse_process_nal (h265parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h265parse->split_packetized) {
@@ -787,6 +888,12 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
   gst_buffer_unmap (buffer, &map);
 
   if (!h265parse->split_packetized) {
+    if (h265parse->transform && before == 0
+        && gst_adapter_available (h265parse->frame_out) == map.size
+        && !gst_h265_parse_convert_in_place (h265parse, buffer, writable)) {
+      GST_WARNING_OBJECT (h265parse, "failed to convert frame in place");
+      frame->flags |= GST_BASE_PARSE_FRAME_FLAG_DROP;
+    }
     gst_h265_parse_parse_frame (parse, frame);
     ret = gst_base_parse_finish_frame (parse, frame, map.size);
   } else {
@@ -976,7 +1083,7 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
         nalu.type == GST_H265_NAL_SPS ||
         nalu.type == GST_H265_NAL_PPS ||
         (h265parse->have_sps && h265parse->have_pps)) {
-      gst_h265_parse_process_nal (h265parse, &nalu);
+      gst_h265_parse_process_nal (h265parse, &nalu, buffer);
     } else {
       GST_WARNING_OBJECT (h265parse,
           "no SPS/PPS yet, nal Type: %d %s, Size: %u will be dropped",
@@ -1726,7 +1833,8 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    /* keep the NALs in the memory they were wrapped in */
+    buf = gst_adapter_take_buffer_fast (h265parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2140,7 +2248,7 @@ gst_h265_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
           goto hvcc_too_small;
         }
 
-        gst_h265_parse_process_nal (h265parse, &nalu);
+        gst_h265_parse_process_nal (h265parse, &nalu, NULL);
         off = nalu.offset + nalu.size;
       }
     }
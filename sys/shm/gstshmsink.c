@@ -31,6 +31,10 @@
  * ! shmsink socket-path=/tmp/blah shm-size=2000000
  * ]| Send video to shm buffers.
  *
+ * Buffers are written to the shared memory area without a copy if upstream
+ * allocated them from the allocator or the pool shmsink proposes. Buffers
+ * backed by a file descriptor, like memfd or dmabuf memory, are not copied
+ * either: the file descriptor is passed to the clients, which map it.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -39,6 +43,8 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
+#include <gst/video/video.h>
 
 #include <string.h>
 
@@ -58,17 +64,20 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_RING_SIZE
 };
 
 struct GstShmClient
 {
   ShmClient *client;
   GstPollFD pollfd;
+  GstPollFD ringpollfd;
 };
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SIZE 0
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -104,6 +113,18 @@ static gpointer pollthread_func (gpointer data);
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
+/* The fd of a GstMemory imported in the pipe of a sink. The memory keeps a
+ * list of them in its qdata, a memory passing through a tee can be imported
+ * by several sinks. */
+typedef struct
+{
+  GstShmSink *sink;
+  ShmBlock *block;
+} GstShmSinkFdArea;
+
+static GQuark fd_areas_quark;
+static GMutex fd_areas_lock;
+
 
 
 /********************
@@ -354,6 +375,7 @@ gst_shm_sink_init (GstShmSink * self)
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_size = DEFAULT_RING_SIZE;
 
   gst_allocation_params_init (&self->params);
 }
@@ -416,6 +438,26 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:ring-size:
+   *
+   * Number of buffer descriptors in the ring shared with each client, rounded
+   * up to a power of two. With a ring, buffers and releases go through shared
+   * memory and eventfd wakeups only happen when the other side is idle,
+   * instead of a socket message for each. A client whose ring is full misses
+   * buffers instead of blocking the others. Takes effect for clients
+   * connecting afterwards, 0 disables it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Ring size",
+          "Number of buffers that can be queued in the shared memory ring of "
+          "each client (0 = send them over the control socket)",
+          0, 65536, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -433,6 +475,8 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
       "Olivier Crete <olivier.crete@collabora.co.uk>");
 
   GST_DEBUG_CATEGORY_INIT (shmsink_debug, "shmsink", 0, "Shared Memory Sink");
+
+  fd_areas_quark = g_quark_from_static_string ("GstShmSinkFdAreas");
 }
 
 static void
@@ -504,6 +548,13 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_RING_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->ring_size = g_value_get_uint (value);
+      if (self->pipe)
+        sp_writer_set_ring_size (self->pipe, self->ring_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -533,6 +584,9 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -569,6 +623,7 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  sp_writer_set_ring_size (self->pipe, self->ring_size);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -657,6 +712,127 @@ gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
   return TRUE;
 }
 
+static void
+free_buffer_locked (GstBuffer * buffer, void *data)
+{
+  GSList **list = data;
+
+  g_assert (buffer != NULL);
+
+  *list = g_slist_prepend (*list, buffer);
+}
+
+/* Collects the buffers released through the rings of the clients, which
+ * doesn't need any syscall, unlike waking up the poll thread for them */
+static void
+gst_shm_sink_recv_rings (GstShmSink * self)
+{
+  GSList *list = NULL;
+
+  GST_OBJECT_LOCK (self);
+  sp_writer_set_ring_blocked (self->pipe, FALSE);
+  sp_writer_recv_rings (self->pipe, (sp_buffer_free_callback)
+      free_buffer_locked, (void **) &list);
+  GST_OBJECT_UNLOCK (self);
+  g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Called with the object lock while render waits for space or for
+ * buffer-time. Collects the released buffers and has the rings signal the
+ * very next ack, waiting for a batch could take forever if the clients hold
+ * on to their buffers. Returns TRUE if buffers were freed, the lock was
+ * released then and the wait condition has to be checked again. */
+static gboolean
+gst_shm_sink_recv_rings_blocked_locked (GstShmSink * self)
+{
+  GSList *list = NULL;
+
+  sp_writer_set_ring_blocked (self->pipe, TRUE);
+  sp_writer_recv_rings (self->pipe, (sp_buffer_free_callback)
+      free_buffer_locked, (void **) &list);
+  if (!list)
+    return FALSE;
+
+  GST_OBJECT_UNLOCK (self);
+  g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+  GST_OBJECT_LOCK (self);
+
+  return TRUE;
+}
+
+static void
+gst_shm_sink_fd_areas_free (GSList * fd_areas)
+{
+  GSList *item;
+
+  for (item = fd_areas; item; item = item->next) {
+    GstShmSinkFdArea *fd_area = item->data;
+
+    if (fd_area->block) {
+      GST_OBJECT_LOCK (fd_area->sink);
+      sp_writer_free_block (fd_area->block);
+      GST_OBJECT_UNLOCK (fd_area->sink);
+    }
+    gst_object_unref (fd_area->sink);
+    g_slice_free (GstShmSinkFdArea, fd_area);
+  }
+  g_slist_free (fd_areas);
+}
+
+/* Returns the block of the fd of @memory, importing it the first time. The
+ * clients get the fd once and keep it mapped until the memory is freed, so a
+ * pool of fd memory only costs a message per buffer. */
+static ShmBlock *
+gst_shm_sink_get_fd_block_locked (GstShmSink * self, GstMemory * memory)
+{
+  GstMemory *parent = memory->parent ? memory->parent : memory;
+  GstShmSinkFdArea *fd_area = NULL;
+  GSList *fd_areas, *item;
+  ShmBlock *block;
+
+  g_mutex_lock (&fd_areas_lock);
+  fd_areas = gst_mini_object_steal_qdata (GST_MINI_OBJECT_CAST (parent),
+      fd_areas_quark);
+
+  for (item = fd_areas; item; item = item->next) {
+    if (((GstShmSinkFdArea *) item->data)->sink == self) {
+      fd_area = item->data;
+      break;
+    }
+  }
+
+  /* Imported before the sink was restarted */
+  if (fd_area && fd_area->block &&
+      sp_writer_block_get_pipe (fd_area->block) != self->pipe) {
+    sp_writer_free_block (fd_area->block);
+    fd_area->block = NULL;
+  }
+
+  if (!fd_area || !fd_area->block) {
+    block = sp_writer_import_fd (self->pipe, gst_fd_memory_get_fd (memory),
+        parent->maxsize);
+    if (block) {
+      GST_DEBUG_OBJECT (self, "Imported fd %d of %" G_GSIZE_FORMAT " bytes",
+          gst_fd_memory_get_fd (memory), parent->maxsize);
+      if (!fd_area) {
+        fd_area = g_slice_new (GstShmSinkFdArea);
+        fd_area->sink = gst_object_ref (self);
+        fd_areas = g_slist_prepend (fd_areas, fd_area);
+      }
+      fd_area->block = block;
+    }
+  } else {
+    block = fd_area->block;
+  }
+
+  if (fd_areas)
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (parent), fd_areas_quark,
+        fd_areas, (GDestroyNotify) gst_shm_sink_fd_areas_free);
+  g_mutex_unlock (&fd_areas_lock);
+
+  return block;
+}
+
 static GstFlowReturn
 gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
@@ -667,8 +843,11 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   GstFlowReturn ret = GST_FLOW_OK;
   GstMemory *memory = NULL;
   GstBuffer *sendbuf = NULL;
+  ShmBlock *fd_block = NULL;
   gsize written_bytes;
 
+  gst_shm_sink_recv_rings (self);
+
   GST_OBJECT_LOCK (self);
   while (self->wait_for_connection && !self->clients) {
     g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
@@ -683,6 +862,8 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
+    if (gst_shm_sink_recv_rings_blocked_locked (self))
+      continue;
     g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
     if (self->unlock) {
       GST_OBJECT_UNLOCK (self);
@@ -693,6 +874,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
         return ret;
     }
   }
+  sp_writer_set_ring_blocked (self->pipe, FALSE);
 
 
   if (gst_buffer_n_memory (buf) > 1) {
@@ -702,7 +884,18 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   } else {
     memory = gst_buffer_peek_memory (buf, 0);
 
-    if (memory->allocator != GST_ALLOCATOR (self->allocator)) {
+    /* The clients have to map it */
+    if (gst_is_fd_memory (memory) && gst_fd_memory_get_fd (memory) >= 0 &&
+        !GST_MEMORY_FLAG_IS_SET (memory, GST_MEMORY_FLAG_NOT_MAPPABLE)) {
+      fd_block = gst_shm_sink_get_fd_block_locked (self, memory);
+      if (!fd_block)
+        GST_LOG_OBJECT (self, "Could not import the fd of buffer %p, will "
+            "memcpy", buf);
+    }
+
+    if (fd_block) {
+      GST_LOG_OBJECT (self, "Sending fd memory of buffer %p", buf);
+    } else if (memory->allocator != GST_ALLOCATOR (self->allocator)) {
       need_new_memory = TRUE;
       GST_LOG_OBJECT (self, "Memory in buffer %p was not allocated by "
           "%" GST_PTR_FORMAT ", will memcpy", buf, memory->allocator);
@@ -722,6 +915,8 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     while ((memory =
             gst_shm_sink_allocator_alloc_locked (self->allocator,
                 gst_buffer_get_size (buf), &self->params)) == NULL) {
+      if (gst_shm_sink_recv_rings_blocked_locked (self))
+        continue;
       g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
@@ -732,6 +927,7 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
           return ret;
       }
     }
+    sp_writer_set_ring_blocked (self->pipe, FALSE);
 
     while (self->wait_for_connection && !self->clients) {
       g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
@@ -772,26 +968,37 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     sendbuf = gst_buffer_ref (buf);
   }
 
-  if (!gst_buffer_map (sendbuf, &map, GST_MAP_READ)) {
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        (NULL), ("Failed to map data into send buffer"));
-    goto error;
-  }
+  if (fd_block) {
+    rv = sp_writer_send_fd_buf (self->pipe, fd_block, memory->offset,
+        memory->size, sendbuf);
+    if (rv == -1) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to send data over SHM"));
+      goto error;
+    }
+  } else {
+    if (!gst_buffer_map (sendbuf, &map, GST_MAP_READ)) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to map data into send buffer"));
+      goto error;
+    }
+
+    /* Make the memory readonly as of now as we've sent it to the other side
+     * We know it's not mapped for writing anywhere as we just mapped it for
+     * reading
+     */
+    rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size,
+        sendbuf);
+    if (rv == -1) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to send data over SHM"));
+      gst_buffer_unmap (sendbuf, &map);
+      goto error;
+    }
 
-  /* Make the memory readonly as of now as we've sent it to the other side
-   * We know it's not mapped for writing anywhere as we just mapped it for
-   * reading
-   */
-  rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size, sendbuf);
-  if (rv == -1) {
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        (NULL), ("Failed to send data over SHM"));
     gst_buffer_unmap (sendbuf, &map);
-    goto error;
   }
 
-  gst_buffer_unmap (sendbuf, &map);
-
   GST_OBJECT_UNLOCK (self);
 
   if (rv == 0) {
@@ -806,16 +1013,6 @@ error:
   return GST_FLOW_ERROR;
 }
 
-static void
-free_buffer_locked (GstBuffer * buffer, void *data)
-{
-  GSList **list = data;
-
-  g_assert (buffer != NULL);
-
-  *list = g_slist_prepend (*list, buffer);
-}
-
 static gpointer
 pollthread_func (gpointer data)
 {
@@ -875,6 +1072,13 @@ pollthread_func (gpointer data)
       gclient->pollfd.fd = sp_writer_get_client_fd (client);
       gst_poll_add_fd (self->poll, &gclient->pollfd);
       gst_poll_fd_ctl_read (self->poll, &gclient->pollfd, TRUE);
+      gst_poll_fd_init (&gclient->ringpollfd);
+      gclient->ringpollfd.fd = sp_writer_get_client_ring_fd (client);
+      if (gclient->ringpollfd.fd >= 0) {
+        GST_DEBUG_OBJECT (self, "Client %d uses a ring", gclient->pollfd.fd);
+        gst_poll_add_fd (self->poll, &gclient->ringpollfd);
+        gst_poll_fd_ctl_read (self->poll, &gclient->ringpollfd, TRUE);
+      }
       self->clients = g_list_prepend (self->clients, gclient);
       g_signal_emit (self, signals[SIGNAL_CLIENT_CONNECTED], 0,
           gclient->pollfd.fd);
@@ -889,6 +1093,7 @@ pollthread_func (gpointer data)
   again:
     for (item = self->clients; item; item = item->next) {
       struct GstShmClient *gclient = item->data;
+      gboolean recv_ring = FALSE;
 
       if (gst_poll_fd_has_closed (self->poll, &gclient->pollfd)) {
         GST_WARNING_OBJECT (self, "One client is gone, closing");
@@ -918,6 +1123,27 @@ pollthread_func (gpointer data)
 
         if (rv == 0)
           gst_buffer_unref (tag);
+
+        /* Releases only go through the socket when the ring is full, the
+         * ring wakeup depends on what the client still holds */
+        recv_ring = TRUE;
+      }
+
+      if (gclient->ringpollfd.fd >= 0 && (recv_ring ||
+              gst_poll_fd_can_read (self->poll, &gclient->ringpollfd))) {
+        GSList *list = NULL;
+        int rv;
+
+        GST_OBJECT_LOCK (self);
+        rv = sp_writer_recv_ring (self->pipe, gclient->client,
+            (sp_buffer_free_callback) free_buffer_locked, (void **) &list);
+        GST_OBJECT_UNLOCK (self);
+        g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+
+        if (rv < 0) {
+          GST_WARNING_OBJECT (self, "One client corrupted its ring, closing");
+          goto close_client;
+        }
       }
       continue;
     close_client:
@@ -931,6 +1157,8 @@ pollthread_func (gpointer data)
       }
 
       gst_poll_remove_fd (self->poll, &gclient->pollfd);
+      if (gclient->ringpollfd.fd >= 0)
+        gst_poll_remove_fd (self->poll, &gclient->ringpollfd);
       self->clients = g_list_remove (self->clients, gclient);
 
       g_signal_emit (self, signals[SIGNAL_CLIENT_DISCONNECTED], 0,
@@ -996,10 +1224,47 @@ static gboolean
 gst_shm_sink_propose_allocation (GstBaseSink * sink, GstQuery * query)
 {
   GstShmSink *self = GST_SHM_SINK (sink);
+  GstCaps *caps;
+  gboolean need_pool;
+  GstVideoInfo info;
+  GstBufferPool *pool;
+  GstStructure *config;
+  guint size, max_buffers;
+
+  if (!self->allocator)
+    return TRUE;
 
-  if (self->allocator)
-    gst_query_add_allocation_param (query, GST_ALLOCATOR (self->allocator),
-        NULL);
+  gst_query_add_allocation_param (query, GST_ALLOCATOR (self->allocator),
+      NULL);
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (!need_pool || !caps || !gst_video_info_from_caps (&info, caps))
+    return TRUE;
+
+  /* Without a limit, upstream would keep allocating once the area is full,
+   * and get system memory that has to be copied */
+  size = info.size;
+  GST_OBJECT_LOCK (self);
+  max_buffers = self->size / (size + gst_memory_alignment + 1);
+  GST_OBJECT_UNLOCK (self);
+
+  if (max_buffers < 2) {
+    GST_DEBUG_OBJECT (self, "Shared memory area too small for a pool of "
+        "frames of %u bytes", size);
+    return TRUE;
+  }
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, size, 0, max_buffers);
+  gst_buffer_pool_config_set_allocator (config,
+      GST_ALLOCATOR (self->allocator), NULL);
+  if (gst_buffer_pool_set_config (pool, config)) {
+    GST_DEBUG_OBJECT (self, "Proposing a pool of up to %u frames of %u bytes",
+        max_buffers, size);
+    gst_query_add_allocation_pool (query, pool, size, 0, max_buffers);
+  }
+  gst_object_unref (pool);
 
   return TRUE;
 }
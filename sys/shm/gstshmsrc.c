@@ -32,6 +32,8 @@
  * ! queue ! videoconvert ! autovideosink
  * ]| Render video from shm buffers.
  *
+ * If the shmsink has a #GstShmSink:ring-size, the buffers are received
+ * through a ring in shared memory instead of the control socket.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -155,6 +157,7 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->ringpollfd);
 }
 
 static void
@@ -275,9 +278,12 @@ gst_shm_src_stop_reading (GstShmSrc * self)
     self->pipe = NULL;
 
     gst_poll_remove_fd (self->poll, &self->pollfd);
+    if (self->ringpollfd.fd >= 0)
+      gst_poll_remove_fd (self->poll, &self->ringpollfd);
   }
 
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->ringpollfd);
   gst_poll_set_flushing (self->poll, TRUE);
 }
 
@@ -327,6 +333,19 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   struct GstShmBuffer *gsb;
 
   do {
+    if (self->ringpollfd.fd >= 0) {
+      GST_OBJECT_LOCK (self);
+      rv = sp_client_recv_ring (self->pipe->pipe, &buf);
+      GST_OBJECT_UNLOCK (self);
+      if (rv < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+            ("Error reading from ring: %d", rv));
+        return GST_FLOW_ERROR;
+      }
+      if (buf)
+        break;
+    }
+
     if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
       if (errno == EBUSY)
         return GST_FLOW_FLUSHING;
@@ -361,6 +380,15 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
             ("Error reading control data: %d", rv));
         return GST_FLOW_ERROR;
       }
+
+      if (self->ringpollfd.fd < 0) {
+        self->ringpollfd.fd = sp_client_get_ring_fd (self->pipe->pipe);
+        if (self->ringpollfd.fd >= 0) {
+          GST_DEBUG_OBJECT (self, "Receiving buffers through a ring");
+          gst_poll_add_fd (self->poll, &self->ringpollfd);
+          gst_poll_fd_ctl_read (self->poll, &self->ringpollfd, TRUE);
+        }
+      }
     }
   } while (buf == NULL);
 
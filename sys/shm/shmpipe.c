@@ -47,6 +47,10 @@
 #include <sys/mman.h>
 #include <assert.h>
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 #include "shmalloc.h"
 
 /*
@@ -67,20 +71,46 @@
  * type 4: ack buffer
  * offset
  *
+ * type 5: new ring
+ * Ring area length
+ * Number of slots
+ * Comes with the fds of the ring area and of its two eventfds
+ *
+ * type 6: new fd area
+ * Area length
+ * Comes with the fd of the area, which the client maps from offset 0
+ *
  * Type 4 goes from the client to the server
  * The rest are from the server to the client
- * The client should never write in the SHM
+ * The client should never write in the SHM, except in its ring
+ *
+ * Type 5 is only sent if the writer has a ring size, right after the shm
+ * areas the client needs to know about. From then on, buffers and acks go through the ring instead
+ * of types 3 and 4, see ShmRingHeader.
+ *
+ * Type 6 announces memory that the writer did not allocate itself, like a
+ * memfd or a dmabuf. Its buffers are then sent like any other, and the area
+ * is closed with type 2.
  */
 
 
 #define LISTEN_BACKLOG 10
 
+#define MAX_COMMAND_FDS 4
+#define SHM_RING_MAX_SLOTS (1 << 16)
+
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+
 enum
 {
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5,
+  COMMAND_NEW_FD_AREA = 6
 };
 
 typedef struct _ShmArea ShmArea;
@@ -99,8 +129,16 @@ struct _ShmArea
 
   char *shm_area_name;
 
+  /* The area was passed as an fd, it has no name and the writer doesn't
+   * map it */
+  int is_fd;
+
   ShmAllocSpace *allocspace;
 
+  /* Client only, the area is closed once the ring tail reaches close_at */
+  int ring_close_pending;
+  uint32_t ring_close_at;
+
   ShmArea *next;
 };
 
@@ -124,6 +162,64 @@ struct _ShmBuffer
 };
 
 
+/*
+ * A ring is an area shared read-write between the writer and one client. It
+ * holds two single producer, single consumer queues of slots: the writer
+ * produces buffers and the client acks. The indices are free running, only
+ * the producer writes head and only the consumer writes tail and notify.
+ *
+ * Before sleeping on the eventfd of a queue, the consumer sets notify to the
+ * index of the slot it wants to be woken up for, and the producer only
+ * signals the eventfd when it fills that very slot. So as long as both sides
+ * are busy, no syscall is needed.
+ */
+
+typedef struct
+{
+  int32_t area_id;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+} ShmRingSlot;
+
+typedef struct
+{
+  /* Written by the producer */
+  uint32_t head;
+  uint8_t padding1[60];
+  /* Written by the consumer */
+  uint32_t tail;
+  uint32_t notify;
+  uint8_t padding2[56];
+} ShmRingQueue;
+
+typedef struct
+{
+  uint32_t n_slots;
+  uint8_t padding[60];
+  ShmRingQueue buffers;
+  ShmRingQueue acks;
+  /* Followed by n_slots buffer slots, then n_slots ack slots */
+} ShmRingHeader;
+
+typedef struct
+{
+  int shm_fd;
+  ShmRingHeader *header;
+  size_t len;
+
+  uint32_t n_slots;
+  ShmRingSlot *buffers;
+  ShmRingSlot *acks;
+
+  /* Signalled by the writer and by the client respectively */
+  int buffers_efd;
+  int acks_efd;
+
+  /* Client only, whether buffers_efd may have been signalled */
+  int armed;
+} ShmRing;
+
 struct _ShmPipe
 {
   int main_socket;
@@ -141,12 +237,22 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  /* Writer only, number of slots of the rings of new clients */
+  unsigned int ring_slots;
+  /* Writer only, whether the writer waits for acks to free space */
+  int ring_blocked;
+
+  /* Client only */
+  ShmRing *ring;
 };
 
 struct _ShmClient
 {
   int fd;
 
+  ShmRing *ring;
+
   ShmClient *next;
 };
 
@@ -179,6 +285,15 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      size_t size;
+      unsigned int n_slots;
+    } new_ring;
+    struct
+    {
+      size_t size;
+    } new_fd_area;
   } payload;
 };
 
@@ -187,6 +302,8 @@ static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
+static void sp_ring_free (ShmRing * ring);
+static int sp_writer_send_fd_area (int fd, ShmArea * area);
 
 
 
@@ -365,6 +482,49 @@ sp_close_shm (ShmArea * area)
   spalloc_free (ShmArea, area);
 }
 
+/* Takes ownership of the fd, only the reader maps it */
+static ShmArea *
+sp_open_fd_area (int fd, int id, size_t size, int is_writer)
+{
+  ShmArea *area = spalloc_new (ShmArea);
+
+  memset (area, 0, sizeof (ShmArea));
+
+  area->id = id;
+  area->use_count = 1;
+  area->is_writer = is_writer;
+  area->is_fd = 1;
+  area->shm_fd = fd;
+  area->shm_area_len = size;
+  area->shm_area_buf = MAP_FAILED;
+
+  if (!is_writer) {
+    area->shm_area_buf = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (area->shm_area_buf == MAP_FAILED) {
+      fprintf (stderr, "mmap of fd area failed (%d): %s\n", errno,
+          strerror (errno));
+      area->use_count--;
+      sp_close_shm (area);
+      return NULL;
+    }
+  }
+
+  return area;
+}
+
+/* Adds an area behind the current one, which is the one new blocks are
+ * allocated from and whose name is announced */
+static void
+sp_add_shm_area (ShmPipe * self, ShmArea * area)
+{
+  if (self->shm_area) {
+    area->next = self->shm_area->next;
+    self->shm_area->next = area;
+  } else {
+    self->shm_area = area;
+  }
+}
+
 static void
 sp_shm_area_inc (ShmArea * area)
 {
@@ -397,6 +557,200 @@ sp_shm_area_dec (ShmPipe * self, ShmArea * area)
   }
 }
 
+static size_t
+sp_ring_size (uint32_t n_slots)
+{
+  return sizeof (ShmRingHeader) + 2 * n_slots * sizeof (ShmRingSlot);
+}
+
+static ShmRing *
+sp_ring_alloc (void)
+{
+  ShmRing *ring = spalloc_new (ShmRing);
+
+  memset (ring, 0, sizeof (ShmRing));
+  ring->shm_fd = -1;
+  ring->header = MAP_FAILED;
+  ring->buffers_efd = -1;
+  ring->acks_efd = -1;
+
+  return ring;
+}
+
+static int
+sp_ring_map (ShmRing * ring, size_t size, uint32_t n_slots)
+{
+  if (n_slots == 0 || n_slots > SHM_RING_MAX_SLOTS ||
+      (n_slots & (n_slots - 1)) != 0 || size < sp_ring_size (n_slots))
+    return 0;
+
+  ring->header = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      ring->shm_fd, 0);
+  if (ring->header == MAP_FAILED)
+    return 0;
+
+  ring->len = size;
+  ring->n_slots = n_slots;
+  ring->buffers = (ShmRingSlot *) (ring->header + 1);
+  ring->acks = ring->buffers + n_slots;
+
+  return 1;
+}
+
+static void
+sp_ring_free (ShmRing * ring)
+{
+  if (ring->header != MAP_FAILED)
+    munmap (ring->header, ring->len);
+
+  if (ring->shm_fd >= 0)
+    close (ring->shm_fd);
+  if (ring->buffers_efd >= 0)
+    close (ring->buffers_efd);
+  if (ring->acks_efd >= 0)
+    close (ring->acks_efd);
+
+  spalloc_free (ShmRing, ring);
+}
+
+/* Creates the ring of a new client, the area is passed as an fd, so it
+ * doesn't need a name */
+static ShmRing *
+sp_ring_new (uint32_t n_slots)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  ShmRing *ring = sp_ring_alloc ();
+  char tmppath[32];
+  size_t size = sp_ring_size (n_slots);
+  int i = 0;
+
+  do {
+    snprintf (tmppath, sizeof (tmppath), "/shmring.%5d.%5d", getpid (), i++);
+    ring->shm_fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL,
+        S_IRUSR | S_IWUSR);
+  } while (ring->shm_fd < 0 && errno == EEXIST);
+
+  if (ring->shm_fd < 0)
+    goto error;
+
+  shm_unlink (tmppath);
+
+  /* The new area is zero filled, so all indices start at 0 */
+  if (ftruncate (ring->shm_fd, size) < 0 || !sp_ring_map (ring, size, n_slots))
+    goto error;
+
+  ring->header->n_slots = n_slots;
+
+  ring->buffers_efd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  ring->acks_efd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ring->buffers_efd < 0 || ring->acks_efd < 0)
+    goto error;
+
+  return ring;
+
+error:
+  fprintf (stderr, "Could not create ring (%d): %s\n", errno,
+      strerror (errno));
+  sp_ring_free (ring);
+#endif
+  return NULL;
+}
+
+/* Takes ownership of the fds */
+static ShmRing *
+sp_ring_open (int *fds, size_t size, uint32_t n_slots)
+{
+  ShmRing *ring = sp_ring_alloc ();
+
+  ring->shm_fd = fds[0];
+  ring->buffers_efd = fds[1];
+  ring->acks_efd = fds[2];
+
+  if (!sp_ring_map (ring, size, n_slots)) {
+    sp_ring_free (ring);
+    return NULL;
+  }
+
+  return ring;
+}
+
+static void
+sp_ring_signal (int efd)
+{
+  uint64_t one = 1;
+
+  /* Only fails if the counter is about to overflow, then the consumer has
+   * plenty of wakeups pending already */
+  if (write (efd, &one, sizeof (one)) < 0)
+    return;
+}
+
+static void
+sp_ring_clear (int efd)
+{
+  uint64_t count;
+
+  /* The eventfd is non-blocking, this just fails if it wasn't signalled */
+  if (read (efd, &count, sizeof (count)) < 0)
+    return;
+}
+
+/* Returns 0 if the queue is full */
+static int
+sp_ring_push (ShmRingQueue * q, ShmRingSlot * slots, uint32_t n_slots,
+    int efd, int area_id, unsigned long offset, unsigned long size)
+{
+  uint32_t head = q->head;
+  ShmRingSlot *slot;
+
+  if (head - __atomic_load_n (&q->tail, __ATOMIC_ACQUIRE) >= n_slots)
+    return 0;
+
+  slot = &slots[head & (n_slots - 1)];
+  slot->area_id = area_id;
+  slot->offset = offset;
+  slot->size = size;
+  __atomic_store_n (&q->head, head + 1, __ATOMIC_RELEASE);
+
+  /* Pairs with the fence in sp_ring_arm(): either the consumer sees the new
+   * head, or we see the notify it set before going to sleep */
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&q->notify, __ATOMIC_RELAXED) == head)
+    sp_ring_signal (efd);
+
+  return 1;
+}
+
+static ShmRingSlot *
+sp_ring_peek (ShmRingQueue * q, ShmRingSlot * slots, uint32_t n_slots)
+{
+  uint32_t tail = q->tail;
+
+  if (__atomic_load_n (&q->head, __ATOMIC_ACQUIRE) == tail)
+    return NULL;
+
+  return &slots[tail & (n_slots - 1)];
+}
+
+static void
+sp_ring_pop (ShmRingQueue * q)
+{
+  __atomic_store_n (&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Asks the producer to signal the eventfd once @count more slots are filled.
+ * Returns 1 if they already are, the consumer must not sleep then. */
+static int
+sp_ring_arm (ShmRingQueue * q, uint32_t count)
+{
+  uint32_t tail = q->tail;
+
+  __atomic_store_n (&q->notify, tail + count - 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+  return __atomic_load_n (&q->head, __ATOMIC_ACQUIRE) - tail >= count;
+}
+
 void *
 sp_get_data (ShmPipe * self)
 {
@@ -446,6 +800,11 @@ sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
   while (self->clients)
     sp_writer_close_client (self, self->clients, callback, user_data);
 
+  if (self->ring) {
+    sp_ring_free (self->ring);
+    self->ring = NULL;
+  }
+
   sp_dec (self);
 }
 
@@ -463,8 +822,10 @@ sp_writer_setperms_shm (ShmPipe * self, mode_t perms)
   ShmArea *area;
 
   self->perms = perms;
-  for (area = self->shm_area; area; area = area->next)
-    ret |= fchmod (area->shm_fd, perms);
+  for (area = self->shm_area; area; area = area->next) {
+    if (!area->is_fd)
+      ret |= fchmod (area->shm_fd, perms);
+  }
 
   ret |= chmod (self->socket_path, perms);
 
@@ -485,6 +846,40 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_with_fds (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int area_id, int *fds, int n_fds)
+{
+  char control[CMSG_SPACE (sizeof (int) * MAX_COMMAND_FDS)];
+  struct msghdr msg = { 0 };
+  struct cmsghdr *cmsg;
+  struct iovec iov;
+
+  assert (n_fds > 0 && n_fds <= MAX_COMMAND_FDS);
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  memset (control, 0, sizeof (control));
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * n_fds);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n_fds);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n_fds);
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -567,42 +962,72 @@ sp_writer_block_get_pipe (ShmBlock * block)
 void
 sp_writer_free_block (ShmBlock * block)
 {
-  shm_alloc_space_block_dec (block->ablock);
+  if (block->ablock) {
+    shm_alloc_space_block_dec (block->ablock);
+  } else {
+    ShmClient *client;
+
+    /* An imported fd, the clients can let go of it once they released its
+     * buffers */
+    for (client = block->pipe->clients; client; client = client->next) {
+      struct CommandBuffer cb = { 0 };
+
+      if (client->fd < 0)
+        continue;
+      send_command (client->fd, &cb, COMMAND_CLOSE_SHM_AREA, block->area->id);
+    }
+  }
   sp_shm_area_dec (block->pipe, block->area);
   sp_dec (block->pipe);
   spalloc_free (ShmBlock, block);
 }
 
+/* Imports memory the writer did not allocate, like a memfd or a dmabuf, and
+ * announces it to the clients. Its buffers can then be sent with
+ * sp_writer_send_fd_buf() until the block is freed. The fd is duplicated,
+ * the caller keeps its own. */
+ShmBlock *
+sp_writer_import_fd (ShmPipe * self, int fd, size_t size)
+{
+  ShmBlock *block;
+  ShmArea *area;
+  ShmClient *client;
+
+  if (size == 0)
+    return NULL;
+
+  fd = fcntl (fd, F_DUPFD_CLOEXEC, 0);
+  if (fd < 0)
+    return NULL;
+
+  area = sp_open_fd_area (fd, ++self->next_area_id, size, 1);
+  sp_add_shm_area (self, area);
+
+  for (client = self->clients; client; client = client->next)
+    sp_writer_send_fd_area (client->fd, area);
+
+  /* The block holds the reference the area was created with */
+  block = spalloc_new (ShmBlock);
+  block->pipe = self;
+  block->area = area;
+  block->ablock = NULL;
+  sp_inc (self);
+
+  return block;
+}
+
 /* Returns the number of client this has successfully been sent to */
 
-int
-sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
+static int
+sp_writer_send_area_buf (ShmPipe * self, ShmArea * area, ShmAllocBlock * ablock,
+    unsigned long offset, size_t size, void *tag)
 {
-  ShmArea *area = NULL;
-  unsigned long offset = 0;
   unsigned long bsize = size;
   ShmBuffer *sb;
   ShmClient *client = NULL;
-  ShmAllocBlock *ablock = NULL;
   int i = 0;
   int c = 0;
 
-  if (self->num_clients == 0)
-    return 0;
-
-  for (area = self->shm_area; area; area = area->next) {
-    if (buf >= area->shm_area_buf &&
-        buf < (area->shm_area_buf + area->shm_area_len)) {
-      offset = buf - area->shm_area_buf;
-      ablock = shm_alloc_space_block_get (area->allocspace, offset);
-      assert (ablock);
-      break;
-    }
-  }
-
-  if (!ablock)
-    return -1;
-
   sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
   memset (sb, 0, sizeof (ShmBuffer));
   memset (sb->clients, -1, sizeof (int) * self->num_clients);
@@ -615,10 +1040,21 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
 
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
-    cb.payload.buffer.offset = offset;
-    cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
-      continue;
+
+    if (client->ring) {
+      ShmRing *ring = client->ring;
+
+      /* Unlike sending on the socket, this never blocks: a client that
+       * lags that far behind misses the buffer */
+      if (!sp_ring_push (&ring->header->buffers, ring->buffers, ring->n_slots,
+              ring->buffers_efd, area->id, offset, bsize))
+        continue;
+    } else {
+      cb.payload.buffer.offset = offset;
+      cb.payload.buffer.size = bsize;
+      if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, area->id))
+        continue;
+    }
     sb->clients[i++] = client->fd;
     c++;
   }
@@ -629,7 +1065,8 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   }
 
   sp_shm_area_inc (area);
-  shm_alloc_space_block_inc (ablock);
+  if (ablock)
+    shm_alloc_space_block_inc (ablock);
 
   sb->use_count = c;
 
@@ -639,6 +1076,47 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+int
+sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
+{
+  ShmArea *area = NULL;
+  unsigned long offset = 0;
+  ShmAllocBlock *ablock = NULL;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  for (area = self->shm_area; area; area = area->next) {
+    if (!area->is_fd && buf >= area->shm_area_buf &&
+        buf < (area->shm_area_buf + area->shm_area_len)) {
+      offset = buf - area->shm_area_buf;
+      ablock = shm_alloc_space_block_get (area->allocspace, offset);
+      assert (ablock);
+      break;
+    }
+  }
+
+  if (!ablock)
+    return -1;
+
+  return sp_writer_send_area_buf (self, area, ablock, offset, size, tag);
+}
+
+/* Sends @size bytes at @offset of a block from sp_writer_import_fd() */
+int
+sp_writer_send_fd_buf (ShmPipe * self, ShmBlock * block, size_t offset,
+    size_t size, void *tag)
+{
+  if (block->pipe != self || block->ablock ||
+      offset + size > block->area->shm_area_len || offset + size < offset)
+    return -1;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  return sp_writer_send_area_buf (self, block->area, NULL, offset, size, tag);
+}
+
 static int
 recv_command (int fd, struct CommandBuffer *cb)
 {
@@ -652,6 +1130,82 @@ recv_command (int fd, struct CommandBuffer *cb)
   }
 }
 
+static void
+close_fds (int *fds, int n_fds)
+{
+  int i;
+
+  for (i = 0; i < n_fds; i++)
+    close (fds[i]);
+}
+
+/* Like recv_command(), but also returns the fds passed with the command,
+ * which the caller has to close */
+static int
+recv_command_with_fds (int fd, struct CommandBuffer *cb, int *fds, int *n_fds)
+{
+  char control[CMSG_SPACE (sizeof (int) * MAX_COMMAND_FDS)];
+  struct msghdr msg = { 0 };
+  struct cmsghdr *cmsg;
+  struct iovec iov;
+  ssize_t retval;
+
+  *n_fds = 0;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof (control);
+
+  retval = recvmsg (fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+  if (retval < 0)
+    return 0;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      int n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+
+      if (n > MAX_COMMAND_FDS - *n_fds)
+        n = MAX_COMMAND_FDS - *n_fds;
+      memcpy (fds + *n_fds, CMSG_DATA (cmsg), sizeof (int) * n);
+      *n_fds += n;
+    }
+  }
+
+  if (retval != sizeof (struct CommandBuffer)) {
+    close_fds (fds, *n_fds);
+    *n_fds = 0;
+    return 0;
+  }
+
+  return 1;
+}
+
+static int
+sp_writer_send_fd_area (int fd, ShmArea * area)
+{
+  struct CommandBuffer cb = { 0 };
+
+  cb.payload.new_fd_area.size = area->shm_area_len;
+  return send_command_with_fds (fd, &cb, COMMAND_NEW_FD_AREA, area->id,
+      &area->shm_fd, 1);
+}
+
+static ShmArea *
+sp_find_shm_area (ShmPipe * self, int area_id)
+{
+  ShmArea *area;
+
+  for (area = self->shm_area; area; area = area->next) {
+    if (area->id == area_id)
+      return area;
+  }
+
+  return NULL;
+}
+
 long int
 sp_client_recv (ShmPipe * self, char **buf)
 {
@@ -659,11 +1213,18 @@ sp_client_recv (ShmPipe * self, char **buf)
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
+  int fds[MAX_COMMAND_FDS];
+  int n_fds;
   int retval;
 
-  if (!recv_command (self->main_socket, &cb))
+  if (!recv_command_with_fds (self->main_socket, &cb, fds, &n_fds))
     return -1;
 
+  if (cb.type != COMMAND_NEW_RING && cb.type != COMMAND_NEW_FD_AREA) {
+    close_fds (fds, n_fds);
+    n_fds = 0;
+  }
+
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
@@ -690,24 +1251,59 @@ sp_client_recv (ShmPipe * self, char **buf)
       break;
 
     case COMMAND_CLOSE_SHM_AREA:
-      for (area = self->shm_area; area; area = area->next) {
-        if (area->id == cb.area_id) {
-          sp_shm_area_dec (self, area);
-          break;
-        }
+      area = sp_find_shm_area (self, cb.area_id);
+      if (!area || area->ring_close_pending)
+        break;
+
+      if (self->ring && sp_ring_peek (&self->ring->header->buffers,
+              self->ring->buffers, self->ring->n_slots)) {
+        /* Buffers of this area may still be queued, keep it until the
+         * ones queued now are consumed */
+        area->ring_close_pending = 1;
+        area->ring_close_at =
+            __atomic_load_n (&self->ring->header->buffers.head,
+            __ATOMIC_ACQUIRE);
+      } else {
+        sp_shm_area_dec (self, area);
       }
       break;
 
+    case COMMAND_NEW_RING:
+      if (n_fds != 3 || self->ring) {
+        close_fds (fds, n_fds);
+        return -5;
+      }
+
+      self->ring = sp_ring_open (fds, cb.payload.new_ring.size,
+          cb.payload.new_ring.n_slots);
+      if (!self->ring)
+        return -5;
+      break;
+
+    case COMMAND_NEW_FD_AREA:
+      if (n_fds != 1 || cb.payload.new_fd_area.size == 0 ||
+          sp_find_shm_area (self, cb.area_id)) {
+        close_fds (fds, n_fds);
+        return -6;
+      }
+
+      newarea = sp_open_fd_area (fds[0], cb.area_id,
+          cb.payload.new_fd_area.size, 0);
+      if (!newarea)
+        return -6;
+
+      sp_add_shm_area (self, newarea);
+      break;
+
     case COMMAND_NEW_BUFFER:
       assert (buf);
-      for (area = self->shm_area; area; area = area->next) {
-        if (area->id == cb.area_id) {
-          *buf = area->shm_area_buf + cb.payload.buffer.offset;
-          sp_shm_area_inc (area);
-          return cb.payload.buffer.size;
-        }
-      }
-      return -23;
+      area = sp_find_shm_area (self, cb.area_id);
+      if (!area)
+        return -23;
+
+      *buf = area->shm_area_buf + cb.payload.buffer.offset;
+      sp_shm_area_inc (area);
+      return cb.payload.buffer.size;
 
     default:
       return -99;
@@ -716,10 +1312,123 @@ sp_client_recv (ShmPipe * self, char **buf)
   return 0;
 }
 
+/* Closes the areas whose last queued buffer was just consumed */
+static void
+sp_client_close_ring_areas (ShmPipe * self)
+{
+  uint32_t tail = self->ring->header->buffers.tail;
+  ShmArea *area, *next;
+
+  for (area = self->shm_area; area; area = next) {
+    next = area->next;
+    if (area->ring_close_pending &&
+        (int32_t) (tail - area->ring_close_at) >= 0) {
+      area->ring_close_pending = 0;
+      sp_shm_area_dec (self, area);
+    }
+  }
+}
+
+static int
+sp_client_ring_ack (ShmPipe * self, int area_id, unsigned long offset)
+{
+  struct CommandBuffer cb = { 0 };
+
+  if (sp_ring_push (&self->ring->header->acks, self->ring->acks,
+          self->ring->n_slots, self->ring->acks_efd, area_id, offset, 0))
+    return 1;
+
+  /* The writer is slow to collect the acks, this is not worth blocking */
+  cb.payload.ack_buffer.offset = offset;
+  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER, area_id);
+}
+
+/* Returns the size of the next buffer of the ring, or 0 with @buf set to NULL
+ * if there is none yet. In that case, the ring fd will be readable once
+ * there is one. */
+long int
+sp_client_recv_ring (ShmPipe * self, char **buf)
+{
+  ShmRing *ring = self->ring;
+  ShmRingSlot *slot;
+  ShmArea *area;
+  long int size;
+
+  *buf = NULL;
+
+  if (!ring)
+    return 0;
+
+  if (ring->armed) {
+    sp_ring_clear (ring->buffers_efd);
+    ring->armed = 0;
+  }
+
+again:
+  slot = sp_ring_peek (&ring->header->buffers, ring->buffers, ring->n_slots);
+  if (!slot) {
+    if (!sp_ring_arm (&ring->header->buffers, 1)) {
+      ring->armed = 1;
+      return 0;
+    }
+    slot = sp_ring_peek (&ring->header->buffers, ring->buffers, ring->n_slots);
+  }
+
+  /* A new area is announced on the socket before its first buffer is
+   * queued, so it can be read right away */
+  while ((area = sp_find_shm_area (self, slot->area_id)) == NULL) {
+    char *unused = NULL;
+
+    if (sp_client_recv (self, &unused) < 0 || unused)
+      break;
+  }
+
+  if (!area) {
+    /* Give it back, otherwise the writer would wait for it forever */
+    if (!sp_client_ring_ack (self, slot->area_id, slot->offset))
+      return -23;
+    sp_ring_pop (&ring->header->buffers);
+    sp_client_close_ring_areas (self);
+    goto again;
+  }
+
+  *buf = area->shm_area_buf + slot->offset;
+  size = slot->size;
+  sp_shm_area_inc (area);
+
+  sp_ring_pop (&ring->header->buffers);
+  sp_client_close_ring_areas (self);
+
+  return size;
+}
+
 int
-sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
+sp_client_get_ring_fd (ShmPipe * self)
+{
+  if (self->ring)
+    return self->ring->buffers_efd;
+
+  return -1;
+}
+
+static int
+sp_writer_ack_buffer (ShmPipe * self, ShmClient * client, int area_id,
+    unsigned long offset, void **tag)
 {
   ShmBuffer *buf = NULL, *prev_buf = NULL;
+
+  for (buf = self->buffers; buf; buf = buf->next) {
+    if (buf->shm_area->id == area_id && buf->offset == offset)
+      return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
+    prev_buf = buf;
+  }
+
+  return -2;
+}
+
+int
+sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
+{
   struct CommandBuffer cb;
 
   if (!recv_command (client->fd, &cb))
@@ -727,16 +1436,8 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
-
-      for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
-            buf->offset == cb.payload.ack_buffer.offset) {
-          return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
-        }
-        prev_buf = buf;
-      }
-
-      return -2;
+      return sp_writer_ack_buffer (self, client, cb.area_id,
+          cb.payload.ack_buffer.offset, tag);
     default:
       return -99;
   }
@@ -749,6 +1450,7 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
 {
   ShmArea *shm_area = NULL;
   unsigned long offset;
+  int area_id;
   struct CommandBuffer cb = { 0 };
 
   for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
@@ -760,12 +1462,15 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
   assert (shm_area);
 
   offset = buf - shm_area->shm_area_buf;
+  area_id = shm_area->id;
 
   sp_shm_area_dec (self, shm_area);
 
+  if (self->ring)
+    return sp_client_ring_ack (self, area_id, offset);
+
   cb.payload.ack_buffer.offset = offset;
-  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER,
-      self->shm_area->id);
+  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER, area_id);
 }
 
 ShmPipe *
@@ -809,6 +1514,7 @@ ShmClient *
 sp_writer_accept_client (ShmPipe * self)
 {
   ShmClient *client = NULL;
+  ShmArea *area;
   int fd;
   struct CommandBuffer cb = { 0 };
   int pathlen = strlen (self->shm_area->shm_area_name) + 1;
@@ -834,8 +1540,39 @@ sp_writer_accept_client (ShmPipe * self)
     goto error;
   }
 
+  /* The imported fds that are still in use */
+  for (area = self->shm_area; area; area = area->next) {
+    if (area->is_fd && !sp_writer_send_fd_area (fd, area)) {
+      fprintf (stderr, "Sending fd area failed: %s", strerror (errno));
+      goto error;
+    }
+  }
+
   client = spalloc_new (ShmClient);
   client->fd = fd;
+  client->ring = NULL;
+
+  /* Without a ring, the client just uses the socket */
+  if (self->ring_slots > 0)
+    client->ring = sp_ring_new (self->ring_slots);
+
+  if (client->ring) {
+    int fds[3];
+
+    fds[0] = client->ring->shm_fd;
+    fds[1] = client->ring->buffers_efd;
+    fds[2] = client->ring->acks_efd;
+
+    memset (&cb, 0, sizeof (cb));
+    cb.payload.new_ring.size = client->ring->len;
+    cb.payload.new_ring.n_slots = client->ring->n_slots;
+    if (!send_command_with_fds (fd, &cb, COMMAND_NEW_RING, 0, fds, 3)) {
+      fprintf (stderr, "Sending ring failed: %s", strerror (errno));
+      sp_ring_free (client->ring);
+      spalloc_free (ShmClient, client);
+      goto error;
+    }
+  }
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -883,7 +1620,8 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
+    if (buf->ablock)
+      shm_alloc_space_block_dec (buf->ablock);
     sp_shm_area_dec (self, buf->shm_area);
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
     return 0;
@@ -898,10 +1636,28 @@ sp_writer_close_client (ShmPipe * self, ShmClient * client,
   ShmBuffer *buffer = NULL, *prev_buf = NULL;
   ShmClient *item = NULL, *prev_item = NULL;
 
+  /* Unlink the client before running any callback: freeing a tag can free
+   * an imported block, which then sends a command to every client left in
+   * the list. The fd stays open until the end so that its number can't be
+   * reused while the buffers are still matched against it */
+  for (item = self->clients; item; item = item->next) {
+    if (item == client)
+      break;
+    prev_item = item;
+  }
+  assert (item);
+
+  if (prev_item)
+    prev_item->next = client->next;
+  else
+    self->clients = client->next;
+
+  self->num_clients--;
+
   shutdown (client->fd, SHUT_RDWR);
-  close (client->fd);
 
 again:
+  prev_buf = NULL;
   for (buffer = self->buffers; buffer; buffer = buffer->next) {
     int i;
     void *tag = NULL;
@@ -919,19 +1675,11 @@ again:
     prev_buf = buffer;
   }
 
-  for (item = self->clients; item; item = item->next) {
-    if (item == client)
-      break;
-    prev_item = item;
-  }
-  assert (item);
-
-  if (prev_item)
-    prev_item->next = client->next;
-  else
-    self->clients = client->next;
+  close (client->fd);
+  client->fd = -1;
 
-  self->num_clients--;
+  if (client->ring)
+    sp_ring_free (client->ring);
 
   spalloc_free (ShmClient, client);
 }
@@ -995,3 +1743,151 @@ sp_writer_get_max_buf_size (ShmPipe * self)
 
   return self->shm_area->shm_area_len;
 }
+
+void
+sp_writer_set_ring_size (ShmPipe * self, unsigned int n_slots)
+{
+  unsigned int size = 1;
+
+  if (n_slots == 0) {
+    self->ring_slots = 0;
+    return;
+  }
+
+  while (size < n_slots && size < SHM_RING_MAX_SLOTS)
+    size <<= 1;
+
+  self->ring_slots = size;
+}
+
+/* While @blocked, the rings are armed to signal every ack instead of a
+ * batch of them, takes effect on the next sp_writer_recv_rings() */
+void
+sp_writer_set_ring_blocked (ShmPipe * self, int blocked)
+{
+  self->ring_blocked = blocked;
+}
+
+int
+sp_writer_get_client_ring_fd (ShmClient * client)
+{
+  if (client->ring)
+    return client->ring->acks_efd;
+
+  return -1;
+}
+
+static unsigned int
+sp_writer_get_client_pending (ShmPipe * self, ShmClient * client)
+{
+  ShmBuffer *buf;
+  unsigned int pending = 0;
+  int i;
+
+  for (buf = self->buffers; buf; buf = buf->next) {
+    for (i = 0; i < buf->num_clients; i++) {
+      if (buf->clients[i] == client->fd) {
+        pending++;
+        break;
+      }
+    }
+  }
+
+  return pending;
+}
+
+/* Collects at most n_slots acks, returns -1 if the ring of the client is
+ * corrupted */
+static int
+sp_writer_drain_ring (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  ShmRing *ring = client->ring;
+  ShmRingSlot *slot;
+  unsigned int pending, budget = ring->n_slots;
+  int freed = 0;
+
+  do {
+    /* The head is written by the client, don't trust it */
+    if (__atomic_load_n (&ring->header->acks.head, __ATOMIC_ACQUIRE) -
+        ring->header->acks.tail > ring->n_slots)
+      return -1;
+
+    while (budget > 0 && (slot = sp_ring_peek (&ring->header->acks,
+                ring->acks, ring->n_slots))) {
+      void *tag = NULL;
+
+      if (sp_writer_ack_buffer (self, client, slot->area_id, slot->offset,
+              &tag) == 0) {
+        if (callback)
+          callback (tag, user_data);
+        freed++;
+      }
+      sp_ring_pop (&ring->header->acks);
+      budget--;
+    }
+
+    /* A client acking as fast as we drain can't keep us here, the rest is
+     * for the next wakeup */
+    if (budget == 0) {
+      sp_ring_signal (ring->acks_efd);
+      break;
+    }
+
+    /* Be woken up once half of the buffers the client still holds are
+     * released, so that the acks are collected in batches. The ring can't
+     * hold more acks than it has slots. A blocked writer needs every ack
+     * though, the client may hold on to most of its buffers. */
+    if (self->ring_blocked)
+      pending = 1;
+    else
+      pending = sp_writer_get_client_pending (self, client) / 2;
+    if (pending < 1)
+      pending = 1;
+    else if (pending > ring->n_slots)
+      pending = ring->n_slots;
+  } while (sp_ring_arm (&ring->header->acks, pending));
+
+  return freed;
+}
+
+/* To be called when the ring fd of the client is readable. Calls @callback
+ * on the tag of every buffer that is not used by any client anymore and
+ * returns how many there were, or -1 if the client corrupted its ring and
+ * has to be closed. */
+int
+sp_writer_recv_ring (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  if (!client->ring)
+    return 0;
+
+  sp_ring_clear (client->ring->acks_efd);
+
+  return sp_writer_drain_ring (self, client, callback, user_data);
+}
+
+/* Like sp_writer_recv_ring(), for all clients, without any syscall */
+int
+sp_writer_recv_rings (ShmPipe * self, sp_buffer_free_callback callback,
+    void *user_data)
+{
+  ShmClient *client;
+  int freed = 0;
+
+  for (client = self->clients; client; client = client->next) {
+    int ret;
+
+    if (!client->ring)
+      continue;
+
+    ret = sp_writer_drain_ring (self, client, callback, user_data);
+    /* Wake up the poll thread so that it closes a broken client */
+    if (ret < 0)
+      sp_ring_signal (client->ring->acks_efd);
+    else
+      freed += ret;
+  }
+
+  return freed;
+}
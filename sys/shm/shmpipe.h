@@ -46,6 +46,11 @@
  * for events on the client fd (the ones where sp_writer_recv() is
  * called), and then try to re-alloc.
  *
+ * Memory the writer did not allocate, like a memfd or a dmabuf, is
+ * passed to the clients with sp_writer_import_fd(), and its buffers are
+ * sent with sp_writer_send_fd_buf(). Freeing the returned block with
+ * sp_writer_free_block() tells the clients it is no longer used.
+ *
  * The reader (client) connect to the writer with sp_client_open() And
  * select()s on the fd from sp_get_fd() until there is something to
  * read.  Then they must read using sp_client_recv() which will return
@@ -97,6 +102,9 @@ int sp_writer_get_client_fd (ShmClient * client);
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
+ShmBlock *sp_writer_import_fd (ShmPipe * self, int fd, size_t size);
+int sp_writer_send_fd_buf (ShmPipe * self, ShmBlock * block, size_t offset,
+    size_t size, void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
@@ -108,6 +116,14 @@ int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
 
 int sp_writer_pending_writes (ShmPipe * self);
 
+void sp_writer_set_ring_size (ShmPipe * self, unsigned int n_slots);
+void sp_writer_set_ring_blocked (ShmPipe * self, int blocked);
+int sp_writer_get_client_ring_fd (ShmClient * client);
+int sp_writer_recv_ring (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void * user_data);
+int sp_writer_recv_rings (ShmPipe * self, sp_buffer_free_callback callback,
+    void * user_data);
+
 ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
 ShmBuffer *sp_writer_get_next_buffer (ShmBuffer * buffer);
 void *sp_writer_buf_get_tag (ShmBuffer * buffer);
@@ -115,6 +131,8 @@ void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+int sp_client_get_ring_fd (ShmPipe * self);
+long int sp_client_recv_ring (ShmPipe * self, char **buf);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
@@ -30,11 +30,13 @@
 #endif
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
 #include <gst/video/gstvideometa.h>
 #include <gst/base/gstbasesrc.h>
+#include <gst/video/gstvideoaggregator.h>
 
 #define VIDEO_CAPS_STRING               \
     "video/x-raw, "                 \
@@ -1740,6 +1742,79 @@ GST_START_TEST (test_obscured_skipped)
 
 GST_END_TEST;
 
+/* sink_0 is covered by the combination of sink_1 and sink_2, each of which
+ * only covers part of it */
+static void
+_test_obscured_combination (gint height1, gint ypos2, gdouble alpha2)
+{
+  GstElement *pipeline, *sink, *cfilter0;
+  GstPad *srcpad;
+  GstSample *sample;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=comp "
+      "sink_0::xpos=10 sink_0::ypos=10 sink_0::width=40 sink_0::height=40 "
+      "sink_1::xpos=0 sink_1::ypos=0 sink_1::width=64 sink_1::height=%d "
+      "sink_2::xpos=0 sink_2::ypos=%d sink_2::width=64 sink_2::height=34 "
+      "sink_2::alpha=%f ! video/x-raw,width=64,height=64 ! appsink name=sink "
+      "videotestsrc num-buffers=5 ! video/x-raw,format=I420 ! "
+      "capsfilter name=cfilter0 ! comp.sink_0 "
+      "videotestsrc num-buffers=5 ! video/x-raw,format=I420 ! comp.sink_1 "
+      "videotestsrc num-buffers=5 ! video/x-raw,format=I420 ! comp.sink_2",
+      height1, ypos2, alpha2);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  cfilter0 = gst_bin_get_by_name (GST_BIN (pipeline), "cfilter0");
+  srcpad = gst_element_get_static_pad (cfilter0, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_obscured_pad_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (cfilter0);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  do {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (sample == NULL)
+      break;
+    gst_sample_unref (sample);
+  } while (TRUE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_obscured_by_combination_skipped)
+{
+  GST_INFO ("testing sink_0 covered by sink_1 and sink_2 together");
+  buffer_mapped = FALSE;
+  _test_obscured_combination (30, 30, 1.0);
+  fail_unless (buffer_mapped == FALSE);
+
+  GST_INFO ("testing gap between sink_1 and sink_2");
+  buffer_mapped = FALSE;
+  _test_obscured_combination (30, 32, 1.0);
+  fail_unless (buffer_mapped == TRUE);
+
+  /* I420 is blended at even positions only, so sink_2 starts at line 32
+   * and line 31 is only covered by sink_0 */
+  GST_INFO ("testing sink_2 at an odd position");
+  buffer_mapped = FALSE;
+  _test_obscured_combination (31, 31, 1.0);
+  fail_unless (buffer_mapped == TRUE);
+
+  GST_INFO ("testing translucent sink_2");
+  buffer_mapped = FALSE;
+  _test_obscured_combination (30, 30, 0.5);
+  fail_unless (buffer_mapped == TRUE);
+  buffer_mapped = FALSE;
+}
+
+GST_END_TEST;
+
 static void
 _pipeline_eos (GstBus * bus, GstMessage * message, GstPipeline * bin)
 {
@@ -1912,6 +1987,422 @@ GST_START_TEST (test_pad_numbering)
 
 GST_END_TEST;
 
+/* Runs the pipeline described by @desc until EOS and returns all buffers
+ * output by its appsink called "sink" */
+static GList *
+_run_pipeline_collect_buffers (const gchar * desc)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GList *buffers = NULL;
+
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  do {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (sample == NULL)
+      break;
+    buffers = g_list_append (buffers,
+        gst_buffer_ref (gst_sample_get_buffer (sample)));
+    gst_sample_unref (sample);
+  } while (TRUE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return buffers;
+}
+
+/* Checks that both lists have @n_buffers buffers with the same content, and
+ * frees them */
+static void
+_check_buffers_identical (GList * expected, GList * actual, guint n_buffers,
+    const gchar * format)
+{
+  GList *l1, *l2;
+  GstMapInfo map1, map2;
+
+  fail_unless_equals_int (g_list_length (expected), n_buffers);
+  fail_unless_equals_int (g_list_length (actual), n_buffers);
+
+  for (l1 = expected, l2 = actual; l1 && l2; l1 = l1->next, l2 = l2->next) {
+    fail_unless (gst_buffer_map (l1->data, &map1, GST_MAP_READ));
+    fail_unless (gst_buffer_map (l2->data, &map2, GST_MAP_READ));
+    fail_unless_equals_int (map1.size, map2.size);
+    fail_unless (memcmp (map1.data, map2.data, map1.size) == 0,
+        "Output differs for %s", format);
+    gst_buffer_unmap (l2->data, &map2);
+    gst_buffer_unmap (l1->data, &map1);
+  }
+
+  g_list_free_full (expected, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (actual, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Composites a layout of overlapping, partially transparent and partially
+ * out-of-frame inputs with odd sizes and positions and returns all output
+ * buffers */
+static GList *
+_run_layout_with_n_threads (const gchar * format, const gchar * background,
+    guint n_threads)
+{
+  GList *buffers;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=comp background=%s n-threads=%u "
+      "sink_0::xpos=-7 sink_0::ypos=-3 "
+      "sink_1::xpos=21 sink_1::ypos=13 sink_1::alpha=0.6 "
+      "sink_2::xpos=120 sink_2::ypos=77 ! "
+      "video/x-raw,format=%s,width=160,height=97 ! "
+      "appsink name=sink sync=false "
+      "videotestsrc num-buffers=3 pattern=smpte ! "
+      "video/x-raw,format=%s,width=64,height=41 ! comp.sink_0 "
+      "videotestsrc num-buffers=3 pattern=ball ! "
+      "video/x-raw,format=%s,width=100,height=71 ! comp.sink_1 "
+      "videotestsrc num-buffers=3 pattern=checkers-8 ! "
+      "video/x-raw,format=%s,width=53,height=37 ! comp.sink_2",
+      background, n_threads, format, format, format, format);
+  buffers = _run_pipeline_collect_buffers (desc);
+  g_free (desc);
+
+  return buffers;
+}
+
+static void
+_check_threaded_output_identical (const gchar * format,
+    const gchar * background)
+{
+  GList *serial, *threaded;
+
+  GST_INFO ("testing %s with %s background", format, background);
+
+  serial = _run_layout_with_n_threads (format, background, 1);
+  threaded = _run_layout_with_n_threads (format, background, 4);
+  _check_buffers_identical (serial, threaded, 3, format);
+}
+
+GST_START_TEST (test_n_threads_identical_output)
+{
+  static const gchar *formats[] = { "AYUV", "BGRA", "I420", "NV12", "Y42B",
+    "Y41B", "Y444", "YUY2", "RGB", "xRGB"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    _check_threaded_output_identical (formats[i], "checker");
+
+  _check_threaded_output_identical ("I420", "black");
+  _check_threaded_output_identical ("NV12", "white");
+  _check_threaded_output_identical ("AYUV", "transparent");
+  _check_threaded_output_identical ("I420", "transparent");
+}
+
+GST_END_TEST;
+
+/* Two inputs at a lower framerate than the output, so that the compositor
+ * repeats their buffers, and a moving one on top */
+static GList *
+_run_static_layout (const gchar * format, const gchar * background,
+    gboolean reuse)
+{
+  GList *buffers;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=comp background=%s "
+      "reuse-static-inputs=%s "
+      "sink_0::xpos=-7 sink_0::ypos=-3 sink_0::width=90 sink_0::height=61 "
+      "sink_1::xpos=21 sink_1::ypos=13 sink_1::alpha=0.6 "
+      "sink_2::xpos=120 sink_2::ypos=77 ! "
+      "video/x-raw,format=%s,width=160,height=97,framerate=30/1 ! "
+      "appsink name=sink sync=false "
+      "videotestsrc num-buffers=2 pattern=smpte ! "
+      "video/x-raw,format=I420,width=64,height=41,framerate=5/1 ! comp.sink_0 "
+      "videotestsrc num-buffers=12 pattern=ball ! "
+      "video/x-raw,format=%s,width=100,height=71,framerate=30/1 ! comp.sink_1 "
+      "videotestsrc num-buffers=2 pattern=checkers-8 ! "
+      "video/x-raw,format=%s,width=53,height=37,framerate=5/1 ! comp.sink_2",
+      background, reuse ? "true" : "false", format, format, format);
+  buffers = _run_pipeline_collect_buffers (desc);
+  g_free (desc);
+
+  return buffers;
+}
+
+static void
+_check_reuse_output_identical (const gchar * format, const gchar * background)
+{
+  GList *full, *reused;
+
+  GST_INFO ("testing %s with %s background", format, background);
+
+  full = _run_static_layout (format, background, FALSE);
+  reused = _run_static_layout (format, background, TRUE);
+  _check_buffers_identical (full, reused, 12, format);
+}
+
+GST_START_TEST (test_reuse_static_inputs_identical_output)
+{
+  static const gchar *formats[] = { "AYUV", "BGRA", "I420", "NV12", "Y42B",
+    "YUY2", "RGB"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    _check_reuse_output_identical (formats[i], "checker");
+
+  _check_reuse_output_identical ("I420", "black");
+  _check_reuse_output_identical ("AYUV", "transparent");
+}
+
+GST_END_TEST;
+
+/* Six inputs of different formats and sizes, so that each of them is
+ * converted and scaled when its frame is prepared */
+static GList *
+_run_conversion_layout (gboolean parallel)
+{
+  GstVideoAggregatorClass *klass;
+  GstElement *comp;
+  gboolean was_parallel;
+  GList *buffers;
+
+  /* There is no property for this, switch the class between both paths */
+  comp = gst_element_factory_make ("compositor", NULL);
+  fail_unless (comp != NULL);
+  klass = (GstVideoAggregatorClass *) G_OBJECT_GET_CLASS (comp);
+  was_parallel = klass->parallel_prepare_frames;
+  klass->parallel_prepare_frames = parallel;
+  gst_object_unref (comp);
+
+  buffers = _run_pipeline_collect_buffers ("compositor name=comp "
+      "sink_0::width=90 sink_0::height=61 "
+      "sink_1::xpos=21 sink_1::ypos=13 sink_1::alpha=0.6 "
+      "sink_2::xpos=100 sink_2::ypos=50 "
+      "sink_3::xpos=10 sink_3::ypos=40 sink_3::width=120 "
+      "sink_4::xpos=70 sink_4::ypos=5 sink_4::alpha=0.7 "
+      "sink_5::xpos=130 sink_5::ypos=70 sink_5::height=20 ! "
+      "video/x-raw,format=I420,width=160,height=97 ! "
+      "appsink name=sink sync=false "
+      "videotestsrc num-buffers=3 pattern=smpte ! "
+      "video/x-raw,format=I420,width=64,height=41 ! comp.sink_0 "
+      "videotestsrc num-buffers=3 pattern=ball ! "
+      "video/x-raw,format=YUY2,width=100,height=71 ! comp.sink_1 "
+      "videotestsrc num-buffers=3 pattern=checkers-8 ! "
+      "video/x-raw,format=RGB,width=53,height=37 ! comp.sink_2 "
+      "videotestsrc num-buffers=3 pattern=zone-plate ! "
+      "video/x-raw,format=NV12,width=80,height=45 ! comp.sink_3 "
+      "videotestsrc num-buffers=3 pattern=circular ! "
+      "video/x-raw,format=AYUV,width=33,height=21 ! comp.sink_4 "
+      "videotestsrc num-buffers=3 pattern=colors ! "
+      "video/x-raw,format=Y444,width=40,height=30 ! comp.sink_5");
+
+  klass->parallel_prepare_frames = was_parallel;
+
+  return buffers;
+}
+
+/* The thread preparing the frames takes one of the pads itself and the
+ * others go to the pool, so several threads are used even on a single
+ * core */
+GST_START_TEST (test_parallel_prepare_frames_identical_output)
+{
+  GList *serial, *parallel;
+
+  serial = _run_conversion_layout (FALSE);
+  parallel = _run_conversion_layout (TRUE);
+  _check_buffers_identical (serial, parallel, 3, "I420");
+}
+
+GST_END_TEST;
+
+static guint
+_get_luma_u16 (GstVideoFrame * frame, gint x, gint y)
+{
+  const guint8 *data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  guint16 val;
+
+  data += y * GST_VIDEO_FRAME_COMP_STRIDE (frame, 0)
+      + x * GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
+  val = *(const guint16 *) data;
+
+  /* AYUV64 is in native endianness, the others are little endian */
+  if (GST_VIDEO_FRAME_FORMAT (frame) != GST_VIDEO_FORMAT_AYUV64)
+    val = GUINT16_FROM_LE (val);
+
+  return val;
+}
+
+static void
+_check_high_bit_depth_blend (const gchar * format)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  const GstVideoFormatInfo *finfo;
+  guint background, white, half, expected, tolerance;
+  gchar *desc;
+
+  GST_INFO ("testing %s", format);
+
+  desc = g_strdup_printf ("compositor name=comp background=black "
+      "sink_1::xpos=32 sink_1::ypos=32 sink_1::alpha=0.5 ! "
+      "video/x-raw,format=%s,width=64,height=64 ! appsink name=sink "
+      "videotestsrc num-buffers=1 pattern=white ! "
+      "video/x-raw,format=%s,width=16,height=16 ! comp. "
+      "videotestsrc num-buffers=1 pattern=white ! "
+      "video/x-raw,format=%s,width=16,height=16 ! comp.",
+      format, format, format);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (sink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  fail_unless (gst_video_info_from_caps (&info, gst_sample_get_caps (sample)));
+  fail_unless (gst_video_frame_map (&frame, &info,
+          gst_sample_get_buffer (sample), GST_MAP_READ));
+
+  finfo = info.finfo;
+  background = _get_luma_u16 (&frame, 60, 4);
+  white = _get_luma_u16 (&frame, 8, 8);
+  half = _get_luma_u16 (&frame, 40, 40);
+  tolerance = 2 << GST_VIDEO_FORMAT_INFO_SHIFT (finfo, 0);
+
+  /* Black background, opaque copy and half way in between */
+  expected = (16 << (GST_VIDEO_FORMAT_INFO_DEPTH (finfo, 0) - 8))
+      << GST_VIDEO_FORMAT_INFO_SHIFT (finfo, 0);
+  fail_unless_equals_int (background, expected);
+  fail_unless (white > background);
+  expected = (background + white) / 2;
+  fail_unless (half + tolerance >= expected && half <= expected + tolerance,
+      "%s: blended luma %u, expected %u", format, half, expected);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_high_bit_depth_blend)
+{
+  _check_high_bit_depth_blend ("I420_10LE");
+  _check_high_bit_depth_blend ("Y444_10LE");
+  _check_high_bit_depth_blend ("P010_10LE");
+  _check_high_bit_depth_blend ("AYUV64");
+}
+
+GST_END_TEST;
+
+static GstMemory *input_memory;
+
+/* Keeps the memory of the first input buffer, and flags the buffer so that
+ * the test can check that the flags are not passed through */
+static GstPadProbeReturn
+_store_input_memory_cb (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  buffer = gst_buffer_make_writable (buffer);
+  GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+
+  if (input_memory == NULL)
+    input_memory = gst_memory_ref (gst_buffer_peek_memory (buffer, 0));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+_check_passthrough (const gchar * pad_props, const gchar * out_caps,
+    gboolean expect_passthrough)
+{
+  GstElement *pipeline, *sink, *cfilter;
+  GstPad *srcpad;
+  GstSample *sample;
+  GstBuffer *buffer;
+  gchar *desc;
+
+  GST_INFO ("testing '%s' with %s", pad_props, out_caps);
+
+  desc = g_strdup_printf ("compositor name=comp %s ! %s ! "
+      "appsink name=sink "
+      "videotestsrc num-buffers=1 ! "
+      "video/x-raw,format=I420,width=64,height=48,framerate=25/1 ! "
+      "capsfilter name=cf0 ! comp.sink_0 "
+      "videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=I420,width=32,height=24,framerate=25/1 ! "
+      "comp.sink_1", pad_props, out_caps);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  input_memory = NULL;
+  cfilter = gst_bin_get_by_name (GST_BIN (pipeline), "cf0");
+  srcpad = gst_element_get_static_pad (cfilter, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      _store_input_memory_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (cfilter);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (sink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  buffer = gst_sample_get_buffer (sample);
+  fail_unless (input_memory != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer), 0);
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer), GST_SECOND / 25);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT));
+  if (expect_passthrough)
+    fail_unless (gst_buffer_peek_memory (buffer, 0) == input_memory);
+  else
+    fail_unless (gst_buffer_peek_memory (buffer, 0) != input_memory);
+  gst_sample_unref (sample);
+  gst_memory_unref (input_memory);
+  input_memory = NULL;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_passthrough_single_opaque_pad)
+{
+  const gchar *caps = "video/x-raw,format=I420,width=64,height=48";
+
+  /* sink_1 below sink_0 is completely covered */
+  _check_passthrough ("sink_1::zorder=0 sink_0::zorder=1", caps, TRUE);
+  /* sink_1 is invisible */
+  _check_passthrough ("sink_1::alpha=0.0", caps, TRUE);
+
+  /* sink_1 on top */
+  _check_passthrough ("", caps, FALSE);
+  _check_passthrough ("sink_1::xpos=64 sink_0::alpha=0.5", caps, FALSE);
+  _check_passthrough ("sink_1::xpos=64 sink_0::xpos=1", caps, FALSE);
+  /* Converted or scaled */
+  _check_passthrough ("sink_1::xpos=64",
+      "video/x-raw,format=Y444,width=64,height=48", FALSE);
+  _check_passthrough ("sink_1::xpos=64",
+      "video/x-raw,format=I420,width=80,height=48", FALSE);
+}
+
+GST_END_TEST;
+
 typedef struct
 {
   gint buffers_sent;
@@ -2099,9 +2590,15 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_flush_start_flush_stop);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
+  tcase_add_test (tc_chain, test_obscured_by_combination_skipped);
   tcase_add_test (tc_chain, test_repeat_after_eos);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
+  tcase_add_test (tc_chain, test_n_threads_identical_output);
+  tcase_add_test (tc_chain, test_reuse_static_inputs_identical_output);
+  tcase_add_test (tc_chain, test_parallel_prepare_frames_identical_output);
+  tcase_add_test (tc_chain, test_high_bit_depth_blend);
+  tcase_add_test (tc_chain, test_passthrough_single_opaque_pad);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3_unlinked_1);
@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -516,6 +517,196 @@ h264parse_packetized_suite (void)
   return s;
 }
 
+/* Pushes @n_frames copies of @frame through h264parse and returns all the
+ * output. With @writable, the input buffers can be converted in place,
+ * otherwise the parser has to reference their memory. With @in_place, all
+ * output buffers but the first one, which gets the codec data inserted,
+ * must end with the memory of their input buffer. */
+static GstBuffer *
+convert_frames (GstCaps * in_caps, const gchar * out_caps,
+    const guint8 * frame, gsize size, guint n_frames, gboolean writable,
+    gboolean in_place)
+{
+  GstHarness *h;
+  GstBuffer *buf, *out;
+  GstMemory **in_mems;
+  guint i;
+
+  h = gst_harness_new ("h264parse");
+  gst_harness_set_caps (h, in_caps, gst_caps_from_string (out_caps));
+
+  in_mems = g_new0 (GstMemory *, n_frames);
+  for (i = 0; i < n_frames; i++) {
+    if (writable) {
+      buf = gst_buffer_new_allocate (NULL, size, NULL);
+      gst_buffer_fill (buf, 0, frame, size);
+    } else {
+      buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (gpointer) frame, size, 0, size, NULL, NULL);
+    }
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * GST_SECOND / 25;
+    in_mems[i] = gst_memory_ref (gst_buffer_peek_memory (buf, 0));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  out = gst_buffer_new ();
+  for (i = 0; (buf = gst_harness_try_pull (h)); i++) {
+    GstMemory *last;
+
+    fail_unless (i < n_frames);
+    last = gst_buffer_peek_memory (buf, gst_buffer_n_memory (buf) - 1);
+    if (in_place && i > 0)
+      fail_unless (last == in_mems[i]);
+    else
+      fail_if (last == in_mems[i]);
+    out = gst_buffer_append (out, buf);
+  }
+  fail_unless_equals_int (i, n_frames);
+
+  for (i = 0; i < n_frames; i++)
+    gst_memory_unref (in_mems[i]);
+  g_free (in_mems);
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+static void
+assert_buffer_equals (GstBuffer * buf, const guint8 * data, gsize size)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, size);
+  fail_unless (memcmp (map.data, data, size) == 0);
+  gst_buffer_unmap (buf, &map);
+}
+
+static GstCaps *
+avc_caps_new (void)
+{
+  GstBuffer *cdata;
+  GstCaps *caps;
+
+  cdata = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      h264_avc_codec_data, sizeof (h264_avc_codec_data), 0,
+      sizeof (h264_avc_codec_data), NULL, NULL);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+
+  return caps;
+}
+
+/* appends @nal, which starts with a 4 bytes start code, to @bytes with the
+ * start code replaced by the size of the NAL */
+static void
+append_avc_nal (GByteArray * bytes, const guint8 * nal, gsize size)
+{
+  guint8 nl[4];
+
+  GST_WRITE_UINT32_BE (nl, size - 4);
+  g_byte_array_append (bytes, nl, 4);
+  g_byte_array_append (bytes, nal + 4, size - 4);
+}
+
+GST_START_TEST (test_convert_avc_to_bs)
+{
+  GstBuffer *in_place, *referenced;
+  GByteArray *frame, *expected;
+  guint i;
+
+  frame = g_byte_array_new ();
+  append_avc_nal (frame, h264_idrframe, sizeof (h264_idrframe));
+
+  /* what the parser output when copying the NALs: the codec data is
+   * inserted in the first frame and each frame starts with an AUD */
+  expected = g_byte_array_new ();
+  for (i = 0; i < 5; i++) {
+    g_byte_array_append (expected, h264_aud, sizeof (h264_aud));
+    if (i == 0) {
+      g_byte_array_append (expected, h264_sps, sizeof (h264_sps));
+      g_byte_array_append (expected, h264_pps, sizeof (h264_pps));
+    }
+    g_byte_array_append (expected, h264_idrframe, sizeof (h264_idrframe));
+  }
+
+  in_place = convert_frames (avc_caps_new (), SINK_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au",
+      frame->data, frame->len, 5, TRUE, TRUE);
+  referenced = convert_frames (avc_caps_new (), SINK_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au",
+      frame->data, frame->len, 5, FALSE, FALSE);
+
+  assert_buffer_equals (in_place, expected->data, expected->len);
+  assert_buffer_equals (referenced, expected->data, expected->len);
+
+  gst_buffer_unref (in_place);
+  gst_buffer_unref (referenced);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (frame);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_bs_to_avc)
+{
+  GstBuffer *writable, *readonly;
+  GByteArray *frame, *expected;
+  guint i;
+
+  /* an access unit with in-band SPS and PPS */
+  frame = g_byte_array_new ();
+  g_byte_array_append (frame, h264_sps, sizeof (h264_sps));
+  g_byte_array_append (frame, h264_pps, sizeof (h264_pps));
+  g_byte_array_append (frame, h264_idrframe, sizeof (h264_idrframe));
+
+  expected = g_byte_array_new ();
+  for (i = 0; i < 5; i++) {
+    append_avc_nal (expected, h264_sps, sizeof (h264_sps));
+    append_avc_nal (expected, h264_pps, sizeof (h264_pps));
+    append_avc_nal (expected, h264_idrframe, sizeof (h264_idrframe));
+  }
+
+  /* byte-stream input goes through the base class adapter, the prefixes
+   * are never rewritten in place */
+  writable = convert_frames (gst_caps_from_string (SRC_CAPS_TMPL
+          ", stream-format = (string) byte-stream, alignment = (string) au"),
+      SINK_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au",
+      frame->data, frame->len, 5, TRUE, FALSE);
+  readonly = convert_frames (gst_caps_from_string (SRC_CAPS_TMPL
+          ", stream-format = (string) byte-stream, alignment = (string) au"),
+      SINK_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au",
+      frame->data, frame->len, 5, FALSE, FALSE);
+
+  assert_buffer_equals (writable, expected->data, expected->len);
+  assert_buffer_equals (readonly, expected->data, expected->len);
+
+  gst_buffer_unref (writable);
+  gst_buffer_unref (readonly);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (frame);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_conversion_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_convert_avc_to_bs);
+  tcase_add_test (tc_chain, test_convert_bs_to_avc);
+
+  return s;
+}
+
 
 /*
  * TODO:
@@ -614,5 +805,10 @@ main (int argc, char **argv)
   s = h264parse_packetized_suite ();
   nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_packetized.c");
 
+  /* stream-format conversion, in place or referencing the input */
+  ctx_suite = "h264parse_conversion";
+  s = h264parse_conversion_suite ();
+  nf += gst_check_run_suite (s, ctx_suite, __FILE__ "_conversion.c");
+
   return nf;
 }
@@ -0,0 +1,268 @@
+/*
+ * GStreamer
+ *
+ * unit test for h265parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define SRC_CAPS_TMPL   "video/x-h265, parsed=(boolean)false"
+#define SINK_CAPS_TMPL  "video/x-h265, parsed=(boolean)true"
+
+/* a 64x64 main profile stream with 16x16 CTBs */
+
+/* VPS */
+static const guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x3c, 0xac, 0x09
+};
+
+/* SPS */
+static const guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+  0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+  0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xa0, 0x20,
+  0x81, 0x05, 0x96, 0xb5, 0xbc, 0x92, 0xe0, 0x80
+};
+
+/* PPS */
+static const guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xf0, 0x71,
+  0x81, 0x12
+};
+
+/* combines to this codec-data */
+static const guint8 h265_hvcc_codec_data[] = {
+  0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x3c, 0xf0, 0x00, 0xfc,
+  0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+  0x20, 0x00, 0x01, 0x00, 0x17,
+  0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03,
+  0x00, 0x00, 0x03, 0x00, 0x3c, 0xac, 0x09,
+  0x21, 0x00, 0x01, 0x00, 0x1c,
+  0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+  0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+  0x00, 0x3c, 0xa0, 0x20, 0x81, 0x05, 0x96, 0xb5,
+  0xbc, 0x92, 0xe0, 0x80,
+  0x22, 0x00, 0x01, 0x00, 0x06,
+  0x44, 0x01, 0xf0, 0x71, 0x81, 0x12
+};
+
+/* IDR_W_RADL slice covering the whole picture */
+static const guint8 h265_idr_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x70,
+  0xa5, 0x5a, 0x00, 0x00, 0x03, 0x01, 0x80
+};
+
+/* Pushes @n_frames copies of @frame through h265parse and returns all the
+ * output. With @writable, the input buffers can be converted in place,
+ * otherwise the parser has to reference their memory. With @in_place, all
+ * output buffers but the first one, which gets the codec data inserted,
+ * must end with the memory of their input buffer. */
+static GstBuffer *
+convert_frames (GstCaps * in_caps, const gchar * out_caps,
+    const guint8 * frame, gsize size, guint n_frames, gboolean writable,
+    gboolean in_place)
+{
+  GstHarness *h;
+  GstBuffer *buf, *out;
+  GstMemory **in_mems;
+  guint i;
+
+  h = gst_harness_new ("h265parse");
+  gst_harness_set_caps (h, in_caps, gst_caps_from_string (out_caps));
+
+  in_mems = g_new0 (GstMemory *, n_frames);
+  for (i = 0; i < n_frames; i++) {
+    if (writable) {
+      buf = gst_buffer_new_allocate (NULL, size, NULL);
+      gst_buffer_fill (buf, 0, frame, size);
+    } else {
+      buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+          (gpointer) frame, size, 0, size, NULL, NULL);
+    }
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * GST_SECOND / 25;
+    in_mems[i] = gst_memory_ref (gst_buffer_peek_memory (buf, 0));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  out = gst_buffer_new ();
+  for (i = 0; (buf = gst_harness_try_pull (h)); i++) {
+    GstMemory *last;
+
+    fail_unless (i < n_frames);
+    last = gst_buffer_peek_memory (buf, gst_buffer_n_memory (buf) - 1);
+    if (in_place && i > 0)
+      fail_unless (last == in_mems[i]);
+    else
+      fail_if (last == in_mems[i]);
+    out = gst_buffer_append (out, buf);
+  }
+  fail_unless_equals_int (i, n_frames);
+
+  for (i = 0; i < n_frames; i++)
+    gst_memory_unref (in_mems[i]);
+  g_free (in_mems);
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+static void
+assert_buffer_equals (GstBuffer * buf, const guint8 * data, gsize size)
+{
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, size);
+  fail_unless (memcmp (map.data, data, size) == 0);
+  gst_buffer_unmap (buf, &map);
+}
+
+static GstCaps *
+hvc1_caps_new (void)
+{
+  GstBuffer *cdata;
+  GstCaps *caps;
+
+  cdata = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) h265_hvcc_codec_data, sizeof (h265_hvcc_codec_data), 0,
+      sizeof (h265_hvcc_codec_data), NULL, NULL);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) hvc1, alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+
+  return caps;
+}
+
+/* appends @nal, which starts with a 4 bytes start code, to @bytes with the
+ * start code replaced by the size of the NAL */
+static void
+append_hvc1_nal (GByteArray * bytes, const guint8 * nal, gsize size)
+{
+  guint8 nl[4];
+
+  GST_WRITE_UINT32_BE (nl, size - 4);
+  g_byte_array_append (bytes, nl, 4);
+  g_byte_array_append (bytes, nal + 4, size - 4);
+}
+
+GST_START_TEST (test_convert_hvc1_to_bs)
+{
+  GstBuffer *in_place, *referenced;
+  GByteArray *frame, *expected;
+  guint i;
+
+  frame = g_byte_array_new ();
+  append_hvc1_nal (frame, h265_idr_slice, sizeof (h265_idr_slice));
+
+  /* what the parser output when copying the NALs: the codec data is
+   * inserted in the first frame only */
+  expected = g_byte_array_new ();
+  for (i = 0; i < 5; i++) {
+    if (i == 0) {
+      g_byte_array_append (expected, h265_vps, sizeof (h265_vps));
+      g_byte_array_append (expected, h265_sps, sizeof (h265_sps));
+      g_byte_array_append (expected, h265_pps, sizeof (h265_pps));
+    }
+    g_byte_array_append (expected, h265_idr_slice, sizeof (h265_idr_slice));
+  }
+
+  in_place = convert_frames (hvc1_caps_new (), SINK_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au",
+      frame->data, frame->len, 5, TRUE, TRUE);
+  referenced = convert_frames (hvc1_caps_new (), SINK_CAPS_TMPL
+      ", stream-format = (string) byte-stream, alignment = (string) au",
+      frame->data, frame->len, 5, FALSE, FALSE);
+
+  assert_buffer_equals (in_place, expected->data, expected->len);
+  assert_buffer_equals (referenced, expected->data, expected->len);
+
+  gst_buffer_unref (in_place);
+  gst_buffer_unref (referenced);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (frame);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_bs_to_hvc1)
+{
+  GstBuffer *writable, *readonly;
+  GByteArray *frame, *expected;
+  guint i;
+
+  /* an access unit with in-band VPS, SPS and PPS */
+  frame = g_byte_array_new ();
+  g_byte_array_append (frame, h265_vps, sizeof (h265_vps));
+  g_byte_array_append (frame, h265_sps, sizeof (h265_sps));
+  g_byte_array_append (frame, h265_pps, sizeof (h265_pps));
+  g_byte_array_append (frame, h265_idr_slice, sizeof (h265_idr_slice));
+
+  expected = g_byte_array_new ();
+  for (i = 0; i < 5; i++) {
+    append_hvc1_nal (expected, h265_vps, sizeof (h265_vps));
+    append_hvc1_nal (expected, h265_sps, sizeof (h265_sps));
+    append_hvc1_nal (expected, h265_pps, sizeof (h265_pps));
+    append_hvc1_nal (expected, h265_idr_slice, sizeof (h265_idr_slice));
+  }
+
+  /* byte-stream input goes through the base class adapter, the prefixes
+   * are never rewritten in place */
+  writable = convert_frames (gst_caps_from_string (SRC_CAPS_TMPL
+          ", stream-format = (string) byte-stream, alignment = (string) au"),
+      SINK_CAPS_TMPL
+      ", stream-format = (string) hvc1, alignment = (string) au",
+      frame->data, frame->len, 5, TRUE, FALSE);
+  readonly = convert_frames (gst_caps_from_string (SRC_CAPS_TMPL
+          ", stream-format = (string) byte-stream, alignment = (string) au"),
+      SINK_CAPS_TMPL
+      ", stream-format = (string) hvc1, alignment = (string) au",
+      frame->data, frame->len, 5, FALSE, FALSE);
+
+  assert_buffer_equals (writable, expected->data, expected->len);
+  assert_buffer_equals (readonly, expected->data, expected->len);
+
+  gst_buffer_unref (writable);
+  gst_buffer_unref (readonly);
+  g_byte_array_unref (expected);
+  g_byte_array_unref (frame);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parse_suite (void)
+{
+  Suite *s = suite_create ("h265parse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_convert_hvc1_to_bs);
+  tcase_add_test (tc_chain, test_convert_bs_to_hvc1);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parse);
@@ -724,6 +724,387 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+typedef struct _GstHlsDemuxTestPrefetchContext
+{
+  GstHlsDemuxTestCase *test_case;
+  GMutex lock;
+  GCond cond;
+  gboolean last_fragment_requested;
+} GstHlsDemuxTestPrefetchContext;
+
+static gboolean
+gst_hlsdemux_test_prefetch_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxTestPrefetchContext *context =
+      (GstHlsDemuxTestPrefetchContext *) user_data;
+  gboolean ret;
+
+  /* the prefetched fragments are requested from several threads */
+  g_mutex_lock (&context->lock);
+  if (g_str_has_suffix (uri, "003.ts")) {
+    context->last_fragment_requested = TRUE;
+    g_cond_broadcast (&context->cond);
+  }
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, context->test_case);
+  g_mutex_unlock (&context->lock);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hlsdemux_test_prefetch_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstHlsDemuxTestPrefetchContext *prefetch =
+      (GstHlsDemuxTestPrefetchContext *) user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+
+  /* only answer the first fragment once the last one was requested, which
+   * can only happen if they are downloaded in parallel */
+  if (g_str_has_suffix (input->uri, "001.ts") && offset == 0) {
+    gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    g_mutex_lock (&prefetch->lock);
+    while (!prefetch->last_fragment_requested) {
+      if (!g_cond_wait_until (&prefetch->cond, &prefetch->lock, end_time))
+        break;
+    }
+    fail_unless (prefetch->last_fragment_requested,
+        "The next fragments were not requested in parallel");
+    g_mutex_unlock (&prefetch->lock);
+  }
+
+  return gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      prefetch->test_case);
+}
+
+static void
+testPrefetchPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-depth", 2, NULL);
+}
+
+/*
+ * Test downloading the next fragments in advance
+ * The first fragment only arrives once the third one was requested, and
+ * the fragments must still be output in order.
+ */
+GST_START_TEST (testPrefetch)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 3 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstHlsDemuxTestPrefetchContext context = { 0, };
+  GByteArray *fragments;
+  guint i, pos;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  /* give each fragment a different payload to check their order */
+  fragments = g_byte_array_sized_new (3 * segment_size);
+  for (i = 0; i < 3; i++) {
+    g_byte_array_append (fragments, mpeg_ts->data, segment_size);
+    for (pos = 0; pos < segment_size; pos += TS_PACKET_LEN)
+      fragments->data[i * segment_size + pos + 4] = i;
+    inputTestData[i + 1].payload = fragments->data + i * segment_size;
+  }
+  outputTestData[0].expected_data = fragments->data;
+
+  context.test_case = &hlsTestCase;
+  g_mutex_init (&context.lock);
+  g_cond_init (&context.cond);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_prefetch_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_prefetch_src_create;
+  engine_callbacks.pre_test = testPrefetchPreTestCallback;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &context);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  fail_unless (context.last_fragment_requested);
+
+  g_mutex_clear (&context.lock);
+  g_cond_clear (&context.cond);
+  g_byte_array_free (fragments, TRUE);
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
+/* One step of a recorded bandwidth trace, 0 ms lasting until the end */
+typedef struct _GstHlsDemuxTestTraceStep
+{
+  guint duration_ms;
+  guint kbps;
+} GstHlsDemuxTestTraceStep;
+
+typedef struct _GstHlsDemuxTestTraceContext
+{
+  GstHlsDemuxTestCase *test_case;
+  const GstHlsDemuxTestTraceStep *trace;
+  GMutex lock;
+  gint64 start_time;            /* time of the first fragment request */
+} GstHlsDemuxTestTraceContext;
+
+/* a fast link while the first fragments are downloaded, then a link too
+ * slow for anything but the lowest variant */
+static const GstHlsDemuxTestTraceStep abr_test_trace[] = {
+  {100, 2000},
+  {0, 200}
+};
+
+/* a link fast enough for the middle variant, but not for the highest one */
+static const GstHlsDemuxTestTraceStep abr_test_constant_trace[] = {
+  {0, 1000}
+};
+
+static gboolean
+gst_hlsdemux_test_trace_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxTestTraceContext *context =
+      (GstHlsDemuxTestTraceContext *) user_data;
+  gboolean ret;
+
+  g_mutex_lock (&context->lock);
+  if (context->start_time == 0 && g_str_has_suffix (uri, ".ts"))
+    context->start_time = g_get_monotonic_time ();
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, context->test_case);
+  g_mutex_unlock (&context->lock);
+
+  return ret;
+}
+
+/* Delivers the data at the bandwidth the trace has at the current time */
+static GstFlowReturn
+gst_hlsdemux_test_trace_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstHlsDemuxTestTraceContext *trace =
+      (GstHlsDemuxTestTraceContext *) user_data;
+  const GstHlsDemuxTestTraceStep *step = trace->trace;
+  gint64 elapsed = 0;
+
+  g_mutex_lock (&trace->lock);
+  if (trace->start_time != 0)
+    elapsed = (g_get_monotonic_time () - trace->start_time) / 1000;
+  g_mutex_unlock (&trace->lock);
+
+  while (step->duration_ms != 0 && elapsed >= step->duration_ms) {
+    elapsed -= step->duration_ms;
+    step++;
+  }
+
+  g_usleep ((guint64) length * 8 * 1000 / step->kbps);
+
+  return gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      trace->test_case);
+}
+
+/* 4 seconds long fragments, so that a few of them are enough to fill the
+ * buffer of the buffer based algorithm */
+#define ABR_TEST_MEDIA_PLAYLIST(variant) \
+  "#EXTM3U \n" \
+  "#EXT-X-TARGETDURATION:4\n" \
+  "#EXTINF:4,Test\n" variant "/001.ts\n" \
+  "#EXTINF:4,Test\n" variant "/002.ts\n" \
+  "#EXTINF:4,Test\n" variant "/003.ts\n" \
+  "#EXTINF:4,Test\n" variant "/004.ts\n" \
+  "#EXTINF:4,Test\n" variant "/005.ts\n" \
+  "#EXTINF:4,Test\n" variant "/006.ts\n" \
+  "#EXTINF:4,Test\n" variant "/007.ts\n" \
+  "#EXTINF:4,Test\n" variant "/008.ts\n" "#EXT-X-ENDLIST\n"
+
+#define ABR_TEST_INPUT_DATA(variant) \
+  {"http://unit.test/" variant ".m3u8", \
+        (guint8 *) ABR_TEST_MEDIA_PLAYLIST (variant), 0}, \
+  {"http://unit.test/" variant "/001.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/002.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/003.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/004.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/005.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/006.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/007.ts", NULL, segment_size}, \
+  {"http://unit.test/" variant "/008.ts", NULL, segment_size}
+
+/* Answers the position queries of the demuxer as if downstream had not
+ * started playing yet, so that everything that was pushed is buffered */
+static GstPadProbeReturn
+gst_hlsdemux_test_stalled_position_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+  GstFormat format;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_POSITION)
+    return GST_PAD_PROBE_OK;
+
+  gst_query_parse_position (query, &format, NULL);
+  if (format != GST_FORMAT_TIME)
+    return GST_PAD_PROBE_OK;
+
+  gst_query_set_position (query, GST_FORMAT_TIME, 0);
+  return GST_PAD_PROBE_HANDLED;
+}
+
+static void
+gst_hlsdemux_test_stall_sink (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  GstPad *pad;
+
+  pad = gst_element_get_static_pad (GST_ELEMENT (stream->appsink), "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM,
+      gst_hlsdemux_test_stalled_position_probe, NULL, NULL);
+  gst_object_unref (pad);
+}
+
+/*
+ * Plays a master playlist with 3 variants over the bandwidth @trace, and
+ * checks that the demuxer switched up at some point and that the last
+ * fragment was downloaded from @last_variant. With @stalled_sink, the
+ * position of the appsink stays at 0, so the buffer level grows by the
+ * duration of each fragment
+ */
+static void
+run_abr_trace_test (void (*pre_test) (GstAdaptiveDemuxTestEngine * engine,
+        gpointer user_data), const GstHlsDemuxTestTraceStep * trace,
+    gboolean stalled_sink, const gchar * last_variant)
+{
+  const guint segment_size = 40 * TS_PACKET_LEN;
+  const gchar *master_playlist =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:4\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=100000\n"
+      "low.m3u8\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=500000\n"
+      "mid.m3u8\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=1200000\n" "high.m3u8\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/master.m3u8", (guint8 *) master_playlist, 0},
+    ABR_TEST_INPUT_DATA ("low"),
+    ABR_TEST_INPUT_DATA ("mid"),
+    ABR_TEST_INPUT_DATA ("high"),
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 8 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstHlsDemuxTestTraceContext context = { 0, };
+  const GValue *requests;
+  const gchar *last_fragment = NULL;
+  gchar *last_prefix;
+  gboolean switched_up = FALSE;
+  guint i;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  context.test_case = &hlsTestCase;
+  context.trace = trace;
+  g_mutex_init (&context.lock);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_trace_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_trace_src_create;
+  engine_callbacks.pre_test = pre_test;
+  if (stalled_sink)
+    engine_callbacks.demux_pad_added = gst_hlsdemux_test_stall_sink;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &context);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  requests = gst_structure_get_value (hlsTestCase.state, "requests");
+  fail_unless (requests != NULL);
+  for (i = 0; i < gst_value_array_get_size (requests); i++) {
+    const gchar *uri =
+        g_value_get_string (gst_value_array_get_value (requests, i));
+
+    if (!g_str_has_suffix (uri, ".ts"))
+      continue;
+    if (!g_str_has_prefix (uri, "http://unit.test/low/"))
+      switched_up = TRUE;
+    last_fragment = uri;
+  }
+  fail_unless (switched_up, "Never switched to a higher variant");
+  fail_unless (last_fragment != NULL);
+  last_prefix = g_strdup_printf ("http://unit.test/%s/", last_variant);
+  fail_unless (g_str_has_prefix (last_fragment, last_prefix),
+      "Ended on the wrong variant: %s", last_fragment);
+  g_free (last_prefix);
+
+  g_mutex_clear (&context.lock);
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+static void
+testAbrThroughputPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  gst_util_set_object_arg (G_OBJECT (engine->demux), "abr-algorithm",
+      "throughput");
+}
+
+static void
+testAbrBufferBasedPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  gst_util_set_object_arg (G_OBJECT (engine->demux), "abr-algorithm",
+      "buffer-based");
+}
+
+/*
+ * Test the throughput based bitrate adaptation over a bandwidth trace: it
+ * switches up while the link is fast and ends on the lowest variant once it
+ * became slow
+ */
+GST_START_TEST (testAbrThroughput)
+{
+  run_abr_trace_test (testAbrThroughputPreTestCallback, abr_test_trace,
+      FALSE, "low");
+}
+
+GST_END_TEST;
+
+/*
+ * Test the buffer based bitrate adaptation. Downstream doesn't consume
+ * anything, so the buffer level passes the minimum level of 10 seconds once
+ * 4 fragments were pushed and reaches the buffer target of 16 seconds with
+ * the 5th one. The link only allows the middle variant, but from there on
+ * BOLA picks the highest one because the buffer is full enough
+ */
+GST_START_TEST (testAbrBufferBased)
+{
+  run_abr_trace_test (testAbrBufferBasedPreTestCallback,
+      abr_test_constant_trace, TRUE, "high");
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -735,6 +1116,9 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testMediaPlaylistNotFound);
   tcase_add_test (tc_basicTest, testFragmentNotFound);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
+  tcase_add_test (tc_basicTest, testPrefetch);
+  tcase_add_test (tc_basicTest, testAbrThroughput);
+  tcase_add_test (tc_basicTest, testAbrBufferBased);
   tcase_add_test (tc_basicTest, testSeek);
   tcase_add_test (tc_basicTest, testSeekKeyUnitPosition);
   tcase_add_test (tc_basicTest, testSeekPosition);
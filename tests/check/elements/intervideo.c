@@ -0,0 +1,281 @@
+/* GStreamer
+ *
+ * unit test for intervideosink and intervideosrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define VIDEO_CAPS \
+  "video/x-raw, format = (string) GRAY8, width = (int) 8, " \
+  "height = (int) 8, framerate = (fraction) 30/1"
+#define FRAME_SIZE (8 * 8)
+#define LARGE_VIDEO_CAPS \
+  "video/x-raw, format = (string) GRAY8, width = (int) 16, " \
+  "height = (int) 16, framerate = (fraction) 30/1"
+#define LARGE_FRAME_SIZE (16 * 16)
+
+/* The frames of the sink are filled with FRAME_VALUE + their index, the
+ * black frames of the sources are darker */
+#define FRAME_VALUE 0x80
+
+/* Neither element gets a clock outside of a pipeline, so the sources take
+ * the frames of the sink in order and don't wait between frames */
+static GstHarness *
+sink_new (guint max_frames)
+{
+  GstHarness *h;
+
+  h = gst_harness_new ("intervideosink");
+  g_object_set (h->element, "sync", FALSE, "max-frames", max_frames, NULL);
+  gst_harness_set_src_caps_str (h, VIDEO_CAPS);
+
+  return h;
+}
+
+static GstHarness *
+src_new (void)
+{
+  GstHarness *h;
+
+  h = gst_harness_new ("intervideosrc");
+  gst_harness_set_sink_caps_str (h, VIDEO_CAPS);
+  gst_harness_play (h);
+
+  return h;
+}
+
+static GstBuffer *
+frame_new_sized (guint index, gsize size)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_memset (buf, 0, FRAME_VALUE + index, size);
+  GST_BUFFER_PTS (buf) = index * GST_SECOND / 30;
+  GST_BUFFER_DURATION (buf) = GST_SECOND / 30;
+
+  return buf;
+}
+
+static GstBuffer *
+frame_new (guint index)
+{
+  return frame_new_sized (index, FRAME_SIZE);
+}
+
+static void
+push_frames (GstHarness * sink, guint n_frames)
+{
+  guint i;
+
+  for (i = 0; i < n_frames; i++)
+    fail_unless_equals_int (gst_harness_push (sink, frame_new (i)),
+        GST_FLOW_OK);
+}
+
+/* Pulls from @src until @n_frames frames of the sink were output for the
+ * first time and checks that they are the frames @first to
+ * @first + @n_frames - 1. Repeated and black frames are skipped. */
+static void
+pull_frames (GstHarness * src, guint first, guint n_frames)
+{
+  guint n = 0;
+
+  while (n < n_frames) {
+    GstBuffer *buf = gst_harness_pull (src);
+    guint8 value;
+
+    fail_unless (buf != NULL);
+    if (gst_buffer_get_size (buf) == FRAME_SIZE
+        && !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP)) {
+      gst_buffer_extract (buf, 0, &value, 1);
+      if (value >= FRAME_VALUE) {
+        fail_unless_equals_int (value - FRAME_VALUE, first + n);
+        n++;
+      }
+    }
+    gst_buffer_unref (buf);
+  }
+}
+
+static void
+check_stats (GstHarness * src, guint64 new_frames, guint64 dropped_frames)
+{
+  GstStructure *stats;
+  guint64 value;
+
+  g_object_get (src->element, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "new-frames", &value));
+  fail_unless_equals_uint64 (value, new_frames);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-frames", &value));
+  fail_unless_equals_uint64 (value, dropped_frames);
+  gst_structure_free (stats);
+}
+
+GST_START_TEST (test_burst_in_order)
+{
+  GstHarness *sink, *src;
+
+  sink = sink_new (8);
+  src = src_new ();
+
+  /* the source may be slower than the sink, but it doesn't fall behind by
+   * more than max-frames */
+  push_frames (sink, 8);
+  pull_frames (src, 0, 8);
+  check_stats (src, 8, 0);
+
+  gst_harness_teardown (src);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_two_sources)
+{
+  GstHarness *sink, *src1, *src2;
+
+  sink = sink_new (8);
+  src1 = src_new ();
+  src2 = src_new ();
+
+  /* both sources get all the frames, reading doesn't take them away */
+  push_frames (sink, 8);
+  pull_frames (src1, 0, 8);
+  pull_frames (src2, 0, 8);
+  check_stats (src1, 8, 0);
+  check_stats (src2, 8, 0);
+
+  gst_harness_teardown (src2);
+  gst_harness_teardown (src1);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_dropped_frames)
+{
+  GstHarness *sink, *src;
+
+  sink = sink_new (2);
+  src = src_new ();
+
+  /* a live source doesn't create frames while paused, so the sink laps the
+   * source: only the last 2 frames are left for it */
+  gst_element_set_state (src->element, GST_STATE_PAUSED);
+  push_frames (sink, 6);
+  gst_element_set_state (src->element, GST_STATE_PLAYING);
+
+  pull_frames (src, 4, 2);
+  check_stats (src, 2, 4);
+
+  gst_harness_teardown (src);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_lower_max_frames)
+{
+  GstHarness *sink;
+  GstBuffer *frames[8];
+  guint i;
+
+  sink = sink_new (8);
+
+  for (i = 0; i < 8; i++) {
+    frames[i] = frame_new (i);
+    fail_unless_equals_int (gst_harness_push (sink,
+            gst_buffer_ref (frames[i])), GST_FLOW_OK);
+  }
+
+  /* the frames that don't fit anymore are released right away */
+  g_object_set (sink->element, "max-frames", 2, NULL);
+  for (i = 0; i < 6; i++)
+    ASSERT_MINI_OBJECT_REFCOUNT (frames[i], "frame", 1);
+  for (i = 6; i < 8; i++)
+    fail_unless (GST_MINI_OBJECT_REFCOUNT_VALUE (frames[i]) > 1);
+
+  gst_harness_teardown (sink);
+  for (i = 0; i < 8; i++)
+    gst_buffer_unref (frames[i]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_caps_change)
+{
+  GstHarness *sink, *src;
+  guint i, n = 0;
+
+  sink = sink_new (8);
+  src = gst_harness_new ("intervideosrc");
+  gst_harness_set_sink_caps_str (src,
+      "video/x-raw, format = (string) GRAY8, framerate = (fraction) 30/1");
+  gst_harness_play (src);
+
+  /* the frames of the old caps are still queued when the caps change */
+  gst_element_set_state (src->element, GST_STATE_PAUSED);
+  push_frames (sink, 3);
+  gst_harness_set_src_caps_str (sink, LARGE_VIDEO_CAPS);
+  for (i = 3; i < 5; i++)
+    fail_unless_equals_int (gst_harness_push (sink,
+            frame_new_sized (i, LARGE_FRAME_SIZE)), GST_FLOW_OK);
+  gst_element_set_state (src->element, GST_STATE_PLAYING);
+
+  /* the source renegotiates and only outputs the frames of the new caps */
+  while (n < 2) {
+    GstBuffer *buf = gst_harness_pull (src);
+    guint8 value;
+
+    fail_unless (buf != NULL);
+    gst_buffer_extract (buf, 0, &value, 1);
+    if (value >= FRAME_VALUE
+        && !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP)) {
+      fail_unless_equals_int (gst_buffer_get_size (buf), LARGE_FRAME_SIZE);
+      fail_unless_equals_int (value - FRAME_VALUE, 3 + n);
+      n++;
+    }
+    gst_buffer_unref (buf);
+  }
+  check_stats (src, 2, 3);
+
+  gst_harness_teardown (src);
+  gst_harness_teardown (sink);
+}
+
+GST_END_TEST;
+
+static Suite *
+intervideo_suite (void)
+{
+  Suite *s = suite_create ("intervideo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_burst_in_order);
+  tcase_add_test (tc_chain, test_two_sources);
+  tcase_add_test (tc_chain, test_dropped_frames);
+  tcase_add_test (tc_chain, test_lower_max_frames);
+  tcase_add_test (tc_chain, test_caps_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (intervideo);
@@ -21,6 +21,7 @@
 #include <gst/check/gstcheck.h>
 #include <string.h>
 #include <gst/video/video.h>
+#include <gst/base/gstadapter.h>
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -803,6 +804,357 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+static void
+test_aggregation_check_output (GList * bufs)
+{
+  guint n_bufs = g_list_length (bufs), n_packets = 0;
+
+  GST_LOG ("%u buffers", n_bufs);
+  for (; bufs != NULL; bufs = bufs->next) {
+    GstBuffer *buf = bufs->data;
+    guint8 header[4];
+    gsize size;
+
+    size = gst_buffer_get_size (buf);
+    GST_LOG ("buffer, size = %5u", (guint) size);
+    fail_unless (size > 0 && size % 188 == 0);
+    n_packets += size / 188;
+
+    /* keyframes start a new buffer */
+    if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+      gst_buffer_extract (buf, 0, header, 4);
+      fail_unless (header[1] & 0x40);
+    }
+  }
+
+  /* packets are output several at a time */
+  fail_unless (n_packets >= 4 * n_bufs);
+}
+
+GST_START_TEST (test_aggregation)
+{
+  check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
+      "sink_%d", test_aggregation_check_output, 50, 30000, 0);
+}
+
+GST_END_TEST;
+
+#define CBR_BITRATE 2000000
+#define CBR_PACKET_TICKS (188 * 8 * G_GUINT64_CONSTANT (27000000) / CBR_BITRATE)
+
+GST_START_TEST (test_cbr)
+{
+  GstElement *mux;
+  GstCaps *caps;
+  GstAdapter *adapter;
+  GstClockTime last_pts = 0;
+  gchar *padname;
+  const guint8 *data;
+  guint64 first_pcr = 0, last_pcr = 0;
+  guint n_packets, n_null = 0, n_pcr = 0, first_pcr_packet = 0, i;
+  GList *l;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", (guint64) CBR_BITRATE, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 3000 byte frames at 25 fps need less than a third of the bitrate */
+  for (i = 0; i < 50; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (3000);
+
+    gst_buffer_memset (inbuffer, 0, 0, 3000);
+    GST_BUFFER_PTS (inbuffer) = GST_BUFFER_DTS (inbuffer) =
+        i * 40 * GST_MSECOND;
+    if (i % KEYFRAME_DISTANCE != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* buffers are timestamped with their sending time */
+  adapter = gst_adapter_new ();
+  for (l = buffers; l; l = l->next) {
+    GstBuffer *buf = l->data;
+
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    fail_unless (GST_BUFFER_PTS (buf) >= last_pts);
+    last_pts = GST_BUFFER_PTS (buf);
+    gst_adapter_push (adapter, gst_buffer_ref (buf));
+  }
+  /* the last frame is sent shortly before its DTS */
+  fail_unless (last_pts > 1800 * GST_MSECOND && last_pts <= 2 * GST_SECOND);
+
+  n_packets = gst_adapter_available (adapter) / 188;
+  fail_unless_equals_int (gst_adapter_available (adapter), n_packets * 188);
+  data = gst_adapter_map (adapter, n_packets * 188);
+
+  for (i = 0; i < n_packets; i++, data += 188) {
+    guint pid;
+    guint64 pcr, expected;
+
+    fail_unless_equals_int (data[0], 0x47);
+    pid = GST_READ_UINT16_BE (data + 1) & 0x1fff;
+    if (pid == 0x1fff) {
+      n_null++;
+      continue;
+    }
+
+    /* adaptation field with PCR_flag */
+    if (!(data[3] & 0x20) || data[4] == 0 || !(data[5] & 0x10))
+      continue;
+
+    pcr = (((guint64) GST_READ_UINT32_BE (data + 6)) << 1 | data[10] >> 7) *
+        300 + (GST_READ_UINT16_BE (data + 10) & 0x1ff);
+
+    if (n_pcr == 0) {
+      first_pcr = pcr;
+      first_pcr_packet = i;
+    } else {
+      /* the PCR is the position of the packet on the bitrate timeline */
+      expected = first_pcr + gst_util_uint64_scale ((i - first_pcr_packet) *
+          188 * 8, 27000000, CBR_BITRATE);
+      fail_unless (pcr + 1 >= expected && pcr <= expected + 1,
+          "PCR %" G_GUINT64_FORMAT " of packet %u is off by %"
+          G_GINT64_FORMAT, pcr, i, (gint64) (pcr - expected));
+
+      /* at most 40ms between PCRs, plus the PAT and PMT sent in between */
+      fail_unless (pcr - last_pcr <= 27000000 / 25 + 4 * CBR_PACKET_TICKS,
+          "%" G_GUINT64_FORMAT " ticks between PCRs", pcr - last_pcr);
+    }
+    last_pcr = pcr;
+    n_pcr++;
+  }
+
+  gst_adapter_unmap (adapter);
+  gst_object_unref (adapter);
+
+  fail_unless (n_pcr >= 40);
+  /* the stream takes less than a third of the bitrate */
+  fail_unless (n_null > n_packets / 2);
+  /* and 2 seconds of it are output */
+  fail_unless (n_packets * 188 * 8 > CBR_BITRATE * 19 / 10);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_cbr_timestamp_jump)
+{
+  GstElement *mux;
+  GstCaps *caps;
+  GstAdapter *adapter;
+  gchar *padname;
+  const guint8 *data;
+  guint n_packets, n_discont_pcr = 0, i;
+  GList *l;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", (guint64) CBR_BITRATE, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* the timestamps jump by 100 seconds after 10 frames */
+  for (i = 0; i < 20; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (3000);
+    GstClockTime ts = i * 40 * GST_MSECOND;
+
+    if (i >= 10)
+      ts += 100 * GST_SECOND;
+    gst_buffer_memset (inbuffer, 0, 0, 3000);
+    GST_BUFFER_PTS (inbuffer) = GST_BUFFER_DTS (inbuffer) = ts;
+    if (i % KEYFRAME_DISTANCE != 0)
+      GST_BUFFER_FLAG_SET (inbuffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  adapter = gst_adapter_new ();
+  for (l = buffers; l; l = l->next)
+    gst_adapter_push (adapter, gst_buffer_ref (GST_BUFFER (l->data)));
+
+  /* the jump is not filled with null packets, the output only covers the
+   * 800ms of frames */
+  n_packets = gst_adapter_available (adapter) / 188;
+  fail_unless (n_packets * 188 * 8 < CBR_BITRATE * 2);
+  data = gst_adapter_map (adapter, n_packets * 188);
+
+  for (i = 0; i < n_packets; i++, data += 188) {
+    /* adaptation field with discontinuity_indicator and PCR_flag */
+    if ((data[3] & 0x20) && data[4] != 0 && (data[5] & 0x90) == 0x90)
+      n_discont_pcr++;
+  }
+  fail_unless_equals_int (n_discont_pcr, 1);
+
+  gst_adapter_unmap (adapter);
+  gst_object_unref (adapter);
+
+  gst_check_drop_buffers ();
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GByteArray *data;
+  GArray *timestamps;
+} MuxOutput;
+
+static GstFlowReturn
+mux_output_chain_func (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  MuxOutput *output = gst_pad_get_element_private (pad);
+  GstClockTime pts = GST_BUFFER_PTS (buffer);
+  GstMapInfo map;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_byte_array_append (output->data, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  g_array_append_val (output->timestamps, pts);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gpointer
+push_stream_thread (gpointer user_data)
+{
+  GstPad *pad = user_data;
+  gboolean video = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (pad),
+          "video"));
+  guint i;
+
+  for (i = 0; i < 100; i++) {
+    GstBuffer *buf;
+    gsize size;
+
+    size = video ? 1000 + (i * 7919) % 30000 : 100 + (i * 31) % 300;
+    buf = gst_buffer_new_and_alloc (size);
+    gst_buffer_memset (buf, 0, i, size);
+    GST_BUFFER_PTS (buf) = i * (video ? 40 : 24) * GST_MSECOND;
+    if (video && i % KEYFRAME_DISTANCE != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (gst_pad_push (pad, buf) != GST_FLOW_OK)
+      break;
+  }
+  gst_pad_push_event (pad, gst_event_new_eos ());
+
+  return NULL;
+}
+
+/* Muxes two video and one audio stream, pushed from their own threads */
+static void
+mux_streams (guint n_threads, MuxOutput * output)
+{
+  const gchar *caps_strings[] = { VIDEO_CAPS_STRING, VIDEO_CAPS_STRING,
+    AUDIO_CAPS_STRING
+  };
+  GstElement *mux;
+  GstPad *srcpads[3], *sinkpad, *mux_src;
+  GThread *threads[3];
+  GstSegment segment;
+  guint i;
+
+  output->data = g_byte_array_new ();
+  output->timestamps = g_array_new (FALSE, FALSE, sizeof (GstClockTime));
+
+  mux = gst_element_factory_make ("mpegtsmux", NULL);
+  g_object_set (mux, "n-threads", n_threads, NULL);
+
+  sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (sinkpad, mux_output_chain_func);
+  gst_pad_set_element_private (sinkpad, output);
+  gst_pad_set_active (sinkpad, TRUE);
+  mux_src = gst_element_get_static_pad (mux, "src");
+  fail_unless (gst_pad_link (mux_src, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (mux_src);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  for (i = 0; i < 3; i++) {
+    GstPad *mux_sink;
+
+    srcpads[i] = gst_pad_new_from_static_template (i < 2 ?
+        &video_src_template : &audio_src_template, "src");
+    g_object_set_data (G_OBJECT (srcpads[i]), "video", GINT_TO_POINTER (i < 2));
+    gst_pad_set_active (srcpads[i], TRUE);
+    mux_sink = gst_element_get_request_pad (mux, "sink_%d");
+    fail_unless (gst_pad_link (srcpads[i], mux_sink) == GST_PAD_LINK_OK);
+    gst_object_unref (mux_sink);
+  }
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < 3; i++) {
+    GstCaps *caps = gst_caps_from_string (caps_strings[i]);
+    gchar *stream_id = g_strdup_printf ("%u", i);
+
+    gst_pad_push_event (srcpads[i], gst_event_new_stream_start (stream_id));
+    gst_pad_push_event (srcpads[i], gst_event_new_caps (caps));
+    gst_pad_push_event (srcpads[i], gst_event_new_segment (&segment));
+    gst_caps_unref (caps);
+    g_free (stream_id);
+  }
+
+  for (i = 0; i < 3; i++)
+    threads[i] = g_thread_new ("push", push_stream_thread, srcpads[i]);
+  for (i = 0; i < 3; i++)
+    g_thread_join (threads[i]);
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  for (i = 0; i < 3; i++)
+    gst_object_unref (srcpads[i]);
+  gst_object_unref (sinkpad);
+  gst_object_unref (mux);
+}
+
+GST_START_TEST (test_threads)
+{
+  MuxOutput serial, threaded;
+  guint i;
+
+  mux_streams (1, &serial);
+  mux_streams (4, &threaded);
+
+  fail_unless (serial.data->len > 0);
+  fail_unless_equals_int (serial.data->len % 188, 0);
+
+  /* packetising on several threads doesn't change the output */
+  fail_unless_equals_int (threaded.data->len, serial.data->len);
+  fail_unless (memcmp (threaded.data->data, serial.data->data,
+          serial.data->len) == 0);
+  fail_unless_equals_int (threaded.timestamps->len, serial.timestamps->len);
+  for (i = 0; i < serial.timestamps->len; i++) {
+    fail_unless_equals_uint64 (g_array_index (threaded.timestamps,
+            GstClockTime, i), g_array_index (serial.timestamps, GstClockTime,
+            i));
+  }
+
+  g_byte_array_unref (serial.data);
+  g_byte_array_unref (threaded.data);
+  g_array_unref (serial.timestamps);
+  g_array_unref (threaded.timestamps);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +1171,10 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_aggregation);
+  tcase_add_test (tc_chain, test_cbr);
+  tcase_add_test (tc_chain, test_cbr_timestamp_jump);
+  tcase_add_test (tc_chain, test_threads);
 
   return s;
 }
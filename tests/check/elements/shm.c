@@ -24,8 +24,12 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+#include <gst/video/video.h>
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -42,7 +46,7 @@ GstElement *src, *sink;
 GstPad *sinkpad, *srcpad;
 
 static void
-setup_shm (void)
+setup_shm_with_ring_size (guint ring_size)
 {
   gchar *socket_path = NULL;
 
@@ -52,7 +56,8 @@ setup_shm (void)
   srcpad = gst_check_setup_src_pad (sink, &src_template);
   sinkpad = gst_check_setup_sink_pad (src, &sink_template);
 
-  g_object_set (sink, "socket-path", "shm-unit-test", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "ring-size", ring_size,
+      NULL);
 
   fail_unless (gst_element_set_state (sink, GST_STATE_PLAYING) ==
       GST_STATE_CHANGE_ASYNC);
@@ -69,6 +74,18 @@ setup_shm (void)
       GST_STATE_CHANGE_SUCCESS);
 }
 
+static void
+setup_shm (void)
+{
+  setup_shm_with_ring_size (0);
+}
+
+static void
+setup_shm_ring (void)
+{
+  setup_shm_with_ring_size (256);
+}
+
 static void
 teardown_shm (void)
 {
@@ -169,6 +186,150 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_many_buffers)
+{
+  GstSegment segment;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 100; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+
+    gst_buffer_memset (buf, 0, i, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 100)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (i = 0; i < 100; i++) {
+    GstBuffer *buf = g_list_nth_data (buffers, i);
+    guint8 data;
+
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    gst_buffer_extract (buf, 999, &data, 1);
+    fail_unless_equals_int (data, i);
+  }
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_alloc_pool)
+{
+  GstQuery *query;
+  GstCaps *caps;
+  GstVideoInfo info;
+  GstAllocator *alloc, *pool_alloc;
+  GstBufferPool *pool;
+  GstStructure *config;
+  guint size, min, max;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 320, 240);
+  caps = gst_video_info_to_caps (&info);
+
+  query = gst_query_new_allocation (caps, TRUE);
+  gst_caps_unref (caps);
+
+  fail_unless (gst_pad_peer_query (srcpad, query));
+
+  fail_unless (gst_query_get_n_allocation_params (query) == 1);
+  gst_query_parse_nth_allocation_param (query, 0, &alloc, NULL);
+  fail_unless (alloc != NULL);
+
+  /* A pool of frames from the shm area, bounded by its size */
+  fail_unless (gst_query_get_n_allocation_pools (query) == 1);
+  gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+  fail_unless (pool != NULL);
+  fail_unless_equals_int (size, info.size);
+  fail_unless (max >= 2);
+
+  config = gst_buffer_pool_get_config (pool);
+  fail_unless (gst_buffer_pool_config_get_allocator (config, &pool_alloc,
+          NULL));
+  fail_unless (pool_alloc == alloc);
+  gst_structure_free (config);
+
+  gst_object_unref (pool);
+  gst_object_unref (alloc);
+  gst_query_unref (query);
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_fd_memory)
+{
+  GstAllocator *fd_alloc;
+  GstMemory *mem;
+  GstSegment segment;
+  gchar *filename = NULL;
+  guint shm_size;
+  gsize size;
+  gint fd, i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* Larger than the shm area, so it can't have been copied into it */
+  g_object_get (sink, "shm-size", &shm_size, NULL);
+  size = shm_size + 4096;
+
+  fd = g_file_open_tmp ("shm-unit-test-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_unlink (filename);
+  g_free (filename);
+  fail_unless (ftruncate (fd, size) == 0);
+  for (i = 0; i < 10; i++) {
+    guint8 data = i;
+
+    fail_unless (pwrite (fd, &data, 1, i * 4096) == 1);
+  }
+
+  fd_alloc = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (fd_alloc, fd, size, GST_FD_MEMORY_FLAG_NONE);
+  gst_object_unref (fd_alloc);
+
+  /* Buffers of different parts of the same memory, which is only passed
+   * once to shmsrc */
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = gst_buffer_new ();
+
+    gst_buffer_append_memory (buf, gst_memory_share (mem, i * 4096,
+            size - i * 4096));
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+  gst_memory_unref (mem);
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 10)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = g_list_nth_data (buffers, i);
+    guint8 data;
+
+    fail_unless (gst_buffer_get_size (buf) == size - i * 4096);
+    gst_buffer_extract (buf, 0, &data, 1);
+    fail_unless_equals_int (data, i);
+  }
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -179,6 +340,17 @@ shm_suite (void)
   tcase_add_checked_fixture (tc, setup_shm, NULL);
   tcase_add_test (tc, test_shm_sysmem_alloc);
   tcase_add_test (tc, test_shm_alloc);
+  tcase_add_test (tc, test_shm_many_buffers);
+  tcase_add_test (tc, test_shm_alloc_pool);
+  tcase_add_test (tc, test_shm_fd_memory);
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("shm-ring");
+  tcase_add_checked_fixture (tc, setup_shm_ring, NULL);
+  tcase_add_test (tc, test_shm_sysmem_alloc);
+  tcase_add_test (tc, test_shm_alloc);
+  tcase_add_test (tc, test_shm_many_buffers);
+  tcase_add_test (tc, test_shm_fd_memory);
   suite_add_tcase (s, tc);
 
   return s;
@@ -0,0 +1,157 @@
+/* GStreamer
+ *
+ * unit test for the client queues of srtserversink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "../../../ext/srt/gstsrtclientqueue.c"
+
+#define QUEUE_SIZE 4
+
+static GstBuffer *buffers[QUEUE_SIZE + 2];
+
+static void
+setup_buffers (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++) {
+    buffers[i] = gst_buffer_new ();
+    GST_BUFFER_OFFSET (buffers[i]) = i;
+  }
+}
+
+static void
+teardown_buffers (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++) {
+    ASSERT_MINI_OBJECT_REFCOUNT (buffers[i], "buffer", 1);
+    gst_buffer_unref (buffers[i]);
+  }
+}
+
+/* Pushes all the buffers and returns how many were accepted */
+static guint
+push_buffers (GQueue * queue, GstSRTServerSinkDropPolicy policy,
+    guint64 * dropped)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++) {
+    if (!gst_srt_client_queue_push (queue, QUEUE_SIZE, policy, buffers[i],
+            dropped))
+      break;
+  }
+
+  return i;
+}
+
+/* Checks that @queue holds the buffers @first to @first + QUEUE_SIZE - 1 and
+ * empties it */
+static void
+check_queue (GQueue * queue, guint first)
+{
+  GstBuffer *buffer;
+  guint i = first;
+
+  fail_unless_equals_int (g_queue_get_length (queue), QUEUE_SIZE);
+  while ((buffer = g_queue_pop_head (queue))) {
+    fail_unless (buffer == buffers[i]);
+    gst_buffer_unref (buffer);
+    i++;
+  }
+}
+
+GST_START_TEST (test_below_limit)
+{
+  GQueue queue = G_QUEUE_INIT;
+  guint64 dropped = 0;
+  guint i;
+
+  for (i = 0; i < QUEUE_SIZE; i++)
+    fail_unless (gst_srt_client_queue_push (&queue, QUEUE_SIZE,
+            GST_SRT_SERVER_SINK_DISCONNECT, buffers[i], &dropped));
+  fail_unless_equals_uint64 (dropped, 0);
+  check_queue (&queue, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_drop_old)
+{
+  GQueue queue = G_QUEUE_INIT;
+  guint64 dropped = 0;
+
+  /* the queue keeps the most recent buffers */
+  fail_unless_equals_int (push_buffers (&queue, GST_SRT_SERVER_SINK_DROP_OLD,
+          &dropped), G_N_ELEMENTS (buffers));
+  fail_unless_equals_uint64 (dropped, 2);
+  check_queue (&queue, 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_drop_new)
+{
+  GQueue queue = G_QUEUE_INIT;
+  guint64 dropped = 0;
+
+  /* the queue keeps the oldest buffers, the new ones are not reffed */
+  fail_unless_equals_int (push_buffers (&queue, GST_SRT_SERVER_SINK_DROP_NEW,
+          &dropped), G_N_ELEMENTS (buffers));
+  fail_unless_equals_uint64 (dropped, 2);
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[QUEUE_SIZE], "buffer", 1);
+  check_queue (&queue, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_disconnect)
+{
+  GQueue queue = G_QUEUE_INIT;
+  guint64 dropped = 0;
+
+  /* the first buffer that doesn't fit is refused and the queue is kept */
+  fail_unless_equals_int (push_buffers (&queue, GST_SRT_SERVER_SINK_DISCONNECT,
+          &dropped), QUEUE_SIZE);
+  fail_unless_equals_uint64 (dropped, 0);
+  check_queue (&queue, 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+srtclientqueue_suite (void)
+{
+  Suite *s = suite_create ("srtclientqueue");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup_buffers, teardown_buffers);
+  tcase_add_test (tc_chain, test_below_limit);
+  tcase_add_test (tc_chain, test_drop_old);
+  tcase_add_test (tc_chain, test_drop_new);
+  tcase_add_test (tc_chain, test_disconnect);
+
+  return s;
+}
+
+GST_CHECK_MAIN (srtclientqueue);
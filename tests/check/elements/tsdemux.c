@@ -0,0 +1,192 @@
+/* GStreamer
+ *
+ * unit test for the PID filter of tsdemux and tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/mpegts/mpegts.h>
+
+#define TS_CAPS \
+  "video/mpegts, systemstream = (boolean) true, packetsize = (int) 188"
+#define TS_PACKET_SIZE 188
+
+#define PROGRAM_NUMBER 1
+#define PMT_PID 0x100
+#define VIDEO_PID 0x101
+/* Not part of any program */
+#define OTHER_PID 0x200
+
+#define N_PSI_PACKETS 2
+#define N_OTHER_PACKETS 20
+#define N_PACKETS (N_PSI_PACKETS + N_OTHER_PACKETS)
+
+/* Writes @section in a single TS packet */
+static void
+write_section_packet (guint8 * data, GstMpegtsSection * section, guint16 pid)
+{
+  guint8 *section_data;
+  gsize size;
+
+  section_data = gst_mpegts_section_packetize (section, &size);
+  fail_unless (section_data != NULL);
+  fail_unless (size <= TS_PACKET_SIZE - 5);
+
+  memset (data, 0xff, TS_PACKET_SIZE);
+  data[0] = 0x47;
+  /* payload_unit_start_indicator */
+  data[1] = 0x40 | (pid >> 8);
+  data[2] = pid & 0xff;
+  data[3] = 0x10;
+  /* pointer_field */
+  data[4] = 0x00;
+  memcpy (data + 5, section_data, size);
+}
+
+/* A PAT and a PMT for a program with a single video stream, followed by
+ * packets on a PID that is not part of it. Enough packets for the packet
+ * size to be detected in one go. */
+static GstBuffer *
+ts_buffer_new (void)
+{
+  GstMpegtsPatProgram *program;
+  GstMpegtsPMTStream *stream;
+  GstMpegtsSection *section;
+  GstMpegtsPMT *pmt;
+  GPtrArray *pat;
+  GstMapInfo map;
+  GstBuffer *buf;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, N_PACKETS * TS_PACKET_SIZE, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+
+  pat = gst_mpegts_pat_new ();
+  program = gst_mpegts_pat_program_new ();
+  program->program_number = PROGRAM_NUMBER;
+  program->network_or_program_map_PID = PMT_PID;
+  g_ptr_array_add (pat, program);
+  section = gst_mpegts_section_from_pat (pat, 0);
+  write_section_packet (map.data, section, 0);
+  gst_mpegts_section_unref (section);
+
+  pmt = gst_mpegts_pmt_new ();
+  pmt->pcr_pid = VIDEO_PID;
+  pmt->program_number = PROGRAM_NUMBER;
+  stream = gst_mpegts_pmt_stream_new ();
+  stream->stream_type = GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2;
+  stream->pid = VIDEO_PID;
+  g_ptr_array_add (pmt->streams, stream);
+  section = gst_mpegts_section_from_pmt (pmt, PMT_PID);
+  write_section_packet (map.data + TS_PACKET_SIZE, section, PMT_PID);
+  gst_mpegts_section_unref (section);
+
+  for (i = N_PSI_PACKETS; i < N_PACKETS; i++) {
+    guint8 *data = map.data + i * TS_PACKET_SIZE;
+
+    memset (data, 0xff, TS_PACKET_SIZE);
+    data[0] = 0x47;
+    data[1] = OTHER_PID >> 8;
+    data[2] = OTHER_PID & 0xff;
+    data[3] = 0x10 | (i & 0xf);
+  }
+
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static void
+get_stats (GstHarness * h, guint64 * processed, guint64 * dropped)
+{
+  GstStructure *stats;
+
+  g_object_get (h->element, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "packets-processed",
+          processed));
+  fail_unless (gst_structure_get_uint64 (stats, "packets-dropped", dropped));
+  gst_structure_free (stats);
+}
+
+GST_START_TEST (test_tsdemux_drops_other_pids)
+{
+  GstHarness *h;
+  guint64 processed, dropped;
+
+  h = gst_harness_new_with_padnames ("tsdemux", "sink", NULL);
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  /* the filter is set up as soon as the PMT is parsed, the packets that
+   * follow it are skipped */
+  fail_unless_equals_int (gst_harness_push (h, ts_buffer_new ()),
+      GST_FLOW_OK);
+  get_stats (h, &processed, &dropped);
+  fail_unless_equals_uint64 (processed, N_PSI_PACKETS);
+  fail_unless_equals_uint64 (dropped, N_OTHER_PACKETS);
+
+  /* the PSI PIDs still go through */
+  fail_unless_equals_int (gst_harness_push (h, ts_buffer_new ()),
+      GST_FLOW_OK);
+  get_stats (h, &processed, &dropped);
+  fail_unless_equals_uint64 (processed, 2 * N_PSI_PACKETS);
+  fail_unless_equals_uint64 (dropped, 2 * N_OTHER_PACKETS);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_tsparse_keeps_all_pids)
+{
+  GstHarness *h;
+  guint64 processed, dropped;
+
+  /* tsparse outputs the whole multiplex, it doesn't filter */
+  h = gst_harness_new ("tsparse");
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  fail_unless_equals_int (gst_harness_push (h, ts_buffer_new ()),
+      GST_FLOW_OK);
+  get_stats (h, &processed, &dropped);
+  fail_unless_equals_uint64 (processed, N_PACKETS);
+  fail_unless_equals_uint64 (dropped, 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  gst_mpegts_initialize ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_tsdemux_drops_other_pids);
+  tcase_add_test (tc_chain, test_tsparse_keeps_all_pids);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
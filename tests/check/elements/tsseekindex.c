@@ -0,0 +1,210 @@
+/* GStreamer
+ *
+ * unit test for the seek index of tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "../../../gst/mpegtsdemux/tsseekindex.c"
+
+#define STREAM_SIZE (188 * 100000)
+#define PMT_PID 0x100
+#define PCR_PID 0x101
+#define VIDEO_PID 0x101
+
+static guint8 head[64 * 1024];
+
+static gchar *
+make_index_location (void)
+{
+  gchar *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("tsseekindex-XXXXXX", &location, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+
+  return location;
+}
+
+static TSSeekIndex *
+make_index (const guint8 * data, guint16 pcr_pid)
+{
+  TSSeekIndex *index = ts_seek_index_new ();
+
+  ts_seek_index_set_fingerprint (index, data, sizeof (head), PMT_PID,
+      pcr_pid);
+
+  return index;
+}
+
+static void
+fill_index (TSSeekIndex * index)
+{
+  guint i;
+
+  /* A PCR every 100 ms and a keyframe every 2 s, 188 kB apart */
+  for (i = 0; i < 600; i++) {
+    GstClockTime ts = i * 100 * GST_MSECOND;
+    guint64 offset = i * 188 * 50;
+
+    ts_seek_index_add (index, TS_SEEK_INDEX_PCR, PCR_PID, ts, offset);
+    if (i % 20 == 0)
+      ts_seek_index_add (index, TS_SEEK_INDEX_KEYFRAME, VIDEO_PID, ts,
+          offset + 188);
+  }
+}
+
+GST_START_TEST (test_lookup)
+{
+  TSSeekIndex *index = make_index (head, PCR_PID);
+  TSSeekIndexEntry entry;
+
+  fill_index (index);
+  fail_unless (ts_seek_index_is_dirty (index));
+
+  /* PCR entries closer than the interval are dropped */
+  fail_unless (ts_seek_index_lookup (index, TS_SEEK_INDEX_PCR, PCR_PID,
+          25 * GST_SECOND + 500 * GST_MSECOND, GST_SECOND, &entry));
+  assert_equals_uint64 (entry.ts, 25 * GST_SECOND);
+  assert_equals_uint64 (entry.offset, 250 * 188 * 50);
+
+  fail_unless (ts_seek_index_lookup (index, TS_SEEK_INDEX_KEYFRAME,
+          VIDEO_PID, 13 * GST_SECOND, 5 * GST_SECOND, &entry));
+  assert_equals_uint64 (entry.ts, 12 * GST_SECOND);
+  assert_equals_uint64 (entry.offset, 120 * 188 * 50 + 188);
+
+  /* Too far away from the last keyframe */
+  fail_if (ts_seek_index_lookup (index, TS_SEEK_INDEX_KEYFRAME, VIDEO_PID,
+          13 * GST_SECOND, 500 * GST_MSECOND, &entry));
+  /* Unknown PID */
+  fail_if (ts_seek_index_lookup (index, TS_SEEK_INDEX_KEYFRAME, 0x200,
+          13 * GST_SECOND, 5 * GST_SECOND, &entry));
+
+  ts_seek_index_free (index);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_save_load)
+{
+  TSSeekIndex *index = make_index (head, PCR_PID);
+  TSSeekIndexEntry entry;
+  GError *err = NULL;
+  gchar *location;
+
+  location = make_index_location ();
+
+  fill_index (index);
+  fail_unless (ts_seek_index_save (index, location, STREAM_SIZE, &err));
+  fail_if (ts_seek_index_is_dirty (index));
+  ts_seek_index_free (index);
+
+  /* A recording that grew since */
+  index = make_index (head, PCR_PID);
+  fail_unless (ts_seek_index_load (index, location, STREAM_SIZE * 2, &err));
+  fail_if (ts_seek_index_is_dirty (index));
+
+  fail_unless (ts_seek_index_lookup (index, TS_SEEK_INDEX_KEYFRAME,
+          VIDEO_PID, 41 * GST_SECOND, 5 * GST_SECOND, &entry));
+  assert_equals_uint64 (entry.ts, 40 * GST_SECOND);
+  assert_equals_uint64 (entry.offset, 400 * 188 * 50 + 188);
+  fail_unless (ts_seek_index_lookup (index, TS_SEEK_INDEX_PCR, PCR_PID,
+          59 * GST_SECOND, GST_SECOND, &entry));
+  assert_equals_uint64 (entry.ts, 59 * GST_SECOND);
+  ts_seek_index_free (index);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reject_stale)
+{
+  TSSeekIndex *index = make_index (head, PCR_PID);
+  TSSeekIndexEntry entry;
+  GError *err = NULL;
+  guint8 *other_head;
+  gchar *location;
+
+  location = make_index_location ();
+
+  fill_index (index);
+  fail_unless (ts_seek_index_save (index, location, STREAM_SIZE, &err));
+  ts_seek_index_free (index);
+
+  /* Another file of the same size */
+  other_head = g_memdup (head, sizeof (head));
+  other_head[4096] ^= 0xff;
+  index = make_index (other_head, PCR_PID);
+  fail_if (ts_seek_index_load (index, location, STREAM_SIZE, &err));
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+  fail_if (ts_seek_index_lookup (index, TS_SEEK_INDEX_PCR, PCR_PID,
+          GST_SECOND, GST_SECOND, &entry));
+  ts_seek_index_free (index);
+  g_free (other_head);
+
+  /* Same data, but another program */
+  index = make_index (head, 0x102);
+  fail_if (ts_seek_index_load (index, location, STREAM_SIZE, &err));
+  g_clear_error (&err);
+  ts_seek_index_free (index);
+
+  /* Smaller than when the index was saved */
+  index = make_index (head, PCR_PID);
+  fail_if (ts_seek_index_load (index, location, STREAM_SIZE / 2, &err));
+  g_clear_error (&err);
+  ts_seek_index_free (index);
+
+  /* Not an index */
+  fail_unless (g_file_set_contents (location, "GSTTSIDX", 8, NULL));
+  index = make_index (head, PCR_PID);
+  fail_if (ts_seek_index_load (index, location, STREAM_SIZE, &err));
+  g_clear_error (&err);
+  ts_seek_index_free (index);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsseekindex_suite (void)
+{
+  Suite *s = suite_create ("tsseekindex");
+  TCase *tc_chain = tcase_create ("general");
+  guint i;
+
+  for (i = 0; i < sizeof (head); i++)
+    head[i] = i * 7 + (i >> 8);
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_lookup);
+  tcase_add_test (tc_chain, test_save_load);
+  tcase_add_test (tc_chain, test_reject_stale);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsseekindex);
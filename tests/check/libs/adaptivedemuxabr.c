@@ -0,0 +1,261 @@
+/* GStreamer
+ *
+ * unit test for the bitrate adaptation algorithms of adaptivedemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemux.h>
+
+#define BITRATE_LIMIT 0.8
+
+/* size in bytes and download time in ms of the fragments, the concurrency
+ * of the last ones is 2 */
+static const struct
+{
+  guint64 size;
+  guint download_ms;
+} abr_test_fragments[] = {
+  {125000, 1000}, {250000, 1000}, {500000, 1000}, {62500, 1000},
+  {300000, 600}, {100000, 2000}, {0, 0}, {400000, 1000},
+  {200000, 1000}, {700000, 3000}
+};
+
+#define N_CONCURRENT_FRAGMENTS 2
+
+static const guint64 abr_test_bitrates[] = { 100000, 500000, 1200000 };
+
+static void
+fragment_downloaded (GstAdaptiveDemuxAbr * abr, guint64 size,
+    guint download_ms, gdouble concurrency)
+{
+  GstAdaptiveDemuxAbrFragment fragment;
+
+  fragment.size = size;
+  fragment.download_time = download_ms * GST_MSECOND;
+  fragment.concurrency = concurrency;
+  gst_adaptive_demux_abr_fragment_downloaded (abr, &fragment);
+}
+
+static guint64
+get_bitrate (GstAdaptiveDemuxAbr * abr, GstClockTime buffer_level)
+{
+  return gst_adaptive_demux_abr_get_bitrate (abr, BITRATE_LIMIT,
+      buffer_level, abr_test_bitrates, G_N_ELEMENTS (abr_test_bitrates));
+}
+
+/* The moving average must pick the same bitrates as adaptivedemux did
+ * before the algorithms could be selected. This is the code it used */
+#define NUM_LOOKBACK_FRAGMENTS 3
+
+typedef struct
+{
+  guint64 fragment_bitrates[NUM_LOOKBACK_FRAGMENTS];
+  guint64 moving_bitrate;
+  guint moving_index;
+} LegacyAverage;
+
+static guint64
+legacy_update_average_bitrate (LegacyAverage * avg, guint64 new_bitrate)
+{
+  gint index = avg->moving_index % NUM_LOOKBACK_FRAGMENTS;
+
+  avg->moving_bitrate -= avg->fragment_bitrates[index];
+  avg->fragment_bitrates[index] = new_bitrate;
+  avg->moving_bitrate += new_bitrate;
+
+  avg->moving_index += 1;
+
+  if (avg->moving_index > NUM_LOOKBACK_FRAGMENTS)
+    return avg->moving_bitrate / NUM_LOOKBACK_FRAGMENTS;
+  return avg->moving_bitrate / avg->moving_index;
+}
+
+static guint64
+legacy_update_current_bitrate (LegacyAverage * avg, guint64 size,
+    guint download_ms, gdouble concurrency)
+{
+  guint64 average_bitrate;
+  guint64 fragment_bitrate = 0;
+  guint64 current_download_rate;
+
+  if (download_ms > 0)
+    fragment_bitrate = gst_util_uint64_scale (size, 8 * GST_SECOND,
+        download_ms * GST_MSECOND);
+  if (concurrency > 1.0)
+    fragment_bitrate *= concurrency;
+
+  average_bitrate = legacy_update_average_bitrate (avg, fragment_bitrate);
+
+  current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  current_download_rate *= BITRATE_LIMIT;
+
+  return current_download_rate;
+}
+
+GST_START_TEST (test_moving_average)
+{
+  GstAdaptiveDemuxAbr *abr;
+  LegacyAverage avg = { {0,}, 0, 0 };
+  guint i;
+
+  abr = gst_adaptive_demux_abr_new (GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+      NULL);
+  fail_if (gst_adaptive_demux_abr_uses_buffer_level (abr));
+
+  /* nothing was measured yet */
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE), 0);
+
+  /* the first fragments are at 1, 2, 4 and 0.5 Mbps */
+  fragment_downloaded (abr, 125000, 1000, 1.0);
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE), 800000);
+  fragment_downloaded (abr, 250000, 1000, 1.0);
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE),
+      1200000);
+  fragment_downloaded (abr, 500000, 1000, 1.0);
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE),
+      1866666);
+  fragment_downloaded (abr, 62500, 1000, 1.0);
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE), 400000);
+  gst_adaptive_demux_abr_free (abr);
+
+  /* the whole trace, with parallel downloads at the end */
+  abr = gst_adaptive_demux_abr_new (GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+      NULL);
+  for (i = 0; i < G_N_ELEMENTS (abr_test_fragments); i++) {
+    gdouble concurrency = 1.0;
+    guint64 expected;
+
+    if (i >= G_N_ELEMENTS (abr_test_fragments) - N_CONCURRENT_FRAGMENTS)
+      concurrency = 2.0;
+
+    expected = legacy_update_current_bitrate (&avg,
+        abr_test_fragments[i].size, abr_test_fragments[i].download_ms,
+        concurrency);
+    fragment_downloaded (abr, abr_test_fragments[i].size,
+        abr_test_fragments[i].download_ms, concurrency);
+
+    /* the moving average doesn't care about the buffer level */
+    fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE),
+        expected);
+    fail_unless_equals_uint64 (get_bitrate (abr, 20 * GST_SECOND), expected);
+  }
+  gst_adaptive_demux_abr_free (abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_throughput)
+{
+  GstAdaptiveDemuxAbr *abr;
+  guint64 bitrate, previous;
+
+  abr = gst_adaptive_demux_abr_new (GST_ADAPTIVE_DEMUX_ABR_THROUGHPUT, NULL);
+  fail_if (gst_adaptive_demux_abr_uses_buffer_level (abr));
+
+  fail_unless_equals_uint64 (get_bitrate (abr, GST_CLOCK_TIME_NONE), 0);
+
+  /* a constant bitrate is estimated right away, whatever the download
+   * times are. The averages are computed in floating point */
+  fragment_downloaded (abr, 125000, 1000, 1.0);
+  bitrate = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (bitrate >= 799999 && bitrate <= 800000);
+  fragment_downloaded (abr, 375000, 3000, 1.0);
+  fragment_downloaded (abr, 62500, 500, 1.0);
+  bitrate = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (bitrate >= 799999 && bitrate <= 800000);
+
+  /* fragments that failed to be timed are ignored */
+  fragment_downloaded (abr, 0, 0, 1.0);
+  bitrate = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (bitrate >= 799999 && bitrate <= 800000);
+
+  /* a slow fragment drops the estimate, but not to its own bitrate */
+  fragment_downloaded (abr, 93750, 3000, 1.0);
+  previous = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (previous < 800000);
+  fail_unless (previous > 200000);
+
+  /* and it takes several fast fragments to recover */
+  fragment_downloaded (abr, 125000, 1000, 1.0);
+  bitrate = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (bitrate > previous);
+  fail_unless (bitrate < 800000);
+
+  gst_adaptive_demux_abr_free (abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_buffer_based)
+{
+  GstAdaptiveDemuxAbr *abr;
+  guint64 throughput;
+
+  abr = gst_adaptive_demux_abr_new (GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED,
+      NULL);
+  fail_unless (gst_adaptive_demux_abr_uses_buffer_level (abr));
+
+  /* nothing is measured and the buffer is filling up: lowest bitrate */
+  fail_unless_equals_uint64 (get_bitrate (abr, 0), 100000);
+  fail_unless_equals_uint64 (get_bitrate (abr, 5 * GST_SECOND), 100000);
+
+  /* 1 Mbps, 800 kbps with the bitrate limit */
+  fragment_downloaded (abr, 125000, 1000, 1.0);
+  throughput = get_bitrate (abr, GST_CLOCK_TIME_NONE);
+  fail_unless (throughput >= 799999 && throughput <= 800000);
+
+  /* the throughput is used while the buffer fills up */
+  fail_unless_equals_uint64 (get_bitrate (abr, 0), throughput);
+  fail_unless_equals_uint64 (get_bitrate (abr, 9 * GST_SECOND), throughput);
+
+  /* then the buffer level alone decides, with 3 bitrates the highest one
+   * is picked from 16 s */
+  fail_unless_equals_uint64 (get_bitrate (abr, 10 * GST_SECOND), 100000);
+  fail_unless_equals_uint64 (get_bitrate (abr, 12 * GST_SECOND), 500000);
+  fail_unless_equals_uint64 (get_bitrate (abr, 14 * GST_SECOND), 500000);
+  fail_unless_equals_uint64 (get_bitrate (abr, 16 * GST_SECOND), 1200000);
+  fail_unless_equals_uint64 (get_bitrate (abr, 30 * GST_SECOND), 1200000);
+
+  /* without a buffer level or a choice, it is the throughput algorithm */
+  fail_unless_equals_uint64 (gst_adaptive_demux_abr_get_bitrate (abr,
+          BITRATE_LIMIT, 30 * GST_SECOND, abr_test_bitrates, 1), throughput);
+
+  gst_adaptive_demux_abr_free (abr);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemuxabr_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemuxabr");
+  TCase *tc_chain = tcase_create ("general");
+
+  /* the algorithms log in the debug category of adaptivedemux, which is
+   * registered with its class */
+  g_type_class_unref (g_type_class_ref (GST_TYPE_ADAPTIVE_DEMUX));
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_moving_average);
+  tcase_add_test (tc_chain, test_throughput);
+  tcase_add_test (tc_chain, test_buffer_based);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemuxabr);
@@ -544,6 +544,97 @@ GST_START_TEST (test_tile_list_obu)
 
 GST_END_TEST;
 
+/* Checks that gst_av1_parse_scan_obus() finds the same OBUs as
+ * gst_av1_parse_get_first_obu() and gst_av1_parse_get_next_obu() */
+static void
+check_scan_obus (gboolean use_annexb, const guint8 * data, gsize size,
+    guint n_obus)
+{
+  GstAV1Parser *parser;
+  GArray *obus;
+  GstAV1OBU obu;
+  guint i;
+
+  parser = gst_av1_parser_new (use_annexb);
+  obus = g_array_new (FALSE, FALSE, sizeof (GstAV1OBU));
+
+  assert_equals_int (gst_av1_parse_scan_obus (parser, data, size, obus),
+      GST_AV1_PARSER_OK);
+  assert_equals_int (obus->len, n_obus);
+
+  /* scanning doesn't touch the state used by gst_av1_parse_get_next_obu() */
+  assert_equals_int (parser->annexb.temporal_unit_size, 0);
+  assert_equals_int (parser->annexb.frame_unit_size, 0);
+
+  for (i = 0; i < obus->len; i++) {
+    GstAV1OBU *scanned = &g_array_index (obus, GstAV1OBU, i);
+
+    if (i == 0)
+      gst_av1_parse_get_first_obu (parser, data, 0, size, &obu);
+    else
+      gst_av1_parse_get_next_obu (parser, &obu);
+
+    assert_equals_int (scanned->header.obu_type, obu.header.obu_type);
+    assert_equals_int (scanned->header.obu_has_size_field,
+        obu.header.obu_has_size_field);
+    assert_equals_uint64 (scanned->offset, obu.offset);
+    assert_equals_uint64 (scanned->header_size, obu.header_size);
+    assert_equals_uint64 (scanned->size, obu.size);
+    fail_unless (scanned->data == obu.data);
+  }
+
+  /* a truncated OBU is reported, the complete ones before it are kept */
+  g_array_set_size (obus, 0);
+  assert_equals_int (gst_av1_parse_scan_obus (parser, data, size - 1, obus),
+      GST_AV1_PARSER_ERROR);
+  fail_unless (obus->len < n_obus);
+
+  g_array_unref (obus);
+  gst_av1_parser_free (parser);
+}
+
+GST_START_TEST (test_av1_scan_obus)
+{
+  GstAV1Parser *parser;
+  GstAV1SequenceHeaderOBU seq_header;
+  GstAV1FrameOBU frame;
+  GArray *obus;
+
+  check_scan_obus (FALSE, aom_testdata_av1_1_b8_01_size_16x16,
+      sizeof (aom_testdata_av1_1_b8_01_size_16x16), 5);
+  check_scan_obus (TRUE, aom_testdata_av1_1_b8_01_size_16x16_reencoded_annexb,
+      sizeof (aom_testdata_av1_1_b8_01_size_16x16_reencoded_annexb), 5);
+
+  /* parse the headers of the scanned OBUs afterwards */
+  memset (&seq_header, 0, sizeof (seq_header));
+  memset (&frame, 0, sizeof (frame));
+
+  parser = gst_av1_parser_new (FALSE);
+  obus = g_array_new (FALSE, FALSE, sizeof (GstAV1OBU));
+  assert_equals_int (gst_av1_parse_scan_obus (parser,
+          aom_testdata_av1_1_b8_01_size_16x16,
+          sizeof (aom_testdata_av1_1_b8_01_size_16x16), obus),
+      GST_AV1_PARSER_OK);
+
+  assert_equals_int (g_array_index (obus, GstAV1OBU, 1).header.obu_type,
+      GST_AV1_OBU_SEQUENCE_HEADER);
+  gst_av1_parse_sequence_header_obu (parser,
+      &g_array_index (obus, GstAV1OBU, 1), &seq_header);
+  assert_equals_int (seq_header.max_frame_width_minus_1, 15);
+  assert_equals_int (seq_header.max_frame_height_minus_1, 15);
+
+  assert_equals_int (g_array_index (obus, GstAV1OBU, 2).header.obu_type,
+      GST_AV1_OBU_FRAME);
+  gst_av1_parse_frame_obu (parser, &g_array_index (obus, GstAV1OBU, 2),
+      &frame);
+  assert_equals_int (frame.frame_header.frame_type, GST_AV1_KEY_FRAME);
+  assert_equals_int (frame.frame_header.show_frame, 1);
+
+  g_array_unref (obus);
+  gst_av1_parser_free (parser);
+}
+
+GST_END_TEST;
 
 static Suite *
 av1parsers_suite (void)
@@ -558,6 +649,7 @@ av1parsers_suite (void)
       test_av1_parse_aom_testdata_av1_1_b8_01_size_16x16_reencoded_annexb);
   tcase_add_test (tc_chain, test_metadata_obu);
   tcase_add_test (tc_chain, test_tile_list_obu);
+  tcase_add_test (tc_chain, test_av1_scan_obus);
 
   return s;
 }
@@ -211,6 +211,172 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+static guint8 sps_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x15,
+  0xec, 0xa4, 0xbf, 0x2e, 0x02, 0x20, 0x00, 0x00,
+  0x03, 0x00, 0x2e, 0xe6, 0xb2, 0x80, 0x01, 0xe2,
+  0xc5, 0xb2, 0xc0,
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2,
+  0x00, 0x00, 0x00, 0x01, 0x09, 0xf0
+};
+
+GST_START_TEST (test_h264_parse_slice_hdr_partial)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  GstH264SliceHdr full, partial;
+  guint offset = 0;
+
+  /* SPS, then PPS */
+  res = gst_h264_parser_identify_nalu (parser, sps_pps, offset,
+      sizeof (sps_pps), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (gst_h264_parser_parse_nal (parser, &nalu),
+      GST_H264_PARSER_OK);
+  offset = nalu.offset + nalu.size;
+
+  res = gst_h264_parser_identify_nalu (parser, sps_pps, offset,
+      sizeof (sps_pps), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (gst_h264_parser_parse_nal (parser, &nalu),
+      GST_H264_PARSER_OK);
+
+  res = gst_h264_parser_identify_nalu (parser, slice_eoseq_slice, 0,
+      sizeof (slice_eoseq_slice), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SLICE_IDR);
+
+  res = gst_h264_parser_parse_slice_hdr (parser, &nalu, &full, TRUE, TRUE);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  res = gst_h264_parser_parse_slice_hdr_partial (parser, &nalu, &partial);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+
+  fail_unless (partial.pps == full.pps);
+  assert_equals_int (partial.first_mb_in_slice, full.first_mb_in_slice);
+  assert_equals_int (partial.type, full.type);
+  fail_unless (GST_H264_IS_I_SLICE (&partial));
+  assert_equals_int (partial.frame_num, full.frame_num);
+  assert_equals_int (partial.field_pic_flag, full.field_pic_flag);
+  assert_equals_int (partial.idr_pic_id, full.idr_pic_id);
+  assert_equals_int (partial.pic_order_cnt_lsb, full.pic_order_cnt_lsb);
+  assert_equals_int (partial.delta_pic_order_cnt_bottom,
+      full.delta_pic_order_cnt_bottom);
+
+  /* the rest isn't parsed */
+  fail_unless (full.header_size > 0);
+  assert_equals_int (partial.header_size, 0);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* SEI with a user data message of 18 zero bytes, which needs 8 emulation
+ * prevention bytes, followed by a frame packing message with another one */
+static guint8 sei_epb[] = {
+  0x00, 0x00, 0x00, 0x01, 0x06,
+  0x05, 0x12,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+  0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+  0x00, 0x00,
+  0x2d, 0x07,
+  0x81, 0x81, 0x00, 0x00, 0x03, 0x00, 0x01, 0x20,
+  0x80,
+  0x00, 0x00, 0x00, 0x01, 0x09, 0xf0
+};
+
+GST_START_TEST (test_h264_parse_sei_emulation_prevention)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  GstH264SEIMessage *sei;
+  GstH264FramePacking *fp;
+  GArray *messages;
+
+  res = gst_h264_parser_identify_nalu (parser, sei_epb, 0, sizeof (sei_epb),
+      &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SEI);
+  assert_equals_int (nalu.size, 40);
+
+  res = gst_h264_parser_parse_sei (parser, &nalu, &messages);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (messages->len, 2);
+
+  sei = &g_array_index (messages, GstH264SEIMessage, 0);
+  assert_equals_int (sei->payloadType, 5);
+
+  sei = &g_array_index (messages, GstH264SEIMessage, 1);
+  assert_equals_int (sei->payloadType, GST_H264_SEI_FRAME_PACKING);
+  fp = &sei->payload.frame_packing;
+  assert_equals_int (fp->frame_packing_id, 0);
+  assert_equals_int (fp->frame_packing_cancel_flag, 0);
+  assert_equals_int (fp->frame_packing_type,
+      GST_H264_FRAME_PACKING_SIDE_BY_SIDE);
+  assert_equals_int (fp->quincunx_sampling_flag, 0);
+  assert_equals_int (fp->content_interpretation_type, 1);
+  assert_equals_int (fp->frame1_grid_position_y, 0);
+  assert_equals_int (fp->frame_packing_repetition_period, 1);
+
+  g_array_free (messages, TRUE);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* Splits a stream of slices whose payload has runs of zeros at all
+ * alignments, with both 3 and 4 byte start codes */
+GST_START_TEST (test_h264_parse_nal_boundaries)
+{
+  static const guint8 sc[] = { 0x00, 0x00, 0x00, 0x01 };
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint offsets[64], sizes[64];
+  GByteArray *stream;
+  guint i, j, offset;
+
+  stream = g_byte_array_new ();
+  for (i = 0; i < G_N_ELEMENTS (offsets); i++) {
+    g_byte_array_append (stream, sc + i % 2, 4 - i % 2);
+    offsets[i] = stream->len;
+    sizes[i] = 2 + (i * 13) % 61;
+
+    /* non-IDR slice header, then 2 zeros every 5 bytes */
+    g_byte_array_append (stream, (const guint8 *) "\x01", 1);
+    for (j = 1; j < sizes[i]; j++) {
+      guint8 byte = (j % 5 < 2 && j < sizes[i] - 1) ? 0x00 : 0x80 | j;
+
+      g_byte_array_append (stream, &byte, 1);
+    }
+  }
+  g_byte_array_append (stream, aud, sizeof (aud));
+
+  offset = 0;
+  for (i = 0; i < G_N_ELEMENTS (offsets); i++) {
+    res = gst_h264_parser_identify_nalu (parser, stream->data, offset,
+        stream->len, &nalu);
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    assert_equals_int (nalu.type, GST_H264_NAL_SLICE);
+    assert_equals_int (nalu.offset, offsets[i]);
+    assert_equals_int (nalu.size, sizes[i]);
+    offset = nalu.offset + nalu.size;
+  }
+
+  res = gst_h264_parser_identify_nalu_unchecked (parser, stream->data, offset,
+      stream->len, &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_AU_DELIMITER);
+
+  g_byte_array_free (stream, TRUE);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +387,9 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_slice_hdr_partial);
+  tcase_add_test (tc_chain, test_h264_parse_sei_emulation_prevention);
+  tcase_add_test (tc_chain, test_h264_parse_nal_boundaries);
 
   return s;
 }
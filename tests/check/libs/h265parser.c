@@ -232,6 +232,170 @@ GST_START_TEST (test_h265_format_range_profiles_partial_match)
 
 GST_END_TEST;
 
+/* Splits a stream of slices whose payload has runs of zeros at all
+ * alignments, with both 3 and 4 byte start codes */
+GST_START_TEST (test_h265_parse_nal_boundaries)
+{
+  static const guint8 sc[] = { 0x00, 0x00, 0x00, 0x01 };
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50 };
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265Parser *const parser = gst_h265_parser_new ();
+  guint sc_offsets[64], offsets[64], sizes[64];
+  GByteArray *stream;
+  guint i, j, offset;
+
+  stream = g_byte_array_new ();
+  for (i = 0; i < G_N_ELEMENTS (offsets); i++) {
+    sc_offsets[i] = stream->len;
+    g_byte_array_append (stream, sc + i % 2, 4 - i % 2);
+    offsets[i] = stream->len;
+    sizes[i] = 3 + (i * 13) % 61;
+
+    /* TRAIL_R slice header, then 2 zeros every 5 bytes */
+    g_byte_array_append (stream, (const guint8 *) "\x02\x01", 2);
+    for (j = 2; j < sizes[i]; j++) {
+      guint8 byte = (j % 5 < 2 && j < sizes[i] - 1) ? 0x00 : 0x80 | j;
+
+      g_byte_array_append (stream, &byte, 1);
+    }
+  }
+  g_byte_array_append (stream, aud, sizeof (aud));
+
+  offset = 0;
+  for (i = 0; i < G_N_ELEMENTS (offsets); i++) {
+    res = gst_h265_parser_identify_nalu (parser, stream->data, offset,
+        stream->len, &nalu);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    assert_equals_int (nalu.type, GST_H265_NAL_SLICE_TRAIL_R);
+    assert_equals_int (nalu.sc_offset, sc_offsets[i]);
+    assert_equals_int (nalu.offset, offsets[i]);
+    assert_equals_int (nalu.size, sizes[i]);
+    offset = nalu.offset + nalu.size;
+  }
+
+  res = gst_h265_parser_identify_nalu_unchecked (parser, stream->data, offset,
+      stream->len, &nalu);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_AUD);
+
+  g_byte_array_free (stream, TRUE);
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* Main profile, 64x64 pictures with 16x16 CTBs and dependent slice segments
+ * enabled. The slices are followed by a few bytes of fake slice data */
+static const guint8 h265_stream[] = {
+  /* VPS */
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x3c, 0xac, 0x09,
+  /* SPS, 64x64 */
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+  0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+  0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xa0, 0x20,
+  0x81, 0x05, 0x96, 0xb5, 0xbc, 0x92, 0xe0, 0x80,
+  /* PPS */
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xf0, 0x71,
+  0x81, 0x12,
+  /* IDR, I slice */
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x70,
+  0xa5, 0x5a, 0x00, 0x00, 0x03, 0x01, 0x80,
+  /* IDR, second I slice at CTB 8 */
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0x28, 0x79,
+  0x60, 0xa5, 0x5a, 0x00, 0x00, 0x03, 0x01, 0x80,
+  /* TRAIL_R, P slice, pic_output_flag 0 */
+  0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x07,
+  0x25, 0xc0, 0xa5, 0x5a, 0x00, 0x00, 0x03, 0x01,
+  0x80,
+  /* TRAIL_R, dependent slice segment at CTB 12 */
+  0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0x79, 0xa5,
+  0x5a, 0x00, 0x00, 0x03, 0x01, 0x80
+};
+
+GST_START_TEST (test_h265_parse_slice_hdr_partial)
+{
+  static const struct
+  {
+    GstH265NalUnitType nal_type;
+    gboolean dependent;
+    guint segment_address;
+    GstH265SliceType type;
+    guint8 pic_output_flag;
+    guint16 pic_order_cnt_lsb;
+  } slices[] = {
+    {GST_H265_NAL_SLICE_IDR_W_RADL, FALSE, 0, GST_H265_I_SLICE, 1, 0},
+    {GST_H265_NAL_SLICE_IDR_W_RADL, FALSE, 8, GST_H265_I_SLICE, 1, 0},
+    {GST_H265_NAL_SLICE_TRAIL_R, FALSE, 0, GST_H265_P_SLICE, 0, 1},
+    {GST_H265_NAL_SLICE_TRAIL_R, TRUE, 12, 0, 1, 0},
+  };
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265Parser *const parser = gst_h265_parser_new ();
+  GstH265SliceHdr full, partial;
+  guint offset = 0, i;
+
+  /* VPS, SPS and PPS */
+  for (i = 0; i < 3; i++) {
+    res = gst_h265_parser_identify_nalu (parser, h265_stream, offset,
+        sizeof (h265_stream), &nalu);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    assert_equals_int (gst_h265_parser_parse_nal (parser, &nalu),
+        GST_H265_PARSER_OK);
+    offset = nalu.offset + nalu.size;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (slices); i++) {
+    res = gst_h265_parser_identify_nalu (parser, h265_stream, offset,
+        sizeof (h265_stream), &nalu);
+    /* the last NAL unit is not followed by a start code */
+    if (i == G_N_ELEMENTS (slices) - 1)
+      assert_equals_int (res, GST_H265_PARSER_NO_NAL_END);
+    else
+      assert_equals_int (res, GST_H265_PARSER_OK);
+    assert_equals_int (nalu.type, slices[i].nal_type);
+    offset = nalu.offset + nalu.size;
+
+    res = gst_h265_parser_parse_slice_hdr (parser, &nalu, &full);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    res = gst_h265_parser_parse_slice_hdr_partial (parser, &nalu, &partial);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+
+    assert_equals_int (partial.first_slice_segment_in_pic_flag,
+        full.first_slice_segment_in_pic_flag);
+    assert_equals_int (partial.no_output_of_prior_pics_flag,
+        full.no_output_of_prior_pics_flag);
+    fail_unless (partial.pps == full.pps);
+    assert_equals_int (partial.dependent_slice_segment_flag,
+        full.dependent_slice_segment_flag);
+    assert_equals_int (partial.segment_address, full.segment_address);
+    assert_equals_int (partial.type, full.type);
+    assert_equals_int (partial.pic_output_flag, full.pic_output_flag);
+    assert_equals_int (partial.colour_plane_id, full.colour_plane_id);
+    assert_equals_int (partial.pic_order_cnt_lsb, full.pic_order_cnt_lsb);
+
+    /* and both match the stream */
+    assert_equals_int (full.dependent_slice_segment_flag,
+        slices[i].dependent);
+    assert_equals_int (full.segment_address, slices[i].segment_address);
+    assert_equals_int (full.type, slices[i].type);
+    assert_equals_int (full.pic_output_flag, slices[i].pic_output_flag);
+    assert_equals_int (full.pic_order_cnt_lsb, slices[i].pic_order_cnt_lsb);
+
+    /* the rest isn't parsed */
+    fail_unless (full.header_size > 0);
+    assert_equals_int (partial.header_size, 0);
+    gst_h265_slice_hdr_free (&full);
+  }
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h265parser_suite (void)
 {
@@ -244,6 +408,8 @@ h265parser_suite (void)
   tcase_add_test (tc_chain, test_h265_base_profiles_compat);
   tcase_add_test (tc_chain, test_h265_format_range_profiles_exact_match);
   tcase_add_test (tc_chain, test_h265_format_range_profiles_partial_match);
+  tcase_add_test (tc_chain, test_h265_parse_nal_boundaries);
+  tcase_add_test (tc_chain, test_h265_parse_slice_hdr_partial);
 
   return s;
 }
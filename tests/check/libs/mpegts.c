@@ -560,6 +560,80 @@ GST_START_TEST (test_mpegts_dvb_descriptors)
 
 GST_END_TEST;
 
+/* Bit by bit CRC32/MPEG-2 as in ISO/IEC 13818-1 Annex A */
+static guint32
+reference_crc32 (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  gint bit;
+
+  for (i = 0; i < size; i++) {
+    for (bit = 7; bit >= 0; bit--) {
+      gboolean msb = (crc >> 31) ^ ((data[i] >> bit) & 1);
+
+      crc <<= 1;
+      if (msb)
+        crc ^= 0x04c11db7;
+    }
+  }
+
+  return crc;
+}
+
+GST_START_TEST (test_mpegts_crc)
+{
+  guint8 payload[256];
+  gint len;
+
+  for (len = 0; len < sizeof (payload); len++)
+    payload[len] = g_random_int_range (0, 256);
+
+  /* PMTs of all sizes, so that the CRC covers every alignment and remainder
+   * of the data */
+  for (len = 0; len < 200; len++) {
+    GstMpegtsPMT *pmt;
+    GstMpegtsSection *section, *parsed_section;
+    const GstMpegtsPMT *parsed;
+    guint8 *data;
+    gsize data_size;
+
+    pmt = gst_mpegts_pmt_new ();
+    pmt->pcr_pid = 0x1FFF;
+    pmt->program_number = 1;
+    g_ptr_array_add (pmt->descriptors,
+        gst_mpegts_descriptor_from_custom (0xFE, payload, len));
+
+    section = gst_mpegts_section_from_pmt (pmt, 0x30);
+    fail_if (section == NULL);
+
+    data = gst_mpegts_section_packetize (section, &data_size);
+    fail_if (data == NULL);
+    fail_unless_equals_int (data_size, 16 + 2 + len);
+    fail_unless_equals_int (GST_READ_UINT32_BE (data + data_size - 4),
+        reference_crc32 (data, data_size - 4));
+    /* the CRC over the data including its CRC is 0 */
+    fail_unless_equals_int (reference_crc32 (data, data_size), 0);
+
+    /* the CRC is checked when parsing */
+    parsed_section = gst_mpegts_section_new (0x30, g_memdup (data, data_size),
+        data_size);
+    parsed = gst_mpegts_section_get_pmt (parsed_section);
+    fail_if (parsed == NULL);
+    gst_mpegts_section_unref (parsed_section);
+
+    data[data_size / 2] ^= 0x10;
+    parsed_section = gst_mpegts_section_new (0x30, g_memdup (data, data_size),
+        data_size);
+    fail_unless (gst_mpegts_section_get_pmt (parsed_section) == NULL);
+    gst_mpegts_section_unref (parsed_section);
+
+    gst_mpegts_section_unref (section);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegts_suite (void)
 {
@@ -577,6 +651,7 @@ mpegts_suite (void)
   tcase_add_test (tc_chain, test_mpegts_atsc_stt);
   tcase_add_test (tc_chain, test_mpegts_descriptors);
   tcase_add_test (tc_chain, test_mpegts_dvb_descriptors);
+  tcase_add_test (tc_chain, test_mpegts_crc);
 
   return s;
 }
@@ -0,0 +1,183 @@
+/*
+ * av1bench.c - Measures how fast the OBUs of an AV1 stream are found
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Repeats the low overhead bitstream sample of the av1parser unit test and
+ * finds all its OBUs, once with gst_av1_parse_get_first_obu() and
+ * gst_av1_parse_get_next_obu(), and once with gst_av1_parse_scan_obus(),
+ * like an indexing tool would.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/codecparsers/gstav1parser.h>
+
+/* 2 temporal units of 5 OBUs, taken from the aom testdata */
+#define OBUS_PER_SAMPLE 5
+
+static const guint8 aom_testdata_av1_1_b8_01_size_16x16[] = {
+  0x12, 0x00, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x01, 0x9f, 0xfb, 0xff, 0xf3,
+  0x00, 0x80, 0x32, 0xa6, 0x01, 0x10, 0x00, 0x87, 0x80, 0x00, 0x03, 0x00,
+  0x00, 0x00, 0x40, 0x00, 0x9e, 0x86, 0x5b, 0xb2, 0x22, 0xb5, 0x58, 0x4d,
+  0x68, 0xe6, 0x37, 0x54, 0x42, 0x7b, 0x84, 0xce, 0xdf, 0x9f, 0xec, 0xab,
+  0x07, 0x4d, 0xf6, 0xe1, 0x5e, 0x9e, 0x27, 0xbf, 0x93, 0x2f, 0x47, 0x0d,
+  0x7b, 0x7c, 0x45, 0x8d, 0xcf, 0x26, 0xf7, 0x6c, 0x06, 0xd7, 0x8c, 0x2e,
+  0xf5, 0x2c, 0xb0, 0x8a, 0x31, 0xac, 0x69, 0xf5, 0xcd, 0xd8, 0x71, 0x5d,
+  0xaf, 0xf8, 0x96, 0x43, 0x8c, 0x9c, 0x23, 0x6f, 0xab, 0xd0, 0x35, 0x43,
+  0xdf, 0x81, 0x12, 0xe3, 0x7d, 0xec, 0x22, 0xb0, 0x30, 0x54, 0x32, 0x9f,
+  0x90, 0xc0, 0x5d, 0x64, 0x9b, 0x0f, 0x75, 0x31, 0x84, 0x3a, 0x57, 0xd7,
+  0x5f, 0x03, 0x6e, 0x7f, 0x43, 0x17, 0x6d, 0x08, 0xc3, 0x81, 0x8a, 0xae,
+  0x73, 0x1c, 0xa8, 0xa7, 0xe4, 0x9c, 0xa9, 0x5b, 0x3f, 0xd1, 0xeb, 0x75,
+  0x3a, 0x7f, 0x22, 0x77, 0x38, 0x64, 0x1c, 0x77, 0xdb, 0xcd, 0xef, 0xb7,
+  0x08, 0x45, 0x8e, 0x7f, 0xea, 0xa3, 0xd0, 0x81, 0xc9, 0xc1, 0xbc, 0x93,
+  0x9b, 0x41, 0xb1, 0xa1, 0x42, 0x17, 0x98, 0x3f, 0x1e, 0x95, 0xdf, 0x68,
+  0x7c, 0xb7, 0x98, 0x12, 0x00, 0x32, 0x4b, 0x30, 0x03, 0xc3, 0x00, 0xa7,
+  0x2e, 0x46, 0x8a, 0x00, 0x00, 0x03, 0x00, 0x00, 0x50, 0xc0, 0x20, 0x00,
+  0xf0, 0xb1, 0x2f, 0x43, 0xf3, 0xbb, 0xe6, 0x5c, 0xbe, 0xe6, 0x53, 0xbc,
+  0xaa, 0x61, 0x7c, 0x7e, 0x0a, 0x04, 0x1b, 0xa2, 0x87, 0x81, 0xe8, 0xa6,
+  0x85, 0xfe, 0xc2, 0x71, 0xb9, 0xf8, 0xc0, 0x78, 0x9f, 0x52, 0x4f, 0xa7,
+  0x8f, 0x55, 0x96, 0x79, 0x90, 0xaa, 0x2b, 0x6d, 0x0a, 0xa7, 0x05, 0x2a,
+  0xf8, 0xfc, 0xc9, 0x7d, 0x9d, 0x4a, 0x61, 0x16, 0xb1, 0x65
+};
+
+static gint n_samples = 200000;
+static gint n_runs = 3;
+
+static gdouble
+get_obus (GByteArray * stream)
+{
+  GstAV1Parser *parser;
+  GstAV1OBU obu;
+  GstAV1ParserResult res;
+  gint64 start, end;
+  gint n = 0;
+
+  parser = gst_av1_parser_new (FALSE);
+
+  start = g_get_monotonic_time ();
+  res = gst_av1_parse_get_first_obu (parser, stream->data, 0, stream->len,
+      &obu);
+  while (res == GST_AV1_PARSER_OK) {
+    n++;
+    res = gst_av1_parse_get_next_obu (parser, &obu);
+  }
+  end = g_get_monotonic_time ();
+
+  gst_av1_parser_free (parser);
+
+  if (n != n_samples * OBUS_PER_SAMPLE) {
+    g_printerr ("Found %d OBUs instead of %d\n", n,
+        n_samples * OBUS_PER_SAMPLE);
+    return -1;
+  }
+
+  return (end - start) / (gdouble) G_USEC_PER_SEC;
+}
+
+static gdouble
+scan_obus (GByteArray * stream, GArray * obus)
+{
+  GstAV1Parser *parser;
+  GstAV1ParserResult res;
+  gint64 start, end;
+
+  parser = gst_av1_parser_new (FALSE);
+  g_array_set_size (obus, 0);
+
+  start = g_get_monotonic_time ();
+  res = gst_av1_parse_scan_obus (parser, stream->data, stream->len, obus);
+  end = g_get_monotonic_time ();
+
+  gst_av1_parser_free (parser);
+
+  if (res != GST_AV1_PARSER_OK || obus->len != n_samples * OBUS_PER_SAMPLE) {
+    g_printerr ("Found %u OBUs instead of %d\n", obus->len,
+        n_samples * OBUS_PER_SAMPLE);
+    return -1;
+  }
+
+  return (end - start) / (gdouble) G_USEC_PER_SEC;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"samples", 'n', 0, G_OPTION_ARG_INT, &n_samples,
+        "Number of times the sample stream is repeated", NULL},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+        "Number of runs, the fastest one is reported", NULL},
+    {NULL}
+  };
+  gdouble get_best = G_MAXDOUBLE, scan_best = G_MAXDOUBLE;
+  GByteArray *stream;
+  GArray *obus;
+  gint i;
+
+  ctx = g_option_context_new ("- AV1 OBU scanning benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (n_samples <= 0 || n_runs <= 0) {
+    g_printerr ("Invalid number of samples or runs\n");
+    return EXIT_FAILURE;
+  }
+
+  stream = g_byte_array_sized_new (n_samples *
+      sizeof (aom_testdata_av1_1_b8_01_size_16x16));
+  for (i = 0; i < n_samples; i++)
+    g_byte_array_append (stream, aom_testdata_av1_1_b8_01_size_16x16,
+        sizeof (aom_testdata_av1_1_b8_01_size_16x16));
+  obus = g_array_sized_new (FALSE, FALSE, sizeof (GstAV1OBU),
+      n_samples * OBUS_PER_SAMPLE);
+
+  for (i = 0; i < n_runs; i++) {
+    gdouble get_time, scan_time;
+
+    get_time = get_obus (stream);
+    scan_time = scan_obus (stream, obus);
+    if (get_time < 0 || scan_time < 0) {
+      g_array_unref (obus);
+      g_byte_array_free (stream, TRUE);
+      return EXIT_FAILURE;
+    }
+
+    get_best = MIN (get_best, get_time);
+    scan_best = MIN (scan_best, scan_time);
+  }
+
+  g_print ("get_first/next_obu: %9.0f OBUs/s (%u bytes in %.3f s)\n",
+      obus->len / get_best, stream->len, get_best);
+  g_print ("scan_obus:          %9.0f OBUs/s (%u bytes in %.3f s)\n",
+      obus->len / scan_best, stream->len, scan_best);
+
+  g_array_unref (obus);
+  g_byte_array_free (stream, TRUE);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+/*
+ * nalbench.c - Measures how fast H.264 and H.265 NAL units are split and read
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The sample streams of the unit tests are far too small to time anything,
+ * so this generates an H.265 byte-stream of random slices, escaped like an
+ * encoder would, and splits it with gst_h265_parser_identify_nalu(). It
+ * then parses an H.264 SEI full of emulation prevention bytes over and over
+ * to time the bit reader.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+static gint n_slices = 500;
+static gint slice_size = 100000;
+static gint n_seis = 200000;
+static gint n_runs = 3;
+
+/* Appends @data, inserting emulation prevention bytes where needed */
+static void
+append_escaped (GByteArray * stream, const guint8 * data, guint size)
+{
+  static const guint8 epb = 0x03;
+  guint i, zeros = 0;
+
+  for (i = 0; i < size; i++) {
+    if (zeros >= 2 && data[i] <= 0x03) {
+      g_byte_array_append (stream, &epb, 1);
+      zeros = 0;
+    }
+    g_byte_array_append (stream, data + i, 1);
+    zeros = data[i] == 0x00 ? zeros + 1 : 0;
+  }
+}
+
+static GByteArray *
+create_h265_stream (void)
+{
+  static const guint8 sc[] = { 0x00, 0x00, 0x00, 0x01 };
+  GByteArray *stream;
+  GRand *rand;
+  guint8 *slice;
+  gint i, j;
+
+  rand = g_rand_new_with_seed (42);
+  stream = g_byte_array_sized_new (n_slices * (slice_size + 16) + 8);
+  slice = g_malloc (slice_size);
+
+  for (i = 0; i < n_slices; i++) {
+    /* TRAIL_R slice header */
+    slice[0] = 0x02;
+    slice[1] = 0x01;
+    for (j = 2; j < slice_size; j++)
+      slice[j] = g_rand_int (rand);
+    /* rbsp_slice_segment_trailing_bits */
+    slice[slice_size - 1] = 0x80;
+
+    g_byte_array_append (stream, sc, sizeof (sc));
+    append_escaped (stream, slice, slice_size);
+  }
+  /* so that the last slice has an end */
+  g_byte_array_append (stream, sc, sizeof (sc));
+  g_byte_array_append (stream, (const guint8 *) "\x46\x01\x50", 3);
+
+  g_free (slice);
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/* An SEI with a 254 byte user data message of mostly zeros, then a
+ * frame packing message */
+static GByteArray *
+create_h264_sei (void)
+{
+  static const guint8 frame_packing[] =
+      { 0x2d, 0x07, 0x81, 0x81, 0x00, 0x00, 0x00, 0x01, 0x20, 0x80 };
+  guint8 sei[2 + 254];
+  GByteArray *stream;
+  guint i;
+
+  stream = g_byte_array_new ();
+  g_byte_array_append (stream, (const guint8 *) "\x00\x00\x00\x01\x06", 5);
+
+  sei[0] = 0x05;
+  sei[1] = 0xfe;
+  for (i = 2; i < sizeof (sei); i++)
+    sei[i] = i % 16 == 0 ? 0x01 : 0x00;
+  append_escaped (stream, sei, sizeof (sei));
+  append_escaped (stream, frame_packing, sizeof (frame_packing));
+
+  g_byte_array_append (stream, (const guint8 *) "\x00\x00\x00\x01\x09\xf0",
+      6);
+
+  return stream;
+}
+
+static gdouble
+split_h265_stream (GByteArray * stream)
+{
+  GstH265Parser *parser;
+  GstH265NalUnit nalu;
+  gint64 start, end;
+  guint offset = 0;
+  gint n = 0;
+
+  parser = gst_h265_parser_new ();
+
+  start = g_get_monotonic_time ();
+  while (gst_h265_parser_identify_nalu (parser, stream->data, offset,
+          stream->len, &nalu) == GST_H265_PARSER_OK) {
+    offset = nalu.offset + nalu.size;
+    n++;
+  }
+  end = g_get_monotonic_time ();
+
+  gst_h265_parser_free (parser);
+
+  if (n != n_slices) {
+    g_printerr ("Found %d slices instead of %d\n", n, n_slices);
+    return -1;
+  }
+
+  return (end - start) / (gdouble) G_USEC_PER_SEC;
+}
+
+static gdouble
+parse_h264_seis (GByteArray * stream)
+{
+  GstH264NalParser *parser;
+  GstH264NalUnit nalu;
+  GArray *messages;
+  gint64 start, end;
+  gint i;
+
+  parser = gst_h264_nal_parser_new ();
+  if (gst_h264_parser_identify_nalu (parser, stream->data, 0, stream->len,
+          &nalu) != GST_H264_PARSER_OK) {
+    gst_h264_nal_parser_free (parser);
+    return -1;
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_seis; i++) {
+    if (gst_h264_parser_parse_sei (parser, &nalu, &messages) !=
+        GST_H264_PARSER_OK || messages->len != 2) {
+      g_printerr ("Failed to parse the SEI\n");
+      g_array_free (messages, TRUE);
+      gst_h264_nal_parser_free (parser);
+      return -1;
+    }
+    g_array_free (messages, TRUE);
+  }
+  end = g_get_monotonic_time ();
+
+  gst_h264_nal_parser_free (parser);
+
+  return (end - start) / (gdouble) G_USEC_PER_SEC;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"slices", 'n', 0, G_OPTION_ARG_INT, &n_slices,
+        "Number of H.265 slices to split", NULL},
+    {"slice-size", 's', 0, G_OPTION_ARG_INT, &slice_size,
+        "Size of each slice in bytes", NULL},
+    {"seis", 'e', 0, G_OPTION_ARG_INT, &n_seis,
+        "Number of H.264 SEIs to parse", NULL},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+        "Number of runs, the fastest one is reported", NULL},
+    {NULL}
+  };
+  gdouble split_best = G_MAXDOUBLE, sei_best = G_MAXDOUBLE;
+  GByteArray *h265, *sei;
+  gint i;
+
+  ctx = g_option_context_new ("- NAL splitting and parsing benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (n_slices <= 0 || slice_size < 3 || n_seis <= 0 || n_runs <= 0) {
+    g_printerr ("Invalid number of slices, slice size, SEIs or runs\n");
+    return EXIT_FAILURE;
+  }
+
+  h265 = create_h265_stream ();
+  sei = create_h264_sei ();
+
+  for (i = 0; i < n_runs; i++) {
+    gdouble split_time, sei_time;
+
+    split_time = split_h265_stream (h265);
+    sei_time = parse_h264_seis (sei);
+    if (split_time < 0 || sei_time < 0) {
+      g_byte_array_free (h265, TRUE);
+      g_byte_array_free (sei, TRUE);
+      return EXIT_FAILURE;
+    }
+
+    split_best = MIN (split_best, split_time);
+    sei_best = MIN (sei_best, sei_time);
+  }
+
+  g_print ("H.265 splitting: %9.2f MB/s (%u bytes in %.3f s)\n",
+      h265->len / split_best / 1000000.0, h265->len, split_best);
+  g_print ("H.264 SEI:       %9.0f SEIs/s of %u bytes\n",
+      n_seis / sei_best, sei->len);
+
+  g_byte_array_free (h265, TRUE);
+  g_byte_array_free (sei, TRUE);
+
+  return EXIT_SUCCESS;
+}
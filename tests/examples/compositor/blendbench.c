@@ -0,0 +1,198 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * Measures how many pixels per second the blending and filling functions
+ * of the compositor process for each of the given raw video formats (or a
+ * default list).
+ *
+ * The functions are called directly on preallocated frames of the output
+ * size, so that the numbers don't include any conversion, allocation or
+ * scheduling. Sources are blended and overlaid with an alpha of 0.5 over
+ * the whole frame.
+ */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "blend.h"
+
+typedef struct
+{
+  GstVideoFormat format;
+  BlendFunction *blend;
+  BlendFunction *overlay;
+  FillCheckerFunction *fill_checker;
+  FillColorFunction *fill_color;
+} BlendFormat;
+
+static const BlendFormat blend_formats[] = {
+  {GST_VIDEO_FORMAT_AYUV, &gst_compositor_blend_ayuv,
+      &gst_compositor_overlay_ayuv, &gst_compositor_fill_checker_ayuv,
+      &gst_compositor_fill_color_ayuv},
+  {GST_VIDEO_FORMAT_BGRA, &gst_compositor_blend_bgra,
+      &gst_compositor_overlay_bgra, &gst_compositor_fill_checker_bgra,
+      &gst_compositor_fill_color_bgra},
+  {GST_VIDEO_FORMAT_I420, &gst_compositor_blend_i420,
+      &gst_compositor_blend_i420, &gst_compositor_fill_checker_i420,
+      &gst_compositor_fill_color_i420},
+  {GST_VIDEO_FORMAT_NV12, &gst_compositor_blend_nv12,
+      &gst_compositor_blend_nv12, &gst_compositor_fill_checker_nv12,
+      &gst_compositor_fill_color_nv12},
+  {GST_VIDEO_FORMAT_Y444, &gst_compositor_blend_y444,
+      &gst_compositor_blend_y444, &gst_compositor_fill_checker_y444,
+      &gst_compositor_fill_color_y444},
+  {GST_VIDEO_FORMAT_YUY2, &gst_compositor_blend_yuy2,
+      &gst_compositor_blend_yuy2, &gst_compositor_fill_checker_yuy2,
+      &gst_compositor_fill_color_yuy2},
+  {GST_VIDEO_FORMAT_AYUV64, &gst_compositor_blend_ayuv64,
+      &gst_compositor_overlay_ayuv64, &gst_compositor_fill_checker_ayuv64,
+      &gst_compositor_fill_color_ayuv64},
+  {GST_VIDEO_FORMAT_I420_10LE, &gst_compositor_blend_i420_10le,
+      &gst_compositor_blend_i420_10le, &gst_compositor_fill_checker_i420_10le,
+      &gst_compositor_fill_color_i420_10le},
+  {GST_VIDEO_FORMAT_Y444_10LE, &gst_compositor_blend_y444_10le,
+      &gst_compositor_blend_y444_10le, &gst_compositor_fill_checker_y444_10le,
+      &gst_compositor_fill_color_y444_10le},
+  {GST_VIDEO_FORMAT_P010_10LE, &gst_compositor_blend_p010_10le,
+      &gst_compositor_blend_p010_10le, &gst_compositor_fill_checker_p010_10le,
+      &gst_compositor_fill_color_p010_10le},
+};
+
+static gint width = 1920;
+static gint height = 1080;
+static gint n_frames = 200;
+
+static void
+print_rate (const gchar * format, const gchar * what, gint64 start,
+    gint64 end)
+{
+  gdouble secs = (end - start) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("%-10s %-13s %8.2f Mpixels/s (%d frames in %.3f s)\n", format,
+      what, (gdouble) width * height * n_frames / secs / 1000000.0, n_frames,
+      secs);
+}
+
+static gboolean
+run_format (const gchar * format)
+{
+  const BlendFormat *bf = NULL;
+  GstVideoFormat vformat;
+  GstVideoInfo info;
+  GstVideoFrame src, dst;
+  GstBuffer *srcbuf, *dstbuf;
+  gint64 start;
+  guint i;
+  gint n;
+
+  vformat = gst_video_format_from_string (format);
+  for (i = 0; i < G_N_ELEMENTS (blend_formats); i++) {
+    if (blend_formats[i].format == vformat) {
+      bf = &blend_formats[i];
+      break;
+    }
+  }
+  if (!bf) {
+    g_printerr ("%s: unsupported format\n", format);
+    return FALSE;
+  }
+
+  gst_video_info_set_format (&info, vformat, width, height);
+  srcbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  dstbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_video_frame_map (&src, &info, srcbuf, GST_MAP_READWRITE);
+  gst_video_frame_map (&dst, &info, dstbuf, GST_MAP_READWRITE);
+
+  (*bf->fill_color) (&src, 0, height, 240, 128, 128);
+  (*bf->fill_checker) (&dst, 0, height);
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < n_frames; n++)
+    (*bf->fill_checker) (&dst, 0, height);
+  print_rate (format, "fill checker", start, g_get_monotonic_time ());
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < n_frames; n++)
+    (*bf->fill_color) (&dst, 0, height, 16, 128, 128);
+  print_rate (format, "fill color", start, g_get_monotonic_time ());
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < n_frames; n++)
+    (*bf->blend) (&src, 0, 0, 0.5, &dst, 0, height,
+        COMPOSITOR_BLEND_MODE_NORMAL);
+  print_rate (format, "blend", start, g_get_monotonic_time ());
+
+  start = g_get_monotonic_time ();
+  for (n = 0; n < n_frames; n++)
+    (*bf->overlay) (&src, 0, 0, 0.5, &dst, 0, height,
+        COMPOSITOR_BLEND_MODE_NORMAL);
+  print_rate (format, "overlay", start, g_get_monotonic_time ());
+
+  gst_video_frame_unmap (&dst);
+  gst_video_frame_unmap (&src);
+  gst_buffer_unref (dstbuf);
+  gst_buffer_unref (srcbuf);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar **formats = NULL;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"width", 0, 0, G_OPTION_ARG_INT, &width, "Frame width", NULL},
+    {"height", 0, 0, G_OPTION_ARG_INT, &height, "Frame height", NULL},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames per format and function", NULL},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &formats, NULL,
+        "[FORMAT...]"},
+    {NULL}
+  };
+  gboolean ok = TRUE;
+  guint i;
+
+  ctx = g_option_context_new ("- compositor blending benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  gst_compositor_init_blend ();
+
+  if (formats) {
+    for (i = 0; formats[i]; i++)
+      ok &= run_format (formats[i]);
+    g_strfreev (formats);
+  } else {
+    for (i = 0; i < G_N_ELEMENTS (blend_formats); i++)
+      ok &= run_format (gst_video_format_to_string (blend_formats[i].format));
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+/* GStreamer
+ *
+ * sectionbench.c: measures how fast PSI sections are checked and parsed
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Builds a PMT section carrying a few large descriptors, then parses copies
+ * of it over and over the way tsdemux does for each section it receives.
+ * Parsing checks the CRC32 over the whole section, while the few
+ * descriptors are cheap to parse, so this mostly measures the CRC.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <gst/gst.h>
+#include <gst/mpegts/mpegts.h>
+
+static gint n_sections = 200000;
+static gint n_descriptors = 3;
+static gint n_runs = 3;
+
+static GstMpegtsSection *
+create_pmt (void)
+{
+  GstMpegtsPMT *pmt;
+  GstMpegtsPMTStream *stream;
+  guint8 payload[250];
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (payload); i++)
+    payload[i] = i;
+
+  pmt = gst_mpegts_pmt_new ();
+  pmt->pcr_pid = 0x40;
+  pmt->program_number = 1;
+  for (i = 0; i < (guint) n_descriptors; i++)
+    g_ptr_array_add (pmt->descriptors,
+        gst_mpegts_descriptor_from_custom (0xfe, payload, sizeof (payload)));
+
+  stream = gst_mpegts_pmt_stream_new ();
+  stream->stream_type = GST_MPEGTS_STREAM_TYPE_VIDEO_H264;
+  stream->pid = 0x40;
+  g_ptr_array_add (pmt->streams, stream);
+
+  return gst_mpegts_section_from_pmt (pmt, 0x30);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"sections", 'n', 0, G_OPTION_ARG_INT, &n_sections,
+        "Number of sections to parse", NULL},
+    {"descriptors", 'd', 0, G_OPTION_ARG_INT, &n_descriptors,
+        "Number of 250 byte descriptors in the section (at most 3)", NULL},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+        "Number of runs, the fastest one is reported", NULL},
+    {NULL}
+  };
+  GstMpegtsSection *pmt;
+  gdouble best = G_MAXDOUBLE;
+  guint8 *data;
+  gsize size;
+  gint i, j;
+
+  ctx = g_option_context_new ("- PSI section parsing benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (n_sections <= 0 || n_descriptors < 0 || n_descriptors > 3
+      || n_runs <= 0) {
+    g_printerr ("Invalid number of sections, descriptors or runs\n");
+    return EXIT_FAILURE;
+  }
+
+  gst_mpegts_initialize ();
+
+  pmt = create_pmt ();
+  data = gst_mpegts_section_packetize (pmt, &size);
+  if (data == NULL) {
+    g_printerr ("Could not create the section\n");
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < n_runs; i++) {
+    gint64 start, end;
+
+    start = g_get_monotonic_time ();
+    for (j = 0; j < n_sections; j++) {
+      GstMpegtsSection *section;
+
+      section = gst_mpegts_section_new (0x30, g_memdup (data, size), size);
+      if (gst_mpegts_section_get_pmt (section) == NULL) {
+        g_printerr ("Failed to parse the section\n");
+        gst_mpegts_section_unref (section);
+        gst_mpegts_section_unref (pmt);
+        return EXIT_FAILURE;
+      }
+      gst_mpegts_section_unref (section);
+    }
+    end = g_get_monotonic_time ();
+
+    best = MIN (best, (end - start) / (gdouble) G_USEC_PER_SEC);
+  }
+
+  g_print ("%9.0f sections/s of %" G_GSIZE_FORMAT " bytes\n",
+      n_sections / best, size);
+  g_print ("%9.2f MB/s\n", n_sections * size / best / 1000000.0);
+
+  gst_mpegts_section_unref (pmt);
+
+  return EXIT_SUCCESS;
+}
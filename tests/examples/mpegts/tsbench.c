@@ -0,0 +1,355 @@
+/* GStreamer
+ *
+ * tsbench.c: measures the throughput of the MPEG-TS parser and demuxer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Writes a synthetic transport stream (PAT, PMT and one H.264 PES stream
+ * carrying the PCR) to a temporary file and measures how fast tsparse and
+ * tsdemux read through it.
+ *
+ * Garbage can be inserted between packets to measure the cost of resyncing.
+ * The statistics of the elements tell how many bytes they copied, which for
+ * tsdemux is reported per byte of elementary stream data it output.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#define TS_PACKET_SIZE 188
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x100
+/* One 30 fps frame every PACKETS_PER_FRAME packets */
+#define PACKETS_PER_FRAME 50
+#define PCR_INTERVAL 20
+#define PSI_INTERVAL 1000
+
+static gint size_mb = 256;
+static gint packet_size = TS_PACKET_SIZE;
+static gint garbage_interval = 0;
+static gint n_runs = 3;
+
+static guint32
+crc32_mpeg (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static void
+write_header (guint8 * data, guint16 pid, gboolean pusi, guint8 afc_flags,
+    guint8 * cc)
+{
+  data[0] = 0x47;
+  data[1] = (pusi ? 0x40 : 0x00) | (pid >> 8);
+  data[2] = pid & 0xff;
+  data[3] = afc_flags | (*cc & 0x0f);
+  *cc = (*cc + 1) & 0x0f;
+}
+
+static void
+write_section (guint8 * data, guint16 pid, const guint8 * section,
+    guint len, guint8 * cc)
+{
+  guint32 crc;
+
+  memset (data, 0xff, TS_PACKET_SIZE);
+  write_header (data, pid, TRUE, 0x10, cc);
+  data[4] = 0;
+  memcpy (data + 5, section, len);
+  crc = crc32_mpeg (section, len);
+  GST_WRITE_UINT32_BE (data + 5 + len, crc);
+}
+
+static void
+write_pts (guint8 * data, guint64 pts)
+{
+  data[0] = 0x21 | ((pts >> 29) & 0x0e);
+  data[1] = (pts >> 22) & 0xff;
+  data[2] = ((pts >> 14) & 0xfe) | 0x01;
+  data[3] = (pts >> 7) & 0xff;
+  data[4] = ((pts << 1) & 0xfe) | 0x01;
+}
+
+static void
+write_pcr (guint8 * data, guint64 pcr)
+{
+  guint64 base = pcr / 300;
+  guint ext = pcr % 300;
+
+  data[0] = (base >> 25) & 0xff;
+  data[1] = (base >> 17) & 0xff;
+  data[2] = (base >> 9) & 0xff;
+  data[3] = (base >> 1) & 0xff;
+  data[4] = ((base & 0x01) << 7) | 0x7e | (ext >> 8);
+  data[5] = ext & 0xff;
+}
+
+static void
+write_packet (guint8 * data, guint64 n)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00
+  };
+  static guint8 pat_cc, pmt_cc, video_cc;
+  guint64 video_n;
+  guint8 *payload;
+
+  if (n % PSI_INTERVAL == 0) {
+    write_section (data, 0, pat, sizeof (pat), &pat_cc);
+    return;
+  }
+  if (n % PSI_INTERVAL == 1) {
+    write_section (data, PMT_PID, pmt, sizeof (pmt), &pmt_cc);
+    return;
+  }
+
+  video_n = n - 2 * (n / PSI_INTERVAL + 1);
+
+  if (video_n % PCR_INTERVAL == 0) {
+    write_header (data, VIDEO_PID, video_n % PACKETS_PER_FRAME == 0, 0x30,
+        &video_cc);
+    data[4] = 7;
+    data[5] = 0x10;
+    write_pcr (data + 6, video_n * (27000000 / (30 * PACKETS_PER_FRAME)));
+    payload = data + 12;
+  } else {
+    write_header (data, VIDEO_PID, video_n % PACKETS_PER_FRAME == 0, 0x10,
+        &video_cc);
+    payload = data + 4;
+  }
+
+  memset (payload, 0, data + TS_PACKET_SIZE - payload);
+  if (video_n % PACKETS_PER_FRAME == 0) {
+    static const guint8 pes_header[] = {
+      0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0x80, 0x05
+    };
+
+    memcpy (payload, pes_header, sizeof (pes_header));
+    /* 100ms ahead of the PCR */
+    write_pts (payload + sizeof (pes_header),
+        9000 + video_n / PACKETS_PER_FRAME * 3000);
+    payload += sizeof (pes_header) + 5;
+    /* access unit delimiter followed by a filler NAL */
+    payload[3] = 0x01;
+    payload[4] = 0x09;
+    payload[5] = 0xf0;
+    payload[9] = 0x01;
+    payload[10] = 0x0c;
+  }
+}
+
+static gchar *
+write_stream (void)
+{
+  guint8 packet[208];
+  guint8 garbage[61];
+  guint64 n, n_packets;
+  gchar *filename = NULL;
+  GError *err = NULL;
+  FILE *f;
+  gint fd;
+
+  fd = g_file_open_tmp ("tsbench-XXXXXX.ts", &filename, &err);
+  if (fd < 0) {
+    g_printerr ("Could not create file: %s\n", err->message);
+    g_clear_error (&err);
+    return NULL;
+  }
+  f = fdopen (fd, "wb");
+
+  /* Garbage that contains sync bytes at the wrong places */
+  memset (garbage, 0x47, sizeof (garbage));
+
+  memset (packet, 0xff, sizeof (packet));
+  n_packets = (guint64) size_mb * 1024 * 1024 / packet_size;
+  for (n = 0; n < n_packets; n++) {
+    if (packet_size == 192) {
+      GST_WRITE_UINT32_BE (packet, n);
+      write_packet (packet + 4, n);
+    } else {
+      write_packet (packet, n);
+    }
+    fwrite (packet, packet_size, 1, f);
+
+    if (garbage_interval > 0 && n % garbage_interval == garbage_interval - 1)
+      fwrite (garbage, sizeof (garbage), 1, f);
+  }
+  fclose (f);
+
+  return filename;
+}
+
+static gboolean
+run_element (const gchar * filename, const gchar * element)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GStatBuf st;
+  gchar *desc;
+  gint64 start, end;
+  gdouble secs, best = G_MAXDOUBLE;
+  gint i;
+
+  if (g_stat (filename, &st) != 0)
+    return FALSE;
+
+  /* tsdemux only exposes pads once it saw the PMT, parse-launch links them
+   * when they appear */
+  desc = g_strdup_printf ("filesrc location=\"%s\" blocksize=%d ! %s name=ts "
+      "! fakesink sync=false", filename, 128 * 1024, element);
+
+  for (i = 0; i < n_runs; i++) {
+    pipeline = gst_parse_launch (desc, NULL);
+    if (!pipeline) {
+      g_printerr ("%s: could not create pipeline\n", element);
+      g_free (desc);
+      return FALSE;
+    }
+
+    start = g_get_monotonic_time ();
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    bus = gst_element_get_bus (pipeline);
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    end = g_get_monotonic_time ();
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      GError *err = NULL;
+
+      gst_message_parse_error (msg, &err, NULL);
+      g_printerr ("%s: %s\n", element, err->message);
+      g_clear_error (&err);
+      best = -1;
+    } else if (i == 0) {
+      GstElement *ts = gst_bin_get_by_name (GST_BIN (pipeline), "ts");
+      GstStructure *stats;
+      guint64 copied = 0, output = 0;
+      gchar *str;
+
+      g_object_get (ts, "stats", &stats, NULL);
+      str = gst_structure_to_string (stats);
+      g_print ("%s\n", str);
+      g_free (str);
+
+      gst_structure_get_uint64 (stats, "bytes-copied", &copied);
+      gst_structure_get_uint64 (stats, "bytes-output", &output);
+      if (output > 0)
+        g_print ("%-9s %9.3f bytes copied per output byte\n", element,
+            copied / (gdouble) output);
+
+      gst_structure_free (stats);
+      gst_object_unref (ts);
+    }
+
+    gst_message_unref (msg);
+    gst_object_unref (bus);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+
+    if (best < 0)
+      break;
+
+    secs = (end - start) / (gdouble) G_USEC_PER_SEC;
+    best = MIN (best, secs);
+  }
+  g_free (desc);
+
+  if (best < 0)
+    return FALSE;
+
+  g_print ("%-9s %9.2f Mbit/s (%" G_GUINT64_FORMAT " bytes in %.3f s)\n",
+      element, st.st_size * 8 / best / 1000000.0, (guint64) st.st_size, best);
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *filename;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"size", 's', 0, G_OPTION_ARG_INT, &size_mb,
+        "Size of the generated stream in MiB", NULL},
+    {"packet-size", 'p', 0, G_OPTION_ARG_INT, &packet_size,
+        "Packet size (188, 192 or 204)", NULL},
+    {"garbage-interval", 'g', 0, G_OPTION_ARG_INT, &garbage_interval,
+        "Insert garbage after every N packets (0 = never)", "N"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+        "Number of runs per element, the fastest one is reported", NULL},
+    {NULL}
+  };
+  gboolean ok;
+
+  ctx = g_option_context_new ("- MPEG-TS demuxing benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (packet_size != 188 && packet_size != 192 && packet_size != 204) {
+    g_printerr ("Unsupported packet size %d\n", packet_size);
+    return EXIT_FAILURE;
+  }
+  if (size_mb <= 0 || n_runs <= 0) {
+    g_printerr ("Size and number of runs must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  filename = write_stream ();
+  if (!filename)
+    return EXIT_FAILURE;
+
+  ok = run_element (filename, "tsparse");
+  ok &= run_element (filename, "tsdemux");
+
+  g_unlink (filename);
+  g_free (filename);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
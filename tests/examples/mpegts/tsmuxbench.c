@@ -0,0 +1,226 @@
+/* GStreamer
+ *
+ * tsmuxbench.c: measures the throughput of the MPEG-TS muxer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Feeds H.264 access units of a fixed size to mpegtsmux as fast as possible
+ * and reports the output bitrate it reaches, along with how many buffers
+ * and TS packets per second it outputs. All input buffers share the same
+ * memory, so that the source costs next to nothing.
+ *
+ * With --streams, the frames are spread over several video streams, which
+ * mpegtsmux can packetise on --threads threads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+
+static gint n_frames = 5000;
+static gint frame_size = 400000;
+static gint alignment = -1;
+static gboolean m2ts_mode = FALSE;
+static gint n_runs = 3;
+static gint n_streams = 1;
+static gint n_threads = 1;
+
+typedef struct
+{
+  guint64 bytes;
+  guint64 buffers;
+} OutputStats;
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    OutputStats * stats)
+{
+  stats->bytes += gst_buffer_get_size (buf);
+  stats->buffers++;
+}
+
+static void
+push_frames (GstElement ** srcs, guint8 * data)
+{
+  GstFlowReturn ret;
+  gint i, j;
+
+  for (i = 0; i < n_frames * n_streams; i++) {
+    GstElement *src = srcs[i % n_streams];
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, data,
+        frame_size, 0, frame_size, NULL, NULL);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) =
+        gst_util_uint64_scale (i / n_streams, GST_SECOND, 25);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+    if ((i / n_streams) % 25 != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+  }
+
+  for (j = 0; j < n_streams; j++)
+    g_signal_emit_by_name (srcs[j], "end-of-stream", &ret);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames to mux", NULL},
+    {"frame-size", 's', 0, G_OPTION_ARG_INT, &frame_size,
+        "Size of each frame in bytes", NULL},
+    {"alignment", 'a', 0, G_OPTION_ARG_INT, &alignment,
+        "mpegtsmux alignment property", NULL},
+    {"m2ts", 'm', 0, G_OPTION_ARG_NONE, &m2ts_mode,
+        "Output 192 byte M2TS packets", NULL},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs,
+        "Number of runs, the fastest one is reported", NULL},
+    {"streams", 'S', 0, G_OPTION_ARG_INT, &n_streams,
+        "Number of video streams", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "mpegtsmux n-threads property", NULL},
+    {NULL}
+  };
+  gdouble best = G_MAXDOUBLE;
+  OutputStats stats = { 0, };
+  guint8 *data;
+  gint i;
+
+  ctx = g_option_context_new ("- MPEG-TS muxing benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (n_frames <= 0 || frame_size < 16 || n_runs <= 0 || n_streams <= 0
+      || n_threads < 0) {
+    g_printerr ("Invalid number of frames, frame size, runs, streams or "
+        "threads\n");
+    return EXIT_FAILURE;
+  }
+
+  /* an access unit delimiter followed by a filler NAL */
+  data = g_malloc0 (frame_size);
+  data[3] = 0x01;
+  data[4] = 0x09;
+  data[5] = 0xf0;
+  data[9] = 0x01;
+  data[10] = 0x0c;
+
+  for (i = 0; i < n_runs; i++) {
+    GstElement *pipeline, **srcs, *mux, *sink;
+    GString *desc;
+    GstBus *bus;
+    GstMessage *msg;
+    gint64 start, end;
+    gint j;
+
+    desc = g_string_new ("mpegtsmux name=mux ! fakesink name=sink sync=false "
+        "signal-handoffs=true");
+    for (j = 0; j < n_streams; j++) {
+      g_string_append_printf (desc, " appsrc name=src%d format=time "
+          "max-bytes=0 caps=video/x-h264,stream-format=byte-stream,"
+          "alignment=au ! mux.sink_%d", j, 0x100 + j);
+    }
+    pipeline = gst_parse_launch (desc->str, &err);
+    g_string_free (desc, TRUE);
+    if (!pipeline) {
+      g_printerr ("Could not create pipeline: %s\n", err->message);
+      g_clear_error (&err);
+      g_free (data);
+      return EXIT_FAILURE;
+    }
+
+    srcs = g_new (GstElement *, n_streams);
+    for (j = 0; j < n_streams; j++) {
+      gchar *name = g_strdup_printf ("src%d", j);
+
+      srcs[j] = gst_bin_get_by_name (GST_BIN (pipeline), name);
+      g_free (name);
+    }
+    mux = gst_bin_get_by_name (GST_BIN (pipeline), "mux");
+    sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+    g_object_set (mux, "alignment", alignment, "m2ts-mode", m2ts_mode,
+        "n-threads", n_threads, NULL);
+    memset (&stats, 0, sizeof (stats));
+    g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), &stats);
+
+    /* appsrc only accepts buffers once started */
+    start = g_get_monotonic_time ();
+    gst_element_set_state (pipeline, GST_STATE_PAUSED);
+    push_frames (srcs, data);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+    bus = gst_element_get_bus (pipeline);
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    end = g_get_monotonic_time ();
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      gst_message_parse_error (msg, &err, NULL);
+      g_printerr ("%s\n", err->message);
+      g_clear_error (&err);
+      best = -1;
+    }
+
+    gst_message_unref (msg);
+    gst_object_unref (bus);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    for (j = 0; j < n_streams; j++)
+      gst_object_unref (srcs[j]);
+    g_free (srcs);
+    gst_object_unref (mux);
+    gst_object_unref (sink);
+    gst_object_unref (pipeline);
+
+    if (best < 0)
+      break;
+
+    best = MIN (best, (end - start) / (gdouble) G_USEC_PER_SEC);
+  }
+
+  g_free (data);
+
+  if (best < 0)
+    return EXIT_FAILURE;
+
+  g_print ("%9.2f Mbit/s (%" G_GUINT64_FORMAT " bytes in %.3f s)\n",
+      stats.bytes * 8 / best / 1000000.0, stats.bytes, best);
+  g_print ("%9.0f buffers/s, %" G_GUINT64_FORMAT " bytes per buffer\n",
+      stats.buffers / best, stats.buffers ? stats.bytes / stats.buffers : 0);
+  g_print ("%9.0f packets/s\n",
+      stats.bytes / (m2ts_mode ? 192 : 188) / best);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/* GStreamer
+ *
+ * shmbench.c: compares the socket and the ring transports of shmsink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Sends buffers from an shmsink to --clients shmsrc, once with the buffers
+ * announced over the control socket (ring-size=0) and once through the
+ * shared memory rings.
+ *
+ * The throughput is measured by pushing --buffers buffers as fast as
+ * possible. The latency is measured by pacing --latency-buffers buffers at
+ * --interval microseconds, like a camera would, and reports how long each
+ * one took from being pushed into the shmsink to reaching the sink behind
+ * the shmsrc.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gst/gst.h>
+
+static gint n_buffers = 100000;
+static gint buffer_size = 4096;
+static gint n_clients = 1;
+static gint ring_size = 256;
+static gint n_latency_buffers = 500;
+static gint interval = 4166;
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gint connected;
+} SinkState;
+
+typedef struct
+{
+  guint64 received;
+  gint64 latency_sum;
+  gint64 latency_min;
+  gint64 latency_max;
+} ClientStats;
+
+static void
+client_connected_cb (GstElement * sink, gint fd, SinkState * state)
+{
+  g_mutex_lock (&state->lock);
+  state->connected++;
+  g_cond_signal (&state->cond);
+  g_mutex_unlock (&state->lock);
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    ClientStats * stats)
+{
+  gint64 sent, latency;
+
+  gst_buffer_extract (buf, 0, &sent, sizeof (sent));
+  latency = g_get_monotonic_time () - sent;
+
+  stats->received++;
+  stats->latency_sum += latency;
+  stats->latency_min = MIN (stats->latency_min, latency);
+  stats->latency_max = MAX (stats->latency_max, latency);
+}
+
+static gboolean
+run (gint ring, gint count, gint pace)
+{
+  GstElement *pipeline, *src, *sink;
+  GstElement **clients;
+  ClientStats *stats;
+  SinkState state;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  GstFlowReturn ret;
+  gchar *socket_path, *desc;
+  gint64 start, end;
+  guint64 received = 0;
+  gdouble secs;
+  gint i;
+
+  socket_path = g_strdup_printf ("%s/shmbench-%d", g_get_tmp_dir (),
+      (gint) getpid ());
+  desc = g_strdup_printf ("appsrc name=src format=bytes block=true ! "
+      "shmsink name=sink socket-path=\"%s\" ring-size=%d sync=false "
+      "wait-for-connection=true", socket_path, ring);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  g_free (socket_path);
+  if (!pipeline) {
+    g_printerr ("Could not create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  g_mutex_init (&state.lock);
+  g_cond_init (&state.cond);
+  state.connected = 0;
+  g_signal_connect (sink, "client-connected",
+      G_CALLBACK (client_connected_cb), &state);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  /* shmsink picks another path if this one is in use */
+  g_object_get (sink, "socket-path", &socket_path, NULL);
+
+  clients = g_new0 (GstElement *, n_clients);
+  stats = g_new0 (ClientStats, n_clients);
+  for (i = 0; i < n_clients; i++) {
+    GstElement *fakesink;
+
+    desc = g_strdup_printf ("shmsrc socket-path=\"%s\" ! fakesink name=sink "
+        "sync=false signal-handoffs=true", socket_path);
+    clients[i] = gst_parse_launch (desc, NULL);
+    g_free (desc);
+
+    stats[i].latency_min = G_MAXINT64;
+    fakesink = gst_bin_get_by_name (GST_BIN (clients[i]), "sink");
+    g_signal_connect (fakesink, "handoff", G_CALLBACK (handoff_cb), &stats[i]);
+    gst_object_unref (fakesink);
+
+    gst_element_set_state (clients[i], GST_STATE_PLAYING);
+  }
+  g_free (socket_path);
+
+  g_mutex_lock (&state.lock);
+  while (state.connected < n_clients)
+    g_cond_wait (&state.cond, &state.lock);
+  g_mutex_unlock (&state.lock);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < count; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, buffer_size, NULL);
+    gint64 now = g_get_monotonic_time ();
+
+    gst_buffer_fill (buf, 0, &now, sizeof (now));
+    g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+
+    if (pace > 0)
+      g_usleep (pace);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &ret);
+
+  /* shmsink only posts EOS once the clients released all buffers */
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = g_get_monotonic_time ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("%s\n", err->message);
+    g_clear_error (&err);
+  }
+
+  for (i = 0; i < n_clients; i++) {
+    gst_element_set_state (clients[i], GST_STATE_NULL);
+    gst_object_unref (clients[i]);
+  }
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  secs = (end - start) / (gdouble) G_USEC_PER_SEC;
+  for (i = 0; i < n_clients; i++)
+    received += stats[i].received;
+
+  if (pace == 0) {
+    g_print ("%-7s %9.0f buffers/s %9.2f MB/s, %" G_GUINT64_FORMAT
+        " of %d buffers received\n", ring ? "ring" : "socket",
+        received / secs, received * buffer_size / secs / (1024 * 1024),
+        received, count * n_clients);
+  } else {
+    gint64 sum = 0, min = G_MAXINT64, max = 0;
+
+    for (i = 0; i < n_clients; i++) {
+      sum += stats[i].latency_sum;
+      min = MIN (min, stats[i].latency_min);
+      max = MAX (max, stats[i].latency_max);
+    }
+
+    g_print ("%-7s latency min %" G_GINT64_FORMAT " us, avg %.1f us, max %"
+        G_GINT64_FORMAT " us\n", ring ? "ring" : "socket", min,
+        received ? sum / (gdouble) received : 0.0, max);
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+  g_free (clients);
+  g_free (stats);
+  g_mutex_clear (&state.lock);
+  g_cond_clear (&state.cond);
+
+  return received > 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &n_buffers,
+        "Number of buffers for the throughput test", NULL},
+    {"size", 's', 0, G_OPTION_ARG_INT, &buffer_size,
+        "Size of each buffer in bytes", NULL},
+    {"clients", 'c', 0, G_OPTION_ARG_INT, &n_clients,
+        "Number of shmsrc receiving the buffers", NULL},
+    {"ring-size", 'r', 0, G_OPTION_ARG_INT, &ring_size,
+        "shmsink ring-size property for the ring transport", NULL},
+    {"latency-buffers", 'l', 0, G_OPTION_ARG_INT, &n_latency_buffers,
+        "Number of buffers for the latency test (0 = skip it)", NULL},
+    {"interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+        "Interval between the buffers of the latency test in microseconds",
+        NULL},
+    {NULL}
+  };
+  gboolean ok = TRUE;
+  gint i;
+
+  ctx = g_option_context_new ("- shm transport benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (n_buffers <= 0 || buffer_size < (gint) sizeof (gint64) ||
+      n_clients <= 0 || ring_size <= 0 || n_latency_buffers < 0 ||
+      interval <= 0) {
+    g_printerr ("Invalid number of buffers, size, clients, ring size or "
+        "interval\n");
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 2 && ok; i++)
+    ok = run (i == 0 ? 0 : ring_size, n_buffers, 0);
+
+  for (i = 0; i < 2 && ok && n_latency_buffers > 0; i++)
+    ok = run (i == 0 ? 0 : ring_size, n_latency_buffers, interval);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
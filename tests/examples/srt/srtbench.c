@@ -0,0 +1,201 @@
+/* GStreamer
+ *
+ * srtbench.c: measures the CPU cost of receiving SRT with srtclientsrc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Sends --bitrate Mbit/s of 1316 byte messages from an srtserversink to an
+ * srtclientsrc over the loopback interface for --seconds seconds, once
+ * receiving one message per buffer, once with batch-size=--batch-size and
+ * once with merge=true as well.
+ *
+ * The CPU time is that of the streaming thread of srtclientsrc, which is
+ * the one the batching saves wakeups and allocations in, and is reported
+ * per Mbit received.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gst/gst.h>
+
+#define MESSAGE_SIZE 1316
+
+static gint bitrate = 50;
+static gint seconds = 10;
+static gint batch_size = 64;
+static gint port = 7001;
+
+typedef struct
+{
+  guint64 bytes;
+  guint64 buffers;
+  gint64 cpu_start;
+  gint64 cpu_end;
+} ReceiverStats;
+
+static gint64
+thread_cpu_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    ReceiverStats * stats)
+{
+  if (stats->buffers == 0)
+    stats->cpu_start = thread_cpu_time ();
+  else
+    stats->cpu_end = thread_cpu_time ();
+
+  stats->bytes += gst_buffer_get_size (buf);
+  stats->buffers++;
+}
+
+static gboolean
+run (const gchar * name, guint batch, gboolean merge)
+{
+  GstElement *sender, *receiver, *src, *sink;
+  ReceiverStats stats = { 0, };
+  GError *err = NULL;
+  GstFlowReturn ret;
+  GstBuffer *buf;
+  gchar *desc;
+  gint64 start, next, interval;
+  guint64 sent = 0;
+  gdouble mbits, cpu_ms;
+
+  desc = g_strdup_printf ("appsrc name=src format=bytes is-live=true ! "
+      "srtserversink uri=srt://:%d poll-timeout=100 sync=false", port);
+  sender = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!sender) {
+    g_printerr ("Could not create sender: %s\n", err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  desc = g_strdup_printf ("srtclientsrc uri=srt://127.0.0.1:%d "
+      "batch-size=%u merge=%d ! fakesink name=sink sync=false "
+      "signal-handoffs=true", port, batch, merge);
+  receiver = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!receiver) {
+    g_printerr ("Could not create receiver: %s\n", err->message);
+    g_clear_error (&err);
+    gst_object_unref (sender);
+    return FALSE;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (sender), "src");
+  sink = gst_bin_get_by_name (GST_BIN (receiver), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), &stats);
+
+  gst_element_set_state (sender, GST_STATE_PLAYING);
+  gst_element_get_state (sender, NULL, NULL, GST_CLOCK_TIME_NONE);
+  gst_element_set_state (receiver, GST_STATE_PLAYING);
+
+  /* srtclientsrc connects when starting */
+  g_usleep (G_USEC_PER_SEC / 2);
+
+  /* Send the messages of each millisecond in one go */
+  buf = gst_buffer_new_allocate (NULL, MESSAGE_SIZE, NULL);
+  gst_buffer_memset (buf, 0, 0x47, MESSAGE_SIZE);
+  interval = 1000;
+  start = next = g_get_monotonic_time ();
+  while (next - start < (gint64) seconds * G_USEC_PER_SEC) {
+    guint64 due = (next - start + interval) * bitrate / 8 / MESSAGE_SIZE;
+
+    for (; sent < due; sent++)
+      g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+
+    next += interval;
+    if (next > g_get_monotonic_time ())
+      g_usleep (next - g_get_monotonic_time ());
+  }
+  gst_buffer_unref (buf);
+
+  /* Let the receiver catch up with the latency of SRT */
+  g_usleep (G_USEC_PER_SEC / 2);
+
+  gst_element_set_state (receiver, GST_STATE_NULL);
+  gst_element_set_state (sender, GST_STATE_NULL);
+
+  mbits = stats.bytes * 8 / 1000000.0;
+  cpu_ms = (stats.cpu_end - stats.cpu_start) / 1000000.0;
+  g_print ("%-12s %8.1f Mbit in %" G_GUINT64_FORMAT " buffers, %8.1f ms CPU, "
+      "%6.3f ms/Mbit\n", name, mbits, stats.buffers, cpu_ms,
+      mbits > 0 ? cpu_ms / mbits : 0.0);
+
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (sender);
+  gst_object_unref (receiver);
+
+  return stats.bytes > 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GOptionEntry options[] = {
+    {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+        "Bitrate to send in Mbit/s", NULL},
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &seconds,
+        "Duration of each run in seconds", NULL},
+    {"batch-size", 'n', 0, G_OPTION_ARG_INT, &batch_size,
+        "srtclientsrc batch-size property for the batched runs", NULL},
+    {"port", 'p', 0, G_OPTION_ARG_INT, &port,
+        "Loopback port to use", NULL},
+    {NULL}
+  };
+  gboolean ok;
+
+  ctx = g_option_context_new ("- SRT receive benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free (ctx);
+
+  if (bitrate <= 0 || seconds <= 0 || batch_size <= 0 || port <= 0) {
+    g_printerr ("Invalid bitrate, duration, batch size or port\n");
+    return EXIT_FAILURE;
+  }
+
+  ok = run ("single", 1, FALSE);
+  ok = ok && run ("batched", batch_size, FALSE);
+  ok = ok && run ("merged", batch_size, TRUE);
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}